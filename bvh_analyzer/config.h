@@ -31,6 +31,7 @@ enum class BvhType
 {
     kBvh2,
     kVkBvh2,
+    kVkBvh4,
     kDx12Bvh2
 };
 
@@ -38,6 +39,7 @@ namespace
 {
 static std::map<std::string, BvhType> s_str_to_type = {{"bvh2", BvhType::kBvh2},
                                                        {"vkbvh2", BvhType::kVkBvh2},
+                                                       {"vkbvh4", BvhType::kVkBvh4},
                                                        {"dx12bvh2", BvhType::kDx12Bvh2}};
 }
 
@@ -86,6 +86,23 @@ int main(int argc, char** argv)
             bvh2.TransformBvh(bvh::Transform2<bvh::VkBvhNode>, vk_bvh.data(), nullptr);
             stats = bvh2.CheckQuality(rays, cfg.ray_width, cfg.ray_height, bvh::QueryType::kClosestHit, hits);
         }
+        if (cfg.type == bvh::BvhType::kVkBvh4)
+        {
+            // The whole geometry is read, wide nodes follow the binary ones.
+            if (cfg.triangle_size < 2)
+            {
+                throw std::runtime_error("Wide bvh needs at least 2 triangles");
+            }
+            std::vector<bvh::VkBvhNode> vk_bvh(bvh::GetVkBvh4NodeCount(cfg.triangle_size));
+            if (GetStreamLength(in_bvh) < vk_bvh.size() * sizeof(bvh::VkBvhNode))
+            {
+                throw std::runtime_error("Bvh file contains less nodes than declared");
+            }
+            in_bvh.read((char*)vk_bvh.data(), vk_bvh.size() * sizeof(bvh::VkBvhNode));
+            bvh::Bvh<4u> bvh4(bvh::GetVkBvh4WideNodeCount(vk_bvh.data(), cfg.triangle_size), cfg.triangle_size);
+            bvh4.TransformBvh(bvh::TransformVkBvh4, vk_bvh.data(), nullptr);
+            stats = bvh4.CheckQuality(rays, cfg.ray_width, cfg.ray_height, bvh::QueryType::kClosestHit, hits);
+        }
         in_bvh.close();
         in_ray.close();
     } catch (std::exception& e)
@@ -124,4 +124,85 @@ void Transform2(void const* in_nodes, void const*, BvhNode<2>* nodes, Triangle*
     }
 }
 
+// Wide nodes of a Vulkan geometry built with RR_BUILD_FLAG_BITS_WIDE_BVH follow the binary nodes, starting at node
+// 2 * triangle_size. A wide node takes 2 binary nodes holding 2 children each, leaf children point to binary leaves
+// and the binary root keeps the first node of the wide root in its update field.
+constexpr uint32_t kVkBvh4LeafBit = 0x80000000u;
+
+inline size_t GetVkBvh4NodeCount(size_t triangle_size) { return 4 * triangle_size - 2; }
+
+// Wide nodes are collapsed from even levels of the binary tree.
+inline size_t GetVkBvh4WideNodeCount(void const* in_nodes, size_t triangle_size)
+{
+    auto                                      bvh_nodes = reinterpret_cast<VkBvhNode const*>(in_nodes);
+    size_t                                    count     = 0;
+    std::queue<std::pair<uint32_t, uint32_t>> q;
+    q.push({0u, 0u});
+    while (!q.empty())
+    {
+        auto addr  = q.front().first;
+        auto depth = q.front().second;
+        q.pop();
+        if (addr < triangle_size - 1)
+        {
+            count += depth % 2 == 0 ? 1 : 0;
+            q.push({bvh_nodes[addr].child0, depth + 1});
+            q.push({bvh_nodes[addr].child1, depth + 1});
+        }
+    }
+    return count;
+}
+
+inline void TransformVkBvh4(void const* in_nodes, void const*, BvhNode<4>* nodes, Triangle* triangles, size_t, size_t)
+{
+    auto bvh_nodes = reinterpret_cast<VkBvhNode const*>(in_nodes);
+    // Wide node address, output index and output parent index.
+    std::queue<std::tuple<uint32_t, uint32_t, uint32_t>> q;
+    uint32_t                                             out_node_idx     = 0;
+    uint32_t                                             out_triangle_idx = 0;
+    q.push({bvh_nodes[0].update, out_node_idx++, kInvalidID});
+    while (!q.empty())
+    {
+        auto in_addr    = std::get<0>(q.front());
+        auto out_addr   = std::get<1>(q.front());
+        auto out_parent = std::get<2>(q.front());
+        q.pop();
+
+        auto& node          = nodes[out_addr];
+        node.children_count = 0;
+        node.parent         = out_parent;
+        node.flag           = 0;
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            auto const& half  = bvh_nodes[in_addr + i / 2];
+            auto        child = i % 2 == 0 ? half.child0 : half.child1;
+            if (child == kInvalidID)
+            {
+                continue;
+            }
+            float const* min = i % 2 == 0 ? half.aabb0_min_or_v0 : half.aabb1_min_or_v2;
+            float const* max = i % 2 == 0 ? half.aabb0_max_or_v1 : half.aabb1_max_or_v3;
+
+            auto slot                   = node.children_count++;
+            node.children_aabb[slot]    = {float3(min[0], min[1], min[2]), float3(max[0], max[1], max[2])};
+            node.children_is_prim[slot] = (child & kVkBvh4LeafBit) != 0;
+            if (node.children_is_prim[slot])
+            {
+                auto const& leaf = bvh_nodes[child & ~kVkBvh4LeafBit];
+                auto&       tri  = triangles[out_triangle_idx];
+                tri.v0           = float3(leaf.aabb0_min_or_v0[0], leaf.aabb0_min_or_v0[1], leaf.aabb0_min_or_v0[2]);
+                tri.v1           = float3(leaf.aabb0_max_or_v1[0], leaf.aabb0_max_or_v1[1], leaf.aabb0_max_or_v1[2]);
+                tri.v2           = float3(leaf.aabb1_min_or_v2[0], leaf.aabb1_min_or_v2[1], leaf.aabb1_min_or_v2[2]);
+                tri.prim_id      = leaf.child1;
+
+                node.children_addr[slot] = out_triangle_idx++;
+            } else
+            {
+                node.children_addr[slot] = out_node_idx;
+                q.push({child, out_node_idx++, out_addr});
+            }
+        }
+    }
+}
+
 }  // namespace bvh
@@ -44,6 +44,8 @@ struct _RRCommandStream;
 
 typedef uint32_t                 RRBuildFlags;
 typedef uint32_t                 RRRayMask;
+typedef uint32_t                 RRRayFlags;
+typedef uint32_t                 RRContextFlags;
 typedef struct _RRDevicePtr*     RRDevicePtr;
 typedef struct _RRContext*       RRContext;
 typedef struct _RREvent*         RREvent;
@@ -73,6 +75,20 @@ typedef enum
     RR_API_VK     = 2
 } RRApi;
 
+/** @brief Context creation flags
+ *
+ * RR_CONTEXT_FLAG_BITS_PERSISTENT_THREADS traces binary BVHs with a fixed number of groups
+ * fetching rays from a work counter instead of one thread per ray. Ignored by DX12 contexts.
+ * RR_CONTEXT_FLAG_BITS_PROFILING brackets every kernel dispatch with GPU timestamps,
+ * see rrGetProfilingResults. Ignored by DX12 contexts.
+ */
+typedef enum
+{
+    RR_CONTEXT_FLAG_BITS_NONE               = 0,
+    RR_CONTEXT_FLAG_BITS_PERSISTENT_THREADS = 1,
+    RR_CONTEXT_FLAG_BITS_PROFILING          = 2
+} RRContextFlagBits;
+
 typedef enum
 {
     RR_LOG_LEVEL_DEBUG = 1,
@@ -101,7 +117,17 @@ typedef enum
 typedef enum
 {
     RR_BUILD_FLAG_BITS_PREFER_FAST_BUILD = 1,
-    RR_BUILD_FLAG_BITS_ALLOW_UPDATE      = 2
+    RR_BUILD_FLAG_BITS_ALLOW_UPDATE      = 2,
+    /*!< Store a 4-wide BVH next to the binary one and trace it with the wide kernels.
+     * Geometry builds on the Vulkan backend only, requires extra memory reported by the memory requirements query.
+     */
+    RR_BUILD_FLAG_BITS_WIDE_BVH = 4,
+    /*!< Build scenes of up to 1024 instances with a binned SAH tree on the host. Geometry builds with the flag
+     * write their bounds to host visible memory, scene builds with the flag read them and fail if a geometry was
+     * built without it or its build has not completed yet. Copies, updates and deserialized geometries keep the
+     * flag of the geometry they come from. Vulkan backend only.
+     */
+    RR_BUILD_FLAG_BITS_HOST_SCENE_BUILD = 8
 } RRBuildFlagBits;
 
 /** @brief Geometric primitive type.
@@ -134,33 +160,119 @@ typedef enum
     RR_INTERSECT_QUERY_ANY     = 1
 } RRIntersectQuery;
 
+/** @brief Flags combined with the query type of rrCmdIntersect.
+ *
+ * RR_INTERSECT_QUERY_FLAG_BITS_REORDER_RAYS sorts rays by direction and origin before tracing them and moves
+ * the hits back to the original ray order afterwards. It makes traversal of incoherent rays more coherent
+ * at the cost of the sort, the scratch buffer has to be sized with rrGetReorderedTraceMemoryRequirements.
+ * Backends which do not reorder rays ignore the flag.
+ */
+typedef enum
+{
+    RR_INTERSECT_QUERY_FLAG_BITS_REORDER_RAYS = 0x100
+} RRIntersectQueryFlagBits;
+
 /** @brief Output type for rrIntersect
+ *
+ * AABB list primitives are only reported by RR_INTERSECT_QUERY_OUTPUT_CANDIDATES,
+ * the other outputs only report triangles.
+ * RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT writes one bit per ray, set if the ray hits anything:
+ * bit i % 32 of the 32-bit word i / 32 for ray i. The hit buffer holds (ray_count + 31) / 32 words
+ * and the query type is ignored, rays are traced as any queries.
+ * RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL writes RRHitWithNormal instead of RRHit.
  */
 typedef enum
 {
     RR_INTERSECT_QUERY_OUTPUT_FULL_HIT,
-    RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID
+    RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID,
+    RR_INTERSECT_QUERY_OUTPUT_CANDIDATES,
+    RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT,
+    RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL
 } RRIntersectQueryOutput;
 
+/** @brief Per-ray traversal flags.
+ *
+ * Triangles are front facing when their vertices are seen counter-clockwise from the ray origin.
+ * Accepting the first hit turns a closest query into an any query for the ray.
+ */
+typedef enum
+{
+    RR_RAY_FLAG_BITS_NONE                            = 0,
+    RR_RAY_FLAG_BITS_CULL_BACK_FACING_TRIANGLES      = 1,
+    RR_RAY_FLAG_BITS_CULL_FRONT_FACING_TRIANGLES     = 2,
+    RR_RAY_FLAG_BITS_ACCEPT_FIRST_HIT_AND_END_SEARCH = 4,
+    RR_RAY_FLAG_BITS_SKIP_TRIANGLES                  = 8,
+    RR_RAY_FLAG_BITS_SKIP_AABBS                      = 16
+} RRRayFlagBits;
+
 /** @brief Ray description for rrIntersect
+ *
+ * mask is tested against instance masks when tracing scenes, see RRSceneBuildInput, 0 disables masking.
+ * Geometries are traced regardless of the mask. flags is a combination of RRRayFlagBits.
  */
 typedef struct
 {
-    float origin[3];
-    float min_t;
-    float direction[3];
-    float max_t;
+    float      origin[3];
+    float      min_t;
+    float      direction[3];
+    float      max_t;
+    RRRayMask  mask;
+    RRRayFlags flags;
+    uint32_t   padding[2];
 } RRRay;
 
 /** @brief Hit description for full hit results of rrIntersect
+ *
+ * prim_id is the triangle index within the triangle mesh primitive geom_id of the geometry.
+ * t is the hit distance along the ray in units of the ray direction length.
  */
 typedef struct
 {
     float    uv[2];
     uint32_t inst_id;
     uint32_t prim_id;
+    uint32_t geom_id;
+    float    t;
 } RRHit;
 
+/** @brief Hit description for RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL results of rrIntersect
+ *
+ * The first members match RRHit. normal is the unit geometric normal of the hit triangle in world space,
+ * pointing to the side its vertices are seen counter-clockwise from.
+ */
+typedef struct
+{
+    float    uv[2];
+    uint32_t inst_id;
+    uint32_t prim_id;
+    uint32_t geom_id;
+    float    t;
+    float    normal[3];
+    uint32_t padding;
+} RRHitWithNormal;
+
+/** @brief Number of RRCandidateHit entries written per ray. */
+#define RR_MAX_CANDIDATE_HITS 4
+
+/** @brief Hit description for candidate results of rrIntersect
+ *
+ * Each ray gets RR_MAX_CANDIDATE_HITS entries sorted by t_entry, unused entries have inst_id set to ~0u.
+ * AABB primitives the ray passes through are reported with the ray interval inside the box,
+ * to be intersected by the user. Triangles are reported with t_entry == t_exit and occlude
+ * farther candidates. Closest queries keep the nearest candidates, any queries stop at the first
+ * triangle hit and report it alone. Rays with more candidates can be traced again starting from
+ * the last t_entry.
+ */
+typedef struct
+{
+    float    t_entry;
+    float    t_exit;
+    uint32_t inst_id;
+    uint32_t prim_id;
+    uint32_t geom_id;
+    uint32_t padding;
+} RRCandidateHit;
+
 /** @brief Various flags controlling scene/geometry build process.
  */
 typedef struct
@@ -214,7 +326,7 @@ typedef struct
 {
     /*!< Defines the following union */
     RRPrimitiveType primitive_type;
-    /*!< Number of primitives in the aRRay */
+    /*!< Number of primitives in the aRRay, triangle meshes of a geometry are reported by RRHit::geom_id */
 
     uint32_t primitive_count;
     union
@@ -229,6 +341,7 @@ typedef struct
 {
     RRDevicePtr geometry;
     float       transform[3][4];
+    RRRayMask   mask;
 } RRInstance;
 
 /** @brief Build input for the scene.
@@ -242,6 +355,13 @@ typedef struct
  * matrices (essentially implementing instancing). Mask is used to implement ray
  * masking: ray mask is bitwise &ded with an instance mask and no intersections
  * are evaluated with the primitive of corresponding instance if the result is 0.
+ * The test is done at the top level, so masked out instances are skipped as a whole.
+ * A zero mask, ray or instance, disables masking, so zero-initialized rays and
+ * instances stay visible to each other.
+ *
+ * Instance geometries may live in at most RR_MAX_GEOMETRY_BUFFERS distinct buffers.
+ * Geometries placed at offsets of one buffer that are multiples of 64 bytes count once,
+ * so scenes with more geometries have to pack them into shared buffers.
  */
 typedef struct
 {
@@ -251,6 +371,9 @@ typedef struct
     uint32_t instance_count;
 } RRSceneBuildInput;
 
+/** @brief Max number of distinct buffers holding the geometries of a scene, see RRSceneBuildInput. */
+#define RR_MAX_GEOMETRY_BUFFERS 2048
+
 typedef struct
 {
     size_t temporary_build_buffer_size;
@@ -258,6 +381,62 @@ typedef struct
     size_t result_buffer_size;
 } RRMemoryRequirements;
 
+/** @brief Size of RRProfilingResult names including the terminating null. */
+#define RR_PROFILING_NAME_SIZE 64
+
+/** @brief GPU time spent in the dispatches of a kernel, see rrGetProfilingResults.
+ *
+ * name is the kernel name, e.g. lbvh_emit_hierarchy_mesh or radix_sort_scatter_keys.
+ */
+typedef struct
+{
+    char     name[RR_PROFILING_NAME_SIZE];
+    uint32_t dispatch_count;
+    float    duration_ms;
+} RRProfilingResult;
+
+/** @brief Identifies serialized acceleration structures ("RRAS" in memory order). */
+#define RR_SERIALIZED_MAGIC 0x53415252u
+/** @brief Version of the serialized format, bumped on any change of the node or scene layout. */
+#define RR_SERIALIZED_VERSION 1u
+
+/** @brief Type of a serialized acceleration structure.
+ */
+typedef enum
+{
+    RR_SERIALIZED_TYPE_GEOMETRY = 0,
+    RR_SERIALIZED_TYPE_SCENE    = 1
+} RRSerializedType;
+
+/** @brief Header of serialized acceleration structures.
+ *
+ * Serialized data starts with the header, followed by the contents of the geometry or scene buffer.
+ * Nodes address each other relative to the first node and geometries referenced by a scene are supplied
+ * on deserialization, so the data can be stored to disk and loaded on any device.
+ * Bounds of the acceleration structure are the union of the two child boxes of its root node, the first
+ * node of the data. They are written by the GPU during serialization, in the local space of a geometry
+ * and in world space for a scene, so loaders can cull or place acceleration structures from the header alone.
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t type;
+    /*!< Number of BVH nodes of the acceleration structure */
+    uint32_t node_count;
+    /*!< Number of instances of a scene, 0 for geometries */
+    uint32_t instance_count;
+    /*!< Size of data following the header in bytes */
+    uint32_t data_size;
+    /*!< RRBuildFlagBits the acceleration structure layout depends on, and the host scene build flag */
+    uint32_t build_flags;
+    /*!< Min corner of the acceleration structure bounds */
+    float    bounds_min[3];
+    /*!< Max corner of the acceleration structure bounds */
+    float    bounds_max[3];
+    uint32_t padding[3];
+} RRSerializedHeader;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -275,6 +454,18 @@ extern "C" {
  */
 RR_API RRError rrCreateContext(uint32_t api_version, RRApi api, RRContext* context);
 
+/** @brief Create RR API context with creation flags.
+ *
+ * Same as rrCreateContext, flags select optional intersector behavior.
+ *
+ * @param api_version API version.
+ * @param api API to use.
+ * @param flags Combination of RRContextFlagBits.
+ * @param context Created context.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrCreateContextWithFlags(uint32_t api_version, RRApi api, RRContextFlags flags, RRContext* context);
+
 /** @brief Destory RR API context.
  *
  * Destroys all the global resources used by RR session. Further calls
@@ -340,13 +531,92 @@ RR_API RRError rrGetGeometryBuildMemoryRequirements(RRContext
                                                     const RRBuildOptions*       build_options,
                                                     RRMemoryRequirements*       memory_requirements);
 
+/** @brief Build a batch of geometries.
+ *
+ * Builds RRGeometries for a number of triangle meshes at once. Primitives of all
+ * geometries are processed by shared dispatches, which is much faster than a series
+ * of rrCmdBuildGeometry calls for many small meshes. Each build input has to describe
+ * a single non-empty triangle mesh. Each geometry buffer has to be at least the
+ * result_buffer_size rrGetGeometryBuildMemoryRequirements reports for its input.
+ *
+ * @param context RR API context.
+ * @param geometry_count Number of geometries to build.
+ * @param build_inputs Array of geometry_count build inputs.
+ * @param build_options Various flags controlling build process.
+ * @param temporary_buffer Temporary buffer for the whole batch.
+ * @param geometry_buffers Array of geometry_count buffers to put geometries to.
+ * @param command_stream Command stream to write command into.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrCmdBuildGeometries(RRContext                   context,
+                                    uint32_t                    geometry_count,
+                                    const RRGeometryBuildInput* build_inputs,
+                                    const RRBuildOptions*       build_options,
+                                    RRDevicePtr                 temporary_buffer,
+                                    const RRDevicePtr*          geometry_buffers,
+                                    RRCommandStream             command_stream);
+
+/** @brief Get memory requirements for a batched geometry build.
+ *
+ * temporary_build_buffer_size is the size of the temporary buffer for the whole batch,
+ * result_buffer_size is the sum of result sizes of all geometries.
+ *
+ * @param context RR API context.
+ * @param geometry_count Number of geometries to build.
+ * @param build_inputs Array of geometry_count build inputs.
+ * @param build_options Various flags controlling build process.
+ * @param memory_requirements Pointer to write result to.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrGetGeometriesBuildMemoryRequirements(RRContext                   context,
+                                                      uint32_t                    geometry_count,
+                                                      const RRGeometryBuildInput* build_inputs,
+                                                      const RRBuildOptions*       build_options,
+                                                      RRMemoryRequirements*       memory_requirements);
+
+/** @brief Get the compacted size of a geometry.
+ *
+ * Reports the number of bytes a built geometry actually occupies in its buffer, which is at most
+ * result_buffer_size of its build input. The size is known as soon as the build command is recorded.
+ * Geometries are tracked by the buffer and offset they were built or copied to.
+ *
+ * @param context RR API context.
+ * @param geometry Buffer holding the geometry.
+ * @param compacted_size Pointer to write result to.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrGetGeometryCompactedSize(RRContext context, RRDevicePtr geometry, size_t* compacted_size);
+
+/** @brief Copy a geometry to another buffer.
+ *
+ * Copies the geometry into a buffer of its compacted size, so it no longer occupies the
+ * result_buffer_size reserved for the build. The copy can be traced, updated and copied again
+ * like the source. Scenes keep referencing the geometry they were built with, so they have
+ * to be rebuilt to use the copy.
+ *
+ * @param context RR API context.
+ * @param src_geometry Buffer holding the geometry.
+ * @param dst_geometry Buffer to copy the geometry to, at least rrGetGeometryCompactedSize bytes.
+ * @param command_stream Command stream to write command into.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrCmdCopyGeometry(RRContext       context,
+                                 RRDevicePtr     src_geometry,
+                                 RRDevicePtr     dst_geometry,
+                                 RRCommandStream command_stream);
+
 /** @brief Build or update a scene.
  *
  * Given a number of RRGeometries from the client, this function builds
  * RRScene representing top level acceleration structure topology (in case of
  * a build) or updates acceleration structure keeping topology intact (update).
+ * An update refits the scene to new instance transforms and requires the same
+ * instance count as the build; it needs no temporary buffer.
+ * The instance geometries must be packed into at most RR_MAX_GEOMETRY_BUFFERS buffers,
+ * the build fails with RR_ERROR_INTERNAL otherwise.
  *
  * @param context RR API context.
+ * @param build_operation Type of build operation.
  * @param build_input Decribes input geometires to build scene for.
  * @param build_options Various flags controlling build process.
  * @param temporary_buffer Temporary buffer for build operation.
@@ -355,6 +625,7 @@ RR_API RRError rrGetGeometryBuildMemoryRequirements(RRContext
  * @return Error in case of a failure, RRSuccess otherwise.
  */
 RR_API RRError rrCmdBuildScene(RRContext                context,
+                               RRBuildOperation         build_operation,
                                const RRSceneBuildInput* build_input,
                                const RRBuildOptions*    build_options,
                                RRDevicePtr              temporary_buffer,
@@ -374,11 +645,96 @@ RR_API RRError rrGetSceneBuildMemoryRequirements(RRContext                contex
                                                  const RRBuildOptions*    build_options,
                                                  RRMemoryRequirements*    memory_requirements);
 
+/** @brief Get the size of a serialized geometry or scene.
+ *
+ * @param context RR API context.
+ * @param acceleration_structure Buffer holding a geometry or a scene.
+ * @param serialized_size Pointer to write result to, including RRSerializedHeader.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrGetSerializedSize(RRContext context, RRDevicePtr acceleration_structure, size_t* serialized_size);
+
+/** @brief Serialize a geometry.
+ *
+ * Writes RRSerializedHeader followed by the geometry nodes to serialized_buffer,
+ * to be mapped once the command stream completes.
+ *
+ * @param context RR API context.
+ * @param geometry Buffer holding the geometry.
+ * @param serialized_buffer Buffer to write serialized data to, at least rrGetSerializedSize bytes.
+ * @param command_stream Command stream to write command into.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrCmdSerializeGeometry(RRContext       context,
+                                      RRDevicePtr     geometry,
+                                      RRDevicePtr     serialized_buffer,
+                                      RRCommandStream command_stream);
+
+/** @brief Deserialize a geometry.
+ *
+ * Serialized data is read from host memory when the command is recorded, it is rejected
+ * if the header does not match RR_SERIALIZED_MAGIC, RR_SERIALIZED_VERSION or the geometry type,
+ * or if serialized_size is smaller than the header and the data size it declares.
+ *
+ * @param context RR API context.
+ * @param serialized_data Data written by rrCmdSerializeGeometry.
+ * @param serialized_size Size of serialized_data in bytes.
+ * @param geometry Buffer to put geometry to, at least node_count * 64 bytes of the header.
+ * @param command_stream Command stream to write command into.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrCmdDeserializeGeometry(RRContext       context,
+                                        const void*     serialized_data,
+                                        size_t          serialized_size,
+                                        RRDevicePtr     geometry,
+                                        RRCommandStream command_stream);
+
+/** @brief Serialize a scene.
+ *
+ * Writes RRSerializedHeader followed by the scene buffer to serialized_buffer, to be mapped
+ * once the command stream completes. Geometries referenced by the scene are not included.
+ *
+ * @param context RR API context.
+ * @param scene Buffer holding the scene.
+ * @param serialized_buffer Buffer to write serialized data to, at least rrGetSerializedSize bytes.
+ * @param command_stream Command stream to write command into.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrCmdSerializeScene(RRContext       context,
+                                   RRDevicePtr     scene,
+                                   RRDevicePtr     serialized_buffer,
+                                   RRCommandStream command_stream);
+
+/** @brief Deserialize a scene.
+ *
+ * Serialized data is read from host memory when the command is recorded, it is rejected if the header
+ * does not match RR_SERIALIZED_MAGIC, RR_SERIALIZED_VERSION or the scene type, or if serialized_size
+ * is smaller than the header and the data size it declares. Instance i of the scene references
+ * geometries[i], which has to be built or deserialized from the geometry instance i referenced when
+ * the scene was serialized.
+ *
+ * @param context RR API context.
+ * @param serialized_data Data written by rrCmdSerializeScene.
+ * @param serialized_size Size of serialized_data in bytes.
+ * @param geometry_count Number of geometries, instance_count of the header.
+ * @param geometries Geometry of each instance.
+ * @param scene Buffer to put scene to, at least result_buffer_size of a scene with instance_count instances.
+ * @param command_stream Command stream to write command into.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrCmdDeserializeScene(RRContext          context,
+                                     const void*        serialized_data,
+                                     size_t             serialized_size,
+                                     uint32_t           geometry_count,
+                                     const RRDevicePtr* geometries,
+                                     RRDevicePtr        scene,
+                                     RRCommandStream    command_stream);
+
 /** @brief Intersect ray buffer.
  *
  * @param context RR API context.
  * @param scene Scene to raycast against.
- * @param query Query type (clsosest or first)
+ * @param query Query type (clsosest or first), optionally combined with RRIntersectQueryFlagBits.
  * @param rays Buffer of rays.
  * @param ray_count Number of rays in the buffer (or max number of rays if indirect_ray_count is supplied).
  * @param indirect_ray_count Optional actual number of rays in the buffer.
@@ -408,6 +764,61 @@ RR_API RRError rrCmdIntersect(RRContext              context,
  */
 RR_API RRError rrGetTraceMemoryRequirements(RRContext context, uint32_t ray_count, size_t* scratch_size);
 
+/** @brief Get memory requirements for trace scratch buffer of rrCmdIntersect with
+ * RR_INTERSECT_QUERY_FLAG_BITS_REORDER_RAYS.
+ *
+ * @param context RR API context.
+ * @param ray_count Number of rays in the buffer (or max number of rays if indirect_ray_count is supplied).
+ * @param scratch_size Pointer to write result to.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrGetReorderedTraceMemoryRequirements(RRContext context, uint32_t ray_count, size_t* scratch_size);
+
+/** @brief Set the traversal stack size of rrCmdIntersect.
+ *
+ * Each ray gets stack_size stack entries in the trace scratch buffer, 64 by default. The size is rounded up
+ * to a multiple of 16, scratch requirements reported afterwards follow it. Shallow trees trace with smaller
+ * scratch buffers, deep trees overflowing the stack need a bigger one. Affects commands recorded afterwards.
+ * Backends without a configurable stack ignore it.
+ *
+ * @param context RR API context.
+ * @param stack_size Number of stack entries per ray.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrSetTraceStackSize(RRContext context, uint32_t stack_size);
+
+/** @brief Get the number of traversal stack overflows since the last call.
+ *
+ * Traversal of a ray overflowing its stack ends early, its hit may be missing or not the closest one.
+ * The counter is read from host visible memory without any synchronization: wait for the events of all
+ * submissions with the traces of interest (rrWaitEvent) before calling it, otherwise overflows of traces still
+ * in flight may be missed or reported by a later call. The count restarts from 0 afterwards. Backends which do
+ * not detect overflows report 0.
+ *
+ * @param context RR API context.
+ * @param overflow_count Pointer to write result to.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrGetTraceStackOverflowCount(RRContext context, uint32_t* overflow_count);
+
+/** @brief Get GPU durations of the kernels of a submission.
+ *
+ * Requires a context created with RR_CONTEXT_FLAG_BITS_PROFILING, other contexts report no results.
+ * Waits for the event. Results are grouped by kernel in order of the first dispatch and stay available
+ * until the event is released. If results is nullptr, result_count receives the number of results,
+ * otherwise it holds the capacity of results on input and the number of results written on output.
+ *
+ * @param context RR API context.
+ * @param event Event of the submission to report.
+ * @param result_count Number of results.
+ * @param results Results to write or nullptr.
+ * @return Error in case of a failure, RRSuccess otherwise.
+ */
+RR_API RRError rrGetProfilingResults(RRContext          context,
+                                     RREvent            event,
+                                     uint32_t*          result_count,
+                                     RRProfilingResult* results);
+
 /** @brief Allocate command stream.
  *
  * @param context RR API context.
@@ -440,6 +851,24 @@ RR_API RRError rrSumbitCommandStream(RRContext       context,
                                      RREvent         wait_event,
                                      RREvent*        out_event);
 
+/** @brief Submit command stream to the asynchronous compute queue.
+ *
+ * Work submitted here may overlap with command streams submitted with rrSumbitCommandStream.
+ * Passing an event from either queue as wait_event makes the GPU wait for it without stalling the host.
+ * Falls back to the main queue if the device does not expose a second compute queue.
+ *
+ * @param context RR API context.
+ * @param command_stream Command stream to execute.
+ * @param wait_event Event to wait for.
+ * @param out_event Event for this submission.
+ * @return Error in case of a failure, RRSuccess
+ * otherwise.
+ */
+RR_API RRError rrSubmitCommandStreamAsync(RRContext       context,
+                                          RRCommandStream command_stream,
+                                          RREvent         wait_event,
+                                          RREvent*        out_event);
+
 /** @brief Release an event.
  *
  * @param context RR API context.
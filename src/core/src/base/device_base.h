@@ -18,7 +18,9 @@ THE SOFTWARE.
 ********************************************************************/
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "backend.h"
@@ -31,6 +33,16 @@ class CommandStreamBase;
 class DevicePtrBase;
 class IntersectorBase;
 
+/**
+ * @brief GPU time spent in a named profiling scope of a submission.
+ **/
+struct ProfilingScope
+{
+    std::string name;
+    uint32_t    dispatch_count = 0u;
+    double      duration_ms    = 0.0;
+};
+
 /**
  * @brief Base class for all raytracing devices.
  *
@@ -74,6 +86,21 @@ public:
      **/
     virtual EventBase* SubmitCommandStream(CommandStreamBase* command_stream_base, EventBase* wait_event_base) = 0;
 
+    /**
+     * @brief Submit a command stream to the asynchronous compute queue.
+     *
+     * Work submitted here may overlap with work submitted by SubmitCommandStream. Devices without a separate queue
+     * submit to the main one.
+     *
+     * @param command_stream_base Command stream to submit.
+     * @param wait_event_base Event to wait for before submitting (or in the submission queue).
+     * @return Event marking a submission.
+     **/
+    virtual EventBase* SubmitCommandStreamAsync(CommandStreamBase* command_stream_base, EventBase* wait_event_base)
+    {
+        return SubmitCommandStream(command_stream_base, wait_event_base);
+    }
+
     /**
      * @brief Releases an event.
      *
@@ -90,6 +117,20 @@ public:
      * Block on CPU until the event has signaled.
      **/
     virtual void WaitEvent(EventBase* event_base) = 0;
+
+    /**
+     * @brief Get GPU durations of the profiling scopes recorded into a submission.
+     *
+     * Waits for the event. Devices created without profiling report no scopes.
+     *
+     * @param event_base Submission event.
+     * @return Scopes in order of their first appearance.
+     **/
+    virtual std::vector<ProfilingScope> GetProfilingResults(EventBase* event_base)
+    {
+        WaitEvent(event_base);
+        return {};
+    }
 };
 
 
@@ -18,6 +18,8 @@ THE SOFTWARE.
 ********************************************************************/
 #pragma once
 
+#include <algorithm>
+#include <stdexcept>
 #include <vector>
 #include "backend.h"
 // clang-format off
@@ -63,6 +65,18 @@ struct TriangleMeshBuildInfo
     RRIndexType    index_type       = RR_INDEX_TYPE_UINT32;
 };
 
+/**
+ * @brief AABB list build info.
+ *
+ * Boxes are pairs of float4 values (xmin, ymin, zmin, unused), (xmax, ymax, zmax, unused).
+ **/
+struct AabbListBuildInfo
+{
+    DevicePtrBase* aabbs       = nullptr;
+    uint32_t       aabb_count  = 0;
+    uint32_t       aabb_stride = 0;
+};
+
 /**
  * @brief Base interface for all intersectors.
  *
@@ -88,6 +102,48 @@ public:
     virtual PreBuildInfo GetTriangleMeshPreBuildInfo(const std::vector<TriangleMeshBuildInfo>& build_info,
                                                      const RRBuildOptions*                     build_options) = 0;
 
+    /**
+     * @brief Get memory requirements of a batched triangle mesh build.
+     *
+     * Result size is the sum of result sizes of all meshes, each mesh still needs its own
+     * result buffer sized for it by GetTriangleMeshPreBuildInfo. Default implementation
+     * matches building meshes one by one with the same scratch buffer.
+     *
+     * @param build_infos Mesh build data, one entry per mesh.
+     * @param build_options Build options.
+     *
+     * @return Memory requirements to build specified meshes.
+     **/
+    virtual PreBuildInfo GetTriangleMeshesPreBuildInfo(const std::vector<TriangleMeshBuildInfo>& build_infos,
+                                                       const RRBuildOptions*                     build_options)
+    {
+        PreBuildInfo batch_info = {0, 0, 0};
+        for (auto const& build_info : build_infos)
+        {
+            PreBuildInfo info              = GetTriangleMeshPreBuildInfo({build_info}, build_options);
+            batch_info.build_scratch_size  = std::max(batch_info.build_scratch_size, info.build_scratch_size);
+            batch_info.update_scratch_size = std::max(batch_info.update_scratch_size, info.update_scratch_size);
+            batch_info.result_size += info.result_size;
+        }
+        return batch_info;
+    }
+
+    /**
+     * @brief Get AABB list memory requirements.
+     *
+     * Default implementation throws, backends without procedural geometry support keep it.
+     *
+     * @param build_info Array of AABB lists of the geometry.
+     * @param build_options Build options.
+     *
+     * @return Memory requirements to build specified AABB lists.
+     **/
+    virtual PreBuildInfo GetAabbListPreBuildInfo(const std::vector<AabbListBuildInfo>& /*build_info*/,
+                                                 const RRBuildOptions*                 /*build_options*/)
+    {
+        throw std::runtime_error("AABB list geometries are not supported by the backend");
+    }
+
     /**
      * @brief Get scene build memeory requirements.
      *
@@ -115,6 +171,30 @@ public:
                                    DevicePtrBase*                            temporary_buffer,
                                    DevicePtrBase*                            geometry_buffer) = 0;
 
+    /**
+     * @brief Build triangle meshes.
+     *
+     * Record commands to build a number of triangle meshes sharing a single temporary buffer.
+     * Default implementation builds meshes one by one.
+     *
+     * @param command_stream Command stream to record to.
+     * @param build_infos Mesh data, one entry per mesh.
+     * @param build_options Build options.
+     * @param temporary_buffer Temporary memory needed during the build.
+     * @param geometry_buffers Buffers to put results into, one per mesh.
+     **/
+    virtual void BuildTriangleMeshes(CommandStreamBase*                        command_stream,
+                                     const std::vector<TriangleMeshBuildInfo>& build_infos,
+                                     const RRBuildOptions*                     build_options,
+                                     DevicePtrBase*                            temporary_buffer,
+                                     const std::vector<DevicePtrBase*>&        geometry_buffers)
+    {
+        for (size_t i = 0; i < build_infos.size(); ++i)
+        {
+            BuildTriangleMesh(command_stream, {build_infos[i]}, build_options, temporary_buffer, geometry_buffers[i]);
+        }
+    }
+
     /**
      * @brief Update triangle mesh.
      *
@@ -133,6 +213,156 @@ public:
                                     DevicePtrBase*                            temporary_buffer,
                                     DevicePtrBase*                            geometry_buffer) = 0;
 
+    /**
+     * @brief Build AABB list.
+     *
+     * Record a command to build a geometry out of AABB lists.
+     *
+     * @param command_stream Command stream to record to.
+     * @param build_info Array of AABB lists of the geometry.
+     * @param build_options Build options.
+     * @param temporary_buffer Temporary memory needed during the build.
+     * @param geometry_buffer A buffer to put result into.
+     **/
+    virtual void BuildAabbList(CommandStreamBase*                    /*command_stream*/,
+                               const std::vector<AabbListBuildInfo>& /*build_info*/,
+                               const RRBuildOptions*                 /*build_options*/,
+                               DevicePtrBase*                        /*temporary_buffer*/,
+                               DevicePtrBase*                        /*geometry_buffer*/)
+    {
+        throw std::runtime_error("AABB list geometries are not supported by the backend");
+    }
+
+    /**
+     * @brief Update AABB list.
+     *
+     * Record a command to refit a geometry to new box positions, box counts can't change.
+     *
+     * @param command_stream Command stream to record to.
+     * @param build_info Array of AABB lists of the geometry.
+     * @param build_options Build options.
+     * @param temporary_buffer Temporary memory needed during the build.
+     * @param geometry_buffer A buffer to put result into.
+     **/
+    virtual void UpdateAabbList(CommandStreamBase*                    /*command_stream*/,
+                                const std::vector<AabbListBuildInfo>& /*build_info*/,
+                                const RRBuildOptions*                 /*build_options*/,
+                                DevicePtrBase*                        /*temporary_buffer*/,
+                                DevicePtrBase*                        /*geometry_buffer*/)
+    {
+        throw std::runtime_error("AABB list geometries are not supported by the backend");
+    }
+
+    /**
+     * @brief Get the compacted size of a geometry.
+     *
+     * @param geometry_buffer A buffer holding a built geometry.
+     *
+     * @return Number of bytes the geometry occupies.
+     **/
+    virtual size_t GetGeometryCompactedSize(DevicePtrBase* /*geometry_buffer*/)
+    {
+        throw std::runtime_error("Geometry compaction is not supported by the backend");
+    }
+
+    /**
+     * @brief Copy a geometry.
+     *
+     * Record a command to copy a geometry into a buffer of its compacted size.
+     *
+     * @param command_stream Command stream to record to.
+     * @param src_geometry_buffer A buffer holding a built geometry.
+     * @param dst_geometry_buffer A buffer to copy the geometry to.
+     **/
+    virtual void CopyGeometry(CommandStreamBase* /*command_stream*/,
+                              DevicePtrBase*     /*src_geometry_buffer*/,
+                              DevicePtrBase*     /*dst_geometry_buffer*/)
+    {
+        throw std::runtime_error("Geometry compaction is not supported by the backend");
+    }
+
+    /**
+     * @brief Get the size of a serialized geometry or scene.
+     *
+     * @param acceleration_structure A buffer holding a geometry or a scene.
+     *
+     * @return Size of serialized data including the header.
+     **/
+    virtual size_t GetSerializedSize(DevicePtrBase* /*acceleration_structure*/)
+    {
+        throw std::runtime_error("Serialization is not supported by the backend");
+    }
+
+    /**
+     * @brief Serialize a geometry.
+     *
+     * Record a command to write the header and nodes of a geometry.
+     *
+     * @param command_stream Command stream to record to.
+     * @param geometry_buffer A buffer holding a built geometry.
+     * @param serialized_buffer A buffer to write serialized data to.
+     **/
+    virtual void SerializeGeometry(CommandStreamBase* /*command_stream*/,
+                                   DevicePtrBase*     /*geometry_buffer*/,
+                                   DevicePtrBase*     /*serialized_buffer*/)
+    {
+        throw std::runtime_error("Serialization is not supported by the backend");
+    }
+
+    /**
+     * @brief Deserialize a geometry.
+     *
+     * Record a command to upload serialized nodes of a geometry.
+     *
+     * @param command_stream Command stream to record to.
+     * @param serialized_data Host memory holding serialized data.
+     * @param serialized_size Size of serialized data in bytes.
+     * @param geometry_buffer A buffer to put result into.
+     **/
+    virtual void DeserializeGeometry(CommandStreamBase* /*command_stream*/,
+                                     void const*        /*serialized_data*/,
+                                     size_t             /*serialized_size*/,
+                                     DevicePtrBase*     /*geometry_buffer*/)
+    {
+        throw std::runtime_error("Serialization is not supported by the backend");
+    }
+
+    /**
+     * @brief Serialize a scene.
+     *
+     * Record a command to write the header and contents of a scene buffer.
+     *
+     * @param command_stream Command stream to record to.
+     * @param scene_buffer A buffer holding a built scene.
+     * @param serialized_buffer A buffer to write serialized data to.
+     **/
+    virtual void SerializeScene(CommandStreamBase* /*command_stream*/,
+                                DevicePtrBase*     /*scene_buffer*/,
+                                DevicePtrBase*     /*serialized_buffer*/)
+    {
+        throw std::runtime_error("Serialization is not supported by the backend");
+    }
+
+    /**
+     * @brief Deserialize a scene.
+     *
+     * Record a command to upload a serialized scene referencing the specified geometries.
+     *
+     * @param command_stream Command stream to record to.
+     * @param serialized_data Host memory holding serialized data.
+     * @param serialized_size Size of serialized data in bytes.
+     * @param geometry_buffers Geometry of each instance.
+     * @param scene_buffer A buffer to put result into.
+     **/
+    virtual void DeserializeScene(CommandStreamBase*                 /*command_stream*/,
+                                  void const*                        /*serialized_data*/,
+                                  size_t                             /*serialized_size*/,
+                                  const std::vector<DevicePtrBase*>& /*geometry_buffers*/,
+                                  DevicePtrBase*                     /*scene_buffer*/)
+    {
+        throw std::runtime_error("Serialization is not supported by the backend");
+    }
+
     /**
      * @brief Build a scene.
      *
@@ -152,6 +382,29 @@ public:
                             DevicePtrBase*        temporary_buffer,
                             DevicePtrBase*        scene_buffer) = 0;
 
+    /**
+     * @brief Update a scene.
+     *
+     * Record a command to refit a scene to new instance data. Keeps the topology
+     * of the tree, so the instance count has to match the one the scene was built with.
+     *
+     * @param command_stream Command stream to record to.
+     * @param instances Array of instance data.
+     * @param instance_count Number of instances in the array.
+     * @param build_options Build options.
+     * @param temporary_buffer Temporary memory needed during the update.
+     * @param scene_buffer A scene to update in place.
+     **/
+    virtual void UpdateScene(CommandStreamBase*    /*command_stream*/,
+                             const RRInstance*     /*instances*/,
+                             uint32_t              /*instance_count*/,
+                             const RRBuildOptions* /*build_options*/,
+                             DevicePtrBase*        /*temporary_buffer*/,
+                             DevicePtrBase*        /*scene_buffer*/)
+    {
+        throw std::runtime_error("Scene updates are not supported by the backend");
+    }
+
     /**
      * @brief Record intersect command into command stream.
      *
@@ -162,7 +415,7 @@ public:
      *
      * @param command_stream Command stream to record to.
      * @param scene_buffer Scene acceleration structure.
-     * @param query Type of raytracing query.
+     * @param query Type of raytracing query, optionally combined with RRIntersectQueryFlagBits.
      * @param ray Buffer containing rays.
      * @param ray_count Number of rays to intersect.
      * @param indirect_ray_count Optional buffer containing number of rays in GPU memory.
@@ -187,6 +440,32 @@ public:
      * @return Size of scratch buffer.
      */
     virtual size_t GetTraceMemoryRequirements(uint32_t ray_count) = 0;
+
+    /** @brief Get memory requirements for trace scratch buffer with RR_INTERSECT_QUERY_FLAG_BITS_REORDER_RAYS.
+     *
+     * Backends which do not reorder rays trace them in place.
+     *
+     * @param ray_count Number of rays in the buffer (or max number of rays if indirect_ray_count is supplied).
+     * @return Size of scratch buffer.
+     */
+    virtual size_t GetReorderedTraceMemoryRequirements(uint32_t ray_count)
+    {
+        return GetTraceMemoryRequirements(ray_count);
+    }
+
+    /** @brief Set the traversal stack size of traces.
+     *
+     * Default implementation ignores it, for backends without a configurable stack.
+     *
+     * @param stack_size Number of stack entries per ray.
+     */
+    virtual void SetTraceStackSize(uint32_t /*stack_size*/) {}
+
+    /** @brief Get the number of traversal stack overflows since the last call and reset it.
+     *
+     * @return Number of overflows, 0 for backends which do not report them.
+     */
+    virtual uint32_t GetTraceStackOverflowCount() { return 0u; }
 };
 
 template<BackendType type>
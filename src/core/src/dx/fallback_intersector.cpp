@@ -306,6 +306,9 @@ void Dx12Intersector::Intersect(CommandStreamBase*     command_stream_base,
 {
     Logger::Get().Debug("Dx12Intersector::Intersect()");
 
+    // Rays are traced in place, reordering is not implemented by this backend.
+    query = RRIntersectQuery(query & ~RR_INTERSECT_QUERY_FLAG_BITS_REORDER_RAYS);
+
     // Allocate buffer and upload data.
     auto                       command_stream = command_stream_cast(command_stream_base);
     ID3D12GraphicsCommandList* command_list   = command_stream->Get();
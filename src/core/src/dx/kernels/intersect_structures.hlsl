@@ -7,6 +7,9 @@ struct Ray
     float  min_t;
     float3 direction;
     float  max_t;
+    uint   mask;
+    uint   flags;
+    uint2  padding;
 };
 
 struct FullHitData
@@ -14,6 +17,8 @@ struct FullHitData
     float2 uv;
     uint   inst_id;
     uint   prim_id;
+    uint   geom_id;
+    float  t;
 };
 
 struct AnyHitData
@@ -71,6 +71,8 @@ void TraceRays(
                 g_hits[gidx].uv = uv;
                 g_hits[gidx].prim_id = g_bvh[node_index].right_child;
                 g_hits[gidx].inst_id = 0;
+                g_hits[gidx].geom_id = 0;
+                g_hits[gidx].t = ray_maxt;
     #endif
                 return;
 #else
@@ -130,6 +132,8 @@ void TraceRays(
         g_hits[gidx].uv = uv;
         g_hits[gidx].prim_id = closest_prim;
         g_hits[gidx].inst_id = 0;
+        g_hits[gidx].geom_id = 0;
+        g_hits[gidx].t = ray_maxt;
     #else
         g_hits[gidx].inst_id = closest_prim;
     #endif
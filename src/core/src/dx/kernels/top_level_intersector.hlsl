@@ -147,6 +147,8 @@ void TraceRays(
     #ifdef FULL_HIT
                 g_hits[gidx].uv = uv;
                 g_hits[gidx].prim_id = node.right_child;
+                g_hits[gidx].geom_id = 0;
+                g_hits[gidx].t = ray_maxt;
     #endif
                 return;
 #else
@@ -175,6 +177,8 @@ void TraceRays(
     #ifdef FULL_HIT
         g_hits[gidx].uv = uv;
         g_hits[gidx].prim_id = closest_prim;
+        g_hits[gidx].geom_id = 0;
+        g_hits[gidx].t = ray_maxt;
     #endif
         g_hits[gidx].inst_id = closest_instance;
     }
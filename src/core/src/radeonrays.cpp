@@ -23,6 +23,8 @@ THE SOFTWARE.
 #include "utils/warning_pop.h"
 // clang-format on
 
+#include <algorithm>
+#include <cstring>
 #include <functional>
 #include <mutex>
 #include <vector>
@@ -73,11 +75,47 @@ std::vector<TriangleMeshBuildInfo> GetTriangleMeshBuildInfo(const RRGeometryBuil
     return build_info;
 }
 
+/// Get AABB list build info from a build input.
+std::vector<AabbListBuildInfo> GetAabbListBuildInfo(const RRGeometryBuildInput& build_input)
+{
+    std::vector<AabbListBuildInfo> build_info(build_input.primitive_count);
+    for (uint32_t i = 0; i < build_input.primitive_count; ++i)
+    {
+        build_info[i].aabbs       = reinterpret_cast<DevicePtrBase*>(build_input.aabb_primitives[i].aabbs);
+        build_info[i].aabb_count  = build_input.aabb_primitives[i].aabb_count;
+        build_info[i].aabb_stride = build_input.aabb_primitives[i].aabb_stride;
+    }
+    return build_info;
+}
+
+/// Get build info of a batch of single mesh triangle build inputs.
+bool GetTriangleMeshesBuildInfo(uint32_t                            geometry_count,
+                                const RRGeometryBuildInput*         build_inputs,
+                                std::vector<TriangleMeshBuildInfo>& build_infos)
+{
+    build_infos.clear();
+    build_infos.reserve(geometry_count);
+    for (uint32_t i = 0; i < geometry_count; ++i)
+    {
+        if (build_inputs[i].primitive_type != RR_PRIMITIVE_TYPE_TRIANGLE_MESH || build_inputs[i].primitive_count != 1)
+        {
+            return false;
+        }
+        build_infos.push_back(GetTriangleMeshBuildInfo(build_inputs[i])[0]);
+    }
+    return true;
+}
+
 }  // namespace
 
 RRError rrCreateContext(uint32_t api_version, RRApi api, RRContext* context)
 {
-    Logger::Get().Info("rrCreateContext({})", api_version);
+    return rrCreateContextWithFlags(api_version, api, RR_CONTEXT_FLAG_BITS_NONE, context);
+}
+
+RRError rrCreateContextWithFlags(uint32_t api_version, RRApi api, RRContextFlags flags, RRContext* context)
+{
+    Logger::Get().Info("rrCreateContextWithFlags({}, {})", api_version, flags);
 
     if (!context)
     {
@@ -102,8 +140,11 @@ RRError rrCreateContext(uint32_t api_version, RRApi api, RRContext* context)
         if (api == RR_API_VK)
         {
             Logger::Get().Info("Creating Vulkan context");
-            rtctx->device      = vulkan::CreateDevice();
-            rtctx->intersector = vulkan::CreateIntersector(*(rtctx->device), vulkan::IntersectorType::kCompute);
+            auto type          = (flags & RR_CONTEXT_FLAG_BITS_PERSISTENT_THREADS)
+                                     ? vulkan::IntersectorType::kComputePersistent
+                                     : vulkan::IntersectorType::kCompute;
+            rtctx->device      = vulkan::CreateDevice((flags & RR_CONTEXT_FLAG_BITS_PROFILING) != 0);
+            rtctx->intersector = vulkan::CreateIntersector(*(rtctx->device), type);
             rtctx->api         = RR_API_VK;
         }
 #endif
@@ -283,6 +324,27 @@ RRError rrCmdBuildGeometry(RRContext                   context,
             }
             break;
         }
+        case RR_PRIMITIVE_TYPE_AABB_LIST: {
+            std::vector<AabbListBuildInfo> build_info = GetAabbListBuildInfo(*build_input);
+
+            if (build_operation == RR_BUILD_OPERATION_BUILD)
+            {
+                ctx->intersector->BuildAabbList(rt_command_stream,
+                                                build_info,
+                                                build_options,
+                                                reinterpret_cast<DevicePtrBase*>(temporary_buffer),
+                                                reinterpret_cast<DevicePtrBase*>(geometry_buffer));
+            }
+            else
+            {
+                ctx->intersector->UpdateAabbList(rt_command_stream,
+                                                 build_info,
+                                                 build_options,
+                                                 reinterpret_cast<DevicePtrBase*>(temporary_buffer),
+                                                 reinterpret_cast<DevicePtrBase*>(geometry_buffer));
+            }
+            break;
+        }
         default: {
             Logger::Get().Error("Build input type not supported");
             return RR_ERROR_NOT_IMPLEMENTED;
@@ -326,6 +388,15 @@ RRError rrGetGeometryBuildMemoryRequirements(RRContext                   context
             memory_requirements->temporary_update_buffer_size = info.update_scratch_size;
             break;
         }
+        case RR_PRIMITIVE_TYPE_AABB_LIST: {
+            std::vector<AabbListBuildInfo> build_info = GetAabbListBuildInfo(*build_input);
+
+            PreBuildInfo info = ctx->intersector->GetAabbListPreBuildInfo(build_info, build_options);
+            memory_requirements->result_buffer_size           = info.result_size;
+            memory_requirements->temporary_build_buffer_size  = info.build_scratch_size;
+            memory_requirements->temporary_update_buffer_size = info.update_scratch_size;
+            break;
+        }
         default: {
             Logger::Get().Error("Build input type not supported");
             return RR_ERROR_NOT_IMPLEMENTED;
@@ -341,7 +412,152 @@ RRError rrGetGeometryBuildMemoryRequirements(RRContext                   context
     return RR_SUCCESS;
 }
 
+RRError rrCmdBuildGeometries(RRContext                   context,
+                             uint32_t                    geometry_count,
+                             const RRGeometryBuildInput* build_inputs,
+                             const RRBuildOptions*       build_options,
+                             RRDevicePtr                 temporary_buffer,
+                             const RRDevicePtr*          geometry_buffers,
+                             RRCommandStream             command_stream)
+{
+    Logger::Get().Info("rrCmdBuildGeometries({})", geometry_count);
+
+    if (!context || !command_stream || !build_inputs || !geometry_buffers)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx               = reinterpret_cast<Context*>(context);
+    auto rt_command_stream = reinterpret_cast<CommandStreamBase*>(command_stream);
+
+    try
+    {
+        std::vector<TriangleMeshBuildInfo> build_infos;
+        if (!GetTriangleMeshesBuildInfo(geometry_count, build_inputs, build_infos))
+        {
+            Logger::Get().Error("Batched builds support single triangle mesh inputs only");
+            return RR_ERROR_NOT_IMPLEMENTED;
+        }
+
+        std::vector<DevicePtrBase*> rt_geometry_buffers(geometry_count);
+        for (uint32_t i = 0; i < geometry_count; ++i)
+        {
+            rt_geometry_buffers[i] = reinterpret_cast<DevicePtrBase*>(geometry_buffers[i]);
+        }
+
+        ctx->intersector->BuildTriangleMeshes(rt_command_stream,
+                                              build_infos,
+                                              build_options,
+                                              reinterpret_cast<DevicePtrBase*>(temporary_buffer),
+                                              rt_geometry_buffers);
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Batched geometry build command successfully recorded");
+    return RR_SUCCESS;
+}
+
+RRError rrGetGeometriesBuildMemoryRequirements(RRContext                   context,
+                                               uint32_t                    geometry_count,
+                                               const RRGeometryBuildInput* build_inputs,
+                                               const RRBuildOptions*       build_options,
+                                               RRMemoryRequirements*       memory_requirements)
+{
+    Logger::Get().Info("rrGetGeometriesBuildMemoryRequirements({})", geometry_count);
+
+    if (!context || !build_inputs || !memory_requirements)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx = reinterpret_cast<Context*>(context);
+
+    try
+    {
+        std::vector<TriangleMeshBuildInfo> build_infos;
+        if (!GetTriangleMeshesBuildInfo(geometry_count, build_inputs, build_infos))
+        {
+            Logger::Get().Error("Batched builds support single triangle mesh inputs only");
+            return RR_ERROR_NOT_IMPLEMENTED;
+        }
+
+        PreBuildInfo info = ctx->intersector->GetTriangleMeshesPreBuildInfo(build_infos, build_options);
+        memory_requirements->result_buffer_size           = info.result_size;
+        memory_requirements->temporary_build_buffer_size  = info.build_scratch_size;
+        memory_requirements->temporary_update_buffer_size = info.update_scratch_size;
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Successfully provided batched geometry memory requirements");
+    return RR_SUCCESS;
+}
+
+RRError rrGetGeometryCompactedSize(RRContext context, RRDevicePtr geometry, size_t* compacted_size)
+{
+    Logger::Get().Info("rrGetGeometryCompactedSize");
+
+    if (!context || !geometry || !compacted_size)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx = reinterpret_cast<Context*>(context);
+
+    try
+    {
+        *compacted_size = ctx->intersector->GetGeometryCompactedSize(reinterpret_cast<DevicePtrBase*>(geometry));
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Successfully provided geometry compacted size");
+    return RR_SUCCESS;
+}
+
+RRError rrCmdCopyGeometry(RRContext       context,
+                          RRDevicePtr     src_geometry,
+                          RRDevicePtr     dst_geometry,
+                          RRCommandStream command_stream)
+{
+    Logger::Get().Info("rrCmdCopyGeometry");
+
+    if (!context || !command_stream || !src_geometry || !dst_geometry)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx               = reinterpret_cast<Context*>(context);
+    auto rt_command_stream = reinterpret_cast<CommandStreamBase*>(command_stream);
+
+    try
+    {
+        ctx->intersector->CopyGeometry(rt_command_stream,
+                                       reinterpret_cast<DevicePtrBase*>(src_geometry),
+                                       reinterpret_cast<DevicePtrBase*>(dst_geometry));
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Geometry copy command successfully recorded");
+    return RR_SUCCESS;
+}
+
 RRError rrCmdBuildScene(RRContext                context,
+                        RRBuildOperation         build_operation,
                         const RRSceneBuildInput* build_input,
                         const RRBuildOptions*    build_options,
                         RRDevicePtr              temporary_buffer,
@@ -361,12 +577,24 @@ RRError rrCmdBuildScene(RRContext                context,
 
     try
     {
-        ctx->intersector->BuildScene(rt_command_stream,
-                                     build_input->instances,
-                                     build_input->instance_count,
-                                     build_options,
-                                     reinterpret_cast<DevicePtrBase*>(temporary_buffer),
-                                     reinterpret_cast<DevicePtrBase*>(scene_buffer));
+        if (build_operation == RR_BUILD_OPERATION_BUILD)
+        {
+            ctx->intersector->BuildScene(rt_command_stream,
+                                         build_input->instances,
+                                         build_input->instance_count,
+                                         build_options,
+                                         reinterpret_cast<DevicePtrBase*>(temporary_buffer),
+                                         reinterpret_cast<DevicePtrBase*>(scene_buffer));
+        }
+        else
+        {
+            ctx->intersector->UpdateScene(rt_command_stream,
+                                          build_input->instances,
+                                          build_input->instance_count,
+                                          build_options,
+                                          reinterpret_cast<DevicePtrBase*>(temporary_buffer),
+                                          reinterpret_cast<DevicePtrBase*>(scene_buffer));
+        }
     } catch (std::exception& e)
     {
         Logger::Get().Error(e.what());
@@ -408,6 +636,167 @@ RRError rrGetSceneBuildMemoryRequirements(RRContext                context,
     return RR_SUCCESS;
 }
 
+RRError rrGetSerializedSize(RRContext context, RRDevicePtr acceleration_structure, size_t* serialized_size)
+{
+    Logger::Get().Info("rrGetSerializedSize");
+
+    if (!context || !acceleration_structure || !serialized_size)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx = reinterpret_cast<Context*>(context);
+
+    try
+    {
+        *serialized_size =
+            ctx->intersector->GetSerializedSize(reinterpret_cast<DevicePtrBase*>(acceleration_structure));
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Successfully provided serialized size");
+    return RR_SUCCESS;
+}
+
+RRError rrCmdSerializeGeometry(RRContext       context,
+                               RRDevicePtr     geometry,
+                               RRDevicePtr     serialized_buffer,
+                               RRCommandStream command_stream)
+{
+    Logger::Get().Info("rrCmdSerializeGeometry");
+
+    if (!context || !command_stream || !geometry || !serialized_buffer)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx               = reinterpret_cast<Context*>(context);
+    auto rt_command_stream = reinterpret_cast<CommandStreamBase*>(command_stream);
+
+    try
+    {
+        ctx->intersector->SerializeGeometry(rt_command_stream,
+                                            reinterpret_cast<DevicePtrBase*>(geometry),
+                                            reinterpret_cast<DevicePtrBase*>(serialized_buffer));
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Geometry serialization command successfully recorded");
+    return RR_SUCCESS;
+}
+
+RRError rrCmdDeserializeGeometry(RRContext       context,
+                                 const void*     serialized_data,
+                                 size_t          serialized_size,
+                                 RRDevicePtr     geometry,
+                                 RRCommandStream command_stream)
+{
+    Logger::Get().Info("rrCmdDeserializeGeometry");
+
+    if (!context || !command_stream || !serialized_data || !geometry)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx               = reinterpret_cast<Context*>(context);
+    auto rt_command_stream = reinterpret_cast<CommandStreamBase*>(command_stream);
+
+    try
+    {
+        ctx->intersector->DeserializeGeometry(
+            rt_command_stream, serialized_data, serialized_size, reinterpret_cast<DevicePtrBase*>(geometry));
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Geometry deserialization command successfully recorded");
+    return RR_SUCCESS;
+}
+
+RRError rrCmdSerializeScene(RRContext       context,
+                            RRDevicePtr     scene,
+                            RRDevicePtr     serialized_buffer,
+                            RRCommandStream command_stream)
+{
+    Logger::Get().Info("rrCmdSerializeScene");
+
+    if (!context || !command_stream || !scene || !serialized_buffer)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx               = reinterpret_cast<Context*>(context);
+    auto rt_command_stream = reinterpret_cast<CommandStreamBase*>(command_stream);
+
+    try
+    {
+        ctx->intersector->SerializeScene(rt_command_stream,
+                                         reinterpret_cast<DevicePtrBase*>(scene),
+                                         reinterpret_cast<DevicePtrBase*>(serialized_buffer));
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Scene serialization command successfully recorded");
+    return RR_SUCCESS;
+}
+
+RRError rrCmdDeserializeScene(RRContext          context,
+                              const void*        serialized_data,
+                              size_t             serialized_size,
+                              uint32_t           geometry_count,
+                              const RRDevicePtr* geometries,
+                              RRDevicePtr        scene,
+                              RRCommandStream    command_stream)
+{
+    Logger::Get().Info("rrCmdDeserializeScene({})", geometry_count);
+
+    if (!context || !command_stream || !serialized_data || !geometries || !scene)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx               = reinterpret_cast<Context*>(context);
+    auto rt_command_stream = reinterpret_cast<CommandStreamBase*>(command_stream);
+
+    try
+    {
+        std::vector<DevicePtrBase*> rt_geometries(geometry_count);
+        for (uint32_t i = 0; i < geometry_count; ++i)
+        {
+            rt_geometries[i] = reinterpret_cast<DevicePtrBase*>(geometries[i]);
+        }
+
+        ctx->intersector->DeserializeScene(rt_command_stream,
+                                           serialized_data,
+                                           serialized_size,
+                                           rt_geometries,
+                                           reinterpret_cast<DevicePtrBase*>(scene));
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Scene deserialization command successfully recorded");
+    return RR_SUCCESS;
+}
+
 RRError rrCmdIntersect(RRContext              context,
                        RRDevicePtr            scene_buffer,
                        RRIntersectQuery       query,
@@ -528,6 +917,36 @@ RRError rrSumbitCommandStream(RRContext context, RRCommandStream command_stream,
     return RR_SUCCESS;
 }
 
+RRError rrSubmitCommandStreamAsync(RRContext       context,
+                                   RRCommandStream command_stream,
+                                   RREvent         wait_event,
+                                   RREvent*        event)
+{
+    Logger::Get().Info("rrSubmitCommandStreamAsync");
+
+    if (!context || !command_stream || !event)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx           = reinterpret_cast<Context*>(context);
+    auto cmd_stream    = reinterpret_cast<CommandStreamBase*>(command_stream);
+    auto rt_wait_event = reinterpret_cast<EventBase*>(wait_event);
+
+    try
+    {
+        *event = reinterpret_cast<RREvent>(ctx->device->SubmitCommandStreamAsync(cmd_stream, rt_wait_event));
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Command stream successfully submitted");
+    return RR_SUCCESS;
+}
+
 RRError rrReleaseEvent(RRContext context, RREvent event)
 {
     Logger::Get().Info("rrReleaseEvent");
@@ -750,6 +1169,118 @@ RRError rrGetTraceMemoryRequirements(RRContext context, uint32_t ray_count, size
     return RR_SUCCESS;
 }
 
+RRError rrGetReorderedTraceMemoryRequirements(RRContext context, uint32_t ray_count, size_t* scratch_size)
+{
+    Logger::Get().Info("rrGetReorderedTraceMemoryRequirements");
+
+    if (!context || !scratch_size || !ray_count)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+    try
+    {
+        auto ctx      = reinterpret_cast<Context*>(context);
+        *scratch_size = ctx->intersector->GetReorderedTraceMemoryRequirements(ray_count);
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Successfully provided reordered trace memory requirements");
+    return RR_SUCCESS;
+}
+
+RRError rrSetTraceStackSize(RRContext context, uint32_t stack_size)
+{
+    Logger::Get().Info("rrSetTraceStackSize({})", stack_size);
+
+    if (!context || !stack_size)
+    {
+        Logger::Get().Error("Invalid parameter passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    try
+    {
+        auto ctx = reinterpret_cast<Context*>(context);
+        ctx->intersector->SetTraceStackSize(stack_size);
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Successfully set trace stack size");
+    return RR_SUCCESS;
+}
+
+RRError rrGetTraceStackOverflowCount(RRContext context, uint32_t* overflow_count)
+{
+    Logger::Get().Info("rrGetTraceStackOverflowCount");
+
+    if (!context || !overflow_count)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+    try
+    {
+        auto ctx        = reinterpret_cast<Context*>(context);
+        *overflow_count = ctx->intersector->GetTraceStackOverflowCount();
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Successfully provided trace stack overflow count");
+    return RR_SUCCESS;
+}
+
+RRError rrGetProfilingResults(RRContext context, RREvent event, uint32_t* result_count, RRProfilingResult* results)
+{
+    Logger::Get().Info("rrGetProfilingResults");
+
+    if (!context || !event || !result_count)
+    {
+        Logger::Get().Error("Invalid pointer passed");
+        return RR_ERROR_INVALID_PARAMETER;
+    }
+
+    auto ctx      = reinterpret_cast<Context*>(context);
+    auto rt_event = reinterpret_cast<EventBase*>(event);
+
+    try
+    {
+        auto scopes = ctx->device->GetProfilingResults(rt_event);
+        if (results)
+        {
+            *result_count = std::min(*result_count, (uint32_t)scopes.size());
+            for (uint32_t i = 0; i < *result_count; ++i)
+            {
+                auto& result = results[i];
+                auto  length = std::min(scopes[i].name.size(), size_t(RR_PROFILING_NAME_SIZE - 1));
+                std::memcpy(result.name, scopes[i].name.data(), length);
+                result.name[length]   = '\0';
+                result.dispatch_count = scopes[i].dispatch_count;
+                result.duration_ms    = (float)scopes[i].duration_ms;
+            }
+        } else
+        {
+            *result_count = (uint32_t)scopes.size();
+        }
+    } catch (std::exception& e)
+    {
+        Logger::Get().Error(e.what());
+        return RR_ERROR_INTERNAL;
+    }
+
+    Logger::Get().Debug("Successfully provided profiling results");
+    return RR_SUCCESS;
+}
+
 #ifdef RR_ENABLE_VK
 RRError rrAllocateDeviceBuffer(RRContext context, size_t size, RRDevicePtr* device_ptr)
 {
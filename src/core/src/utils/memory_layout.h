@@ -18,11 +18,13 @@ THE SOFTWARE.
 ********************************************************************/
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
-#include <unordered_map>
-#include <vector>
+#include <limits>
+#include <type_traits>
 
 namespace rt
 {
@@ -33,16 +35,37 @@ inline T RoundUp(T val, U a)
     return T(((val + a - 1) / a) * a);
 }
 
+/**
+ * @brief Lifetime of a memory block.
+ *
+ * Closed interval of algorithm phases [first, last] during which the block content is needed.
+ * Blocks with disjoint lifetimes may share memory.
+ */
+struct BlockLifetime
+{
+    uint32_t first = 0;
+    uint32_t last  = std::numeric_limits<uint32_t>::max();
+
+    bool overlaps(BlockLifetime const& other) const noexcept { return first <= other.last && other.first <= last; }
+};
+
 /**
  * @brief MemoryLayout represents a memory map of a contiguous memory space.
  *
- * Layout consists of consecutive blocks defined by starting offset and size.
- * An offset of each next block is aligned in accordacnce with an optional alignement
- * parameter.
+ * Layout consists of blocks defined by starting offset and size.
+ * An offset of each block is aligned in accordacnce with an optional alignement
+ * parameter. Blocks are placed first-fit at the lowest offset not intersecting any
+ * previously appended block with an overlapping lifetime, so blocks which are never
+ * alive at the same time alias each other. Blocks appended without a lifetime are
+ * alive all the time and get laid out back to back.
+ *
+ * BlockID is an enum with values in [0, MaxBlocks), lookup is a plain array access.
  */
-template <typename BlockID, typename AddrT>
+template <typename BlockID, typename AddrT, std::size_t MaxBlocks = 16>
 class MemoryLayout
 {
+    static_assert(std::is_enum<BlockID>::value, "BlockID must be an enum");
+
 public:
     /**
      * @brief Constructor
@@ -51,7 +74,7 @@ public:
      * @param base_offset Base offset for address caluclation.
      **/
     MemoryLayout(AddrT alignment = AddrT(), AddrT base_offset = AddrT()) noexcept
-        : alignment_(alignment), base_offset_(base_offset)
+        : alignment_(alignment ? alignment : AddrT(1)), base_offset_(base_offset)
     {
     }
 
@@ -60,24 +83,45 @@ public:
      *
      * @param id ID of the block.
      * @param count Number of items of type T in the block.
+     * @param lifetime Phases the block is alive in, the whole algorithm by default.
      **/
     template <typename T>
-    void AppendBlock(BlockID id, std::size_t count)
+    void AppendBlock(BlockID id, std::size_t count, BlockLifetime lifetime = BlockLifetime())
     {
-        if (blocks_.empty())
-        {
-            blocks_.push_back(Block{0, count * sizeof(T)});
-            block_map_[id] = 0;
-        } else
-        {
-            Block        block;
-            const Block& last_block = blocks_.back();
+        auto index = static_cast<std::size_t>(id);
+        assert(index < MaxBlocks && !blocks_[index].valid);
+
+        Block block;
+        block.size     = count * sizeof(T);
+        block.lifetime = lifetime;
+        block.valid    = true;
 
-            block.offset   = RoundUp(last_block.offset + last_block.size, alignment_);
-            block.size     = count * sizeof(T);
-            block_map_[id] = blocks_.size();
-            blocks_.push_back(block);
+        // First fit: bump the candidate offset past every conflicting block until it stays put.
+        AddrT offset = 0;
+        bool  moved  = true;
+        while (moved)
+        {
+            moved = false;
+            for (auto i = 0u; i < block_count_; ++i)
+            {
+                Block const& other = blocks_[order_[i]];
+                if (!other.lifetime.overlaps(lifetime))
+                {
+                    continue;
+                }
+                AddrT other_end = other.offset + AddrT(other.size);
+                if (offset < other_end && other.offset < offset + AddrT(block.size))
+                {
+                    offset = RoundUp(other_end, alignment_);
+                    moved  = true;
+                }
+            }
         }
+        block.offset = offset;
+
+        blocks_[index]          = block;
+        order_[block_count_++] = index;
+        total_size_            = std::max(total_size_, std::size_t(RoundUp(offset + AddrT(block.size), alignment_)));
     }
 
     /**
@@ -86,12 +130,7 @@ public:
      * @param id ID of the block.
      * @return Offset of the block (including base offset).
      **/
-    AddrT offset_of(BlockID id) const
-    {
-        auto it = block_map_.find(id);
-        assert(it != block_map_.end());
-        return blocks_[it->second].offset + base_offset_;
-    }
+    AddrT offset_of(BlockID id) const { return block(id).offset + base_offset_; }
 
     /**
      * @brief Get a size in bytes of a specified block.
@@ -99,12 +138,7 @@ public:
      * @param id ID of the block.
      * @return Size of the block in bytes.
      **/
-    std::size_t size_of(BlockID id) const
-    {
-        auto it = block_map_.find(id);
-        assert(it != block_map_.end());
-        return blocks_[it->second].size;
-    }
+    std::size_t size_of(BlockID id) const { return block(id).size; }
 
     /**
      * @brief Get a size in elements of type T of a specified block.
@@ -115,9 +149,7 @@ public:
     template <typename T>
     std::size_t size_in_elements(BlockID id) const
     {
-        auto it = block_map_.find(id);
-        assert(it != block_map_.end());
-        return blocks_[it->second].size / sizeof(T);
+        return block(id).size / sizeof(T);
     }
 
     /**
@@ -125,23 +157,15 @@ public:
      **/
     void Reset()
     {
-        block_map_.clear();
-        blocks_.clear();
+        blocks_.fill(Block());
+        block_count_ = 0;
+        total_size_  = 0;
     }
 
     /**
      * @brief Get total size of memory layout in bytes.
      **/
-    std::size_t total_size() const noexcept
-    {
-        if (!blocks_.empty())
-        {
-            const Block& last_block = blocks_.back();
-            return RoundUp(last_block.offset + last_block.size, alignment_);
-        }
-
-        return 0;
-    }
+    std::size_t total_size() const noexcept { return total_size_; }
 
     /**
      * @brief Set base offset of a memory layout.
@@ -153,13 +177,25 @@ public:
 private:
     struct Block
     {
-        AddrT       offset = 0;
-        std::size_t size   = 0;
+        AddrT         offset = 0;
+        std::size_t   size   = 0;
+        BlockLifetime lifetime;
+        bool          valid = false;
     };
 
-    std::unordered_map<BlockID, std::size_t> block_map_;
-    std::vector<Block>                       blocks_;
-    AddrT                                    alignment_   = 1;
-    AddrT                                    base_offset_ = 0;
+    Block const& block(BlockID id) const
+    {
+        auto index = static_cast<std::size_t>(id);
+        assert(index < MaxBlocks && blocks_[index].valid);
+        return blocks_[index];
+    }
+
+    std::array<Block, MaxBlocks>       blocks_;
+    // Block indices in the order of appending.
+    std::array<std::size_t, MaxBlocks> order_       = {};
+    std::size_t                        block_count_ = 0;
+    std::size_t                        total_size_  = 0;
+    AddrT                              alignment_   = 1;
+    AddrT                              base_offset_ = 0;
 };
-}  // namespace rt
\ No newline at end of file
+}  // namespace rt
@@ -18,89 +18,230 @@ THE SOFTWARE.
 ********************************************************************/
 #pragma once
 
-#include <assert.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
-#include <queue>
-#include <type_traits>
+#include <stdexcept>
 
 namespace rt
 {
-/** @brief Pool of objects.
+/** @brief Default pool policy.
  *
- * Implements object pooling for a subsequent reuse.
+ * Forwards object creation / deletion to user functions.
  **/
 template <typename T>
-class Pool
+struct FunctionPoolPolicy
 {
-public:
     //<! Producer function.
     using CreateFn = std::function<T*()>;
     //<! Deleter function.
     using DeleteFn = std::function<void(T*)>;
 
+    T*   Create(size_t) { return create_fn(); }
+    void Destroy(T* obj) { delete_fn(obj); }
+
+    CreateFn create_fn = nullptr;
+    DeleteFn delete_fn = nullptr;
+};
+
+/** @brief Thread-safe pool of objects.
+ *
+ * Implements object pooling for a subsequent reuse. Released objects are kept on lock-free stacks (one per size
+ * class), so objects can be acquired and released from several threads without external locking.
+ *
+ * Policy is a type providing T* Create(size_t size_class) and void Destroy(T*). Its calls are resolved statically,
+ * so a dedicated policy struct lets the compiler inline the factory. Create may be called concurrently.
+ **/
+template <typename T, typename Policy = FunctionPoolPolicy<T>, size_t SizeClassCount = 1>
+class Pool
+{
+    static_assert(SizeClassCount > 0, "Pool needs at least one size class");
+
+public:
     /**
      * @brief Constructor.
      *
-     * @param create_fn User function which is called to create a new object.
-     * @param delete_fn User function which is called to delete an object.
+     * @param policy Object factory policy.
      **/
-    Pool(CreateFn create_fn = nullptr, DeleteFn delete_fn = nullptr) : create_fn_(create_fn), delete_fn_(delete_fn) {}
+    explicit Pool(Policy policy = Policy()) : policy_(std::move(policy))
+    {
+        for (auto& chunk : chunks_)
+        {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    Pool(Pool const&) = delete;
+    Pool& operator=(Pool const&) = delete;
 
     /**
      * @brief Destructor.
+     *
+     * Pooled objects are destroyed using the policy. Must not race with other calls.
      **/
     ~Pool()
     {
-        while (!objects_.empty())
+        for (auto& objects : objects_)
+        {
+            for (auto index = objects.Pop(*this); index != kInvalidNode; index = objects.Pop(*this))
+            {
+                policy_.Destroy(GetNode(index).object);
+            }
+        }
+        for (auto& chunk : chunks_)
         {
-            T* obj = objects_.front();
-            objects_.pop();
-            delete_fn_(obj);
+            delete[] chunk.load(std::memory_order_relaxed);
         }
     }
 
     /**
      * @brief Get an object from a pool.
      *
-     * If the pool is empty, a new object is created using create_fn,
+     * If the pool is empty, a new object is created using the policy,
      * otherwise existing object is returned.
      *
+     * @param size_class Size class to take an object from.
      * @return An object.
      **/
-    T* AcquireObject()
+    T* AcquireObject(size_t size_class = 0)
     {
-        if (!objects_.empty())
-        {
-            T* obj = objects_.front();
-            objects_.pop();
-            return obj;
-        } else
+        auto index = objects_.at(size_class).Pop(*this);
+        if (index == kInvalidNode)
         {
-            return create_fn_();
+            return policy_.Create(size_class);
         }
+        T* obj = GetNode(index).object;
+        free_nodes_.Push(*this, index);
+        return obj;
     }
 
     /**
      * @brief Release object back to the pool.
+     *
+     * @param obj Object to release.
+     * @param size_class Size class the object belongs to.
      **/
-    void ReleaseObject(T* obj) { objects_.push(obj); }
+    void ReleaseObject(T* obj, size_t size_class = 0)
+    {
+        auto& objects = objects_.at(size_class);
+        auto  index   = free_nodes_.Pop(*this);
+        if (index == kInvalidNode)
+        {
+            index = AllocateNode();
+        }
+        GetNode(index).object = obj;
+        objects.Push(*this, index);
+    }
 
     /**
      * @brief Set producer function.
      **/
-
-    void SetCreateFn(CreateFn fn) { create_fn_ = fn; }
+    template <typename Fn>
+    void SetCreateFn(Fn fn)
+    {
+        policy_.create_fn = std::move(fn);
+    }
     /**
      * @brief Set deleter function.
      **/
-    void SetDeleteFn(DeleteFn fn) { delete_fn_ = fn; }
+    template <typename Fn>
+    void SetDeleteFn(Fn fn)
+    {
+        policy_.delete_fn = std::move(fn);
+    }
+
+    /**
+     * @brief Access the policy, e.g. to bind it to a device after the pool is constructed.
+     **/
+    Policy& policy() { return policy_; }
 
 private:
-    //<! Objects are organised in the queue.
-    std::queue<T*> objects_;
-    //<! Producer function.
-    CreateFn create_fn_ = nullptr;
-    //<! Deleter function.
-    DeleteFn delete_fn_ = nullptr;
+    static constexpr uint32_t kInvalidNode   = UINT32_MAX;
+    static constexpr uint32_t kNodesPerChunk = 256u;
+    static constexpr uint32_t kMaxChunks     = 4096u;
+
+    //<! Stack entry. Nodes are never freed before the pool, so a stale read is always safe.
+    struct Node
+    {
+        T*                    object = nullptr;
+        std::atomic<uint32_t> next{0u};
+    };
+
+    /** @brief Treiber stack of node indices.
+     *
+     * Head packs a modification tag in the upper 32 bits and (index + 1) in the lower ones,
+     * the tag protects from ABA.
+     **/
+    class Stack
+    {
+    public:
+        void Push(Pool& pool, uint32_t index)
+        {
+            auto& node = pool.GetNode(index);
+            auto  head = head_.load(std::memory_order_relaxed);
+            uint64_t new_head;
+            do
+            {
+                node.next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+                new_head = (((head >> 32) + 1) << 32) | (uint64_t(index) + 1);
+            } while (!head_.compare_exchange_weak(head, new_head, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        uint32_t Pop(Pool& pool)
+        {
+            auto head = head_.load(std::memory_order_acquire);
+            while (auto top = static_cast<uint32_t>(head))
+            {
+                auto next     = pool.GetNode(top - 1).next.load(std::memory_order_relaxed);
+                auto new_head = (((head >> 32) + 1) << 32) | next;
+                if (head_.compare_exchange_weak(head, new_head, std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    return top - 1;
+                }
+            }
+            return kInvalidNode;
+        }
+
+    private:
+        std::atomic<uint64_t> head_{0u};
+    };
+
+    Node& GetNode(uint32_t index)
+    {
+        return chunks_[index / kNodesPerChunk].load(std::memory_order_acquire)[index % kNodesPerChunk];
+    }
+
+    uint32_t AllocateNode()
+    {
+        auto index = node_count_.fetch_add(1u, std::memory_order_relaxed);
+        auto chunk = index / kNodesPerChunk;
+        if (chunk >= kMaxChunks)
+        {
+            throw std::runtime_error("Pool node capacity exceeded");
+        }
+        if (!chunks_[chunk].load(std::memory_order_acquire))
+        {
+            Node* expected = nullptr;
+            Node* nodes    = new Node[kNodesPerChunk];
+            if (!chunks_[chunk].compare_exchange_strong(expected, nodes, std::memory_order_acq_rel))
+            {
+                delete[] nodes;
+            }
+        }
+        return index;
+    }
+
+private:
+    //<! Node storage, grows chunk by chunk.
+    std::array<std::atomic<Node*>, kMaxChunks> chunks_;
+    std::atomic<uint32_t>                      node_count_{0u};
+    //<! Nodes not holding an object.
+    Stack free_nodes_;
+    //<! Pooled objects, one stack per size class.
+    std::array<Stack, SizeClassCount> objects_;
+    //<! Factory policy.
+    Policy policy_;
 };
 }  // namespace rt
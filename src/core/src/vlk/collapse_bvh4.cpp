@@ -0,0 +1,146 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "collapse_bvh4.h"
+
+#include <stdexcept>
+
+#include "utils/logger.h"
+#include "vlk/common.h"
+
+namespace rt::vulkan
+{
+namespace
+{
+constexpr char const* s_collapse_kernel_name = "collapse_bvh4.comp.spv";
+
+constexpr uint32_t kGroupSize = 128u;
+
+uint32_t GetBvhNodeCount(uint32_t leaf_count) { return 2 * leaf_count - 1; }
+// Wide nodes start after the binary nodes, padded to an even node.
+uint32_t GetWideNodesOffset(uint32_t leaf_count) { return 2 * leaf_count; }
+}  // namespace
+
+struct CollapseBvh4::CollapseBvh4Impl
+{
+    std::shared_ptr<GpuHelper> gpu_helper_;
+    ShaderManager const&       shader_manager_;
+
+    // Descriptor sets
+    std::vector<DescriptorSet> collapse_sets_;
+    DescriptorCacheTable<1, 1> cache_;
+
+    ShaderPtr collapse_kernel_ = nullptr;
+
+    CollapseBvh4Impl(std::shared_ptr<GpuHelper> helper, ShaderManager const& manager)
+        : gpu_helper_(helper), shader_manager_(manager), cache_(helper)
+    {
+        Init();
+    }
+    void Init()
+    {
+        ShaderManager::KernelID collapse_id = s_collapse_kernel_name;
+
+        collapse_kernel_ = shader_manager_.CreateKernel(collapse_id);
+        collapse_sets_   = shader_manager_.CreateDescriptorSets(collapse_kernel_);
+        shader_manager_.PrepareKernel(collapse_id, collapse_sets_);
+    }
+
+    ~CollapseBvh4Impl()
+    {
+        for (auto& desc_set : collapse_sets_)
+        {
+            gpu_helper_->device.destroyDescriptorSetLayout(desc_set.layout_);
+        }
+    }
+};
+
+CollapseBvh4::CollapseBvh4(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager)
+    : impl_(std::make_unique<CollapseBvh4Impl>(gpu_helper, shader_manager))
+{
+}
+CollapseBvh4::~CollapseBvh4() = default;
+
+uint32_t CollapseBvh4::GetNodeCount(uint32_t leaf_count)
+{
+    // A single leaf is traversed as is.
+    return leaf_count > 1 ? GetWideNodesOffset(leaf_count) + 2 * (leaf_count - 1) : GetBvhNodeCount(leaf_count);
+}
+
+void CollapseBvh4::operator()(vk::CommandBuffer command_buffer,
+                              uint32_t          leaf_count,
+                              vk::Buffer        bvh,
+                              size_t            bvh_offset)
+{
+    if (leaf_count < 2)
+    {
+        return;
+    }
+
+    // Geometries sharing a buffer share the descriptor, nodes are addressed from the start of the buffer.
+    if (bvh_offset % sizeof(BvhNode) != 0)
+    {
+        constexpr const char* message = "Geometries with a wide BVH have to be aligned to BVH nodes";
+        Logger::Get().Error(message);
+        throw std::runtime_error(message);
+    }
+
+    auto     descriptor_set = GetDescriptor(bvh);
+    uint32_t node_offset    = uint32_t(bvh_offset / sizeof(BvhNode));
+    uint32_t push_consts[]  = {node_offset, leaf_count - 1, GetWideNodesOffset(leaf_count)};
+
+    // The binary BVH is written by build or refit kernels.
+    impl_->gpu_helper_->EncodeBufferBarrier(bvh,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer);
+
+    impl_->gpu_helper_->EncodePushConstant(
+        impl_->collapse_kernel_->pipeline_layout, 0u, sizeof(push_consts), push_consts, command_buffer);
+    impl_->gpu_helper_->EncodeBindDescriptorSets(
+        &descriptor_set, 1u, 0u, impl_->collapse_kernel_->pipeline_layout, command_buffer);
+
+    // Launch kernel.
+    auto num_groups = CeilDivide(leaf_count - 1, kGroupSize);
+    impl_->shader_manager_.EncodeDispatch1D(*impl_->collapse_kernel_, num_groups, command_buffer);
+
+    impl_->gpu_helper_->EncodeBufferBarrier(bvh,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer);
+}
+
+vk::DescriptorSet CollapseBvh4::GetDescriptor(vk::Buffer bvh)
+{
+    if (impl_->cache_.Contains({bvh}))
+    {
+        return impl_->cache_.Get({bvh})[0];
+    }
+
+    vk::DescriptorBufferInfo buffer_info(bvh, 0u, VK_WHOLE_SIZE);
+
+    vk::DescriptorSet descriptor_set = impl_->gpu_helper_->AllocateDescriptorSet(impl_->collapse_sets_[0].layout_);
+    impl_->gpu_helper_->WriteDescriptorSet(descriptor_set, &buffer_info, 1u);
+    impl_->cache_.Push({bvh}, {descriptor_set});
+    return descriptor_set;
+}
+}  // namespace rt::vulkan
@@ -0,0 +1,61 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vlk/gpu_helper.h"
+#include "vlk/shader_manager.h"
+
+namespace rt::vulkan
+{
+/**
+ * @brief Wide BVH collapser.
+ *
+ * Collapse a binary BVH into a 4-wide one.
+ **/
+class CollapseBvh4
+{
+public:
+    CollapseBvh4(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager);
+    ~CollapseBvh4();
+    /**
+     * @brief Collapse BVH.
+     *
+     * Every other level of the binary BVH is pulled into its parent, so each wide node has up to 4 children.
+     * Wide nodes are written after the binary nodes, which stay intact and keep the leaves.
+     **/
+    void operator()(vk::CommandBuffer command_buffer, uint32_t leaf_count, vk::Buffer bvh, size_t bvh_offset);
+
+    /**
+     * @brief Number of BVH nodes taken by a geometry with a wide BVH.
+     *
+     * Wide nodes take 2 nodes each and start at an even node.
+     **/
+    static uint32_t GetNodeCount(uint32_t leaf_count);
+
+private:
+    vk::DescriptorSet GetDescriptor(vk::Buffer bvh);
+
+    struct CollapseBvh4Impl;
+    std::unique_ptr<CollapseBvh4Impl> impl_;
+};
+
+}  // namespace rt::vulkan
@@ -28,6 +28,30 @@ AllocatedBuffer* CommandStream::GetAllocatedTemporaryBuffer(size_t size)
     return temp_buffer;
 }
 
+UploadRange CommandStream::AllocateUploadRange(size_t size)
+{
+    if (!upload_ring_)
+    {
+        upload_ring_ = device_.AcquireUploadRing();
+    }
+    auto range = upload_ring_->Allocate(size);
+    if (!range)
+    {
+        // Does not fit into the ring, fall back to a dedicated staging buffer.
+        auto temp_buffer = GetAllocatedTemporaryBuffer(size);
+        range            = {temp_buffer->buffer, 0u, temp_buffer->mapped};
+    }
+    return range;
+}
+
+void CommandStream::OnSubmit(vk::Fence fence)
+{
+    if (upload_ring_)
+    {
+        upload_ring_->Submit(fence);
+    }
+}
+
 CommandStream::~CommandStream()
 {
     if (external_)
@@ -37,6 +61,10 @@ CommandStream::~CommandStream()
             device_.ReleaseTemporaryBuffer(buffer);
         }
     }
+    if (upload_ring_)
+    {
+        device_.ReleaseUploadRing(upload_ring_);
+    }
 }
 vk::CommandBuffer CommandStream::Get() const { return command_buffer_; }
 void              CommandStream::Set(vk::CommandBuffer command_buffer) { command_buffer_ = command_buffer; }
@@ -48,5 +76,10 @@ void     rt::vulkan::CommandStream::ClearTemporaryBuffers()
         device_.ReleaseTemporaryBuffer(buffer);
     }
     temp_buffers_.clear();
+    // Stream is about to be reset, so the device is done with everything uploaded through it.
+    if (upload_ring_)
+    {
+        upload_ring_->Reset();
+    }
 }
 }  // namespace rt::vulkan
\ No newline at end of file
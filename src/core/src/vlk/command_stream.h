@@ -40,6 +40,9 @@ public:
 
     // Get temporary allocated buffer and attach it to this command stream.
     AllocatedBuffer*                GetAllocatedTemporaryBuffer(size_t size) override;
+    // Get a persistently mapped sub-range of the stream upload ring.
+    UploadRange                     AllocateUploadRange(size_t size) override;
+    void                            OnSubmit(vk::Fence fence) override;
     void                            ClearTemporaryBuffers() override;
     vk::CommandBuffer               Get() const override;
     void                            Set(vk::CommandBuffer command_buffer) override;
@@ -50,10 +53,15 @@ public:
 
     /// Vulkan things.
     vk::CommandBuffer command_buffer_ = nullptr;
+    /// Command pool owned by a pooled stream, null for external ones.
+    vk::CommandPool command_pool_ = nullptr;
 
     /// Temporary resources attached by the device.
     std::vector<AllocatedBuffer*> temp_buffers_;
 
+    /// Upload ring, acquired on first use and kept while the stream is pooled.
+    UploadRing* upload_ring_ = nullptr;
+
     bool external_ = false;
 };
 }  // namespace rt::vulkan
\ No newline at end of file
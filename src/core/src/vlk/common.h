@@ -86,9 +86,17 @@ struct ChildrenBvhsDesc
 {
     uint32_t                bvhs_count = 0;
     ChildrenBvhsContainer buffers;
+    /** @brief All children carry a 4-wide BVH, so the wide traversal kernels can be used. */
+    bool wide = false;
 };
 
-template <size_t BufSize, size_t DescSize>
+/**
+ * @brief Descriptor sets cached by the buffers they are written with.
+ *
+ * Keyed by buffers only by default, so sets bound to the same buffers at different offsets collide.
+ * Users binding buffer ranges which change between calls key the table by vk::DescriptorBufferInfo instead.
+ **/
+template <size_t BufSize, size_t DescSize, typename KeyT = vk::Buffer>
 class DescriptorCacheTable
 {
     struct BuffersHash
@@ -98,7 +106,14 @@ class DescriptorCacheTable
             std::hash<size_t> hasher;
             seed ^= hasher(size_t(VkBuffer(v))) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
         }
-        size_t operator()(std::array<vk::Buffer, BufSize> const& bufs) const
+        static void hash_combine(size_t& seed, const vk::DescriptorBufferInfo& v)
+        {
+            std::hash<size_t> hasher;
+            hash_combine(seed, v.buffer);
+            seed ^= hasher(size_t(v.offset)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            seed ^= hasher(size_t(v.range)) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        }
+        size_t operator()(std::array<KeyT, BufSize> const& bufs) const
         {
             size_t res = 0;
             for (const auto& buf : bufs)
@@ -109,7 +124,7 @@ class DescriptorCacheTable
         }
     };
 
-    std::unordered_map<std::array<vk::Buffer, BufSize>, std::array<vk::DescriptorSet, DescSize>, BuffersHash>
+    std::unordered_map<std::array<KeyT, BufSize>, std::array<vk::DescriptorSet, DescSize>, BuffersHash>
                                cache_table;
     std::shared_ptr<GpuHelper> gpu_helper;
 
@@ -125,12 +140,9 @@ public:
             }
         }
     }
-    bool Contains(const std::array<vk::Buffer, BufSize>& key) { return cache_table.count(key); }
-    std::array<vk::DescriptorSet, DescSize> Get(const std::array<vk::Buffer, BufSize>& key)
-    {
-        return cache_table.at(key);
-    }
-    void Push(std::array<vk::Buffer, BufSize> key, std::array<vk::DescriptorSet, DescSize> value)
+    bool Contains(const std::array<KeyT, BufSize>& key) { return cache_table.count(key); }
+    std::array<vk::DescriptorSet, DescSize> Get(const std::array<KeyT, BufSize>& key) { return cache_table.at(key); }
+    void Push(std::array<KeyT, BufSize> key, std::array<vk::DescriptorSet, DescSize> value)
     {
         cache_table[key] = value;
     }
@@ -18,9 +18,12 @@ THE SOFTWARE.
 ********************************************************************/
 #include "device.h"
 
+#include <algorithm>
+#include <cstring>
 #include <vector>
 
 #include "src/utils/logger.h"
+#include "src/vlk/profiler.h"
 #include "src/vlk/command_stream.h"
 #include "src/vlk/device_ptr.h"
 #include "src/vlk/event.h"
@@ -32,12 +35,15 @@ static constexpr uint64_t kInfiniteTime       = UINT64_MAX;
 static constexpr auto     VK_VENDOR_ID_AMD    = 0x1002;
 static constexpr auto     VK_VENDOR_ID_NVIDIA = 0x10de;
 static constexpr auto     VK_VENDOR_ID_INTEL  = 0x8086;
+// Temporary staging buffer sizes per pool size class.
+static constexpr size_t kTempBufferSizes[] = {1 * 1024 * 1024, 16 * 1024 * 1024, 256 * 1024 * 1024};
+static constexpr size_t kUploadRingSize    = 4 * 1024 * 1024;
 }  // namespace
 
 
 namespace rt::vulkan
 {
-std::unique_ptr<rt::DeviceBase> CreateDevice() { return std::make_unique<Device>(); }
+std::unique_ptr<rt::DeviceBase> CreateDevice(bool profiling) { return std::make_unique<Device>(profiling); }
 
 std::unique_ptr<rt::DeviceBase> CreateDevice(VkDevice         device,
                                              VkPhysicalDevice ph_device,
@@ -97,12 +103,20 @@ void Device::CreateDeviceAndCommandQueue()
         Logger::Get().Error("No queue for compute");
         throw std::runtime_error("No compute queue.");
     }
+    // Prefer a compute family with a second queue for asynchronous builds.
+    for (uint32_t i = queue_index + 1; i < queue_count && queue_props[queue_index].queueCount < 2; i++)
+    {
+        if ((queue_props[i].queueFlags & vk::QueueFlagBits::eCompute) && queue_props[i].queueCount > 1)
+        {
+            queue_index = i;
+        }
+    }
 
-    float                     queue_prio = 1.0f;
+    float                     queue_prios[] = {1.0f, 1.0f};
     vk::DeviceQueueCreateInfo queue_create_info;
     queue_create_info.queueFamilyIndex = queue_index;
-    queue_create_info.queueCount       = 1;
-    queue_create_info.pQueuePriorities = &queue_prio;
+    queue_create_info.queueCount       = std::min(queue_props[queue_index].queueCount, 2u);
+    queue_create_info.pQueuePriorities = queue_prios;
 
     auto features = physical_device.getFeatures();
 
@@ -110,6 +124,19 @@ void Device::CreateDeviceAndCommandQueue()
     physical_device_descriptor_indexing_features.shaderStorageBufferArrayNonUniformIndexing = true;
     physical_device_descriptor_indexing_features.runtimeDescriptorArray                     = true;
     physical_device_descriptor_indexing_features.descriptorBindingVariableDescriptorCount   = true;
+    physical_device_descriptor_indexing_features.descriptorBindingPartiallyBound            = true;
+    // Timeline semaphores let submissions wait for events on GPU.
+    auto available_extensions = physical_device.enumerateDeviceExtensionProperties();
+    bool timeline_extension =
+        std::any_of(available_extensions.begin(), available_extensions.end(), [](auto const& extension) {
+            return std::strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0;
+        });
+    auto timeline_chain =
+        physical_device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeatures>();
+    auto timeline_support = timeline_chain.get<vk::PhysicalDeviceTimelineSemaphoreFeatures>();
+    timeline_semaphores_ = timeline_extension && timeline_support.timelineSemaphore;
+    vk::PhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_features{timeline_semaphores_};
+    physical_device_descriptor_indexing_features.setPNext(&timeline_semaphore_features);
     vk::PhysicalDeviceFeatures2 features2{};
     features2.setFeatures(features);
     features2.setPNext(&physical_device_descriptor_indexing_features);
@@ -135,6 +162,10 @@ void Device::CreateDeviceAndCommandQueue()
     }
     device_extensions.push_back(VK_EXT_SHADER_SUBGROUP_BALLOT_EXTENSION_NAME);
     device_extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    if (timeline_semaphores_)
+    {
+        device_extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
     device_create_info.enabledExtensionCount   = (uint32_t)device_extensions.size();
     device_create_info.ppEnabledExtensionNames = device_extensions.data();
 
@@ -142,55 +173,134 @@ void Device::CreateDeviceAndCommandQueue()
     auto queue  = device.getQueue(queue_index, 0);
     impl_       = std::make_shared<GpuHelper>(device, physical_device, queue, queue_index, instance);
 
+    main_queue_.queue = queue;
+    if (queue_create_info.queueCount > 1)
+    {
+        async_queue_.queue = device.getQueue(queue_index, 1);
+    }
+
     Logger::Get().Debug("Vulkan device and queue are successfully created");
 }
 
+void Device::CreateTimelineSemaphores()
+{
+    if (!timeline_semaphores_)
+    {
+        return;
+    }
+
+    vk::SemaphoreTypeCreateInfo type_info(vk::SemaphoreType::eTimeline, 0u);
+    vk::SemaphoreCreateInfo     semaphore_info;
+    semaphore_info.setPNext(&type_info);
+    for (auto queue : {&main_queue_, &async_queue_})
+    {
+        if (queue->queue)
+        {
+            queue->timeline = impl_->device.createSemaphore(semaphore_info);
+        }
+    }
+}
+
+void Device::CreateProfiler()
+{
+    auto const& queue_family = impl_->physical_device.getQueueFamilyProperties()[impl_->queue_family_index];
+    if (queue_family.timestampValidBits == 0u)
+    {
+        Logger::Get().Warn("Compute queue does not support timestamps, profiling is disabled");
+        return;
+    }
+    impl_->profiler = std::make_shared<Profiler>(
+        impl_->device, impl_->device_properties.limits.timestampPeriod, queue_family.timestampValidBits);
+}
+
+EventBackend<BackendType::kVulkan>* Device::EventPolicy::Create(size_t)
+{
+    EventBackend<BackendType::kVulkan>* event = new Event;
+    vk::FenceCreateInfo                 fence_info(vk::FenceCreateFlagBits::eSignaled);
+    event->Set(device.createFence(fence_info));
+    return event;
+}
+
+void Device::EventPolicy::Destroy(EventBackend<BackendType::kVulkan>* event)
+{
+    device.destroyFence(event->Get());
+    delete event;
+}
+
+CommandStreamBackend<BackendType::kVulkan>* Device::CommandStreamPolicy::Create(size_t)
+{
+    auto helper = owner->impl_;
+    auto stream = new CommandStream(*owner);
+
+    vk::CommandPoolCreateInfo pool_info;
+    pool_info.queueFamilyIndex = helper->queue_family_index;
+    pool_info.flags            = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+    stream->command_pool_      = helper->device.createCommandPool(pool_info);
+
+    vk::CommandBufferAllocateInfo allocate_info;
+    allocate_info.commandPool        = stream->command_pool_;
+    allocate_info.level              = vk::CommandBufferLevel::ePrimary;
+    allocate_info.commandBufferCount = 1;
+    stream->Set(helper->device.allocateCommandBuffers(allocate_info)[0]);
+    return stream;
+}
+
+void Device::CommandStreamPolicy::Destroy(CommandStreamBackend<BackendType::kVulkan>* command_stream)
+{
+    auto device = owner->impl_->device;
+    auto stream = static_cast<CommandStream*>(command_stream);
+    device.freeCommandBuffers(stream->command_pool_, stream->Get());
+    device.destroyCommandPool(stream->command_pool_);
+    stream->Set(nullptr);
+    delete stream;
+}
+
+size_t Device::TemporaryBufferPolicy::SizeClass(size_t size)
+{
+    for (size_t i = 0; i < kSizeClassCount; ++i)
+    {
+        if (size <= kTempBufferSizes[i])
+        {
+            return i;
+        }
+    }
+    throw std::runtime_error("Temporary buffer size is too big.");
+}
+
+AllocatedBuffer* Device::TemporaryBufferPolicy::Create(size_t size_class)
+{
+    AllocatedBuffer* buffer = new AllocatedBuffer();
+    *buffer                 = gpu_helper->CreateStagingBuffer(kTempBufferSizes[size_class]);
+    // Keep staging memory mapped, it is unmapped on destruction.
+    buffer->Map();
+    return buffer;
+}
+
+void Device::TemporaryBufferPolicy::Destroy(AllocatedBuffer* buffer)
+{
+    buffer->Destroy();
+    delete buffer;
+}
+
+UploadRing* Device::UploadRingPolicy::Create(size_t) { return new UploadRing(gpu_helper, kUploadRingSize); }
+
 void Device::InitializePools()
 {
     Logger::Get().Debug("Initializing resource pools");
-    // Initialize event pool creation functions.
-    event_pool_.SetCreateFn([device = impl_->device]() {
-        EventBackend<BackendType::kVulkan>* event = new Event;
-        vk::FenceCreateInfo                 fence_info(vk::FenceCreateFlagBits::eSignaled);
-        event->Set(device.createFence(fence_info));
-        return event;
-    });
-
-    event_pool_.SetDeleteFn([device = impl_->device](EventBackend<BackendType::kVulkan>* event) {
-        device.destroyFence(event->Get());
-        delete event;
-    });
-
-    // Initialize command stream pool funcs.
-    command_stream_pool_.SetCreateFn([me = this, device = impl_->device, pool = impl_->command_pool]() {
-        CommandStreamBackend<BackendType::kVulkan>* stream = new CommandStream(*me);
-        vk::CommandBufferAllocateInfo               allocate_info;
-        allocate_info.commandPool        = pool;
-        allocate_info.level              = vk::CommandBufferLevel::ePrimary;
-        allocate_info.commandBufferCount = 1;
-        stream->Set(device.allocateCommandBuffers(allocate_info)[0]);
-        return stream;
-    });
-
-    command_stream_pool_.SetDeleteFn([device = impl_->device, pool = impl_->command_pool](
-                                         CommandStreamBackend<BackendType::kVulkan>* command_stream) {
-        device.freeCommandBuffers(pool, command_stream->Get());
-        command_stream->Set(nullptr);
-        delete command_stream;
-    });
-
-    // Prepare temporary resource pool for staging buffers.
-    temporary_buffer_pool_.SetCreateFn([this]() {
-        constexpr size_t kMaxTempBufferSize = 256 * 1024 * 1024;
-        AllocatedBuffer* buffer             = new AllocatedBuffer();
-        *buffer                             = impl_->CreateStagingBuffer(kMaxTempBufferSize);
-        return buffer;
-    });
-
-    temporary_buffer_pool_.SetDeleteFn([](AllocatedBuffer* buffer) {
-        buffer->Destroy();
-        delete buffer;
-    });
+    event_pool_.policy().device                = impl_->device;
+    command_stream_pool_.policy().owner        = this;
+    temporary_buffer_pool_.policy().gpu_helper = impl_.get();
+    upload_ring_pool_.policy().gpu_helper      = impl_;
+}
+
+AllocatedBuffer* Device::AcquireTemporaryBuffer(size_t size)
+{
+    return temporary_buffer_pool_.AcquireObject(TemporaryBufferPolicy::SizeClass(size));
+}
+
+void Device::ReleaseTemporaryBuffer(AllocatedBuffer* buffer)
+{
+    temporary_buffer_pool_.ReleaseObject(buffer, TemporaryBufferPolicy::SizeClass(buffer->size));
 }
 
 DevicePtrBackend<BackendType::kVulkan>* Device::CreateAllocatedBuffer(size_t size)
@@ -212,6 +322,10 @@ void Device::ReleaseCommandStream(CommandStreamBase* command_stream_base)
 
     // Release and clear temporary objects back to the pool
     command_stream->ClearTemporaryBuffers();
+    if (impl_->profiler)
+    {
+        impl_->profiler->Discard(command_stream->Get());
+    }
     command_stream->Get().reset(vk::CommandBufferResetFlagBits::eReleaseResources);
 
     // Release command stream back to the pool.
@@ -221,12 +335,25 @@ void Device::ReleaseCommandStream(CommandStreamBase* command_stream_base)
 EventBase* Device::SubmitCommandStream(CommandStreamBase* command_stream_base, EventBase* wait_event_base)
 {
     Logger::Get().Debug("Device::SubmitCommandStream()");
+    return Submit(main_queue_, command_stream_base, wait_event_base);
+}
 
+EventBase* Device::SubmitCommandStreamAsync(CommandStreamBase* command_stream_base, EventBase* wait_event_base)
+{
+    Logger::Get().Debug("Device::SubmitCommandStreamAsync()");
+    return Submit(async_queue_.queue ? async_queue_ : main_queue_, command_stream_base, wait_event_base);
+}
+
+EventBase* Device::Submit(Queue& queue, CommandStreamBase* command_stream_base, EventBase* wait_event_base)
+{
     auto command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+    auto wait_event     = dynamic_cast<EventBackend<BackendType::kVulkan>*>(wait_event_base);
 
     EventBackend<BackendType::kVulkan>* event = event_pool_.AcquireObject();
 
-    if (wait_event_base)
+    // Events signaling a timeline semaphore are waited for in the queue, others block until they have signaled.
+    bool gpu_wait = wait_event && wait_event->Semaphore();
+    if (wait_event && !gpu_wait)
     {
         WaitEvent(wait_event_base);
     }
@@ -235,7 +362,35 @@ EventBase* Device::SubmitCommandStream(CommandStreamBase* command_stream_base, E
 
     impl_->device.resetFences({event->Get()});
     auto cmd_buffer = command_stream->Get();
-    impl_->queue.submit(vk::SubmitInfo(0, nullptr, nullptr, 1, &cmd_buffer, 0, nullptr), event->Get());
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        vk::SubmitInfo                  submit_info(0, nullptr, nullptr, 1, &cmd_buffer, 0, nullptr);
+        vk::TimelineSemaphoreSubmitInfo timeline_info;
+        vk::Semaphore                   wait_semaphore = gpu_wait ? wait_event->Semaphore() : nullptr;
+        uint64_t                        wait_value     = gpu_wait ? wait_event->Value() : 0u;
+        vk::PipelineStageFlags          wait_stage     = vk::PipelineStageFlagBits::eAllCommands;
+        uint64_t                        signal_value   = queue.submitted + 1;
+        if (queue.timeline)
+        {
+            if (gpu_wait)
+            {
+                submit_info.setWaitSemaphoreCount(1).setPWaitSemaphores(&wait_semaphore);
+                submit_info.setPWaitDstStageMask(&wait_stage);
+                timeline_info.setWaitSemaphoreValueCount(1).setPWaitSemaphoreValues(&wait_value);
+            }
+            submit_info.setSignalSemaphoreCount(1).setPSignalSemaphores(&queue.timeline);
+            timeline_info.setSignalSemaphoreValueCount(1).setPSignalSemaphoreValues(&signal_value);
+            submit_info.setPNext(&timeline_info);
+        }
+        queue.queue.submit(submit_info, event->Get());
+        queue.submitted = signal_value;
+        event->SetTimeline(queue.timeline, signal_value);
+    }
+    if (impl_->profiler)
+    {
+        impl_->profiler->OnSubmit(cmd_buffer, event);
+    }
+    command_stream->OnSubmit(event->Get());
     return event;
 }
 
@@ -243,6 +398,10 @@ void Device::ReleaseEvent(EventBase* event_base)
 {
     Logger::Get().Debug("Device::ReleaseEvent()");
     EventBackend<BackendType::kVulkan>* event = dynamic_cast<EventBackend<BackendType::kVulkan>*>(event_base);
+    if (impl_->profiler)
+    {
+        impl_->profiler->Release(event);
+    }
     event_pool_.ReleaseObject(event);
 }
 
@@ -272,18 +431,46 @@ void Device::WaitEvent(EventBase* event_base)
     }
 }
 
-Device::Device()
+std::vector<ProfilingScope> Device::GetProfilingResults(EventBase* event_base)
+{
+    Logger::Get().Debug("Device::GetProfilingResults()");
+    WaitEvent(event_base);
+    if (!impl_->profiler)
+    {
+        return {};
+    }
+    return impl_->profiler->GetResults(dynamic_cast<EventBackend<BackendType::kVulkan>*>(event_base));
+}
+
+Device::Device(bool profiling)
 {
     CreateDeviceAndCommandQueue();
+    CreateTimelineSemaphores();
+    if (profiling)
+    {
+        CreateProfiler();
+    }
     InitializePools();
 }
 
 Device::Device(VkDevice device, VkPhysicalDevice physical_device, VkQueue command_queue, uint32_t queue_family_index)
     : impl_(std::make_unique<GpuHelper>(device, physical_device, command_queue, queue_family_index))
 {
+    // Features and queues of an external device are not known, so submissions stay on its queue with CPU waits.
+    main_queue_.queue = command_queue;
     InitializePools();
 }
 
-Device::~Device() = default;
+Device::~Device()
+{
+    for (auto queue : {&main_queue_, &async_queue_})
+    {
+        if (queue->timeline)
+        {
+            queue->queue.waitIdle();
+            impl_->device.destroySemaphore(queue->timeline);
+        }
+    }
+}
 
 }  // namespace rt::vulkan
\ No newline at end of file
@@ -21,6 +21,7 @@ THE SOFTWARE.
 #include <atomic>
 #include <cstdint>
 #include <memory>
+#include <mutex>
 
 #include "src/utils/pool.h"
 #include "src/vlk/device_ptr.h"
@@ -37,8 +38,8 @@ namespace rt::vulkan
 class Device : public DeviceBackend<BackendType::kVulkan>
 {
 public:
-    // Constructor.
-    Device();
+    // Constructor, profiling brackets kernel dispatches with timestamp queries.
+    explicit Device(bool profiling = false);
     Device(VkDevice device, VkPhysicalDevice physical_device, VkQueue queue, uint32_t queue_family_index);
     // Destructor.
     ~Device();
@@ -75,6 +76,18 @@ public:
      **/
     EventBase* SubmitCommandStream(CommandStreamBase* command_stream_base, EventBase* wait_event_base) override;
 
+    /**
+     * @brief Submit a command stream to the asynchronous compute queue.
+     *
+     * Uses a second queue of the compute family when the device was created by the library and the family has one,
+     * so builds may overlap with traces submitted to the main queue.
+     *
+     * @param command_stream_base Command stream to submit.
+     * @param wait_event_base Event to wait for before submitting (or in the submission queue).
+     * @return Event marking a submission.
+     **/
+    EventBase* SubmitCommandStreamAsync(CommandStreamBase* command_stream_base, EventBase* wait_event_base) override;
+
     /**
      * @brief Releases an event.
      *
@@ -92,6 +105,13 @@ public:
      **/
     void WaitEvent(EventBase* event_base) override;
 
+    /**
+     * @brief Get GPU durations of the kernels of a submission.
+     *
+     * Waits for the event, scopes are named after the kernels dispatched.
+     **/
+    std::vector<ProfilingScope> GetProfilingResults(EventBase* event_base) override;
+
     /**
      * @brief Create allocated buffer
      *
@@ -103,28 +123,94 @@ public:
     /// Allocate temporary staging buffer.
     // Get an underlying Vulkan device helpers.
     std::shared_ptr<GpuHelper> Get() const override;
-    AllocatedBuffer*           AcquireTemporaryBuffer(size_t) override { return temporary_buffer_pool_.AcquireObject(); }
-    void ReleaseTemporaryBuffer(AllocatedBuffer* buffer) override { temporary_buffer_pool_.ReleaseObject(buffer); }
+    AllocatedBuffer*           AcquireTemporaryBuffer(size_t size) override;
+    void                       ReleaseTemporaryBuffer(AllocatedBuffer* buffer) override;
+    /// Acquire upload ring for a command stream.
+    UploadRing* AcquireUploadRing() override { return upload_ring_pool_.AcquireObject(); }
+    void        ReleaseUploadRing(UploadRing* ring) override
+    {
+        ring->Reset();
+        upload_ring_pool_.ReleaseObject(ring);
+    }
 
 private:
-    void InitializePools();
-    void CreateDeviceAndCommandQueue();
+    // Submission queue with a timeline semaphore counting its submissions.
+    struct Queue
+    {
+        vk::Queue     queue     = nullptr;
+        vk::Semaphore timeline  = nullptr;
+        uint64_t      submitted = 0u;
+    };
+
+    void       InitializePools();
+    void       CreateDeviceAndCommandQueue();
+    void       CreateTimelineSemaphores();
+    void       CreateProfiler();
+    EventBase* Submit(Queue& queue, CommandStreamBase* command_stream_base, EventBase* wait_event_base);
+
+    // Pool policies, bound to the device in InitializePools().
+    struct EventPolicy
+    {
+        EventBackend<BackendType::kVulkan>* Create(size_t);
+        void                                Destroy(EventBackend<BackendType::kVulkan>* event);
+
+        vk::Device device = nullptr;
+    };
+
+    // Every stream owns its command pool, so streams can be recorded from different threads.
+    struct CommandStreamPolicy
+    {
+        CommandStreamBackend<BackendType::kVulkan>* Create(size_t);
+        void Destroy(CommandStreamBackend<BackendType::kVulkan>* command_stream);
+
+        Device* owner = nullptr;
+    };
+
+    struct TemporaryBufferPolicy
+    {
+        static constexpr size_t kSizeClassCount = 3;
+        // Size class fitting the requested size.
+        static size_t SizeClass(size_t size);
+
+        AllocatedBuffer* Create(size_t size_class);
+        void             Destroy(AllocatedBuffer* buffer);
+
+        GpuHelper* gpu_helper = nullptr;
+    };
+
+    struct UploadRingPolicy
+    {
+        UploadRing* Create(size_t);
+        void        Destroy(UploadRing* ring) { delete ring; }
+
+        std::shared_ptr<GpuHelper> gpu_helper;
+    };
 
 private:
     std::shared_ptr<GpuHelper> impl_;
 
+    // Queue submission has to be externally synchronized.
+    std::mutex queue_mutex_;
+    // Main queue and the asynchronous compute queue, the latter is null if the compute family has a single queue.
+    Queue main_queue_;
+    Queue async_queue_;
+    // Wait events are waited for on GPU via timeline semaphores if supported, on CPU otherwise.
+    bool timeline_semaphores_ = false;
+
     // Event pool for submission events.
-    Pool<EventBackend<BackendType::kVulkan>> event_pool_;
+    Pool<EventBackend<BackendType::kVulkan>, EventPolicy> event_pool_;
+    // Upload ring pool, has to outlive command streams holding the rings.
+    Pool<UploadRing, UploadRingPolicy> upload_ring_pool_;
     // Command stream pool for submissions pulling.
-    Pool<CommandStreamBackend<BackendType::kVulkan>> command_stream_pool_;
+    Pool<CommandStreamBackend<BackendType::kVulkan>, CommandStreamPolicy> command_stream_pool_;
     // Temporary buffer pool.
-    Pool<AllocatedBuffer> temporary_buffer_pool_;
+    Pool<AllocatedBuffer, TemporaryBufferPolicy, TemporaryBufferPolicy::kSizeClassCount> temporary_buffer_pool_;
 
     friend class CommandStream;
 };
 
 /// Create device from scratch.
-std::unique_ptr<rt::DeviceBase> CreateDevice();
+std::unique_ptr<rt::DeviceBase> CreateDevice(bool profiling = false);
 /// Create device from existing Vulkan device and queue.
 std::unique_ptr<rt::DeviceBase> CreateDevice(VkDevice         device,
                                              VkPhysicalDevice physical_device,
@@ -0,0 +1,186 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "dispatch_args.h"
+
+namespace rt::vulkan
+{
+namespace
+{
+constexpr char const* s_dispatch_args_kernel_name = "dispatch_args.comp.spv";
+constexpr char const* s_reset_counter_kernel_name = "reset_counter.comp.spv";
+}  // namespace
+
+struct DispatchArgs::DispatchArgsImpl
+{
+#pragma pack(push, 1)
+    struct PushConstants
+    {
+        uint32_t g_num_rays;
+        uint32_t g_group_size;
+    };
+#pragma pack(pop)
+
+    std::shared_ptr<GpuHelper> gpu_helper_;
+    ShaderManager const&       shader_manager_;
+    ShaderPtr                  kernel_ = nullptr;
+    std::vector<DescriptorSet> desc_set_;
+    ShaderPtr                  reset_kernel_ = nullptr;
+    std::vector<DescriptorSet> reset_desc_set_;
+    // Keyed by buffer ranges, ray counts may live at any offset of a buffer.
+    DescriptorCacheTable<1, 1, vk::DescriptorBufferInfo> cache_;
+    // Keyed by buffer ranges holding the counters.
+    DescriptorCacheTable<1, 1, vk::DescriptorBufferInfo> reset_cache_;
+    // Group counts in x, y and z.
+    AllocatedBuffer args_;
+
+    DispatchArgsImpl(std::shared_ptr<GpuHelper> helper, ShaderManager const& manager)
+        : gpu_helper_(helper), shader_manager_(manager), cache_(helper), reset_cache_(helper)
+    {
+        ShaderManager::KernelID id = s_dispatch_args_kernel_name;
+        kernel_                    = shader_manager_.CreateKernel(id);
+        desc_set_                  = shader_manager_.CreateDescriptorSets(kernel_);
+        shader_manager_.PrepareKernel(id, desc_set_);
+
+        ShaderManager::KernelID reset_id = s_reset_counter_kernel_name;
+        reset_kernel_                    = shader_manager_.CreateKernel(reset_id);
+        reset_desc_set_                  = shader_manager_.CreateDescriptorSets(reset_kernel_);
+        shader_manager_.PrepareKernel(reset_id, reset_desc_set_);
+
+        args_ = gpu_helper_->CreateDeviceBuffer(
+            vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer, 3 * sizeof(uint32_t));
+    }
+    ~DispatchArgsImpl()
+    {
+        for (auto& desc : desc_set_)
+        {
+            gpu_helper_->device.destroyDescriptorSetLayout(desc.layout_);
+        }
+        for (auto& desc : reset_desc_set_)
+        {
+            gpu_helper_->device.destroyDescriptorSetLayout(desc.layout_);
+        }
+        args_.Destroy();
+    }
+
+    vk::DescriptorSet GetDescriptor(vk::Buffer ray_count_buffer, size_t ray_count_buffer_offset)
+    {
+        std::array<vk::DescriptorBufferInfo, 1> key = {
+            vk::DescriptorBufferInfo{ray_count_buffer, ray_count_buffer_offset, VK_WHOLE_SIZE}};
+        if (cache_.Contains(key))
+        {
+            return cache_.Get(key)[0];
+        }
+
+        vk::DescriptorBufferInfo info[] = {key[0], {args_.buffer, 0, VK_WHOLE_SIZE}};
+
+        vk::DescriptorSet descriptor_set = gpu_helper_->AllocateDescriptorSet(desc_set_[0].layout_);
+        gpu_helper_->WriteDescriptorSet(descriptor_set, info, 2u);
+        cache_.Push(key, {descriptor_set});
+        return descriptor_set;
+    }
+
+    vk::DescriptorSet GetResetDescriptor(vk::Buffer buffer, size_t buffer_offset)
+    {
+        std::array<vk::DescriptorBufferInfo, 1> key = {vk::DescriptorBufferInfo{buffer, buffer_offset, VK_WHOLE_SIZE}};
+        if (reset_cache_.Contains(key))
+        {
+            return reset_cache_.Get(key)[0];
+        }
+
+        vk::DescriptorSet descriptor_set = gpu_helper_->AllocateDescriptorSet(reset_desc_set_[0].layout_);
+        gpu_helper_->WriteDescriptorSet(descriptor_set, key.data(), 1u);
+        reset_cache_.Push(key, {descriptor_set});
+        return descriptor_set;
+    }
+};
+
+DispatchArgs::DispatchArgs(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager)
+    : impl_(std::make_unique<DispatchArgsImpl>(gpu_helper, shader_manager))
+{
+}
+DispatchArgs::~DispatchArgs() = default;
+
+void DispatchArgs::operator()(vk::CommandBuffer command_buffer,
+                              vk::Buffer        ray_count_buffer,
+                              size_t            ray_count_buffer_offset,
+                              uint32_t          max_ray_count,
+                              uint32_t          group_size)
+{
+    auto descriptor_set = impl_->GetDescriptor(ray_count_buffer, ray_count_buffer_offset);
+
+    // Previous indirect dispatch may still read the arguments.
+    impl_->gpu_helper_->EncodeBufferBarrier(impl_->args_.buffer,
+                                            vk::AccessFlagBits::eIndirectCommandRead,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::PipelineStageFlagBits::eDrawIndirect,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer);
+
+    DispatchArgsImpl::PushConstants push_consts = {max_ray_count, group_size};
+    impl_->gpu_helper_->EncodePushConstant(
+        impl_->kernel_->pipeline_layout, 0u, sizeof(push_consts), &push_consts, command_buffer);
+    impl_->gpu_helper_->EncodeBindDescriptorSets(
+        &descriptor_set, 1u, 0u, impl_->kernel_->pipeline_layout, command_buffer);
+    impl_->shader_manager_.EncodeDispatch1D(*impl_->kernel_, 1u, command_buffer);
+
+    impl_->gpu_helper_->EncodeBufferBarrier(impl_->args_.buffer,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eIndirectCommandRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eDrawIndirect,
+                                            command_buffer);
+}
+
+void DispatchArgs::ResetCounter(vk::CommandBuffer command_buffer,
+                                vk::Buffer        buffer,
+                                size_t            buffer_offset,
+                                uint32_t          counter_index)
+{
+    auto   descriptor_set = impl_->GetResetDescriptor(buffer, buffer_offset);
+    size_t counter_offset = buffer_offset + sizeof(uint32_t) * counter_index;
+
+    // Previous dispatch may still use the counter.
+    impl_->gpu_helper_->EncodeBufferBarrier(buffer,
+                                            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer,
+                                            counter_offset,
+                                            sizeof(uint32_t));
+
+    impl_->gpu_helper_->EncodePushConstant(
+        impl_->reset_kernel_->pipeline_layout, 0u, sizeof(counter_index), &counter_index, command_buffer);
+    impl_->gpu_helper_->EncodeBindDescriptorSets(
+        &descriptor_set, 1u, 0u, impl_->reset_kernel_->pipeline_layout, command_buffer);
+    impl_->shader_manager_.EncodeDispatch1D(*impl_->reset_kernel_, 1u, command_buffer);
+
+    impl_->gpu_helper_->EncodeBufferBarrier(buffer,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer,
+                                            counter_offset,
+                                            sizeof(uint32_t));
+}
+
+vk::Buffer DispatchArgs::GetArgsBuffer() const { return impl_->args_.buffer; }
+
+}  // namespace rt::vulkan
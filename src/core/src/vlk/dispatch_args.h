@@ -0,0 +1,76 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vlk/common.h"
+#include "vlk/gpu_helper.h"
+#include "vlk/shader_manager.h"
+
+namespace rt::vulkan
+{
+/**
+ * @brief Indirect dispatch arguments from a GPU ray count.
+ *
+ * Converts the indirect ray count into group counts for vkCmdDispatchIndirect,
+ * so kernels fed by compacted ray buffers only launch the groups covering live rays.
+ * Also clears work counters of persistent kernels.
+ **/
+class DispatchArgs
+{
+public:
+    DispatchArgs(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager);
+    ~DispatchArgs();
+
+    /**
+     * @brief Write arguments dispatching min(ray count, max_ray_count) threads in groups of group_size.
+     *
+     * The arguments are ready for an indirect dispatch after the call. They are overwritten by the next call,
+     * which waits for the previous dispatch to read them.
+     **/
+    void operator()(vk::CommandBuffer command_buffer,
+                    vk::Buffer        ray_count_buffer,
+                    size_t            ray_count_buffer_offset,
+                    uint32_t          max_ray_count,
+                    uint32_t          group_size);
+
+    /**
+     * @brief Clear the counter at index counter_index of the uint array bound at buffer_offset.
+     *
+     * A compute dispatch instead of a transfer fill, so counters in user scratch do not require transfer usage.
+     * The counter is ready for compute reads and writes after the call.
+     **/
+    void ResetCounter(vk::CommandBuffer command_buffer,
+                      vk::Buffer        buffer,
+                      size_t            buffer_offset,
+                      uint32_t          counter_index);
+
+    /**
+     * @brief Buffer holding the arguments at offset 0.
+     **/
+    vk::Buffer GetArgsBuffer() const;
+
+private:
+    struct DispatchArgsImpl;
+    std::unique_ptr<DispatchArgsImpl> impl_;
+};
+
+}  // namespace rt::vulkan
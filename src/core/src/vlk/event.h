@@ -34,11 +34,21 @@ public:
     Event() = default;
     /// Destructor.
     virtual ~Event() = default;
-    vk::Fence Get() const override { return fence_; }
-    void      Set(vk::Fence f) override { fence_ = f; }
+    vk::Fence     Get() const override { return fence_; }
+    void          Set(vk::Fence f) override { fence_ = f; }
+    vk::Semaphore Semaphore() const override { return semaphore_; }
+    uint64_t      Value() const override { return value_; }
+    void          SetTimeline(vk::Semaphore semaphore, uint64_t value) override
+    {
+        semaphore_ = semaphore;
+        value_     = value;
+    }
 
 private:
     /// Fence for GPU work submission sync.
     vk::Fence fence_ = nullptr;
+    /// Timeline semaphore of the submission queue and its value signaled by the submission, null if unsupported.
+    vk::Semaphore semaphore_ = nullptr;
+    uint64_t      value_     = 0u;
 };
 }  // namespace rt::vulkan
\ No newline at end of file
@@ -18,30 +18,74 @@ THE SOFTWARE.
 ********************************************************************/
 #include "geometry_trace.h"
 
+#include <algorithm>
+#include <cstring>
+#include <string>
 #include <unordered_map>
 
 namespace rt::vulkan
 {
 namespace
 {
-constexpr char const* s_trace_full_closest_kernel_name     = "trace_geometry_full_closest.comp.spv";
-constexpr char const* s_trace_full_any_kernel_name         = "trace_geometry_full_any.comp.spv";
-constexpr char const* s_trace_instance_closest_kernel_name = "trace_geometry_instance_closest.comp.spv";
-constexpr char const* s_trace_instance_any_kernel_name     = "trace_geometry_instance_any.comp.spv";
+constexpr char const* s_trace_full_closest_kernel_name        = "trace_geometry_full_closest.comp.spv";
+constexpr char const* s_trace_full_any_kernel_name            = "trace_geometry_full_any.comp.spv";
+constexpr char const* s_trace_instance_closest_kernel_name    = "trace_geometry_instance_closest.comp.spv";
+constexpr char const* s_trace_instance_any_kernel_name        = "trace_geometry_instance_any.comp.spv";
+constexpr char const* s_trace_candidates_closest_kernel_name  = "trace_geometry_candidates_closest.comp.spv";
+constexpr char const* s_trace_candidates_any_kernel_name      = "trace_geometry_candidates_any.comp.spv";
+constexpr char const* s_trace_occlusion_any_kernel_name       = "trace_geometry_occlusion_any.comp.spv";
+constexpr char const* s_trace_full_normal_closest_kernel_name = "trace_geometry_full_normal_closest.comp.spv";
+constexpr char const* s_trace_full_normal_any_kernel_name     = "trace_geometry_full_normal_any.comp.spv";
 
-constexpr char const* s_trace_full_closest_indirect_kernel_name     = "trace_geometry_full_closest_i.comp.spv";
-constexpr char const* s_trace_full_any_indirect_kernel_name         = "trace_geometry_full_any_i.comp.spv";
-constexpr char const* s_trace_instance_closest_indirect_kernel_name = "trace_geometry_instance_closest_i.comp.spv";
-constexpr char const* s_trace_instance_any_indirect_kernel_name     = "trace_geometry_instance_any_i.comp.spv";
+constexpr char const* s_trace_full_closest_indirect_kernel_name        = "trace_geometry_full_closest_i.comp.spv";
+constexpr char const* s_trace_full_any_indirect_kernel_name            = "trace_geometry_full_any_i.comp.spv";
+constexpr char const* s_trace_instance_closest_indirect_kernel_name    = "trace_geometry_instance_closest_i.comp.spv";
+constexpr char const* s_trace_instance_any_indirect_kernel_name        = "trace_geometry_instance_any_i.comp.spv";
+constexpr char const* s_trace_candidates_closest_indirect_kernel_name  = "trace_geometry_candidates_closest_i.comp.spv";
+constexpr char const* s_trace_candidates_any_indirect_kernel_name      = "trace_geometry_candidates_any_i.comp.spv";
+constexpr char const* s_trace_occlusion_any_indirect_kernel_name       = "trace_geometry_occlusion_any_i.comp.spv";
+constexpr char const* s_trace_full_normal_closest_indirect_kernel_name =
+    "trace_geometry_full_normal_closest_i.comp.spv";
+constexpr char const* s_trace_full_normal_any_indirect_kernel_name     = "trace_geometry_full_normal_any_i.comp.spv";
+
+constexpr char const* s_trace_wide_full_closest_kernel_name        = "trace_geometry_wide_full_closest.comp.spv";
+constexpr char const* s_trace_wide_full_any_kernel_name            = "trace_geometry_wide_full_any.comp.spv";
+constexpr char const* s_trace_wide_instance_closest_kernel_name    = "trace_geometry_wide_instance_closest.comp.spv";
+constexpr char const* s_trace_wide_instance_any_kernel_name        = "trace_geometry_wide_instance_any.comp.spv";
+constexpr char const* s_trace_wide_candidates_closest_kernel_name  = "trace_geometry_wide_candidates_closest.comp.spv";
+constexpr char const* s_trace_wide_candidates_any_kernel_name      = "trace_geometry_wide_candidates_any.comp.spv";
+constexpr char const* s_trace_wide_occlusion_any_kernel_name       = "trace_geometry_wide_occlusion_any.comp.spv";
+constexpr char const* s_trace_wide_full_normal_closest_kernel_name = "trace_geometry_wide_full_normal_closest.comp.spv";
+constexpr char const* s_trace_wide_full_normal_any_kernel_name     = "trace_geometry_wide_full_normal_any.comp.spv";
+
+constexpr char const* s_trace_wide_full_closest_indirect_kernel_name =
+    "trace_geometry_wide_full_closest_i.comp.spv";
+constexpr char const* s_trace_wide_full_any_indirect_kernel_name            = "trace_geometry_wide_full_any_i.comp.spv";
+constexpr char const* s_trace_wide_instance_closest_indirect_kernel_name =
+    "trace_geometry_wide_instance_closest_i.comp.spv";
+constexpr char const* s_trace_wide_instance_any_indirect_kernel_name =
+    "trace_geometry_wide_instance_any_i.comp.spv";
+constexpr char const* s_trace_wide_candidates_closest_indirect_kernel_name =
+    "trace_geometry_wide_candidates_closest_i.comp.spv";
+constexpr char const* s_trace_wide_candidates_any_indirect_kernel_name =
+    "trace_geometry_wide_candidates_any_i.comp.spv";
+constexpr char const* s_trace_wide_occlusion_any_indirect_kernel_name =
+    "trace_geometry_wide_occlusion_any_i.comp.spv";
+constexpr char const* s_trace_wide_full_normal_closest_indirect_kernel_name =
+    "trace_geometry_wide_full_normal_closest_i.comp.spv";
+constexpr char const* s_trace_wide_full_normal_any_indirect_kernel_name =
+    "trace_geometry_wide_full_normal_any_i.comp.spv";
 
 struct TraceKey
 {
     RRIntersectQuery       query;
     RRIntersectQueryOutput query_output;
     bool                   indirect;
+    bool                   wide;
     bool                   operator==(const TraceKey& other) const
     {
-        return (query == other.query && query_output == other.query_output && indirect == other.indirect);
+        return (query == other.query && query_output == other.query_output && indirect == other.indirect &&
+                wide == other.wide);
     }
 };
 struct KeyHasher
@@ -50,19 +94,28 @@ struct KeyHasher
     {
         using std::hash;
         constexpr size_t kNumber = 17;
-        return kNumber * kNumber * k.query + kNumber * k.query_output + uint32_t(k.indirect);
+        return kNumber * kNumber * k.query + kNumber * k.query_output + 2 * uint32_t(k.indirect) + uint32_t(k.wide);
     }
 };
 struct TraceValue
 {
     TraceValue(char const* kernel_name) : name(kernel_name) {}
-    char const*                name;
+    std::string                name;
     std::vector<DescriptorSet> desc_set;
     ShaderPtr                  kernel;
 };
 
 constexpr uint32_t kGroupSize = 128u;
-constexpr uint32_t kStackSize = 64u;
+constexpr uint32_t kDefaultStackSize = 64u;
+// Groups launched by persistent-threads kernels, enough to fill the machines the kernels are tuned for.
+constexpr uint32_t kPersistentGroupCount = 512u;
+
+// Persistent-threads variants of the binary BVH kernels carry "persistent_" after the common prefix.
+std::string GetPersistentKernelName(std::string const& name)
+{
+    constexpr char const* kPrefix = "trace_geometry_";
+    return kPrefix + std::string("persistent_") + name.substr(std::strlen(kPrefix));
+}
 }  // namespace
 
 struct TraceGeometry::TraceGeometryImpl
@@ -72,33 +125,128 @@ struct TraceGeometry::TraceGeometryImpl
 
     // shader things
     std::unordered_map<TraceKey, TraceValue, KeyHasher> trace_kernels_ = {
-        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, false}, {s_trace_full_closest_kernel_name}},
-        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, false},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, false, false},
+         {s_trace_full_closest_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, false, false},
          {s_trace_instance_closest_kernel_name}},
-        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, false}, {s_trace_full_any_kernel_name}},
-        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, false}, {s_trace_instance_any_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, false, false}, {s_trace_full_any_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, false, false},
+         {s_trace_instance_any_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_CANDIDATES, false, false},
+         {s_trace_candidates_closest_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_CANDIDATES, false, false},
+         {s_trace_candidates_any_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT, false, false},
+         {s_trace_occlusion_any_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL, false, false},
+         {s_trace_full_normal_closest_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL, false, false},
+         {s_trace_full_normal_any_kernel_name}},
 
-        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, true},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, true, false},
          {s_trace_full_closest_indirect_kernel_name}},
-        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, true},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, true, false},
          {s_trace_instance_closest_indirect_kernel_name}},
-        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, true}, {s_trace_full_any_indirect_kernel_name}},
-        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, true},
-         {s_trace_instance_any_indirect_kernel_name}}};
-    DescriptorCacheTable<5, 1> cache_;
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, true, false},
+         {s_trace_full_any_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, true, false},
+         {s_trace_instance_any_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_CANDIDATES, true, false},
+         {s_trace_candidates_closest_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_CANDIDATES, true, false},
+         {s_trace_candidates_any_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT, true, false},
+         {s_trace_occlusion_any_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL, true, false},
+         {s_trace_full_normal_closest_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL, true, false},
+         {s_trace_full_normal_any_indirect_kernel_name}},
 
-    TraceGeometryImpl(std::shared_ptr<GpuHelper> helper, ShaderManager const& shader_manager)
-        : gpu_helper_(helper), shader_manager_(shader_manager), cache_(gpu_helper_)
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, false, true},
+         {s_trace_wide_full_closest_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, false, true},
+         {s_trace_wide_instance_closest_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, false, true},
+         {s_trace_wide_full_any_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, false, true},
+         {s_trace_wide_instance_any_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_CANDIDATES, false, true},
+         {s_trace_wide_candidates_closest_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_CANDIDATES, false, true},
+         {s_trace_wide_candidates_any_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT, false, true},
+         {s_trace_wide_occlusion_any_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL, false, true},
+         {s_trace_wide_full_normal_closest_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL, false, true},
+         {s_trace_wide_full_normal_any_kernel_name}},
+
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, true, true},
+         {s_trace_wide_full_closest_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, true, true},
+         {s_trace_wide_instance_closest_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, true, true},
+         {s_trace_wide_full_any_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_INSTANCE_ID, true, true},
+         {s_trace_wide_instance_any_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_CANDIDATES, true, true},
+         {s_trace_wide_candidates_closest_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_CANDIDATES, true, true},
+         {s_trace_wide_candidates_any_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT, true, true},
+         {s_trace_wide_occlusion_any_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL, true, true},
+         {s_trace_wide_full_normal_closest_indirect_kernel_name}},
+        {{RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL, true, true},
+         {s_trace_wide_full_normal_any_indirect_kernel_name}}};
+    // Keyed by buffer ranges, reordered traces bind rays and hits at offsets depending on the ray count.
+    DescriptorCacheTable<5, 1, vk::DescriptorBufferInfo> cache_;
+
+    // Indirect traces launch the groups covering the ray count only.
+    DispatchArgs dispatch_args_;
+    // Binary BVHs are traversed by persistent threads fetching rays from a work counter.
+    bool persistent_threads_;
+    // Global stack entries per ray, specialization constant 0 of the kernels.
+    uint32_t stack_size_ = kDefaultStackSize;
+    // Host visible counter of stack overflows.
+    AllocatedBuffer stack_overflow_;
+
+    TraceGeometryImpl(std::shared_ptr<GpuHelper> helper, ShaderManager const& shader_manager, bool persistent_threads)
+        : gpu_helper_(helper),
+          shader_manager_(shader_manager),
+          cache_(gpu_helper_),
+          dispatch_args_(gpu_helper_, shader_manager_),
+          persistent_threads_(persistent_threads)
     {
+        uint32_t zero   = 0u;
+        stack_overflow_ = gpu_helper_->CreateStagingBuffer(sizeof(uint32_t), &zero);
         Init();
     }
     void Init()
     {
         for (auto& kernel : trace_kernels_)
         {
-            kernel.second.kernel   = shader_manager_.CreateKernel(kernel.second.name);
+            if (persistent_threads_ && !kernel.first.wide)
+            {
+                kernel.second.name = GetPersistentKernelName(kernel.second.name);
+            }
+            kernel.second.kernel   = shader_manager_.CreateKernel(kernel.second.name, {stack_size_});
             kernel.second.desc_set = shader_manager_.CreateDescriptorSets(kernel.second.kernel);
-            shader_manager_.PrepareKernel(kernel.second.name, kernel.second.desc_set);
+            shader_manager_.PrepareKernel(kernel.second.name, kernel.second.desc_set, {stack_size_});
+        }
+    }
+    // Descriptor set layouts do not depend on the stack size, only the pipelines are specialized again.
+    void SetStackSize(uint32_t stack_size)
+    {
+        if (stack_size == stack_size_)
+        {
+            return;
+        }
+        stack_size_ = stack_size;
+        for (auto& kernel : trace_kernels_)
+        {
+            kernel.second.kernel = shader_manager_.CreateKernel(kernel.second.name, {stack_size_});
+            shader_manager_.PrepareKernel(kernel.second.name, kernel.second.desc_set, {stack_size_});
         }
     }
     ~TraceGeometryImpl()
@@ -110,17 +258,21 @@ struct TraceGeometry::TraceGeometryImpl
                 gpu_helper_->device.destroyDescriptorSetLayout(desc.layout_);
             }
         }
+        stack_overflow_.Destroy();
     }
 };
 
-TraceGeometry::TraceGeometry(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager)
-    : impl_(std::make_unique<TraceGeometryImpl>(gpu_helper, shader_manager))
+TraceGeometry::TraceGeometry(std::shared_ptr<GpuHelper> gpu_helper,
+                             ShaderManager const&       shader_manager,
+                             bool                       persistent_threads)
+    : impl_(std::make_unique<TraceGeometryImpl>(gpu_helper, shader_manager, persistent_threads))
 {
 }
 TraceGeometry::~TraceGeometry() = default;
 void TraceGeometry::operator()(vk::CommandBuffer      command_buffer,
                                RRIntersectQuery       query,
                                RRIntersectQueryOutput query_output,
+                               bool                   wide,
                                vk::Buffer             bvh,
                                size_t                 bvh_offset,
                                uint32_t               ray_count,
@@ -135,6 +287,7 @@ void TraceGeometry::operator()(vk::CommandBuffer      command_buffer,
 {
     auto descriptor_set = GetDescriptor(query,
                                         query_output,
+                                        wide,
                                         bvh,
                                         bvh_offset,
                                         ray_count_buffer,
@@ -146,17 +299,37 @@ void TraceGeometry::operator()(vk::CommandBuffer      command_buffer,
                                         scratch,
                                         scratch_offset);
 
-    ShaderPtr kernel         = impl_->trace_kernels_.at({query, query_output, bool(ray_count_buffer)}).kernel;
+    ShaderPtr kernel         = impl_->trace_kernels_.at({query, query_output, bool(ray_count_buffer), wide}).kernel;
     uint32_t  num_groups     = CeilDivide(ray_count, kGroupSize);
     uint32_t  constants[]    = {ray_count};
 
+    bool persistent        = impl_->persistent_threads_ && !wide;
+    bool indirect_dispatch = bool(ray_count_buffer) && !persistent;
+    if (persistent)
+    {
+        // Reset the work counter that follows the stacks and launch just enough groups to fill the device.
+        impl_->dispatch_args_.ResetCounter(command_buffer, scratch, scratch_offset, impl_->stack_size_ * ray_count);
+        num_groups = std::min(num_groups, kPersistentGroupCount);
+    } else if (indirect_dispatch)
+    {
+        // Launch only the groups covering the live rays.
+        impl_->dispatch_args_(command_buffer, ray_count_buffer, ray_count_buffer_offset, ray_count, kGroupSize);
+    }
+
     // Set prim counter push constant.
     impl_->gpu_helper_->EncodePushConstant(kernel->pipeline_layout, 0u, sizeof(constants), constants, command_buffer);
 
     impl_->gpu_helper_->EncodeBindDescriptorSets(&descriptor_set, 1u, 0u, kernel->pipeline_layout, command_buffer);
 
     // Launch kernel.
-    impl_->shader_manager_.EncodeDispatch1D(*kernel, num_groups, command_buffer);
+    if (indirect_dispatch)
+    {
+        impl_->shader_manager_.EncodeDispatch1DIndirect(
+            *kernel, impl_->dispatch_args_.GetArgsBuffer(), 0u, command_buffer);
+    } else
+    {
+        impl_->shader_manager_.EncodeDispatch1D(*kernel, num_groups, command_buffer);
+    }
 
     impl_->gpu_helper_->EncodeBufferBarrier(hits,
                                             vk::AccessFlagBits::eShaderWrite,
@@ -164,12 +337,36 @@ void TraceGeometry::operator()(vk::CommandBuffer      command_buffer,
                                             vk::PipelineStageFlagBits::eComputeShader,
                                             vk::PipelineStageFlagBits::eComputeShader,
                                             command_buffer);
+    // Overflow count is read by the host.
+    impl_->gpu_helper_->EncodeBufferBarrier(impl_->stack_overflow_.buffer,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eHostRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eHost,
+                                            command_buffer);
+}
+
+size_t TraceGeometry::GetScratchSize(uint32_t ray_count) const
+{
+    // Persistent threads keep their work counter after the stacks.
+    size_t counter_size = impl_->persistent_threads_ ? sizeof(uint32_t) : 0u;
+    return sizeof(uint32_t) * impl_->stack_size_ * ray_count + counter_size;
 }
 
-size_t TraceGeometry::GetScratchSize(uint32_t ray_count) const { return sizeof(uint32_t) * kStackSize * ray_count; }
+void TraceGeometry::SetStackSize(uint32_t stack_size) { impl_->SetStackSize(stack_size); }
+
+uint32_t TraceGeometry::GetStackOverflowCount()
+{
+    auto*    counter = impl_->stack_overflow_.Map<uint32_t>();
+    uint32_t count   = *counter;
+    *counter         = 0u;
+    impl_->stack_overflow_.Unmap();
+    return count;
+}
 
 vk::DescriptorSet TraceGeometry::GetDescriptor(RRIntersectQuery       query,
                                                RRIntersectQueryOutput query_output,
+                                               bool                   wide,
                                                vk::Buffer             bvh,
                                                size_t                 bvh_offset,
                                                vk::Buffer             ray_count_buffer,
@@ -181,7 +378,13 @@ vk::DescriptorSet TraceGeometry::GetDescriptor(RRIntersectQuery       query,
                                                vk::Buffer             scratch,
                                                size_t                 scratch_offset)
 {
-    std::array<vk::Buffer, 5> key = {bvh, ray_count_buffer, rays, hits, scratch};
+    using BufferRange = vk::DescriptorBufferInfo;
+
+    std::array<BufferRange, 5> key = {BufferRange{bvh, bvh_offset, VK_WHOLE_SIZE},
+                                      BufferRange{ray_count_buffer, ray_count_buffer_offset, VK_WHOLE_SIZE},
+                                      BufferRange{rays, rays_offset, VK_WHOLE_SIZE},
+                                      BufferRange{hits, hits_offset, VK_WHOLE_SIZE},
+                                      BufferRange{scratch, scratch_offset, VK_WHOLE_SIZE}};
     if (impl_->cache_.Contains(key))
     {
         return impl_->cache_.Get(key)[0];
@@ -193,8 +396,9 @@ vk::DescriptorSet TraceGeometry::GetDescriptor(RRIntersectQuery       query,
     }
     info.emplace_back(hits, hits_offset, VK_WHOLE_SIZE);
     info.emplace_back(scratch, scratch_offset, VK_WHOLE_SIZE);
+    info.emplace_back(impl_->stack_overflow_.buffer, 0, VK_WHOLE_SIZE);
 
-    auto              trace_value    = impl_->trace_kernels_.at({query, query_output, bool(ray_count_buffer)});
+    auto              trace_value    = impl_->trace_kernels_.at({query, query_output, bool(ray_count_buffer), wide});
     vk::DescriptorSet trace_desc_set = impl_->gpu_helper_->AllocateDescriptorSet(trace_value.desc_set[0].layout_);
     impl_->gpu_helper_->WriteDescriptorSet(trace_desc_set, info.data(), (uint32_t)info.size());
 
@@ -22,6 +22,7 @@ THE SOFTWARE.
 #include <cstdint>
 
 #include "vlk/common.h"
+#include "vlk/dispatch_args.h"
 #include "vlk/shader_manager.h"
 
 namespace rt::vulkan
@@ -32,12 +33,19 @@ namespace rt::vulkan
 class TraceGeometry
 {
 public:
-    TraceGeometry(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager);
+    /**
+     * @brief Create the tracer.
+     * @param persistent_threads Trace binary BVHs with persistent threads fetching rays from a work counter.
+     */
+    TraceGeometry(std::shared_ptr<GpuHelper> gpu_helper,
+                  ShaderManager const&       shader_manager,
+                  bool                       persistent_threads = false);
     ~TraceGeometry();
 
     void operator()(vk::CommandBuffer      command_list,
                     RRIntersectQuery       query,
                     RRIntersectQueryOutput query_output,
+                    bool                   wide,
                     vk::Buffer             bvh,
                     size_t                 bvh_offset,
                     uint32_t               ray_count,
@@ -52,9 +60,22 @@ public:
 
     size_t GetScratchSize(uint32_t ray_count) const;
 
+    /**
+     * @brief Set the number of global stack entries per ray, a multiple of the LDS stack size.
+     **/
+    void SetStackSize(uint32_t stack_size);
+
+    /**
+     * @brief Get the number of stack overflows since the last call and reset it.
+     *
+     * Traversal of an overflowing ray ends early. Read it after the traces completed.
+     **/
+    uint32_t GetStackOverflowCount();
+
 private:
     vk::DescriptorSet GetDescriptor(RRIntersectQuery       query,
                                     RRIntersectQueryOutput query_output,
+                                    bool                   wide,
                                     vk::Buffer             bvh,
                                     size_t                 bvh_offset,
                                     vk::Buffer             ray_count_buffer,
@@ -19,6 +19,7 @@ THE SOFTWARE.
 
 #pragma once
 #include <functional>
+#include <memory>
 // clang-format off
 #include "utils/warning_push.h"
 #include "utils/warning_ignore_general.h"
@@ -37,6 +38,8 @@ static constexpr auto VK_VENDOR_ID_NVIDIA = 0x10de;
 static constexpr auto VK_VENDOR_ID_INTEL  = 0x8086;
 }  // namespace
 
+class Profiler;
+
 struct GpuHelper
 {
     static auto constexpr kNumDescriptors = 1000000u;
@@ -73,6 +76,8 @@ struct GpuHelper
     {
         queue.waitIdle();
         device.waitIdle();
+        // Query pools of the profiler go before the device.
+        profiler.reset();
         if (command_pool)
         {
             device.destroyCommandPool(command_pool);
@@ -133,9 +138,12 @@ struct GpuHelper
 
     AllocatedBuffer CreateScratchDeviceBuffer(vk::DeviceSize size)
     {
-        AllocatedBuffer result = CreateBuffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
-                         vk::MemoryPropertyFlagBits::eDeviceLocal,
-                         size);
+        // Transfer destination for the counters some algorithms reset with fills.
+        AllocatedBuffer result = CreateBuffer(vk::BufferUsageFlagBits::eStorageBuffer |
+                                                  vk::BufferUsageFlagBits::eTransferSrc |
+                                                  vk::BufferUsageFlagBits::eTransferDst,
+                                              vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                              size);
         return result;
     }
 
@@ -296,6 +304,15 @@ struct GpuHelper
         command_buffer.pipelineBarrier(src_stage, dst_stage, {}, nullptr, {barrier}, nullptr);
     }
 
+    void EncodeFillBuffer(vk::Buffer         buffer,
+                          vk::DeviceSize     offset,
+                          vk::DeviceSize     size,
+                          uint32_t           value,
+                          vk::CommandBuffer& command_buffer) const
+    {
+        command_buffer.fillBuffer(buffer, offset, size, value);
+    }
+
     void EncodePushConstant(vk::PipelineLayout layout,
                             uint32_t           offset,
                             uint32_t           data_size,
@@ -337,6 +354,8 @@ struct GpuHelper
     vk::PhysicalDeviceProperties       device_properties;
     vk::PhysicalDeviceMemoryProperties device_memory_properties;
     bool                               is_external = false;
+    // Timestamp profiler, null unless profiling was requested at device creation.
+    std::shared_ptr<Profiler> profiler;
 };
 
 }  // namespace rt::vulkan
\ No newline at end of file
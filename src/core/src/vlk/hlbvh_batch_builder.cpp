@@ -0,0 +1,672 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include "hlbvh_batch_builder.h"
+
+#include <algorithm>
+#include <array>
+#include <unordered_map>
+
+#include "vlk/common.h"
+#include "vlk/radix_sort.h"
+
+namespace rt::vulkan
+{
+namespace
+{
+// Building kernels
+constexpr char const* s_calc_morton_codes_kernel_name = "lbvh_calc_morton_codes_mesh_batch.comp.spv";
+constexpr char const* s_calc_mesh_aabb_kernel_name    = "lbvh_calc_mesh_aabb_batch.comp.spv";
+constexpr char const* s_emit_bvh_kernel_name          = "lbvh_emit_hierarchy_mesh_batch.comp.spv";
+constexpr char const* s_fit_aabb_kernel_name          = "lbvh_fit_aabb_mesh_batch.comp.spv";
+constexpr char const* s_init_kernel_name              = "lbvh_init_mesh_batch.comp.spv";
+constexpr char const* s_gather_slot_keys_kernel_name  = "lbvh_gather_slot_keys_mesh_batch.comp.spv";
+
+constexpr uint32_t kTrianglesPerThread = 8u;
+constexpr uint32_t kGroupSize          = 128u;
+constexpr uint32_t kTrianglesPerGroup  = kTrianglesPerThread * kGroupSize;
+constexpr uint32_t kMortonCodeBits     = 30u;
+
+// Mirror batch flags of lbvh_mesh_batch.h.
+constexpr uint32_t kMergeGeometriesFlag = 1u;
+constexpr uint32_t kRefitFlag           = 2u;
+
+// Mirror primitive types of lbvh_mesh_batch.h.
+constexpr uint32_t kTrianglesPrimitiveType = 0u;
+constexpr uint32_t kAabbsPrimitiveType     = 1u;
+
+// Mirrors GeometryDesc of lbvh_mesh_batch.h.
+struct GeometryDesc
+{
+    uint32_t prim_offset;
+    uint32_t prim_count;
+    uint32_t vertex_stride;
+    uint32_t primitive_type;
+};
+
+uint32_t GetBvhNodeCount(uint32_t leaf_count) { return 2 * leaf_count - 1; }
+
+// Kernels index descriptions from the start of the bound buffer.
+uint32_t GetGeometryDescsIndex(size_t geometry_descs_offset)
+{
+    if (geometry_descs_offset % sizeof(GeometryDesc) != 0)
+    {
+        throw std::runtime_error("Mesh descriptions of a batched build are misaligned");
+    }
+    return static_cast<uint32_t>(geometry_descs_offset / sizeof(GeometryDesc));
+}
+
+// Number of key bits holding slot indices of the second (segment) sort.
+uint32_t GetSlotBits(uint32_t slot_count)
+{
+    uint32_t slot_bits = 0u;
+    while ((1u << slot_bits) < slot_count)
+    {
+        ++slot_bits;
+    }
+    return slot_bits;
+}
+
+// Number of internal (set 0) bindings preceding the per mesh ranges in a descriptor key.
+constexpr uint32_t kInternalBindingCount = 5u;
+
+// Buffer ranges bound by a batch: internals followed by per mesh indices, vertices and results.
+struct DescriptorKey
+{
+    uint32_t                              geometry_count;
+    uint32_t                              result_count;
+    std::vector<vk::DescriptorBufferInfo> buffers;
+
+    bool operator==(DescriptorKey const& other) const
+    {
+        return geometry_count == other.geometry_count && result_count == other.result_count &&
+               buffers == other.buffers;
+    }
+};
+
+struct DescriptorKeyHash
+{
+    static void hash_combine(size_t& seed, size_t v)
+    {
+        std::hash<size_t> hasher;
+        seed ^= hasher(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    size_t operator()(DescriptorKey const& key) const
+    {
+        size_t seed = 0;
+        hash_combine(seed, key.geometry_count);
+        hash_combine(seed, key.result_count);
+        for (auto const& info : key.buffers)
+        {
+            hash_combine(seed, size_t(VkBuffer(info.buffer)));
+            hash_combine(seed, size_t(info.offset));
+            hash_combine(seed, size_t(info.range));
+        }
+        return seed;
+    }
+};
+}  // namespace
+
+struct BuildHlBvhBatch::HlBvhBatchImpl
+{
+    // Scratch space layout.
+    enum class ScratchLayout
+    {
+        kGeometryAabbs,
+        kSortKeys,
+        kPrimitiveRefs,
+        kMortonCodes,
+        kSortMemory
+    };
+
+    // Build phases scratch blocks are alive in.
+    enum BuildPhase : uint32_t
+    {
+        kCalcAabbPhase,
+        kCalcMortonCodesPhase,
+        kSortPhase,
+        kEmitPhase
+    };
+
+    std::shared_ptr<GpuHelper> gpu_helper_;
+    ShaderManager const&       shader_manager_;
+
+    // radix sort algo object
+    algorithm::RadixSortKeyValue radix_sort_;
+
+    // Descriptor sets
+    std::vector<DescriptorSet> build_sets_;
+
+    // Sets are never rewritten once recorded, batches binding the same ranges share them.
+    std::unordered_map<DescriptorKey, std::array<vk::DescriptorSet, 2>, DescriptorKeyHash> descriptor_cache_;
+
+    // Bound to the index slots of AABB lists and to internals a refit does not use.
+    AllocatedBuffer dummy_buffer_;
+
+    ShaderPtr calc_mesh_aabb_kernel_    = nullptr;
+    ShaderPtr calc_morton_codes_kernel_ = nullptr;
+    ShaderPtr emit_bvh_kernel_          = nullptr;
+    ShaderPtr fit_aabb_kernel_          = nullptr;
+    ShaderPtr init_kernel_              = nullptr;
+    ShaderPtr gather_slot_keys_kernel_  = nullptr;
+
+    using ScratchLayoutT = MemoryLayout<ScratchLayout, vk::DeviceSize>;
+
+    mutable uint32_t       current_geometry_count_ = 0u;
+    mutable uint32_t       current_triangle_count_ = 0u;
+    mutable ScratchLayoutT scratch_layout_         = ScratchLayoutT(kAlignment);
+
+    HlBvhBatchImpl(std::shared_ptr<GpuHelper> helper, ShaderManager const& manager)
+        : gpu_helper_(helper), shader_manager_(manager), radix_sort_(helper, manager)
+    {
+        Init();
+    }
+    void Init()
+    {
+        ShaderManager::KernelID calc_morton_id    = s_calc_morton_codes_kernel_name;
+        ShaderManager::KernelID calc_mesh_aabb_id = s_calc_mesh_aabb_kernel_name;
+        ShaderManager::KernelID emit_bvh_id       = s_emit_bvh_kernel_name;
+        ShaderManager::KernelID fit_aabb_id       = s_fit_aabb_kernel_name;
+        ShaderManager::KernelID init_aabb_id      = s_init_kernel_name;
+        ShaderManager::KernelID gather_slot_id    = s_gather_slot_keys_kernel_name;
+
+        // All batch kernels share the same bindings.
+        calc_mesh_aabb_kernel_ = shader_manager_.CreateKernel(calc_mesh_aabb_id);
+        build_sets_            = shader_manager_.CreateDescriptorSets(calc_mesh_aabb_kernel_);
+        shader_manager_.PrepareKernel(calc_mesh_aabb_id, build_sets_);
+
+        calc_morton_codes_kernel_ = shader_manager_.CreateKernel(calc_morton_id);
+        shader_manager_.PrepareKernel(calc_morton_id, build_sets_);
+
+        init_kernel_ = shader_manager_.CreateKernel(init_aabb_id);
+        shader_manager_.PrepareKernel(init_aabb_id, build_sets_);
+
+        emit_bvh_kernel_ = shader_manager_.CreateKernel(emit_bvh_id);
+        shader_manager_.PrepareKernel(emit_bvh_id, build_sets_);
+
+        fit_aabb_kernel_ = shader_manager_.CreateKernel(fit_aabb_id);
+        shader_manager_.PrepareKernel(fit_aabb_id, build_sets_);
+
+        gather_slot_keys_kernel_ = shader_manager_.CreateKernel(gather_slot_id);
+        shader_manager_.PrepareKernel(gather_slot_id, build_sets_);
+
+        dummy_buffer_ = gpu_helper_->CreateDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, 4);
+    }
+
+    // Bind the cached sets of a key, return false if the key has none yet.
+    bool GetDescriptorSets(DescriptorKey const& key)
+    {
+        auto cached = descriptor_cache_.find(key);
+        if (cached == descriptor_cache_.end())
+        {
+            return false;
+        }
+        build_sets_[0].descriptor_set_ = cached->second[0];
+        build_sets_[1].descriptor_set_ = cached->second[1];
+        return true;
+    }
+
+    void AllocateDescriptorSets()
+    {
+        // Descriptor sets can't be updated while a previously recorded batch is pending, so allocate new ones.
+        build_sets_[0].descriptor_set_ = gpu_helper_->AllocateDescriptorSet(build_sets_[0].layout_);
+        build_sets_[1].descriptor_set_ = gpu_helper_->AllocateDescriptorSet(build_sets_[1].layout_);
+    }
+
+    // Set push constants, bind batch desc sets and launch a kernel.
+    void EncodeKernel(ShaderPtr const&  kernel,
+                      uint32_t const*   push_consts,
+                      uint32_t          push_consts_size,
+                      uint32_t          num_groups,
+                      vk::CommandBuffer command_buffer) const
+    {
+        gpu_helper_->EncodePushConstant(kernel->pipeline_layout, 0u, push_consts_size, push_consts, command_buffer);
+
+        std::vector<vk::DescriptorSet> desc_sets = {build_sets_[0].descriptor_set_, build_sets_[1].descriptor_set_};
+
+        gpu_helper_->EncodeBindDescriptorSets(
+            desc_sets.data(), (std::uint32_t)desc_sets.size(), 0u, kernel->pipeline_layout, command_buffer);
+
+        shader_manager_.EncodeDispatch1D(*kernel, num_groups, command_buffer);
+    }
+
+    ~HlBvhBatchImpl()
+    {
+        for (auto const& pair : descriptor_cache_)
+        {
+            for (auto const& desc_set : pair.second)
+            {
+                gpu_helper_->device.freeDescriptorSets(gpu_helper_->descriptor_pool, {desc_set});
+            }
+        }
+        for (auto& desc_set : build_sets_)
+        {
+            gpu_helper_->device.destroyDescriptorSetLayout(desc_set.layout_);
+        }
+        dummy_buffer_.Destroy();
+    }
+};
+
+BuildHlBvhBatch::BuildHlBvhBatch(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager)
+    : impl_(std::make_unique<HlBvhBatchImpl>(gpu_helper, shader_manager))
+{
+}
+BuildHlBvhBatch::~BuildHlBvhBatch() = default;
+
+void BuildHlBvhBatch::operator()(vk::CommandBuffer                       command_buffer,
+                                 std::vector<BatchedTriangleMesh> const& meshes,
+                                 vk::Buffer                              geometry_descs,
+                                 size_t                                  geometry_descs_offset,
+                                 vk::Buffer                              scratch,
+                                 size_t                                  scratch_offset)
+{
+    Build(command_buffer, meshes, geometry_descs, geometry_descs_offset, scratch, scratch_offset, 0u);
+}
+
+void BuildHlBvhBatch::BuildMerged(vk::CommandBuffer                       command_buffer,
+                                  std::vector<BatchedTriangleMesh> const& meshes,
+                                  vk::Buffer                              geometry_descs,
+                                  size_t                                  geometry_descs_offset,
+                                  vk::Buffer                              scratch,
+                                  size_t                                  scratch_offset)
+{
+    Build(
+        command_buffer, meshes, geometry_descs, geometry_descs_offset, scratch, scratch_offset, kMergeGeometriesFlag);
+}
+
+void BuildHlBvhBatch::UpdateMerged(vk::CommandBuffer                       command_buffer,
+                                   std::vector<BatchedTriangleMesh> const& meshes,
+                                   vk::Buffer                              geometry_descs,
+                                   size_t                                  geometry_descs_offset)
+{
+    if (meshes.empty() || meshes.size() > kMaxGeometries)
+    {
+        throw std::runtime_error("Invalid number of meshes in a batched build");
+    }
+
+    auto geometry_count = static_cast<uint32_t>(meshes.size());
+    auto triangle_count = 0u;
+    for (auto const& mesh : meshes)
+    {
+        triangle_count += mesh.triangle_count;
+    }
+
+    auto flags = kMergeGeometriesFlag | kRefitFlag;
+    UpdateDescriptors(meshes, geometry_descs, vk::Buffer(), 0u, flags);
+
+    uint32_t push_consts[] = {geometry_count, triangle_count, flags, GetGeometryDescsIndex(geometry_descs_offset)};
+    auto     result        = meshes[0].result;
+
+    /// Reset update flags
+    impl_->EncodeKernel(impl_->init_kernel_,
+                        push_consts,
+                        sizeof(push_consts),
+                        CeilDivide(2 * triangle_count - 1, kGroupSize),
+                        command_buffer);
+    impl_->gpu_helper_->EncodeBufferBarrier(result,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer);
+
+    /// Fit bounds
+    impl_->EncodeKernel(impl_->fit_aabb_kernel_,
+                        push_consts,
+                        sizeof(push_consts),
+                        CeilDivide(triangle_count, kTrianglesPerGroup),
+                        command_buffer);
+    impl_->gpu_helper_->EncodeBufferBarrier(result,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer);
+}
+
+void BuildHlBvhBatch::Build(vk::CommandBuffer                       command_buffer,
+                            std::vector<BatchedTriangleMesh> const& meshes,
+                            vk::Buffer                              geometry_descs,
+                            size_t                                  geometry_descs_offset,
+                            vk::Buffer                              scratch,
+                            size_t                                  scratch_offset,
+                            uint32_t                                flags)
+{
+    if (meshes.empty() || meshes.size() > kMaxGeometries)
+    {
+        throw std::runtime_error("Invalid number of meshes in a batched build");
+    }
+
+    auto geometry_count = static_cast<uint32_t>(meshes.size());
+    auto triangle_count = 0u;
+    for (auto const& mesh : meshes)
+    {
+        triangle_count += mesh.triangle_count;
+    }
+
+    // Merged meshes share a single bounds slot and need no segment sort.
+    bool merge      = (flags & kMergeGeometriesFlag) != 0;
+    auto slot_count = merge ? 1u : geometry_count;
+
+    AdjustLayouts(slot_count, triangle_count);
+    UpdateDescriptors(meshes, geometry_descs, scratch, scratch_offset, flags);
+    // scratch layout: temporary buffers
+    auto aabb_offset      = impl_->scratch_layout_.offset_of(HlBvhBatchImpl::ScratchLayout::kGeometryAabbs);
+    auto aabb_size        = impl_->scratch_layout_.size_of(HlBvhBatchImpl::ScratchLayout::kGeometryAabbs);
+    auto keys_offset      = impl_->scratch_layout_.offset_of(HlBvhBatchImpl::ScratchLayout::kSortKeys);
+    auto keys_size        = impl_->scratch_layout_.size_of(HlBvhBatchImpl::ScratchLayout::kSortKeys);
+    auto primitive_offset = impl_->scratch_layout_.offset_of(HlBvhBatchImpl::ScratchLayout::kPrimitiveRefs);
+    auto primitive_size   = impl_->scratch_layout_.size_of(HlBvhBatchImpl::ScratchLayout::kPrimitiveRefs);
+    auto morton_offset    = impl_->scratch_layout_.offset_of(HlBvhBatchImpl::ScratchLayout::kMortonCodes);
+    auto morton_size      = impl_->scratch_layout_.size_of(HlBvhBatchImpl::ScratchLayout::kMortonCodes);
+    auto sort_offset      = impl_->scratch_layout_.offset_of(HlBvhBatchImpl::ScratchLayout::kSortMemory);
+
+    // Meshes may share result buffers, barrier each buffer once. Merged meshes only write the first one.
+    std::vector<vk::Buffer> results;
+    for (size_t i = 0; i < (merge ? 1 : meshes.size()); ++i)
+    {
+        if (std::find(results.cbegin(), results.cend(), meshes[i].result) == results.cend())
+        {
+            results.push_back(meshes[i].result);
+        }
+    }
+
+    uint32_t push_consts[] = {geometry_count, triangle_count, flags, GetGeometryDescsIndex(geometry_descs_offset)};
+    auto     num_groups    = CeilDivide(triangle_count, kTrianglesPerGroup);
+
+    /// Init mesh AABBs
+    impl_->EncodeKernel(impl_->init_kernel_,
+                        push_consts,
+                        sizeof(push_consts),
+                        CeilDivide(slot_count, kGroupSize),
+                        command_buffer);
+    impl_->gpu_helper_->EncodeBufferBarrier(scratch,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer,
+                                            aabb_offset,
+                                            aabb_size);
+
+    /// Calc mesh AABBs
+    impl_->EncodeKernel(
+        impl_->calc_mesh_aabb_kernel_, push_consts, sizeof(push_consts), num_groups, command_buffer);
+    impl_->gpu_helper_->EncodeBufferBarrier(scratch,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer,
+                                            aabb_offset,
+                                            aabb_size);
+
+    /// Calculate Morton codes and sort keys for prims
+    impl_->EncodeKernel(
+        impl_->calc_morton_codes_kernel_, push_consts, sizeof(push_consts), num_groups, command_buffer);
+    impl_->gpu_helper_->EncodeBufferBarrier(scratch,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer,
+                                            keys_offset,
+                                            keys_size);
+    impl_->gpu_helper_->EncodeBufferBarrier(scratch,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer,
+                                            primitive_offset,
+                                            primitive_size);
+    impl_->gpu_helper_->EncodeBufferBarrier(scratch,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer,
+                                            morton_offset,
+                                            morton_size);
+
+    /// Sort prim indices of all meshes by full Morton codes in place
+    impl_->radix_sort_(command_buffer,
+                       scratch,
+                       keys_offset,
+                       keys_size,
+                       scratch,
+                       keys_offset,
+                       (vk::DeviceSize)keys_size,
+                       scratch,
+                       primitive_offset,
+                       (vk::DeviceSize)primitive_size,
+                       scratch,
+                       primitive_offset,
+                       (vk::DeviceSize)primitive_size,
+                       scratch,
+                       sort_offset,
+                       triangle_count,
+                       kMortonCodeBits);
+
+    /// Segmented sort: a second stable pass by slot moves meshes back to their ranges in Morton order
+    if (slot_count > 1)
+    {
+        impl_->EncodeKernel(
+            impl_->gather_slot_keys_kernel_, push_consts, sizeof(push_consts), num_groups, command_buffer);
+        impl_->gpu_helper_->EncodeBufferBarrier(scratch,
+                                                vk::AccessFlagBits::eShaderWrite,
+                                                vk::AccessFlagBits::eShaderRead,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                command_buffer,
+                                                keys_offset,
+                                                keys_size);
+
+        impl_->radix_sort_(command_buffer,
+                           scratch,
+                           keys_offset,
+                           keys_size,
+                           scratch,
+                           keys_offset,
+                           (vk::DeviceSize)keys_size,
+                           scratch,
+                           primitive_offset,
+                           (vk::DeviceSize)primitive_size,
+                           scratch,
+                           primitive_offset,
+                           (vk::DeviceSize)primitive_size,
+                           scratch,
+                           sort_offset,
+                           triangle_count,
+                           GetSlotBits(slot_count));
+    }
+
+    /// Emit BVHs
+    impl_->EncodeKernel(impl_->emit_bvh_kernel_, push_consts, sizeof(push_consts), num_groups, command_buffer);
+    for (auto const& result : results)
+    {
+        impl_->gpu_helper_->EncodeBufferBarrier(result,
+                                                vk::AccessFlagBits::eShaderWrite,
+                                                vk::AccessFlagBits::eShaderRead,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                command_buffer);
+    }
+
+    /// Fit bounds
+    impl_->EncodeKernel(impl_->fit_aabb_kernel_, push_consts, sizeof(push_consts), num_groups, command_buffer);
+    for (auto const& result : results)
+    {
+        impl_->gpu_helper_->EncodeBufferBarrier(result,
+                                                vk::AccessFlagBits::eShaderWrite,
+                                                vk::AccessFlagBits::eShaderRead,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                command_buffer);
+    }
+}
+
+size_t BuildHlBvhBatch::GetGeometryDescsSize(uint32_t geometry_count) const
+{
+    return geometry_count * sizeof(GeometryDesc);
+}
+
+void BuildHlBvhBatch::WriteGeometryDescs(std::vector<BatchedTriangleMesh> const& meshes, void* dst) const
+{
+    auto descs       = static_cast<GeometryDesc*>(dst);
+    auto prim_offset = 0u;
+    for (auto const& mesh : meshes)
+    {
+        if (mesh.triangle_count == 0)
+        {
+            throw std::runtime_error("Batched build does not support empty meshes");
+        }
+        auto primitive_type = mesh.aabb_list ? kAabbsPrimitiveType : kTrianglesPrimitiveType;
+        *descs++            = {prim_offset, mesh.triangle_count, mesh.vertex_stride, primitive_type};
+        prim_offset += mesh.triangle_count;
+    }
+}
+
+size_t BuildHlBvhBatch::GetScratchDataSize(uint32_t geometry_count, uint32_t triangle_count) const
+{
+    AdjustLayouts(geometry_count, triangle_count);
+    return impl_->scratch_layout_.total_size();
+}
+
+void BuildHlBvhBatch::AdjustLayouts(uint32_t geometry_count, uint32_t triangle_count) const
+{
+    if (geometry_count == impl_->current_geometry_count_ && triangle_count == impl_->current_triangle_count_)
+    {
+        return;
+    }
+
+    impl_->current_geometry_count_ = geometry_count;
+    impl_->current_triangle_count_ = triangle_count;
+    impl_->scratch_layout_.Reset();
+    // Scratch buffer. Same aliasing as BuildHlBvh: keys are sorted in place and mesh AABBs alias the sort memory.
+    // Morton codes stay in primitive order, so they survive the second (segment) sort pass.
+    BlockLifetime keys_lifetime{HlBvhBatchImpl::kCalcMortonCodesPhase, HlBvhBatchImpl::kEmitPhase};
+    BlockLifetime sort_lifetime{HlBvhBatchImpl::kSortPhase, HlBvhBatchImpl::kSortPhase};
+    BlockLifetime aabb_lifetime{HlBvhBatchImpl::kCalcAabbPhase, HlBvhBatchImpl::kCalcMortonCodesPhase};
+    impl_->scratch_layout_.AppendBlock<uint32_t>(
+        HlBvhBatchImpl::ScratchLayout::kSortKeys, impl_->current_triangle_count_, keys_lifetime);
+    impl_->scratch_layout_.AppendBlock<uint32_t>(
+        HlBvhBatchImpl::ScratchLayout::kPrimitiveRefs, impl_->current_triangle_count_, keys_lifetime);
+    impl_->scratch_layout_.AppendBlock<uint32_t>(
+        HlBvhBatchImpl::ScratchLayout::kMortonCodes, impl_->current_triangle_count_, keys_lifetime);
+
+    auto sort_memory_size = impl_->radix_sort_.GetScratchDataSize(impl_->current_triangle_count_);
+    impl_->scratch_layout_.AppendBlock<char>(
+        HlBvhBatchImpl::ScratchLayout::kSortMemory, sort_memory_size, sort_lifetime);
+    impl_->scratch_layout_.AppendBlock<Aabb>(
+        HlBvhBatchImpl::ScratchLayout::kGeometryAabbs, impl_->current_geometry_count_, aabb_lifetime);
+}
+
+void BuildHlBvhBatch::UpdateDescriptors(std::vector<BatchedTriangleMesh> const& meshes,
+                                        vk::Buffer                              geometry_descs,
+                                        vk::Buffer                              scratch,
+                                        size_t                                  scratch_offset,
+                                        uint32_t                                flags)
+{
+    vk::DescriptorBufferInfo dummy_info(impl_->dummy_buffer_.buffer, 0u, VK_WHOLE_SIZE);
+
+    // Merged meshes write a single BVH over all triangles to the result of the first mesh.
+    bool merge          = (flags & kMergeGeometriesFlag) != 0;
+    auto geometry_count = static_cast<uint32_t>(meshes.size());
+    auto result_count   = merge ? 1u : geometry_count;
+
+    // Batch internals, a refit has no scratch space. Descriptions are bound whole and located
+    // by a push constant, batches recorded from different upload ranges of a buffer share sets.
+    DescriptorKey key = {geometry_count,
+                         result_count,
+                         {{geometry_descs, 0u, VK_WHOLE_SIZE}, dummy_info, dummy_info, dummy_info, dummy_info}};
+    auto& buffer_infos = key.buffers;
+
+    if (scratch)
+    {
+        // scratch layout: temporary buffers
+        impl_->scratch_layout_.SetBaseOffset(VkDeviceSize(scratch_offset));
+        auto aabb_offset      = impl_->scratch_layout_.offset_of(HlBvhBatchImpl::ScratchLayout::kGeometryAabbs);
+        auto aabb_size        = impl_->scratch_layout_.size_of(HlBvhBatchImpl::ScratchLayout::kGeometryAabbs);
+        auto keys_offset      = impl_->scratch_layout_.offset_of(HlBvhBatchImpl::ScratchLayout::kSortKeys);
+        auto keys_size        = impl_->scratch_layout_.size_of(HlBvhBatchImpl::ScratchLayout::kSortKeys);
+        auto primitive_offset = impl_->scratch_layout_.offset_of(HlBvhBatchImpl::ScratchLayout::kPrimitiveRefs);
+        auto primitive_size   = impl_->scratch_layout_.size_of(HlBvhBatchImpl::ScratchLayout::kPrimitiveRefs);
+        auto morton_offset    = impl_->scratch_layout_.offset_of(HlBvhBatchImpl::ScratchLayout::kMortonCodes);
+        auto morton_size      = impl_->scratch_layout_.size_of(HlBvhBatchImpl::ScratchLayout::kMortonCodes);
+
+        buffer_infos[1] = {scratch, keys_offset, keys_size};
+        buffer_infos[2] = {scratch, primitive_offset, primitive_size};
+        buffer_infos[3] = {scratch, aabb_offset, aabb_size};
+        buffer_infos[4] = {scratch, morton_offset, morton_size};
+    }
+
+    // Per mesh index arrays, AABB lists have no indices.
+    for (auto const& mesh : meshes)
+    {
+        buffer_infos.push_back(mesh.indices ? vk::DescriptorBufferInfo(mesh.indices, mesh.indices_offset, VK_WHOLE_SIZE)
+                                            : dummy_info);
+    }
+    // Per mesh vertex arrays.
+    for (auto const& mesh : meshes)
+    {
+        buffer_infos.emplace_back(mesh.vertices, mesh.vertices_offset, VK_WHOLE_SIZE);
+    }
+    // Per mesh BVHs.
+    if (merge)
+    {
+        auto triangle_count = 0u;
+        for (auto const& mesh : meshes)
+        {
+            triangle_count += mesh.triangle_count;
+        }
+        auto bvh_size = RoundUp(GetBvhNodeCount(triangle_count) * sizeof(BvhNode), kAlignment);
+        buffer_infos.emplace_back(meshes[0].result, meshes[0].result_offset, bvh_size);
+    } else
+    {
+        for (auto const& mesh : meshes)
+        {
+            auto bvh_size = RoundUp(GetBvhNodeCount(mesh.triangle_count) * sizeof(BvhNode), kAlignment);
+            buffer_infos.emplace_back(mesh.result, mesh.result_offset, bvh_size);
+        }
+    }
+
+    if (impl_->GetDescriptorSets(key))
+    {
+        return;
+    }
+
+    impl_->AllocateDescriptorSets();
+    impl_->gpu_helper_->WriteDescriptorSet(
+        impl_->build_sets_[0].descriptor_set_, buffer_infos.data(), kInternalBindingCount);
+
+    // Mesh arrays are partially bound, only the slots of the batch are written.
+    auto mesh_infos = buffer_infos.data() + kInternalBindingCount;
+    impl_->gpu_helper_->WriteDescriptorSet(impl_->build_sets_[1].descriptor_set_, mesh_infos, geometry_count, 0u);
+    impl_->gpu_helper_->WriteDescriptorSet(
+        impl_->build_sets_[1].descriptor_set_, mesh_infos + geometry_count, geometry_count, 1u);
+    impl_->gpu_helper_->WriteDescriptorSet(
+        impl_->build_sets_[1].descriptor_set_, mesh_infos + 2 * geometry_count, result_count, 2u);
+
+    impl_->descriptor_cache_.emplace(std::move(key),
+                                     std::array<vk::DescriptorSet, 2>{impl_->build_sets_[0].descriptor_set_,
+                                                                      impl_->build_sets_[1].descriptor_set_});
+}
+
+}  // namespace rt::vulkan
@@ -0,0 +1,150 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "base/command_stream_base.h"
+#include "vlk/gpu_helper.h"
+#include "vlk/shader_manager.h"
+#include "utils/memory_layout.h"
+
+namespace rt::vulkan
+{
+/**
+ * @brief Triangle mesh of a batched build along with its output location.
+ *
+ * AABB lists are built as meshes too: vertices hold the boxes, vertex_stride is the box stride,
+ * triangle_count is the box count and there are no indices.
+ **/
+struct BatchedTriangleMesh
+{
+    vk::Buffer vertices;
+    size_t     vertices_offset;
+    uint32_t   vertex_stride;
+    uint32_t   vertex_count;
+    vk::Buffer indices;
+    size_t     indices_offset;
+    uint32_t   triangle_count;
+    vk::Buffer result;
+    size_t     result_offset;
+    bool       aabb_list = false;
+};
+
+/**
+ * @brief Batched HLBVH builder.
+ *
+ * Build linear BVHs for many triangle meshes at once. Primitives of all meshes are
+ * processed by the same dispatches: a single Morton code pass, a segmented sort (a stable sort
+ * by full 30-bit Morton codes, then a stable sort by mesh index) and a single emit/fit pass.
+ * Every mesh gets a BVH with the same layout BuildHlBvh produces.
+ **/
+class BuildHlBvhBatch
+{
+public:
+    /// Max number of meshes in a single batch, bounded by the descriptor arrays of the kernels.
+    static constexpr uint32_t kMaxGeometries = 1024u;
+
+    BuildHlBvhBatch(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager);
+    ~BuildHlBvhBatch();
+    /**
+     * @brief Build BVHs.
+     *
+     * @param meshes Meshes to build, up to kMaxGeometries.
+     * @param geometry_descs Buffer holding mesh descriptions written by WriteGeometryDescs.
+     * @param geometry_descs_offset Offset of the mesh descriptions, a multiple of 16 bytes.
+     **/
+    void operator()(vk::CommandBuffer                       command_buffer,
+                    std::vector<BatchedTriangleMesh> const& meshes,
+                    vk::Buffer                              geometry_descs,
+                    size_t                                  geometry_descs_offset,
+                    vk::Buffer                              scratch,
+                    size_t                                  scratch_offset);
+
+    /**
+     * @brief Build a single BVH over several meshes.
+     *
+     * Triangles of all meshes are sorted together and the BVH goes to the result of the first mesh.
+     * Leaves keep the triangle index within its mesh and the index of the mesh.
+     * Scratch space is GetScratchDataSize(1, triangle_count).
+     *
+     * @param meshes Meshes of the geometry, up to kMaxGeometries.
+     **/
+    void BuildMerged(vk::CommandBuffer                       command_buffer,
+                     std::vector<BatchedTriangleMesh> const& meshes,
+                     vk::Buffer                              geometry_descs,
+                     size_t                                  geometry_descs_offset,
+                     vk::Buffer                              scratch,
+                     size_t                                  scratch_offset);
+
+    /**
+     * @brief Refit a BVH built by BuildMerged to new vertex positions.
+     *
+     * Meshes must have the same triangle counts as at build time, no scratch space is needed.
+     **/
+    void UpdateMerged(vk::CommandBuffer                       command_buffer,
+                      std::vector<BatchedTriangleMesh> const& meshes,
+                      vk::Buffer                              geometry_descs,
+                      size_t                                  geometry_descs_offset);
+
+    /**
+     * @brief Get size in bytes of mesh descriptions.
+     *
+     * @param geometry_count Number of meshes
+     **/
+    size_t GetGeometryDescsSize(uint32_t geometry_count) const;
+
+    /**
+     * @brief Write mesh descriptions to host visible memory.
+     *
+     * @param meshes Meshes to build.
+     * @param dst Mapped memory of at least GetGeometryDescsSize bytes.
+     **/
+    void WriteGeometryDescs(std::vector<BatchedTriangleMesh> const& meshes, void* dst) const;
+
+    /**
+     * @brief Get size if bytes required for scratch space.
+     *
+     * @param geometry_count Number of meshes
+     * @param triangle_count Total number of triangles across the meshes
+     **/
+    size_t GetScratchDataSize(uint32_t geometry_count, uint32_t triangle_count) const;
+
+private:
+    void Build(vk::CommandBuffer                       command_buffer,
+               std::vector<BatchedTriangleMesh> const& meshes,
+               vk::Buffer                              geometry_descs,
+               size_t                                  geometry_descs_offset,
+               vk::Buffer                              scratch,
+               size_t                                  scratch_offset,
+               uint32_t                                flags);
+    void AdjustLayouts(uint32_t geometry_count, uint32_t triangle_count) const;
+    void UpdateDescriptors(std::vector<BatchedTriangleMesh> const& meshes,
+                           vk::Buffer                              geometry_descs,
+                           vk::Buffer                              scratch,
+                           size_t                                  scratch_offset,
+                           uint32_t                                flags);
+
+private:
+    struct HlBvhBatchImpl;
+    std::unique_ptr<HlBvhBatchImpl> impl_;
+};
+
+}  // namespace rt::vulkan
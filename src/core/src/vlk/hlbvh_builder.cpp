@@ -33,9 +33,18 @@ constexpr char const* s_emit_bvh_kernel_name          = "lbvh_emit_hierarchy_mes
 constexpr char const* s_fit_aabb_kernel_name          = "lbvh_fit_aabb_mesh.comp.spv";
 constexpr char const* s_init_kernel_name              = "lbvh_init_mesh.comp.spv";
 
+constexpr char const* s_calc_wide_morton_codes_kernel_name = "lbvh_calc_morton_codes_mesh_wide.comp.spv";
+constexpr char const* s_gather_morton_codes_kernel_name    = "lbvh_gather_morton_codes_mesh.comp.spv";
+constexpr char const* s_emit_wide_bvh_kernel_name          = "lbvh_emit_hierarchy_mesh_wide.comp.spv";
+
 constexpr uint32_t kTrianglesPerThread = 8u;
 constexpr uint32_t kGroupSize          = 128u;
 constexpr uint32_t kTrianglesPerGroup  = kTrianglesPerThread * kGroupSize;
+// Morton codes only occupy the low 30 bits of sort keys.
+constexpr uint32_t kMortonCodeBits = 30u;
+// 63-bit Morton codes are sorted by their low 32 bits and then by their high 31 bits.
+constexpr uint32_t kWideMortonCodeLowBits  = 32u;
+constexpr uint32_t kWideMortonCodeHighBits = 31u;
 
 uint32_t GetBvhInternalNodeCount(uint32_t leaf_count) { return leaf_count - 1; }
 uint32_t GetBvhNodeCount(uint32_t leaf_count) { return 2 * leaf_count - 1; }
@@ -55,11 +64,18 @@ struct BuildHlBvh::HlBvhImpl
         kAabb,
         kMortonCodes,
         kPrimitiveRefs,
-        kSortedMortonCodes,
-        kSortedPrimitiveRefs,
         kSortMemory
     };
 
+    // Build phases scratch blocks are alive in.
+    enum BuildPhase : uint32_t
+    {
+        kCalcAabbPhase,
+        kCalcMortonCodesPhase,
+        kSortPhase,
+        kEmitPhase
+    };
+
     std::shared_ptr<GpuHelper> gpu_helper_;
     ShaderManager const&       shader_manager_;
 
@@ -77,18 +93,35 @@ struct BuildHlBvh::HlBvhImpl
     ShaderPtr fit_aabb_kernel_          = nullptr;
     ShaderPtr init_kernel_              = nullptr;
 
+    ShaderPtr calc_wide_morton_codes_kernel_ = nullptr;
+    ShaderPtr gather_morton_codes_kernel_    = nullptr;
+    ShaderPtr emit_wide_bvh_kernel_          = nullptr;
+
     using ResultLayoutT  = MemoryLayout<ResultLayout, vk::DeviceSize>;
     using ScratchLayoutT = MemoryLayout<ScratchLayout, vk::DeviceSize>;
 
+    // Meshes with at least this many triangles are sorted by 63-bit Morton codes.
+    uint32_t wide_morton_codes_min_triangle_count_;
+
     mutable uint32_t       current_triangle_count_ = 0u;
     mutable ResultLayoutT  result_layout_          = ResultLayoutT(kAlignment);
     mutable ScratchLayoutT scratch_layout_         = ScratchLayoutT(kAlignment);
 
-    HlBvhImpl(std::shared_ptr<GpuHelper> helper, ShaderManager const& manager)
-        : gpu_helper_(helper), shader_manager_(manager), radix_sort_(helper, manager), cache_(helper)
+    HlBvhImpl(std::shared_ptr<GpuHelper> helper,
+              ShaderManager const&       manager,
+              uint32_t                   wide_morton_codes_min_triangle_count)
+        : gpu_helper_(helper),
+          shader_manager_(manager),
+          radix_sort_(helper, manager),
+          cache_(helper),
+          wide_morton_codes_min_triangle_count_(wide_morton_codes_min_triangle_count)
     {
         Init();
     }
+    bool UseWideMortonCodes(uint32_t triangle_count) const
+    {
+        return triangle_count >= wide_morton_codes_min_triangle_count_;
+    }
     void Init()
     {
         ShaderManager::KernelID calc_morton_id    = s_calc_morton_codes_kernel_name;
@@ -113,6 +146,16 @@ struct BuildHlBvh::HlBvhImpl
 
         fit_aabb_kernel_ = shader_manager_.CreateKernel(fit_aabb_id);
         shader_manager_.PrepareKernel(fit_aabb_id, build_sorted_sets_);
+
+        // 63-bit Morton code kernels share descriptor sets with the 30-bit ones.
+        calc_wide_morton_codes_kernel_ = shader_manager_.CreateKernel(s_calc_wide_morton_codes_kernel_name);
+        shader_manager_.PrepareKernel(s_calc_wide_morton_codes_kernel_name, build_sets_);
+
+        gather_morton_codes_kernel_ = shader_manager_.CreateKernel(s_gather_morton_codes_kernel_name);
+        shader_manager_.PrepareKernel(s_gather_morton_codes_kernel_name, build_sets_);
+
+        emit_wide_bvh_kernel_ = shader_manager_.CreateKernel(s_emit_wide_bvh_kernel_name);
+        shader_manager_.PrepareKernel(s_emit_wide_bvh_kernel_name, build_sorted_sets_);
     }
 
     void AllocateDescriptorSets()
@@ -150,8 +193,10 @@ struct BuildHlBvh::HlBvhImpl
     }
 };
 
-BuildHlBvh::BuildHlBvh(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager)
-    : impl_(std::make_unique<HlBvhImpl>(gpu_helper, shader_manager))
+BuildHlBvh::BuildHlBvh(std::shared_ptr<GpuHelper> gpu_helper,
+                       ShaderManager const&       shader_manager,
+                       uint32_t                   wide_morton_codes_min_triangle_count)
+    : impl_(std::make_unique<HlBvhImpl>(gpu_helper, shader_manager, wide_morton_codes_min_triangle_count))
 {
 }
 BuildHlBvh::~BuildHlBvh() = default;
@@ -179,12 +224,15 @@ void BuildHlBvh::operator()(vk::CommandBuffer command_buffer,
     auto morton_size             = impl_->scratch_layout_.size_of(HlBvhImpl::ScratchLayout::kMortonCodes);
     auto primitive_offset        = impl_->scratch_layout_.offset_of(HlBvhImpl::ScratchLayout::kPrimitiveRefs);
     auto primitive_size          = impl_->scratch_layout_.size_of(HlBvhImpl::ScratchLayout::kPrimitiveRefs);
-    auto sorted_morton_offset    = impl_->scratch_layout_.offset_of(HlBvhImpl::ScratchLayout::kSortedMortonCodes);
-    auto sorted_morton_size      = impl_->scratch_layout_.size_of(HlBvhImpl::ScratchLayout::kSortedMortonCodes);
-    auto sorted_primitive_offset = impl_->scratch_layout_.offset_of(HlBvhImpl::ScratchLayout::kSortedPrimitiveRefs);
-    auto sorted_primitive_size   = impl_->scratch_layout_.size_of(HlBvhImpl::ScratchLayout::kSortedPrimitiveRefs);
     auto sort_offset             = impl_->scratch_layout_.offset_of(HlBvhImpl::ScratchLayout::kSortMemory);
 
+    // Sort keys lead the Morton code block, wide codes keep their high and low words after them.
+    auto wide_morton_codes = impl_->UseWideMortonCodes(triangle_count);
+    auto keys_size         = vk::DeviceSize(triangle_count * sizeof(uint32_t));
+    auto calc_morton_codes_kernel =
+        wide_morton_codes ? impl_->calc_wide_morton_codes_kernel_ : impl_->calc_morton_codes_kernel_;
+    auto emit_bvh_kernel = wide_morton_codes ? impl_->emit_wide_bvh_kernel_ : impl_->emit_bvh_kernel_;
+
     /// Init mesh AABB
     {
         // Bind internal and user desc sets.
@@ -243,7 +291,7 @@ void BuildHlBvh::operator()(vk::CommandBuffer command_buffer,
     {
         // Set prim counter push constant.
         impl_->gpu_helper_->EncodePushConstant(
-            impl_->calc_morton_codes_kernel_->pipeline_layout, 0u, sizeof(push_consts), push_consts, command_buffer);
+            calc_morton_codes_kernel->pipeline_layout, 0u, sizeof(push_consts), push_consts, command_buffer);
 
         // Bind internal and user desc sets.
         std::vector<vk::DescriptorSet> desc_sets = {impl_->build_sets_[0].descriptor_set_,
@@ -253,12 +301,12 @@ void BuildHlBvh::operator()(vk::CommandBuffer command_buffer,
         impl_->gpu_helper_->EncodeBindDescriptorSets(desc_sets.data(),
                                                      (std::uint32_t)desc_sets.size(),
                                                      0u,
-                                                     impl_->calc_morton_codes_kernel_->pipeline_layout,
+                                                     calc_morton_codes_kernel->pipeline_layout,
                                                      command_buffer);
 
         // Launch kernel.
         auto num_groups = CeilDivide(triangle_count, kTrianglesPerGroup);
-        impl_->shader_manager_.EncodeDispatch1D(*impl_->calc_morton_codes_kernel_, num_groups, command_buffer);
+        impl_->shader_manager_.EncodeDispatch1D(*calc_morton_codes_kernel, num_groups, command_buffer);
 
         impl_->gpu_helper_->EncodeBufferBarrier(scratch,
                                                 vk::AccessFlagBits::eShaderWrite,
@@ -278,29 +326,101 @@ void BuildHlBvh::operator()(vk::CommandBuffer command_buffer,
                                                 primitive_offset,
                                                 primitive_size);
     }
-    /// Sort Morton codes and prim indices
-    impl_->radix_sort_(command_buffer,
-                       scratch,
-                       morton_offset,
-                       morton_size,
-                       scratch,
-                       sorted_morton_offset,
-                       (vk::DeviceSize)sorted_morton_size,
-                       scratch,
-                       primitive_offset,
-                       (vk::DeviceSize)primitive_size,
-                       scratch,
-                       sorted_primitive_offset,
-                       (vk::DeviceSize)sorted_primitive_size,
-                       scratch,
-                       sort_offset,
-                       triangle_count);
+    /// Sort Morton codes and prim indices in place
+    if (wide_morton_codes)
+    {
+        // Two stable passes: by low words, then by high words gathered in the resulting order.
+        impl_->radix_sort_(command_buffer,
+                           scratch,
+                           morton_offset,
+                           keys_size,
+                           scratch,
+                           morton_offset,
+                           keys_size,
+                           scratch,
+                           primitive_offset,
+                           (vk::DeviceSize)primitive_size,
+                           scratch,
+                           primitive_offset,
+                           (vk::DeviceSize)primitive_size,
+                           scratch,
+                           sort_offset,
+                           triangle_count,
+                           kWideMortonCodeLowBits);
+
+        // Set prim counter push constant.
+        impl_->gpu_helper_->EncodePushConstant(impl_->gather_morton_codes_kernel_->pipeline_layout,
+                                               0u,
+                                               sizeof(uint32_t),
+                                               &triangle_count,
+                                               command_buffer);
+
+        // Bind internal and user desc sets.
+        std::vector<vk::DescriptorSet> desc_sets = {impl_->build_sets_[0].descriptor_set_,
+                                                    impl_->build_sets_[1].descriptor_set_};
+
+        impl_->gpu_helper_->EncodeBindDescriptorSets(desc_sets.data(),
+                                                     (std::uint32_t)desc_sets.size(),
+                                                     0u,
+                                                     impl_->gather_morton_codes_kernel_->pipeline_layout,
+                                                     command_buffer);
+
+        // Launch kernel.
+        auto num_groups = CeilDivide(triangle_count, kTrianglesPerGroup);
+        impl_->shader_manager_.EncodeDispatch1D(*impl_->gather_morton_codes_kernel_, num_groups, command_buffer);
+
+        impl_->gpu_helper_->EncodeBufferBarrier(scratch,
+                                                vk::AccessFlagBits::eShaderWrite,
+                                                vk::AccessFlagBits::eShaderRead,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                command_buffer,
+                                                morton_offset,
+                                                keys_size);
+
+        impl_->radix_sort_(command_buffer,
+                           scratch,
+                           morton_offset,
+                           keys_size,
+                           scratch,
+                           morton_offset,
+                           keys_size,
+                           scratch,
+                           primitive_offset,
+                           (vk::DeviceSize)primitive_size,
+                           scratch,
+                           primitive_offset,
+                           (vk::DeviceSize)primitive_size,
+                           scratch,
+                           sort_offset,
+                           triangle_count,
+                           kWideMortonCodeHighBits);
+    } else
+    {
+        impl_->radix_sort_(command_buffer,
+                           scratch,
+                           morton_offset,
+                           morton_size,
+                           scratch,
+                           morton_offset,
+                           (vk::DeviceSize)morton_size,
+                           scratch,
+                           primitive_offset,
+                           (vk::DeviceSize)primitive_size,
+                           scratch,
+                           primitive_offset,
+                           (vk::DeviceSize)primitive_size,
+                           scratch,
+                           sort_offset,
+                           triangle_count,
+                           kMortonCodeBits);
+    }
 
     /// Emit BVH
     {
         // Set prim counter push constant.
         impl_->gpu_helper_->EncodePushConstant(
-            impl_->emit_bvh_kernel_->pipeline_layout, 0u, sizeof(uint32_t), &triangle_count, command_buffer);
+            emit_bvh_kernel->pipeline_layout, 0u, sizeof(uint32_t), &triangle_count, command_buffer);
 
         // Bind internal and user desc sets.
         std::vector<vk::DescriptorSet> desc_sets = {impl_->build_sorted_sets_[0].descriptor_set_,
@@ -310,11 +430,11 @@ void BuildHlBvh::operator()(vk::CommandBuffer command_buffer,
         impl_->gpu_helper_->EncodeBindDescriptorSets(desc_sets.data(),
                                                      (std::uint32_t)desc_sets.size(),
                                                      0u,
-                                                     impl_->emit_bvh_kernel_->pipeline_layout,
+                                                     emit_bvh_kernel->pipeline_layout,
                                                      command_buffer);
         // Launch kernel.
         auto num_groups = CeilDivide(triangle_count, kTrianglesPerGroup);
-        impl_->shader_manager_.EncodeDispatch1D(*impl_->emit_bvh_kernel_, num_groups, command_buffer);
+        impl_->shader_manager_.EncodeDispatch1D(*emit_bvh_kernel, num_groups, command_buffer);
         impl_->gpu_helper_->EncodeBufferBarrier(result,
                                                 vk::AccessFlagBits::eShaderWrite,
                                                 vk::AccessFlagBits::eShaderRead,
@@ -375,19 +495,23 @@ void BuildHlBvh::AdjustLayouts(uint32_t triangle_count) const
     // Result buffer
     impl_->result_layout_.AppendBlock<BvhNode>(HlBvhImpl::ResultLayout::kBvh,
                                                GetBvhNodeCount(impl_->current_triangle_count_));
-    // Scratch buffer.
-    impl_->scratch_layout_.AppendBlock<Aabb>(HlBvhImpl::ScratchLayout::kAabb, 1);
+    // Scratch buffer. Keys are sorted in place, so sorted copies are not needed, and the mesh AABB is only read
+    // before the sort, so it aliases the sort memory. Wide Morton codes keep unsorted high and low words after keys.
+    auto morton_code_count = impl_->UseWideMortonCodes(impl_->current_triangle_count_)
+                                 ? 3 * impl_->current_triangle_count_
+                                 : impl_->current_triangle_count_;
     impl_->scratch_layout_.AppendBlock<uint32_t>(HlBvhImpl::ScratchLayout::kMortonCodes,
-                                                 impl_->current_triangle_count_);
+                                                 morton_code_count,
+                                                 {HlBvhImpl::kCalcMortonCodesPhase, HlBvhImpl::kEmitPhase});
     impl_->scratch_layout_.AppendBlock<uint32_t>(HlBvhImpl::ScratchLayout::kPrimitiveRefs,
-                                                 impl_->current_triangle_count_);
-    impl_->scratch_layout_.AppendBlock<uint32_t>(HlBvhImpl::ScratchLayout::kSortedMortonCodes,
-                                                 impl_->current_triangle_count_);
-    impl_->scratch_layout_.AppendBlock<uint32_t>(HlBvhImpl::ScratchLayout::kSortedPrimitiveRefs,
-                                                 impl_->current_triangle_count_);
+                                                 impl_->current_triangle_count_,
+                                                 {HlBvhImpl::kCalcMortonCodesPhase, HlBvhImpl::kEmitPhase});
 
     auto sort_memory_size = impl_->radix_sort_.GetScratchDataSize(impl_->current_triangle_count_);
-    impl_->scratch_layout_.AppendBlock<char>(HlBvhImpl::ScratchLayout::kSortMemory, sort_memory_size);
+    impl_->scratch_layout_.AppendBlock<char>(
+        HlBvhImpl::ScratchLayout::kSortMemory, sort_memory_size, {HlBvhImpl::kSortPhase, HlBvhImpl::kSortPhase});
+    impl_->scratch_layout_.AppendBlock<Aabb>(
+        HlBvhImpl::ScratchLayout::kAabb, 1, {HlBvhImpl::kCalcAabbPhase, HlBvhImpl::kCalcMortonCodesPhase});
 }
 
 void BuildHlBvh::UpdateDescriptors(vk::Buffer vertices,
@@ -413,10 +537,6 @@ void BuildHlBvh::UpdateDescriptors(vk::Buffer vertices,
         auto morton_size             = impl_->scratch_layout_.size_of(HlBvhImpl::ScratchLayout::kMortonCodes);
         auto primitive_offset        = impl_->scratch_layout_.offset_of(HlBvhImpl::ScratchLayout::kPrimitiveRefs);
         auto primitive_size          = impl_->scratch_layout_.size_of(HlBvhImpl::ScratchLayout::kPrimitiveRefs);
-        auto sorted_morton_offset    = impl_->scratch_layout_.offset_of(HlBvhImpl::ScratchLayout::kSortedMortonCodes);
-        auto sorted_morton_size      = impl_->scratch_layout_.size_of(HlBvhImpl::ScratchLayout::kSortedMortonCodes);
-        auto sorted_primitive_offset = impl_->scratch_layout_.offset_of(HlBvhImpl::ScratchLayout::kSortedPrimitiveRefs);
-        auto sorted_primitive_size   = impl_->scratch_layout_.size_of(HlBvhImpl::ScratchLayout::kSortedPrimitiveRefs);
 
         // Build desc set for BVH builds.
         {
@@ -429,11 +549,11 @@ void BuildHlBvh::UpdateDescriptors(vk::Buffer vertices,
                 impl_->build_sets_[0].descriptor_set_, buffer_infos, sizeof(buffer_infos) / sizeof(buffer_infos[0]));
         }
 
-        // Build desc set for BVH updates.
+        // Build desc set for BVH emission, keys are sorted in place by then.
         {
             vk::DescriptorBufferInfo buffer_infos[] = {{result, bvh_offset, bvh_size},
-                                                       {scratch, sorted_morton_offset, sorted_morton_size},
-                                                       {scratch, sorted_primitive_offset, sorted_primitive_size},
+                                                       {scratch, morton_offset, morton_size},
+                                                       {scratch, primitive_offset, primitive_size},
                                                        {scratch, aabb_offset, aabb_size}};
 
             impl_->gpu_helper_->WriteDescriptorSet(impl_->build_sorted_sets_[0].descriptor_set_,
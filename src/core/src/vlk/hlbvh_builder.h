@@ -35,7 +35,18 @@ namespace rt::vulkan
 class BuildHlBvh
 {
 public:
-    BuildHlBvh(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager);
+    /// Above this count 30-bit Morton codes collapse too many primitives into identical codes.
+    static constexpr uint32_t kDefaultWideMortonCodesMinTriangleCount = 1u << 22u;
+
+    /**
+     * @brief Constructor.
+     *
+     * @param wide_morton_codes_min_triangle_count Meshes with at least this many triangles are sorted by 63-bit
+     * Morton codes.
+     **/
+    BuildHlBvh(std::shared_ptr<GpuHelper> gpu_helper,
+               ShaderManager const&       shader_manager,
+               uint32_t wide_morton_codes_min_triangle_count = kDefaultWideMortonCodesMinTriangleCount);
     ~BuildHlBvh();
     /**
      * @brief Build BVH.
@@ -34,15 +34,21 @@ constexpr char const* s_calc_scene_aabb_kernel_name   = "lbvh_calc_scene_aabb.co
 constexpr char const* s_emit_bvh_kernel_name          = "lbvh_emit_hierarchy_scene.comp.spv";
 constexpr char const* s_fit_aabb_kernel_name          = "lbvh_fit_aabb_scene.comp.spv";
 constexpr char const* s_init_kernel_name              = "lbvh_init_scene.comp.spv";
+// Refit kernels
+constexpr char const* s_reset_update_kernel_name = "lbvh_reset_update_flags_scene.comp.spv";
+constexpr char const* s_update_kernel_name       = "lbvh_update_scene.comp.spv";
 
 // there is only option to have 1 instance per thread due to descriptor indexing extension implemention
 constexpr uint32_t kInstancesPerThread = 8u;
 constexpr uint32_t kGroupSize          = 128u;
 constexpr uint32_t kInstancesPerGroup  = kInstancesPerThread * kGroupSize;
+// Morton codes only occupy the low 30 bits of sort keys.
+constexpr uint32_t kMortonCodeBits = 30u;
 
 uint32_t GetBvhInternalNodeCount(uint32_t leaf_count) { return leaf_count - 1; }
 uint32_t GetBvhNodeCount(uint32_t leaf_count) { return 2 * leaf_count - 1; }
 uint32_t GetTransformsCount(uint32_t leaf_count) { return 2 * leaf_count; }
+uint32_t GetInstanceDataCount(uint32_t leaf_count) { return 4 * leaf_count; }
 }  // namespace
 
 struct BuildHlBvhTopLevel::HlBvhTopLevelImpl
@@ -51,7 +57,8 @@ struct BuildHlBvhTopLevel::HlBvhTopLevelImpl
     enum class ResultLayout
     {
         kBvh,
-        kTransforms
+        kTransforms,
+        kInstances
     };
 
     // Scratch space layout.
@@ -60,11 +67,18 @@ struct BuildHlBvhTopLevel::HlBvhTopLevelImpl
         kAabb,
         kMortonCodes,
         kPrimitiveRefs,
-        kSortedMortonCodes,
-        kSortedPrimitiveRefs,
         kSortMemory
     };
 
+    // Build phases scratch blocks are alive in.
+    enum BuildPhase : uint32_t
+    {
+        kCalcAabbPhase,
+        kCalcMortonCodesPhase,
+        kSortPhase,
+        kEmitPhase
+    };
+
     std::shared_ptr<GpuHelper> gpu_helper_;
     ShaderManager const&       shader_manager_;
 
@@ -74,6 +88,7 @@ struct BuildHlBvhTopLevel::HlBvhTopLevelImpl
     // Descriptor sets
     std::vector<DescriptorSet> build_sets_;
     std::vector<DescriptorSet> build_sorted_sets_;
+    std::vector<DescriptorSet> update_sets_;
     DescriptorCacheTable<4, 3> cache_;
 
     ShaderPtr calc_aabb_kernel_         = nullptr;
@@ -81,6 +96,8 @@ struct BuildHlBvhTopLevel::HlBvhTopLevelImpl
     ShaderPtr emit_bvh_kernel_          = nullptr;
     ShaderPtr fit_aabb_kernel_          = nullptr;
     ShaderPtr init_kernel_              = nullptr;
+    ShaderPtr reset_update_kernel_      = nullptr;
+    ShaderPtr update_kernel_            = nullptr;
 
     using ResultLayoutT  = MemoryLayout<ResultLayout, vk::DeviceSize>;
     using ScratchLayoutT = MemoryLayout<ScratchLayout, vk::DeviceSize>;
@@ -118,6 +135,16 @@ struct BuildHlBvhTopLevel::HlBvhTopLevelImpl
 
         fit_aabb_kernel_ = shader_manager_.CreateKernel(fit_aabb_id);
         shader_manager_.PrepareKernel(fit_aabb_id, build_sorted_sets_);
+
+        ShaderManager::KernelID reset_update_id = s_reset_update_kernel_name;
+        ShaderManager::KernelID update_id       = s_update_kernel_name;
+
+        update_kernel_ = shader_manager_.CreateKernel(update_id);
+        update_sets_   = shader_manager_.CreateDescriptorSets(update_kernel_);
+        shader_manager_.PrepareKernel(update_id, update_sets_);
+
+        reset_update_kernel_ = shader_manager_.CreateKernel(reset_update_id);
+        shader_manager_.PrepareKernel(reset_update_id, update_sets_);
     }
 
     void AllocateDescriptorSets()
@@ -151,6 +178,10 @@ struct BuildHlBvhTopLevel::HlBvhTopLevelImpl
         {
             gpu_helper_->device.destroyDescriptorSetLayout(desc_set.layout_);
         }
+        for (auto& desc_set : update_sets_)
+        {
+            gpu_helper_->device.destroyDescriptorSetLayout(desc_set.layout_);
+        }
     }
 };
 
@@ -179,12 +210,7 @@ void BuildHlBvhTopLevel::operator()(vk::CommandBuffer            command_buffer,
     auto morton_size          = impl_->scratch_layout_.size_of(HlBvhTopLevelImpl::ScratchLayout::kMortonCodes);
     auto primitive_offset     = impl_->scratch_layout_.offset_of(HlBvhTopLevelImpl::ScratchLayout::kPrimitiveRefs);
     auto primitive_size       = impl_->scratch_layout_.size_of(HlBvhTopLevelImpl::ScratchLayout::kPrimitiveRefs);
-    auto sorted_morton_offset = impl_->scratch_layout_.offset_of(HlBvhTopLevelImpl::ScratchLayout::kSortedMortonCodes);
-    auto sorted_morton_size   = impl_->scratch_layout_.size_of(HlBvhTopLevelImpl::ScratchLayout::kSortedMortonCodes);
-    auto sorted_primitive_offset =
-        impl_->scratch_layout_.offset_of(HlBvhTopLevelImpl::ScratchLayout::kSortedPrimitiveRefs);
-    auto sorted_primitive_size = impl_->scratch_layout_.size_of(HlBvhTopLevelImpl::ScratchLayout::kSortedPrimitiveRefs);
-    auto sort_offset           = impl_->scratch_layout_.offset_of(HlBvhTopLevelImpl::ScratchLayout::kSortMemory);
+    auto sort_offset          = impl_->scratch_layout_.offset_of(HlBvhTopLevelImpl::ScratchLayout::kSortMemory);
 
     uint32_t push_consts[] = {instance_count};
 
@@ -281,23 +307,24 @@ void BuildHlBvhTopLevel::operator()(vk::CommandBuffer            command_buffer,
                                                 primitive_offset,
                                                 primitive_size);
     }
-    /// Sort Morton codes and prim indices
+    /// Sort Morton codes and prim indices in place
     impl_->radix_sort_(command_buffer,
                        scratch,
                        morton_offset,
                        morton_size,
                        scratch,
-                       sorted_morton_offset,
-                       (vk::DeviceSize)sorted_morton_size,
+                       morton_offset,
+                       (vk::DeviceSize)morton_size,
                        scratch,
                        primitive_offset,
                        (vk::DeviceSize)primitive_size,
                        scratch,
-                       sorted_primitive_offset,
-                       (vk::DeviceSize)sorted_primitive_size,
+                       primitive_offset,
+                       (vk::DeviceSize)primitive_size,
                        scratch,
                        sort_offset,
-                       instance_count);
+                       instance_count,
+                       kMortonCodeBits);
 
     /// Emit BVH
     {
@@ -353,12 +380,115 @@ void BuildHlBvhTopLevel::operator()(vk::CommandBuffer            command_buffer,
     }
 }
 
+void BuildHlBvhTopLevel::Update(vk::CommandBuffer            command_buffer,
+                                vk::Buffer                   instance_descs,
+                                size_t                       instance_desc_offset,
+                                ChildrenBvhsContainer const& instances,
+                                uint32_t                     instance_count,
+                                vk::Buffer                   result,
+                                size_t                       result_offset)
+{
+    AdjustLayouts(instance_count);
+    UpdateRefitDescriptors(instance_descs, instance_desc_offset, instances, result, result_offset);
+
+    uint32_t push_consts[] = {instance_count};
+    auto     num_groups    = CeilDivide(instance_count, kInstancesPerGroup);
+
+    /// Reset update flags left set by the previous fit
+    {
+        std::vector<vk::DescriptorSet> desc_sets = {impl_->update_sets_[0].descriptor_set_,
+                                                    impl_->update_sets_[1].descriptor_set_};
+
+        impl_->gpu_helper_->EncodePushConstant(
+            impl_->reset_update_kernel_->pipeline_layout, 0u, sizeof(push_consts), push_consts, command_buffer);
+
+        impl_->gpu_helper_->EncodeBindDescriptorSets(desc_sets.data(),
+                                                     (std::uint32_t)desc_sets.size(),
+                                                     0u,
+                                                     impl_->reset_update_kernel_->pipeline_layout,
+                                                     command_buffer);
+
+        impl_->shader_manager_.EncodeDispatch1D(*impl_->reset_update_kernel_, num_groups, command_buffer);
+        impl_->gpu_helper_->EncodeBufferBarrier(result,
+                                                vk::AccessFlagBits::eShaderWrite,
+                                                vk::AccessFlagBits::eShaderRead,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                command_buffer);
+    }
+
+    EncodeRefit(command_buffer, instance_count, result);
+}
+
+void BuildHlBvhTopLevel::BuildFromNodes(vk::CommandBuffer            command_buffer,
+                                        vk::Buffer                   nodes,
+                                        size_t                       nodes_offset,
+                                        vk::Buffer                   instance_descs,
+                                        size_t                       instance_desc_offset,
+                                        ChildrenBvhsContainer const& instances,
+                                        uint32_t                     instance_count,
+                                        vk::Buffer                   result,
+                                        size_t                       result_offset)
+{
+    AdjustLayouts(instance_count);
+    UpdateRefitDescriptors(instance_descs, instance_desc_offset, instances, result, result_offset);
+
+    // Host nodes come with zeroed update flags, so no reset is needed before the fit.
+    auto bvh_offset = impl_->result_layout_.offset_of(HlBvhTopLevelImpl::ResultLayout::kBvh);
+    auto bvh_size   = impl_->result_layout_.size_of(HlBvhTopLevelImpl::ResultLayout::kBvh);
+    command_buffer.copyBuffer(nodes, result, vk::BufferCopy(nodes_offset, bvh_offset, bvh_size));
+    impl_->gpu_helper_->EncodeBufferBarrier(result,
+                                            vk::AccessFlagBits::eTransferWrite,
+                                            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                                            vk::PipelineStageFlagBits::eTransfer,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer,
+                                            bvh_offset,
+                                            bvh_size);
+
+    EncodeRefit(command_buffer, instance_count, result);
+}
+
+void BuildHlBvhTopLevel::EncodeRefit(vk::CommandBuffer command_buffer, uint32_t instance_count, vk::Buffer result)
+{
+    uint32_t push_consts[] = {instance_count};
+
+    std::vector<vk::DescriptorSet> desc_sets = {impl_->update_sets_[0].descriptor_set_,
+                                                impl_->update_sets_[1].descriptor_set_};
+
+    /// Fit bounds and write transforms
+    impl_->gpu_helper_->EncodePushConstant(
+        impl_->update_kernel_->pipeline_layout, 0u, sizeof(push_consts), push_consts, command_buffer);
+
+    impl_->gpu_helper_->EncodeBindDescriptorSets(desc_sets.data(),
+                                                 (std::uint32_t)desc_sets.size(),
+                                                 0u,
+                                                 impl_->update_kernel_->pipeline_layout,
+                                                 command_buffer);
+
+    auto num_groups = CeilDivide(instance_count, kInstancesPerGroup);
+    impl_->shader_manager_.EncodeDispatch1D(*impl_->update_kernel_, num_groups, command_buffer);
+    impl_->gpu_helper_->EncodeBufferBarrier(result,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eShaderRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer);
+}
+
 size_t BuildHlBvhTopLevel::GetResultDataSize(uint32_t instance_count) const
 {
     AdjustLayouts(instance_count);
     return impl_->result_layout_.total_size();
 }
 
+size_t BuildHlBvhTopLevel::GetInstancesOffset(uint32_t instance_count) const
+{
+    AdjustLayouts(instance_count);
+    return impl_->result_layout_.offset_of(HlBvhTopLevelImpl::ResultLayout::kInstances) -
+           impl_->result_layout_.offset_of(HlBvhTopLevelImpl::ResultLayout::kBvh);
+}
+
 size_t BuildHlBvhTopLevel::GetScratchDataSize(uint32_t instance_count) const
 {
     AdjustLayouts(instance_count);
@@ -379,19 +509,21 @@ void BuildHlBvhTopLevel::AdjustLayouts(uint32_t instance_count) const
                                                GetBvhNodeCount(impl_->current_instance_count_));
     impl_->result_layout_.AppendBlock<Transform>(HlBvhTopLevelImpl::ResultLayout::kTransforms,
                                                  GetTransformsCount(impl_->current_instance_count_));
-    // Scratch buffer.
-    impl_->scratch_layout_.AppendBlock<Aabb>(HlBvhTopLevelImpl::ScratchLayout::kAabb, 1);
-    impl_->scratch_layout_.AppendBlock<uint32_t>(HlBvhTopLevelImpl::ScratchLayout::kMortonCodes,
-                                                 impl_->current_instance_count_);
-    impl_->scratch_layout_.AppendBlock<uint32_t>(HlBvhTopLevelImpl::ScratchLayout::kPrimitiveRefs,
-                                                 impl_->current_instance_count_);
-    impl_->scratch_layout_.AppendBlock<uint32_t>(HlBvhTopLevelImpl::ScratchLayout::kSortedMortonCodes,
-                                                 impl_->current_instance_count_);
-    impl_->scratch_layout_.AppendBlock<uint32_t>(HlBvhTopLevelImpl::ScratchLayout::kSortedPrimitiveRefs,
-                                                 impl_->current_instance_count_);
+    impl_->result_layout_.AppendBlock<uint32_t>(HlBvhTopLevelImpl::ResultLayout::kInstances,
+                                                GetInstanceDataCount(impl_->current_instance_count_));
+    // Scratch buffer. Keys are sorted in place and the scene AABB aliases the sort memory.
+    BlockLifetime keys_lifetime{HlBvhTopLevelImpl::kCalcMortonCodesPhase, HlBvhTopLevelImpl::kEmitPhase};
+    BlockLifetime sort_lifetime{HlBvhTopLevelImpl::kSortPhase, HlBvhTopLevelImpl::kSortPhase};
+    BlockLifetime aabb_lifetime{HlBvhTopLevelImpl::kCalcAabbPhase, HlBvhTopLevelImpl::kCalcMortonCodesPhase};
+    impl_->scratch_layout_.AppendBlock<uint32_t>(
+        HlBvhTopLevelImpl::ScratchLayout::kMortonCodes, impl_->current_instance_count_, keys_lifetime);
+    impl_->scratch_layout_.AppendBlock<uint32_t>(
+        HlBvhTopLevelImpl::ScratchLayout::kPrimitiveRefs, impl_->current_instance_count_, keys_lifetime);
 
     auto sort_memory_size = impl_->radix_sort_.GetScratchDataSize(impl_->current_instance_count_);
-    impl_->scratch_layout_.AppendBlock<char>(HlBvhTopLevelImpl::ScratchLayout::kSortMemory, sort_memory_size);
+    impl_->scratch_layout_.AppendBlock<char>(
+        HlBvhTopLevelImpl::ScratchLayout::kSortMemory, sort_memory_size, sort_lifetime);
+    impl_->scratch_layout_.AppendBlock<Aabb>(HlBvhTopLevelImpl::ScratchLayout::kAabb, 1, aabb_lifetime);
 }
 
 void BuildHlBvhTopLevel::UpdateDescriptors(vk::Buffer                   instance_desc,
@@ -410,6 +542,8 @@ void BuildHlBvhTopLevel::UpdateDescriptors(vk::Buffer                   instance
         auto bvh_size          = impl_->result_layout_.size_of(HlBvhTopLevelImpl::ResultLayout::kBvh);
         auto transforms_offset = impl_->result_layout_.offset_of(HlBvhTopLevelImpl::ResultLayout::kTransforms);
         auto transforms_size   = impl_->result_layout_.size_of(HlBvhTopLevelImpl::ResultLayout::kTransforms);
+        auto instances_offset  = impl_->result_layout_.offset_of(HlBvhTopLevelImpl::ResultLayout::kInstances);
+        auto instances_size    = impl_->result_layout_.size_of(HlBvhTopLevelImpl::ResultLayout::kInstances);
         // scratch layout: temporary buffers
         impl_->scratch_layout_.SetBaseOffset((VkDeviceSize)scratch_offset);
         auto aabb_offset      = impl_->scratch_layout_.offset_of(HlBvhTopLevelImpl::ScratchLayout::kAabb);
@@ -418,20 +552,14 @@ void BuildHlBvhTopLevel::UpdateDescriptors(vk::Buffer                   instance
         auto morton_size      = impl_->scratch_layout_.size_of(HlBvhTopLevelImpl::ScratchLayout::kMortonCodes);
         auto primitive_offset = impl_->scratch_layout_.offset_of(HlBvhTopLevelImpl::ScratchLayout::kPrimitiveRefs);
         auto primitive_size   = impl_->scratch_layout_.size_of(HlBvhTopLevelImpl::ScratchLayout::kPrimitiveRefs);
-        auto sorted_morton_offset =
-            impl_->scratch_layout_.offset_of(HlBvhTopLevelImpl::ScratchLayout::kSortedMortonCodes);
-        auto sorted_morton_size = impl_->scratch_layout_.size_of(HlBvhTopLevelImpl::ScratchLayout::kSortedMortonCodes);
-        auto sorted_primitive_offset =
-            impl_->scratch_layout_.offset_of(HlBvhTopLevelImpl::ScratchLayout::kSortedPrimitiveRefs);
-        auto sorted_primitive_size =
-            impl_->scratch_layout_.size_of(HlBvhTopLevelImpl::ScratchLayout::kSortedPrimitiveRefs);
 
         {
             vk::DescriptorBufferInfo buffer_infos[] = {{result, bvh_offset, bvh_size},
                                                        {result, transforms_offset, transforms_size},
                                                        {scratch, morton_offset, morton_size},
                                                        {scratch, primitive_offset, primitive_size},
-                                                       {scratch, aabb_offset, aabb_size}};
+                                                       {scratch, aabb_offset, aabb_size},
+                                                       {result, instances_offset, instances_size}};
 
             impl_->gpu_helper_->WriteDescriptorSet(
                 impl_->build_sets_[0].descriptor_set_, buffer_infos, sizeof(buffer_infos) / sizeof(buffer_infos[0]));
@@ -440,9 +568,10 @@ void BuildHlBvhTopLevel::UpdateDescriptors(vk::Buffer                   instance
         {
             vk::DescriptorBufferInfo buffer_infos[] = {{result, bvh_offset, bvh_size},
                                                        {result, transforms_offset, transforms_size},
-                                                       {scratch, sorted_morton_offset, sorted_morton_size},
-                                                       {scratch, sorted_primitive_offset, sorted_primitive_size},
-                                                       {scratch, aabb_offset, aabb_size}};
+                                                       {scratch, morton_offset, morton_size},
+                                                       {scratch, primitive_offset, primitive_size},
+                                                       {scratch, aabb_offset, aabb_size},
+                                                       {result, instances_offset, instances_size}};
 
             impl_->gpu_helper_->WriteDescriptorSet(impl_->build_sorted_sets_[0].descriptor_set_,
                                                    buffer_infos,
@@ -469,4 +598,46 @@ void BuildHlBvhTopLevel::UpdateDescriptors(vk::Buffer                   instance
     }
 }
 
+void BuildHlBvhTopLevel::UpdateRefitDescriptors(vk::Buffer                   instance_desc,
+                                                size_t                       instance_desc_offset,
+                                                ChildrenBvhsContainer const& instances,
+                                                vk::Buffer                   result,
+                                                size_t                       result_offset)
+{
+    // Allocated per update for the same reason as build descriptor sets.
+    impl_->update_sets_[0].descriptor_set_ = impl_->gpu_helper_->AllocateDescriptorSet(impl_->update_sets_[0].layout_);
+    impl_->update_sets_[1].descriptor_set_ = impl_->gpu_helper_->AllocateDescriptorSet(impl_->update_sets_[1].layout_);
+
+    impl_->result_layout_.SetBaseOffset((VkDeviceSize)result_offset);
+    auto bvh_offset        = impl_->result_layout_.offset_of(HlBvhTopLevelImpl::ResultLayout::kBvh);
+    auto bvh_size          = impl_->result_layout_.size_of(HlBvhTopLevelImpl::ResultLayout::kBvh);
+    auto transforms_offset = impl_->result_layout_.offset_of(HlBvhTopLevelImpl::ResultLayout::kTransforms);
+    auto transforms_size   = impl_->result_layout_.size_of(HlBvhTopLevelImpl::ResultLayout::kTransforms);
+    auto instances_offset  = impl_->result_layout_.offset_of(HlBvhTopLevelImpl::ResultLayout::kInstances);
+    auto instances_size    = impl_->result_layout_.size_of(HlBvhTopLevelImpl::ResultLayout::kInstances);
+
+    {
+        vk::DescriptorBufferInfo buffer_infos[] = {{result, bvh_offset, bvh_size},
+                                                   {result, transforms_offset, transforms_size},
+                                                   {result, instances_offset, instances_size}};
+
+        impl_->gpu_helper_->WriteDescriptorSet(
+            impl_->update_sets_[0].descriptor_set_, buffer_infos, sizeof(buffer_infos) / sizeof(buffer_infos[0]));
+    }
+
+    {
+        vk::DescriptorBufferInfo instance_info{instance_desc, instance_desc_offset, VK_WHOLE_SIZE};
+        impl_->gpu_helper_->WriteDescriptorSet(impl_->update_sets_[1].descriptor_set_, &instance_info, 1u, 0u);
+
+        std::vector<vk::DescriptorBufferInfo> buffer_infos;
+        for (const auto& instance : instances)
+        {
+            buffer_infos.push_back({instance.first, instance.second, VK_WHOLE_SIZE});
+        }
+
+        impl_->gpu_helper_->WriteDescriptorSet(
+            impl_->update_sets_[1].descriptor_set_, buffer_infos.data(), (uint32_t)buffer_infos.size(), 1u);
+    }
+}
+
 }  // namespace rt::vulkan
\ No newline at end of file
@@ -53,6 +53,37 @@ public:
                     vk::Buffer                   result,
                     size_t                       result_offset);
 
+    /**
+     * @brief Refit BVH.
+     *
+     * Given a set of instance descs for a scene built with the same instance count,
+     * refit the existing BVH to new transforms. The topology is kept, so no scratch memory is needed.
+     **/
+    void Update(vk::CommandBuffer            command_buffer,
+                vk::Buffer                   instance_descs,
+                size_t                       instance_desc_offset,
+                ChildrenBvhsContainer const& instances,
+                uint32_t                     instance_count,
+                vk::Buffer                   result,
+                size_t                       result_offset);
+
+    /**
+     * @brief Build BVH out of host built nodes.
+     *
+     * Copy BVH nodes with topology built on the host into the result and fit their bounds.
+     *
+     * @param nodes Buffer holding 2 * instance_count - 1 nodes laid out the way the GPU emits them.
+     **/
+    void BuildFromNodes(vk::CommandBuffer            command_buffer,
+                        vk::Buffer                   nodes,
+                        size_t                       nodes_offset,
+                        vk::Buffer                   instance_descs,
+                        size_t                       instance_desc_offset,
+                        ChildrenBvhsContainer const& instances,
+                        uint32_t                     instance_count,
+                        vk::Buffer                   result,
+                        size_t                       result_offset);
+
     /**
      * @brief Get size if bytes required to hold resulting BVH.
      *
@@ -60,6 +91,15 @@ public:
      **/
     size_t GetResultDataSize(uint32_t instance_count) const;
 
+    /**
+     * @brief Get offset in bytes of the instance table in the resulting buffer.
+     *
+     * The table holds (geometry buffer slot, root node index, mask, 0) per instance.
+     *
+     * @param instance_count Number of instances
+     **/
+    size_t GetInstancesOffset(uint32_t instance_count) const;
+
     /**
      * @brief Get size if bytes required for scratch space.
      *
@@ -76,6 +116,12 @@ private:
                            size_t                       scratch_offset,
                            vk::Buffer                   result,
                            size_t                       result_offset);
+    void EncodeRefit(vk::CommandBuffer command_buffer, uint32_t instance_count, vk::Buffer result);
+    void UpdateRefitDescriptors(vk::Buffer                   instance_descs,
+                                size_t                       instance_desc_offset,
+                                ChildrenBvhsContainer const& instances,
+                                vk::Buffer                   result,
+                                size_t                       result_offset);
 
 private:
     struct HlBvhTopLevelImpl;
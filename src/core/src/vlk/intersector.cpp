@@ -19,14 +19,22 @@ THE SOFTWARE.
 
 #include "intersector.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "utils/logger.h"
+#include "vlk/collapse_bvh4.h"
 #include "vlk/common.h"
 #include "vlk/geometry_trace.h"
+#include "vlk/hlbvh_batch_builder.h"
 #include "vlk/hlbvh_builder.h"
 #include "vlk/hlbvh_top_level_builder.h"
+#include "vlk/reorder_rays.h"
 #include "vlk/restructure_hlbvh.h"
+#include "vlk/root_bounds.h"
+#include "vlk/sah_top_level_builder.h"
 #include "vlk/scene_trace.h"
 #include "vlk/shader_manager.h"
 #include "vlk/update_hlbvh.h"
@@ -35,13 +43,44 @@ namespace rt::vulkan
 {
 namespace
 {
-constexpr size_t kMaxInstances = 2048;
+// Max number of distinct buffers holding the geometries of a scene, sizes the descriptor arrays of scene kernels.
+constexpr size_t kMaxGeometryBuffers = RR_MAX_GEOMETRY_BUFFERS;
+// Number of geometry bounds held by a chunk of host visible bounds hints.
+constexpr uint32_t kBoundsHintsPerChunk = 1024u;
+// Max number of bounds hint chunks, geometries left without a hint can't go to host scene builds.
+constexpr uint32_t kMaxBoundsHintChunks = 64u;
+// Hint slot: min and max corners, the generation of the capture that wrote them and padding.
+constexpr uint32_t kBoundsHintStride = 8u;
+// Serialized data is uploaded in chunks fitting a temporary buffer size class, whatever its total size.
+constexpr size_t kSerializedUploadChunkSize = 16u * 1024u * 1024u;
+
+uint32_t GetBvhNodeCount(uint32_t leaf_count) { return 2 * leaf_count - 1; }
+
+bool IsWideBvhBuild(const RRBuildOptions* build_options)
+{
+    return build_options && (build_options->build_flags & RR_BUILD_FLAG_BITS_WIDE_BVH) != 0;
+}
+
+bool IsHostSceneBuild(const RRBuildOptions* build_options)
+{
+    return build_options && (build_options->build_flags & RR_BUILD_FLAG_BITS_HOST_SCENE_BUILD) != 0;
+}
+
+// Wide geometries keep the binary tree and append the wide nodes collapsed from it.
+uint32_t GetGeometryNodeCount(uint32_t leaf_count, bool wide)
+{
+    return wide ? CollapseBvh4::GetNodeCount(leaf_count) : GetBvhNodeCount(leaf_count);
+}
 
 struct InstanceDescription
 {
     float    transform[12];
     uint32_t index;
-    uint32_t padding[3];
+    // Slot of the geometry buffer in the scene descriptor array.
+    uint32_t geometry_buffer;
+    // Index of the geometry root node in that buffer.
+    uint32_t geometry_offset;
+    uint32_t mask;
 };
 struct BufferHasher
 {
@@ -52,49 +91,585 @@ struct BufferHasher
         return 23 * size_t(VkBuffer(k.first)) + k.second;
     }
 };
+
+using GeometrySlots = std::unordered_map<std::pair<vk::Buffer, size_t>, uint32_t, BufferHasher>;
+using GeometrySet   = std::unordered_set<std::pair<vk::Buffer, size_t>, BufferHasher>;
+
+// Get the slot of a geometry buffer in the scene descriptor array and the index of the geometry root node in that
+// buffer. Instances only reference geometry buffers through these pairs, so the descriptor array holds each distinct
+// buffer once and the instance count is not bound by its size. Geometries placed at node-aligned offsets of one buffer
+// share its slot.
+std::pair<uint32_t, uint32_t> AddSceneGeometry(DevicePtrBase*         geometry_buffer,
+                                               GeometrySlots&         slots,
+                                               ChildrenBvhsContainer& geometries)
+{
+    vk::Buffer geometry        = device_ptr_cast(geometry_buffer);
+    size_t     geometry_offset = device_ptr_offset(geometry_buffer);
+    size_t     node_offset     = 0u;
+    if (geometry_offset % sizeof(BvhNode) == 0)
+    {
+        node_offset     = geometry_offset / sizeof(BvhNode);
+        geometry_offset = 0u;
+    }
+
+    auto slot = slots.emplace(std::make_pair(geometry, geometry_offset), uint32_t(geometries.size()));
+    if (slot.second)
+    {
+        if (geometries.size() == kMaxGeometryBuffers)
+        {
+            constexpr const char* message =
+                "Too many distinct geometry buffers per top-level acc structure, max is RR_MAX_GEOMETRY_BUFFERS";
+            Logger::Get().Error(message);
+            throw std::runtime_error(message);
+        }
+        geometries.push_back(std::make_pair(geometry, geometry_offset));
+    }
+    return {slot.first->second, uint32_t(node_offset)};
+}
+
+BatchedTriangleMesh GetBatchedTriangleMesh(TriangleMeshBuildInfo const& build_info, DevicePtrBase* geometry_buffer)
+{
+    return {device_ptr_cast(build_info.vertices),
+            device_ptr_offset(build_info.vertices),
+            build_info.vertex_stride,
+            build_info.vertex_count,
+            device_ptr_cast(build_info.triangle_indices),
+            device_ptr_offset(build_info.triangle_indices),
+            build_info.triangle_count,
+            device_ptr_cast(geometry_buffer),
+            device_ptr_offset(geometry_buffer)};
+}
+
+BatchedTriangleMesh GetBatchedAabbList(AabbListBuildInfo const& build_info, DevicePtrBase* geometry_buffer)
+{
+    BatchedTriangleMesh mesh = {device_ptr_cast(build_info.aabbs),
+                                device_ptr_offset(build_info.aabbs),
+                                build_info.aabb_stride,
+                                build_info.aabb_count,
+                                vk::Buffer(),
+                                0u,
+                                build_info.aabb_count,
+                                device_ptr_cast(geometry_buffer),
+                                device_ptr_offset(geometry_buffer)};
+    mesh.aabb_list = true;
+    return mesh;
+}
+
+uint32_t GetTriangleCount(const std::vector<TriangleMeshBuildInfo>& build_info)
+{
+    uint32_t triangle_count = 0;
+    for (auto const& mesh : build_info)
+    {
+        triangle_count += mesh.triangle_count;
+    }
+    return triangle_count;
+}
+
+uint32_t GetPrimCount(std::vector<BatchedTriangleMesh> const& meshes)
+{
+    uint32_t prim_count = 0;
+    for (auto const& mesh : meshes)
+    {
+        prim_count += mesh.triangle_count;
+    }
+    return prim_count;
+}
+
+uint32_t GetAabbCount(const std::vector<AabbListBuildInfo>& build_info)
+{
+    uint32_t aabb_count = 0;
+    for (auto const& aabbs : build_info)
+    {
+        aabb_count += aabbs.aabb_count;
+    }
+    return aabb_count;
+}
+
+void ValidateMeshCount(const std::vector<TriangleMeshBuildInfo>& build_info)
+{
+    if (build_info.empty() || build_info.size() > BuildHlBvhBatch::kMaxGeometries)
+    {
+        constexpr const char* message = "Invalid number of triangle meshes per geometry";
+        Logger::Get().Error(message);
+        throw std::runtime_error(message);
+    }
+}
+
+void ValidateAabbListCount(const std::vector<AabbListBuildInfo>& build_info)
+{
+    if (build_info.empty() || build_info.size() > BuildHlBvhBatch::kMaxGeometries)
+    {
+        constexpr const char* message = "Invalid number of AABB lists per geometry";
+        Logger::Get().Error(message);
+        throw std::runtime_error(message);
+    }
+}
 }  // namespace
 
 struct Intersector::IntersectorImpl
 {
-    IntersectorImpl(std::shared_ptr<GpuHelper> gpu_helper)
+    IntersectorImpl(std::shared_ptr<GpuHelper> gpu_helper, bool persistent_threads)
         : gpu_helper_(gpu_helper),
-          shader_manager_(gpu_helper->device),
+          shader_manager_(gpu_helper->device, gpu_helper->profiler.get()),
           build_bvh_(gpu_helper_, shader_manager_),
+          build_bvh_batch_(gpu_helper_, shader_manager_),
           build_bvh_top_level_(gpu_helper_, shader_manager_),
           update_bvh_(gpu_helper, shader_manager_),
           restructure_bvh_(gpu_helper, shader_manager_),
-          trace_geometry_(gpu_helper, shader_manager_),
-          trace_scene_(gpu_helper, shader_manager_)
+          collapse_bvh4_(gpu_helper, shader_manager_),
+          root_bounds_(gpu_helper, shader_manager_),
+          trace_geometry_(gpu_helper, shader_manager_, persistent_threads),
+          trace_scene_(gpu_helper, shader_manager_, persistent_threads),
+          reorder_rays_(gpu_helper, shader_manager_)
+    {
+    }
+    ~IntersectorImpl()
+    {
+        for (auto& chunk : bounds_hint_chunks_)
+        {
+            chunk.Destroy();
+        }
+    }
+
+    // Record a build of a single BVH over several meshes or AABB lists, restructured unless fast build is preferred.
+    void BuildMerged(CommandStreamBackend<BackendType::kVulkan>* command_stream,
+                     std::vector<BatchedTriangleMesh> const&     meshes,
+                     const RRBuildOptions*                       build_options,
+                     vk::Buffer                                  scratch,
+                     size_t                                      scratch_offset)
+    {
+        vk::CommandBuffer command_buffer = command_stream->Get();
+
+        auto descs_range =
+            command_stream->AllocateUploadRange(build_bvh_batch_.GetGeometryDescsSize(uint32_t(meshes.size())));
+        build_bvh_batch_.WriteGeometryDescs(meshes, descs_range.data);
+
+        build_bvh_batch_.BuildMerged(
+            command_buffer, meshes, descs_range.buffer, descs_range.offset, scratch, scratch_offset);
+
+        uint32_t prim_count = GetPrimCount(meshes);
+        if (build_options && (build_options->build_flags & RR_BUILD_FLAG_BITS_PREFER_FAST_BUILD) == 0)
+        {
+            // Restructuring reuses the scratch space of the build.
+            vk::AccessFlags scratch_access = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eShaderRead;
+            gpu_helper_->EncodeBufferBarrier(scratch,
+                                             scratch_access,
+                                             scratch_access,
+                                             vk::PipelineStageFlagBits::eComputeShader,
+                                             vk::PipelineStageFlagBits::eComputeShader,
+                                             command_buffer);
+            restructure_bvh_(
+                command_buffer, prim_count, scratch, scratch_offset, meshes[0].result, meshes[0].result_offset);
+        }
+
+        if (IsWideBvhBuild(build_options))
+        {
+            collapse_bvh4_(command_buffer, prim_count, meshes[0].result, meshes[0].result_offset);
+        }
+    }
+
+    // Remember the node count of a geometry built or copied to the buffer, the buffer no longer holds a scene.
+    // Bounds of the previous geometry are gone, the new one captures them again if it is built for host scenes.
+    void RegisterGeometry(vk::Buffer buffer, size_t offset, uint32_t node_count, bool wide)
+    {
+        auto key                   = std::make_pair(buffer, offset);
+        geometry_node_counts_[key] = node_count;
+        buffers_cache_.erase(key);
+        ReleaseBoundsHintSlot(buffer, offset);
+        if (wide)
+        {
+            wide_geometries_.insert(key);
+        } else
+        {
+            wide_geometries_.erase(key);
+        }
+    }
+
+    // The buffer holds a geometry, not a scene, and the old wide nodes are gone with it.
+    void UnregisterGeometry(vk::Buffer buffer, size_t offset)
+    {
+        auto key = std::make_pair(buffer, offset);
+        geometry_node_counts_.erase(key);
+        wide_geometries_.erase(key);
+        ReleaseBoundsHintSlot(buffer, offset);
+    }
+
+    bool IsWideGeometry(vk::Buffer buffer, size_t offset) const
+    {
+        return wide_geometries_.count(std::make_pair(buffer, offset)) != 0;
+    }
+
+    // Record a collapse of a refitted geometry, wide nodes do not follow the binary ones on their own.
+    void UpdateWideNodes(vk::CommandBuffer command_buffer, uint32_t leaf_count, vk::Buffer buffer, size_t offset)
+    {
+        if (IsWideGeometry(buffer, offset))
+        {
+            collapse_bvh4_(command_buffer, leaf_count, buffer, offset);
+        }
+    }
+
+    bool HasBoundsHint(vk::Buffer buffer, size_t offset) const
+    {
+        return bounds_hint_slots_.count(std::make_pair(buffer, offset)) != 0;
+    }
+
+    void ReleaseBoundsHintSlot(vk::Buffer buffer, size_t offset)
+    {
+        auto hint = bounds_hint_slots_.find(std::make_pair(buffer, offset));
+        if (hint != bounds_hint_slots_.end())
+        {
+            free_bounds_hint_slots_.push_back(hint->second);
+            bounds_hint_slots_.erase(hint);
+        }
+    }
+
+    // Get the bounds hint slot of a geometry, false if all the slots are taken.
+    bool AcquireBoundsHintSlot(vk::Buffer buffer, size_t offset, uint32_t& slot)
+    {
+        auto key  = std::make_pair(buffer, offset);
+        auto hint = bounds_hint_slots_.find(key);
+        if (hint != bounds_hint_slots_.end())
+        {
+            slot = hint->second;
+            return true;
+        }
+
+        if (!free_bounds_hint_slots_.empty())
+        {
+            slot = free_bounds_hint_slots_.back();
+            free_bounds_hint_slots_.pop_back();
+        } else if (bounds_hint_generations_.size() < kMaxBoundsHintChunks * kBoundsHintsPerChunk)
+        {
+            slot = uint32_t(bounds_hint_generations_.size());
+            bounds_hint_generations_.push_back(0u);
+            if (slot % kBoundsHintsPerChunk == 0u)
+            {
+                bounds_hint_chunks_.push_back(
+                    gpu_helper_->CreateStagingBuffer(kBoundsHintsPerChunk * kBoundsHintStride * sizeof(uint32_t)));
+                std::memset(bounds_hint_chunks_.back().Map(), 0, bounds_hint_chunks_.back().size);
+            }
+        } else
+        {
+            return false;
+        }
+        bounds_hint_slots_.emplace(key, slot);
+        return true;
+    }
+
+    // Record a write of geometry bounds to host visible memory, they steer host scene builds.
+    // The bounds are followed by a new generation of the slot, so the host only takes bounds written last.
+    void CaptureBoundsHint(vk::CommandBuffer command_buffer, vk::Buffer buffer, size_t offset)
+    {
+        uint32_t slot = 0u;
+        if (!AcquireBoundsHintSlot(buffer, offset, slot))
+        {
+            return;
+        }
+
+        auto&    chunk        = bounds_hint_chunks_[slot / kBoundsHintsPerChunk];
+        uint32_t bounds_index = (slot % kBoundsHintsPerChunk) * kBoundsHintStride;
+        uint32_t generation   = ++bounds_hint_generations_[slot];
+        root_bounds_(command_buffer, buffer, offset, chunk.buffer, 0u, bounds_index, generation);
+    }
+
+    // Record a new write of the bounds of a refitted geometry, if it is built for host scenes.
+    void RefreshBoundsHint(vk::CommandBuffer command_buffer, vk::Buffer buffer, size_t offset)
+    {
+        if (HasBoundsHint(buffer, offset))
+        {
+            CaptureBoundsHint(command_buffer, buffer, offset);
+        }
+    }
+
+    // Get world space bounds of scene instances from the bounds hints of their geometries.
+    // Fails if a hint is missing or its write has not completed yet, e.g. it was recorded into the same stream.
+    bool GetInstanceBounds(const RRInstance*                      instances,
+                           uint32_t                               instance_count,
+                           std::vector<BuildSahTopLevel::Bounds>& bounds) const
+    {
+        bounds.resize(instance_count);
+        for (auto i = 0u; i < instance_count; ++i)
+        {
+            auto geometry = reinterpret_cast<DevicePtrBase*>(instances[i].geometry);
+            auto it       = bounds_hint_slots_.find({device_ptr_cast(geometry), device_ptr_offset(geometry)});
+            if (it == bounds_hint_slots_.end())
+            {
+                return false;
+            }
+
+            auto slot       = it->second;
+            auto mapped     = static_cast<uint32_t const*>(bounds_hint_chunks_[slot / kBoundsHintsPerChunk].mapped);
+            auto hint       = mapped + (slot % kBoundsHintsPerChunk) * kBoundsHintStride;
+            auto generation = reinterpret_cast<uint32_t const volatile*>(hint + 6);
+            if (*generation != bounds_hint_generations_[slot])
+            {
+                return false;
+            }
+
+            BuildSahTopLevel::Bounds local_bounds;
+            std::memcpy(&local_bounds, hint, sizeof(local_bounds));
+            if (!BuildSahTopLevel::IsValid(local_bounds))
+            {
+                return false;
+            }
+            bounds[i] = BuildSahTopLevel::TransformBounds(local_bounds, instances[i].transform);
+        }
+        return true;
+    }
+
+    uint32_t GetGeometryNodeCount(vk::Buffer buffer, size_t offset) const
+    {
+        auto it = geometry_node_counts_.find(std::make_pair(buffer, offset));
+        if (it == geometry_node_counts_.end())
+        {
+            constexpr const char* message = "Buffer does not hold a built geometry";
+            Logger::Get().Error(message);
+            throw std::runtime_error(message);
+        }
+        return it->second;
+    }
+
+    // Get the header of the geometry or scene held by the buffer.
+    RRSerializedHeader GetSerializedHeader(vk::Buffer buffer, size_t offset) const
+    {
+        RRSerializedHeader header = {};
+        header.magic              = RR_SERIALIZED_MAGIC;
+        header.version            = RR_SERIALIZED_VERSION;
+
+        auto key = std::make_pair(buffer, offset);
+        if (geometry_node_counts_.count(key))
+        {
+            header.type        = RR_SERIALIZED_TYPE_GEOMETRY;
+            header.node_count  = geometry_node_counts_.at(key);
+            header.build_flags = wide_geometries_.count(key) ? RR_BUILD_FLAG_BITS_WIDE_BVH : 0u;
+            header.build_flags |= HasBoundsHint(buffer, offset) ? RR_BUILD_FLAG_BITS_HOST_SCENE_BUILD : 0u;
+        } else if (buffers_cache_.count(key))
+        {
+            header.type           = RR_SERIALIZED_TYPE_SCENE;
+            header.instance_count = buffers_cache_.at(key).bvhs_count;
+            header.node_count     = GetBvhNodeCount(header.instance_count);
+        } else
+        {
+            constexpr const char* message = "Buffer does not hold a built geometry or scene";
+            Logger::Get().Error(message);
+            throw std::runtime_error(message);
+        }
+        header.data_size = uint32_t(GetSerializedDataSize(header));
+        return header;
+    }
+
+    // Scenes are stored with their transforms and instance table.
+    size_t GetSerializedDataSize(RRSerializedHeader const& header) const
+    {
+        return header.type == RR_SERIALIZED_TYPE_SCENE ? build_bvh_top_level_.GetResultDataSize(header.instance_count)
+                                                       : header.node_count * sizeof(BvhNode);
+    }
+
+    // Check the header of serialized data and its size before anything is uploaded.
+    RRSerializedHeader ReadSerializedHeader(void const*      serialized_data,
+                                            size_t           serialized_size,
+                                            RRSerializedType type) const
     {
-        // allocate temporary buffer for scene building to avoid validation issues
-        temporary_buffer_ = gpu_helper_->CreateDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, 4);
+        RRSerializedHeader header = {};
+        if (serialized_size >= sizeof(header))
+        {
+            std::memcpy(&header, serialized_data, sizeof(header));
+        }
+
+        const char* message = nullptr;
+        if (serialized_size < sizeof(header) || sizeof(header) + size_t(header.data_size) > serialized_size)
+        {
+            message = "Serialized data is truncated";
+        } else if (header.magic != RR_SERIALIZED_MAGIC || header.version != RR_SERIALIZED_VERSION)
+        {
+            message = "Serialized data has an unsupported format or version";
+        } else if (header.type != type)
+        {
+            message = "Serialized data holds a different kind of acc structure";
+        } else if (header.node_count == 0 || header.data_size != GetSerializedDataSize(header) ||
+                   (type == RR_SERIALIZED_TYPE_SCENE && header.node_count != GetBvhNodeCount(header.instance_count)))
+        {
+            message = "Serialized data is corrupted";
+        }
+
+        if (message)
+        {
+            Logger::Get().Error(message);
+            throw std::runtime_error(message);
+        }
+        return header;
     }
 
-    ~IntersectorImpl() { temporary_buffer_.Destroy(); }
+    // Record a copy of the header and contents of a geometry or scene buffer, then fill the header bounds.
+    void Serialize(CommandStreamBackend<BackendType::kVulkan>* command_stream,
+                   DevicePtrBase*                              src_buffer,
+                   DevicePtrBase*                              serialized_buffer,
+                   RRSerializedType                            type)
+    {
+        vk::CommandBuffer command_buffer = command_stream->Get();
+
+        vk::Buffer src        = device_ptr_cast(src_buffer);
+        size_t     src_offset = device_ptr_offset(src_buffer);
+        vk::Buffer dst        = device_ptr_cast(serialized_buffer);
+        size_t     dst_offset = device_ptr_offset(serialized_buffer);
+
+        auto header = GetSerializedHeader(src, src_offset);
+        if (header.type != type)
+        {
+            const char* message = type == RR_SERIALIZED_TYPE_SCENE ? "Buffer does not hold a built scene"
+                                                                     : "Buffer does not hold a built geometry";
+            Logger::Get().Error(message);
+            throw std::runtime_error(message);
+        }
+
+        auto header_range = command_stream->AllocateUploadRange(sizeof(header));
+        std::memcpy(header_range.data, &header, sizeof(header));
+
+        gpu_helper_->EncodeBufferBarrier(src,
+                                         vk::AccessFlagBits::eShaderWrite,
+                                         vk::AccessFlagBits::eTransferRead,
+                                         vk::PipelineStageFlagBits::eComputeShader,
+                                         vk::PipelineStageFlagBits::eTransfer,
+                                         command_buffer,
+                                         src_offset,
+                                         header.data_size);
+        command_buffer.copyBuffer(
+            header_range.buffer, dst, vk::BufferCopy(header_range.offset, dst_offset, sizeof(header)));
+        command_buffer.copyBuffer(src, dst, vk::BufferCopy(src_offset, dst_offset + sizeof(header), header.data_size));
+        // Bounds are read from the root node on GPU, after the host written header they overwrite.
+        root_bounds_(command_buffer,
+                     src,
+                     src_offset,
+                     dst,
+                     dst_offset,
+                     uint32_t(offsetof(RRSerializedHeader, bounds_min) / sizeof(float)));
+        gpu_helper_->EncodeBufferBarrier(dst,
+                                         vk::AccessFlagBits::eTransferWrite,
+                                         vk::AccessFlagBits::eHostRead | vk::AccessFlagBits::eShaderRead,
+                                         vk::PipelineStageFlagBits::eTransfer,
+                                         vk::PipelineStageFlagBits::eHost | vk::PipelineStageFlagBits::eComputeShader,
+                                         command_buffer,
+                                         dst_offset,
+                                         sizeof(header) + header.data_size);
+    }
+
+    // Record an upload of acc structure contents to its buffer, chunk by chunk so any size fits staging memory.
+    void EncodeUpload(CommandStreamBackend<BackendType::kVulkan>* command_stream,
+                      void const*                                 data,
+                      vk::DeviceSize                              size,
+                      vk::Buffer                                  result,
+                      size_t                                      result_offset)
+    {
+        vk::CommandBuffer command_buffer = command_stream->Get();
+        for (vk::DeviceSize offset = 0; offset < size; offset += kSerializedUploadChunkSize)
+        {
+            auto chunk_size = std::min<vk::DeviceSize>(kSerializedUploadChunkSize, size - offset);
+            auto range      = command_stream->AllocateUploadRange(chunk_size);
+            std::memcpy(range.data, static_cast<char const*>(data) + offset, chunk_size);
+            command_buffer.copyBuffer(
+                range.buffer, result, vk::BufferCopy(range.offset, result_offset + offset, chunk_size));
+        }
+        gpu_helper_->EncodeBufferBarrier(result,
+                                         vk::AccessFlagBits::eTransferWrite,
+                                         vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                                         vk::PipelineStageFlagBits::eTransfer,
+                                         vk::PipelineStageFlagBits::eComputeShader,
+                                         command_buffer,
+                                         result_offset,
+                                         size);
+    }
+
+    // Write instance descriptions of a scene to the upload ring and collect the geometry buffers they reference.
+    UploadRange WriteInstanceDescs(CommandStreamBackend<BackendType::kVulkan>* command_stream,
+                                   const RRInstance*                           instances,
+                                   uint32_t                                    instance_count,
+                                   vk::Buffer                                  result,
+                                   size_t                                      result_offset)
+    {
+        // Write instance descriptions straight into the persistently mapped upload ring.
+        auto desc_range     = command_stream->AllocateUploadRange(instance_count * sizeof(InstanceDescription));
+        auto instance_descs = static_cast<InstanceDescription*>(desc_range.data);
+
+        // The buffer no longer holds a geometry that could be copied.
+        UnregisterGeometry(result, result_offset);
+
+        // Reuse the cached container of the scene buffer, so rebuilding the same scene does not reallocate.
+        auto& children   = buffers_cache_[std::make_pair(result, result_offset)];
+        auto& geometries = children.buffers;
+        geometries.clear();
+
+        // Wide traversal only applies to scenes whose geometries all carry wide nodes.
+        bool          wide = instance_count > 0;
+        GeometrySlots geometry_slots;
+        for (auto i = 0u; i < instance_count; ++i)
+        {
+            auto geometry = reinterpret_cast<DevicePtrBase*>(instances[i].geometry);
+            auto slot     = AddSceneGeometry(geometry, geometry_slots, geometries);
+            wide          = wide && IsWideGeometry(device_ptr_cast(geometry), device_ptr_offset(geometry));
+
+            instance_descs[i].index           = i;
+            instance_descs[i].geometry_buffer = slot.first;
+            instance_descs[i].geometry_offset = slot.second;
+            // A zero mask keeps the instance visible to all rays.
+            instance_descs[i].mask            = instances[i].mask ? instances[i].mask : ~0u;
+            std::memcpy(&(instance_descs[i].transform), &(instances[i].transform[0][0]), 12 * sizeof(float));
+        }
+        children.bvhs_count = instance_count;
+        children.wide       = wide;
+        return desc_range;
+    }
+
+    // Record a refit of a BVH recorded by BuildMerged.
+    void UpdateMerged(CommandStreamBackend<BackendType::kVulkan>* command_stream,
+                      std::vector<BatchedTriangleMesh> const&     meshes)
+    {
+        auto descs_range =
+            command_stream->AllocateUploadRange(build_bvh_batch_.GetGeometryDescsSize(uint32_t(meshes.size())));
+        build_bvh_batch_.WriteGeometryDescs(meshes, descs_range.data);
+
+        build_bvh_batch_.UpdateMerged(command_stream->Get(), meshes, descs_range.buffer, descs_range.offset);
+        UpdateWideNodes(command_stream->Get(), GetPrimCount(meshes), meshes[0].result, meshes[0].result_offset);
+    }
 
     std::shared_ptr<GpuHelper> gpu_helper_;
     ShaderManager              shader_manager_;
 
     BuildHlBvh         build_bvh_;
+    BuildHlBvhBatch    build_bvh_batch_;
     BuildHlBvhTopLevel build_bvh_top_level_;
     UpdateHlBvh        update_bvh_;
     RestructureHlBvh   restructure_bvh_;
+    CollapseBvh4       collapse_bvh4_;
+    RootBounds         root_bounds_;
 
     // Trace things
     TraceGeometry                                                                     trace_geometry_;
     TraceScene                                                                        trace_scene_;
+    ReorderRays                                                                       reorder_rays_;
     std::unordered_map<std::pair<vk::Buffer, size_t>, ChildrenBvhsDesc, BufferHasher> buffers_cache_;
-    AllocatedBuffer                                                                   temporary_buffer_;
+    // Node counts of geometries by the buffer they were built or copied to.
+    std::unordered_map<std::pair<vk::Buffer, size_t>, uint32_t, BufferHasher> geometry_node_counts_;
+    // Geometries carrying wide nodes after the binary ones.
+    GeometrySet wide_geometries_;
+
+    // Host built scenes: root nodes of geometries copied to host visible memory and the builder using them.
+    std::vector<AllocatedBuffer>                                               bounds_hint_chunks_;
+    std::unordered_map<std::pair<vk::Buffer, size_t>, uint32_t, BufferHasher> bounds_hint_slots_;
+    // Generation of the last copy recorded per slot, and slots released by unregistered geometries.
+    std::vector<uint32_t> bounds_hint_generations_;
+    std::vector<uint32_t> free_bounds_hint_slots_;
+    BuildSahTopLevel                                                           build_sah_top_level_;
 };
 
-Intersector::Intersector(std::shared_ptr<GpuHelper> gpu_helper) : impl_(std::make_unique<IntersectorImpl>(gpu_helper))
+Intersector::Intersector(std::shared_ptr<GpuHelper> gpu_helper, bool persistent_threads)
+    : impl_(std::make_unique<IntersectorImpl>(gpu_helper, persistent_threads))
 {
 }
 Intersector::~Intersector() = default;
 
-std::unique_ptr<IntersectorBase> CreateIntersector(std::shared_ptr<GpuHelper> gpu_helper)
+std::unique_ptr<IntersectorBase> CreateIntersector(std::shared_ptr<GpuHelper> gpu_helper, bool persistent_threads)
 {
-    return std::make_unique<Intersector>(gpu_helper);
+    return std::make_unique<Intersector>(gpu_helper, persistent_threads);
 }
 
 PreBuildInfo Intersector::GetTriangleMeshPreBuildInfo(const std::vector<TriangleMeshBuildInfo>& build_info,
@@ -107,14 +682,91 @@ PreBuildInfo Intersector::GetTriangleMeshPreBuildInfo(const std::vector<Triangle
     info.build_scratch_size  = 0;
     info.update_scratch_size = 0;
 
-    assert(build_info.size() == 1);
+    ValidateMeshCount(build_info);
+
+    // Meshes of a multi-mesh geometry share a single BVH.
+    auto triangle_count = GetTriangleCount(build_info);
+
+    info.result_size = impl_->build_bvh_.GetResultDataSize(triangle_count);
+    if (IsWideBvhBuild(build_options))
+    {
+        info.result_size = std::max(info.result_size, CollapseBvh4::GetNodeCount(triangle_count) * sizeof(BvhNode));
+    }
+
+    info.build_scratch_size = build_info.size() == 1 ? impl_->build_bvh_.GetScratchDataSize(triangle_count)
+                                                     : impl_->build_bvh_batch_.GetScratchDataSize(1u, triangle_count);
+    size_t restructure_scratch_size =
+        (build_options && (build_options->build_flags & RR_BUILD_FLAG_BITS_PREFER_FAST_BUILD) == 0)
+            ? impl_->restructure_bvh_.GetScratchDataSize(triangle_count)
+            : 0;
+    info.build_scratch_size = std::max(info.build_scratch_size, restructure_scratch_size);
+
+    return info;
+}
+PreBuildInfo Intersector::GetTriangleMeshesPreBuildInfo(const std::vector<TriangleMeshBuildInfo>& build_infos,
+                                                        const RRBuildOptions*                     build_options)
+{
+    Logger::Get().Debug("Intersector::GetTriangleMeshesPreBuildInfo()");
+
+    PreBuildInfo info;
+    info.result_size         = 0;
+    info.build_scratch_size  = 0;
+    info.update_scratch_size = 0;
+
+    bool restructure =
+        build_options && (build_options->build_flags & RR_BUILD_FLAG_BITS_PREFER_FAST_BUILD) == 0;
+
+    // Meshes are built in chunks of at most BuildHlBvhBatch::kMaxGeometries sharing the scratch buffer.
+    for (size_t first = 0; first < build_infos.size(); first += BuildHlBvhBatch::kMaxGeometries)
+    {
+        auto     last           = std::min(build_infos.size(), first + BuildHlBvhBatch::kMaxGeometries);
+        uint32_t triangle_count = 0;
+        for (auto i = first; i < last; ++i)
+        {
+            triangle_count += build_infos[i].triangle_count;
+            auto result_size = impl_->build_bvh_.GetResultDataSize(build_infos[i].triangle_count);
+            if (IsWideBvhBuild(build_options))
+            {
+                result_size =
+                    std::max(result_size, CollapseBvh4::GetNodeCount(build_infos[i].triangle_count) * sizeof(BvhNode));
+            }
+            info.result_size += result_size;
+            if (restructure)
+            {
+                info.build_scratch_size = std::max(
+                    info.build_scratch_size, impl_->restructure_bvh_.GetScratchDataSize(build_infos[i].triangle_count));
+            }
+        }
+        auto batch_scratch_size = impl_->build_bvh_batch_.GetScratchDataSize(uint32_t(last - first), triangle_count);
+        info.build_scratch_size = std::max(info.build_scratch_size, batch_scratch_size);
+    }
+
+    return info;
+}
+PreBuildInfo Intersector::GetAabbListPreBuildInfo(const std::vector<AabbListBuildInfo>& build_info,
+                                                  const RRBuildOptions*                 build_options)
+{
+    Logger::Get().Debug("Intersector::GetAabbListPreBuildInfo()");
+
+    PreBuildInfo info;
+    info.result_size         = 0;
+    info.build_scratch_size  = 0;
+    info.update_scratch_size = 0;
+
+    ValidateAabbListCount(build_info);
 
-    info.result_size = impl_->build_bvh_.GetResultDataSize(build_info[0].triangle_count);
+    // Boxes of all lists share a single BVH built by the batch builder.
+    auto aabb_count = GetAabbCount(build_info);
 
-    info.build_scratch_size = impl_->build_bvh_.GetScratchDataSize(build_info[0].triangle_count);
+    info.result_size        = impl_->build_bvh_.GetResultDataSize(aabb_count);
+    info.build_scratch_size = impl_->build_bvh_batch_.GetScratchDataSize(1u, aabb_count);
+    if (IsWideBvhBuild(build_options))
+    {
+        info.result_size = std::max(info.result_size, CollapseBvh4::GetNodeCount(aabb_count) * sizeof(BvhNode));
+    }
     size_t restructure_scratch_size =
         (build_options && (build_options->build_flags & RR_BUILD_FLAG_BITS_PREFER_FAST_BUILD) == 0)
-            ? impl_->restructure_bvh_.GetScratchDataSize(build_info[0].triangle_count)
+            ? impl_->restructure_bvh_.GetScratchDataSize(aabb_count)
             : 0;
     info.build_scratch_size = std::max(info.build_scratch_size, restructure_scratch_size);
 
@@ -141,19 +793,43 @@ void Intersector::BuildTriangleMesh(CommandStreamBase*                        co
                                     DevicePtrBase*                            geometry_buffer)
 {
     Logger::Get().Debug("Intersector::BuildTriangleMesh()");
-    vk::CommandBuffer command_buffer = command_stream_cast(command_stream_base);
+    auto              command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+    vk::CommandBuffer command_buffer = command_stream->Get();
 
-    assert(build_info.size() == 1);
+    ValidateMeshCount(build_info);
 
-    vk::Buffer vertices       = device_ptr_cast(build_info[0].vertices);
-    size_t     vert_offset    = device_ptr_offset(build_info[0].vertices);
-    vk::Buffer indices        = device_ptr_cast(build_info[0].triangle_indices);
-    size_t     ind_offset     = device_ptr_offset(build_info[0].triangle_indices);
     vk::Buffer scratch        = device_ptr_cast(temporary_buffer);
     size_t     scratch_offset = device_ptr_offset(temporary_buffer);
     vk::Buffer result         = device_ptr_cast(geometry_buffer);
     size_t     result_offset  = device_ptr_offset(geometry_buffer);
 
+    bool wide           = IsWideBvhBuild(build_options);
+    auto triangle_count = GetTriangleCount(build_info);
+    impl_->RegisterGeometry(result, result_offset, GetGeometryNodeCount(triangle_count, wide), wide);
+
+    if (build_info.size() > 1)
+    {
+        // Several meshes go to a single BVH, leaves keep the mesh index reported in hits.
+        std::vector<BatchedTriangleMesh> meshes;
+        meshes.reserve(build_info.size());
+        for (auto const& mesh : build_info)
+        {
+            meshes.push_back(GetBatchedTriangleMesh(mesh, geometry_buffer));
+        }
+
+        impl_->BuildMerged(command_stream, meshes, build_options, scratch, scratch_offset);
+        if (IsHostSceneBuild(build_options))
+        {
+            impl_->CaptureBoundsHint(command_buffer, result, result_offset);
+        }
+        return;
+    }
+
+    vk::Buffer vertices    = device_ptr_cast(build_info[0].vertices);
+    size_t     vert_offset = device_ptr_offset(build_info[0].vertices);
+    vk::Buffer indices     = device_ptr_cast(build_info[0].triangle_indices);
+    size_t     ind_offset  = device_ptr_offset(build_info[0].triangle_indices);
+
     impl_->build_bvh_(command_buffer,
                       vertices,
                       vert_offset,
@@ -172,6 +848,102 @@ void Intersector::BuildTriangleMesh(CommandStreamBase*                        co
         impl_->restructure_bvh_(
             command_buffer, build_info[0].triangle_count, scratch, scratch_offset, result, result_offset);
     }
+    if (wide)
+    {
+        impl_->collapse_bvh4_(command_buffer, triangle_count, result, result_offset);
+    }
+    if (IsHostSceneBuild(build_options))
+    {
+        impl_->CaptureBoundsHint(command_buffer, result, result_offset);
+    }
+}
+void Intersector::BuildTriangleMeshes(CommandStreamBase*                        command_stream_base,
+                                      const std::vector<TriangleMeshBuildInfo>& build_infos,
+                                      const RRBuildOptions*                     build_options,
+                                      DevicePtrBase*                            temporary_buffer,
+                                      const std::vector<DevicePtrBase*>&        geometry_buffers)
+{
+    Logger::Get().Debug("Intersector::BuildTriangleMeshes()");
+    Logger::Get().Debug("Recording batched build of {} meshes", build_infos.size());
+
+    auto              command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+    vk::CommandBuffer command_buffer = command_stream->Get();
+
+    vk::Buffer scratch        = device_ptr_cast(temporary_buffer);
+    size_t     scratch_offset = device_ptr_offset(temporary_buffer);
+
+    bool restructure =
+        build_options && (build_options->build_flags & RR_BUILD_FLAG_BITS_PREFER_FAST_BUILD) == 0;
+    bool            wide           = IsWideBvhBuild(build_options);
+    vk::AccessFlags scratch_access = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eShaderRead;
+
+    std::vector<BatchedTriangleMesh> meshes;
+    meshes.reserve(std::min<size_t>(build_infos.size(), BuildHlBvhBatch::kMaxGeometries));
+    for (size_t first = 0; first < build_infos.size(); first += BuildHlBvhBatch::kMaxGeometries)
+    {
+        auto last = std::min(build_infos.size(), first + BuildHlBvhBatch::kMaxGeometries);
+
+        // Chunks share the scratch buffer.
+        if (first > 0)
+        {
+            impl_->gpu_helper_->EncodeBufferBarrier(scratch,
+                                                    scratch_access,
+                                                    scratch_access,
+                                                    vk::PipelineStageFlagBits::eComputeShader,
+                                                    vk::PipelineStageFlagBits::eComputeShader,
+                                                    command_buffer);
+        }
+
+        meshes.clear();
+        for (auto i = first; i < last; ++i)
+        {
+            meshes.push_back(GetBatchedTriangleMesh(build_infos[i], geometry_buffers[i]));
+            impl_->RegisterGeometry(meshes.back().result,
+                                    meshes.back().result_offset,
+                                    GetGeometryNodeCount(build_infos[i].triangle_count, wide),
+                                    wide);
+        }
+
+        // Mesh descriptions go through the upload ring, same as instance descriptions of a scene build.
+        auto descs_range =
+            command_stream->AllocateUploadRange(impl_->build_bvh_batch_.GetGeometryDescsSize(uint32_t(meshes.size())));
+        impl_->build_bvh_batch_.WriteGeometryDescs(meshes, descs_range.data);
+
+        impl_->build_bvh_batch_(
+            command_buffer, meshes, descs_range.buffer, descs_range.offset, scratch, scratch_offset);
+
+        if (restructure)
+        {
+            for (auto const& mesh : meshes)
+            {
+                impl_->gpu_helper_->EncodeBufferBarrier(scratch,
+                                                        scratch_access,
+                                                        scratch_access,
+                                                        vk::PipelineStageFlagBits::eComputeShader,
+                                                        vk::PipelineStageFlagBits::eComputeShader,
+                                                        command_buffer);
+                impl_->restructure_bvh_(
+                    command_buffer, mesh.triangle_count, scratch, scratch_offset, mesh.result, mesh.result_offset);
+            }
+        }
+
+        if (wide)
+        {
+            for (auto const& mesh : meshes)
+            {
+                impl_->collapse_bvh4_(command_buffer, mesh.triangle_count, mesh.result, mesh.result_offset);
+            }
+        }
+    }
+
+    if (IsHostSceneBuild(build_options))
+    {
+        for (auto geometry_buffer : geometry_buffers)
+        {
+            impl_->CaptureBoundsHint(
+                command_buffer, device_ptr_cast(geometry_buffer), device_ptr_offset(geometry_buffer));
+        }
+    }
 }
 void Intersector::UpdateTriangleMesh(CommandStreamBase*                        command_stream_base,
                                      const std::vector<TriangleMeshBuildInfo>& build_info,
@@ -180,16 +952,32 @@ void Intersector::UpdateTriangleMesh(CommandStreamBase*                        c
                                      DevicePtrBase* geometry_buffer)
 {
     Logger::Get().Debug("Intersector::UpdateTriangleMesh()");
-    vk::CommandBuffer command_buffer = command_stream_cast(command_stream_base);
+    auto              command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+    vk::CommandBuffer command_buffer = command_stream->Get();
+
+    ValidateMeshCount(build_info);
 
-    assert(build_info.size() == 1);
+    vk::Buffer result        = device_ptr_cast(geometry_buffer);
+    size_t     result_offset = device_ptr_offset(geometry_buffer);
+
+    if (build_info.size() > 1)
+    {
+        std::vector<BatchedTriangleMesh> meshes;
+        meshes.reserve(build_info.size());
+        for (auto const& mesh : build_info)
+        {
+            meshes.push_back(GetBatchedTriangleMesh(mesh, geometry_buffer));
+        }
+
+        impl_->UpdateMerged(command_stream, meshes);
+        impl_->RefreshBoundsHint(command_buffer, result, result_offset);
+        return;
+    }
 
     vk::Buffer vertices        = device_ptr_cast(build_info[0].vertices);
     size_t     vertices_offset = device_ptr_offset(build_info[0].vertices);
     vk::Buffer indices         = device_ptr_cast(build_info[0].triangle_indices);
     size_t     indices_offset  = device_ptr_offset(build_info[0].triangle_indices);
-    vk::Buffer result          = device_ptr_cast(geometry_buffer);
-    size_t     result_offset   = device_ptr_offset(geometry_buffer);
 
     impl_->update_bvh_(command_buffer,
                        vertices,
@@ -201,66 +989,314 @@ void Intersector::UpdateTriangleMesh(CommandStreamBase*                        c
                        build_info[0].triangle_count,
                        result,
                        result_offset);
+    impl_->UpdateWideNodes(command_buffer, build_info[0].triangle_count, result, result_offset);
+    impl_->RefreshBoundsHint(command_buffer, result, result_offset);
 }
-void Intersector::BuildScene(CommandStreamBase* command_stream_base,
-                             const RRInstance*  instances,
-                             uint32_t           instance_count,
-                             const RRBuildOptions*,
-                             DevicePtrBase* temporary_buffer,
-                             DevicePtrBase* scene_buffer)
+void Intersector::BuildAabbList(CommandStreamBase*                    command_stream_base,
+                                const std::vector<AabbListBuildInfo>& build_info,
+                                const RRBuildOptions*                 build_options,
+                                DevicePtrBase*                        temporary_buffer,
+                                DevicePtrBase*                        geometry_buffer)
 {
-    Logger::Get().Debug("Intersector::BuildScene()");
-    Logger::Get().Debug("Recording scene build with {} instances", instance_count);
+    Logger::Get().Debug("Intersector::BuildAabbList()");
+    auto command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+
+    ValidateAabbListCount(build_info);
+
+    std::vector<BatchedTriangleMesh> aabb_lists;
+    aabb_lists.reserve(build_info.size());
+    for (auto const& aabbs : build_info)
+    {
+        aabb_lists.push_back(GetBatchedAabbList(aabbs, geometry_buffer));
+    }
+
+    bool wide = IsWideBvhBuild(build_options);
+    impl_->RegisterGeometry(device_ptr_cast(geometry_buffer),
+                            device_ptr_offset(geometry_buffer),
+                            GetGeometryNodeCount(GetAabbCount(build_info), wide),
+                            wide);
+
+    impl_->BuildMerged(command_stream,
+                       aabb_lists,
+                       build_options,
+                       device_ptr_cast(temporary_buffer),
+                       device_ptr_offset(temporary_buffer));
+    if (IsHostSceneBuild(build_options))
+    {
+        impl_->CaptureBoundsHint(
+            command_stream->Get(), device_ptr_cast(geometry_buffer), device_ptr_offset(geometry_buffer));
+    }
+}
+size_t Intersector::GetGeometryCompactedSize(DevicePtrBase* geometry_buffer)
+{
+    Logger::Get().Debug("Intersector::GetGeometryCompactedSize()");
+
+    auto node_count =
+        impl_->GetGeometryNodeCount(device_ptr_cast(geometry_buffer), device_ptr_offset(geometry_buffer));
+    return node_count * sizeof(BvhNode);
+}
+void Intersector::CopyGeometry(CommandStreamBase* command_stream_base,
+                               DevicePtrBase*     src_geometry_buffer,
+                               DevicePtrBase*     dst_geometry_buffer)
+{
+    Logger::Get().Debug("Intersector::CopyGeometry()");
+    auto              command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+    vk::CommandBuffer command_buffer = command_stream->Get();
+
+    vk::Buffer src        = device_ptr_cast(src_geometry_buffer);
+    size_t     src_offset = device_ptr_offset(src_geometry_buffer);
+    vk::Buffer dst        = device_ptr_cast(dst_geometry_buffer);
+    size_t     dst_offset = device_ptr_offset(dst_geometry_buffer);
+
+    // Nodes address each other relative to the first node of the geometry, so they are copied as is.
+    auto           node_count = impl_->GetGeometryNodeCount(src, src_offset);
+    vk::DeviceSize size       = node_count * sizeof(BvhNode);
+
+    impl_->gpu_helper_->EncodeBufferBarrier(src,
+                                            vk::AccessFlagBits::eShaderWrite,
+                                            vk::AccessFlagBits::eTransferRead,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            vk::PipelineStageFlagBits::eTransfer,
+                                            command_buffer,
+                                            src_offset,
+                                            size);
+    command_buffer.copyBuffer(src, dst, vk::BufferCopy(src_offset, dst_offset, size));
+    impl_->gpu_helper_->EncodeBufferBarrier(dst,
+                                            vk::AccessFlagBits::eTransferWrite,
+                                            vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                                            vk::PipelineStageFlagBits::eTransfer,
+                                            vk::PipelineStageFlagBits::eComputeShader,
+                                            command_buffer,
+                                            dst_offset,
+                                            size);
+
+    // Copies of geometries built for host scenes are usable by them as well.
+    bool bounds_hint = impl_->HasBoundsHint(src, src_offset);
+    impl_->RegisterGeometry(dst, dst_offset, node_count, impl_->IsWideGeometry(src, src_offset));
+    if (bounds_hint)
+    {
+        impl_->CaptureBoundsHint(command_buffer, dst, dst_offset);
+    }
+}
+void Intersector::UpdateAabbList(CommandStreamBase*                    command_stream_base,
+                                 const std::vector<AabbListBuildInfo>& build_info,
+                                 const RRBuildOptions*,
+                                 DevicePtrBase*,
+                                 DevicePtrBase* geometry_buffer)
+{
+    Logger::Get().Debug("Intersector::UpdateAabbList()");
+    auto command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+
+    ValidateAabbListCount(build_info);
+
+    std::vector<BatchedTriangleMesh> aabb_lists;
+    aabb_lists.reserve(build_info.size());
+    for (auto const& aabbs : build_info)
+    {
+        aabb_lists.push_back(GetBatchedAabbList(aabbs, geometry_buffer));
+    }
+
+    impl_->UpdateMerged(command_stream, aabb_lists);
+    impl_->RefreshBoundsHint(
+        command_stream->Get(), device_ptr_cast(geometry_buffer), device_ptr_offset(geometry_buffer));
+}
+size_t Intersector::GetSerializedSize(DevicePtrBase* acceleration_structure)
+{
+    Logger::Get().Debug("Intersector::GetSerializedSize()");
+
+    auto header =
+        impl_->GetSerializedHeader(device_ptr_cast(acceleration_structure), device_ptr_offset(acceleration_structure));
+    return sizeof(header) + header.data_size;
+}
+void Intersector::SerializeGeometry(CommandStreamBase* command_stream_base,
+                                    DevicePtrBase*     geometry_buffer,
+                                    DevicePtrBase*     serialized_buffer)
+{
+    Logger::Get().Debug("Intersector::SerializeGeometry()");
+    auto command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+
+    impl_->Serialize(command_stream, geometry_buffer, serialized_buffer, RR_SERIALIZED_TYPE_GEOMETRY);
+}
+void Intersector::DeserializeGeometry(CommandStreamBase* command_stream_base,
+                                      void const*        serialized_data,
+                                      size_t             serialized_size,
+                                      DevicePtrBase*     geometry_buffer)
+{
+    Logger::Get().Debug("Intersector::DeserializeGeometry()");
+    auto command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+
+    vk::Buffer result        = device_ptr_cast(geometry_buffer);
+    size_t     result_offset = device_ptr_offset(geometry_buffer);
+
+    auto header = impl_->ReadSerializedHeader(serialized_data, serialized_size, RR_SERIALIZED_TYPE_GEOMETRY);
+    auto nodes  = static_cast<char const*>(serialized_data) + sizeof(header);
+
+    impl_->EncodeUpload(command_stream, nodes, header.data_size, result, result_offset);
+    impl_->RegisterGeometry(
+        result, result_offset, header.node_count, (header.build_flags & RR_BUILD_FLAG_BITS_WIDE_BVH) != 0);
+    if (header.build_flags & RR_BUILD_FLAG_BITS_HOST_SCENE_BUILD)
+    {
+        impl_->CaptureBoundsHint(command_stream->Get(), result, result_offset);
+    }
+}
+void Intersector::SerializeScene(CommandStreamBase* command_stream_base,
+                                 DevicePtrBase*     scene_buffer,
+                                 DevicePtrBase*     serialized_buffer)
+{
+    Logger::Get().Debug("Intersector::SerializeScene()");
+    auto command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
 
-    // Allocate buffer and upload data.
+    impl_->Serialize(command_stream, scene_buffer, serialized_buffer, RR_SERIALIZED_TYPE_SCENE);
+}
+void Intersector::DeserializeScene(CommandStreamBase*                 command_stream_base,
+                                   void const*                        serialized_data,
+                                   size_t                             serialized_size,
+                                   const std::vector<DevicePtrBase*>& geometry_buffers,
+                                   DevicePtrBase*                     scene_buffer)
+{
+    Logger::Get().Debug("Intersector::DeserializeScene()");
     auto command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
 
-    auto required_staging_size = instance_count * sizeof(InstanceDescription);
-    auto desc_buffer           = command_stream->GetAllocatedTemporaryBuffer(required_staging_size);
+    vk::Buffer result        = device_ptr_cast(scene_buffer);
+    size_t     result_offset = device_ptr_offset(scene_buffer);
 
-    // Fill desc buffer
-    std::vector<InstanceDescription> instance_descs(instance_count);
-    ChildrenBvhsContainer            geometries;
-    geometries.reserve(kMaxInstances);
-    if (kMaxInstances < instance_count)
+    auto header = impl_->ReadSerializedHeader(serialized_data, serialized_size, RR_SERIALIZED_TYPE_SCENE);
+    if (geometry_buffers.size() != header.instance_count)
     {
-        constexpr const char* message = "Too big amount of instances per top-level acc structure";
+        constexpr const char* message = "Number of geometries does not match the serialized scene";
         Logger::Get().Error(message);
         throw std::runtime_error(message);
     }
-    for (auto i = 0u; i < instance_count; ++i)
+
+    // Instance geometry slots are patched in a host copy of the scene.
+    auto              scene_data = static_cast<char const*>(serialized_data) + sizeof(header);
+    std::vector<char> data(scene_data, scene_data + header.data_size);
+
+    impl_->UnregisterGeometry(result, result_offset);
+
+    // Serialized geometry slots refer to the buffers the scene was built with, point instances to the new ones.
+    auto& children   = impl_->buffers_cache_[std::make_pair(result, result_offset)];
+    auto& geometries = children.buffers;
+    geometries.clear();
+
+    auto instances_offset = impl_->build_bvh_top_level_.GetInstancesOffset(header.instance_count);
+    auto instances        = reinterpret_cast<uint32_t*>(data.data() + instances_offset);
+
+    bool          wide = true;
+    GeometrySlots geometry_slots;
+    for (auto i = 0u; i < header.instance_count; ++i)
     {
-        instance_descs[i].index = i;
-        std::memcpy(&(instance_descs[i].transform), &(instances[i].transform[0][0]), 12 * sizeof(float));
-        geometries.push_back(
-            std::make_pair(device_ptr_cast(instances[i].geometry), device_ptr_offset(instances[i].geometry)));
+        auto slot            = AddSceneGeometry(geometry_buffers[i], geometry_slots, geometries);
+        instances[4 * i]     = slot.first;
+        instances[4 * i + 1] = slot.second;
+        wide                 = wide && impl_->IsWideGeometry(device_ptr_cast(geometry_buffers[i]),
+                                                       device_ptr_offset(geometry_buffers[i]));
     }
-    // there are kMaxInstances created buffer in descriptor binding
-    // it's needed to fill it out
-    for (auto i = instance_count; i < kMaxInstances; ++i)
+    children.bvhs_count = header.instance_count;
+    children.wide       = wide;
+
+    impl_->EncodeUpload(command_stream, data.data(), header.data_size, result, result_offset);
+}
+void Intersector::BuildScene(CommandStreamBase*    command_stream_base,
+                             const RRInstance*     instances,
+                             uint32_t              instance_count,
+                             const RRBuildOptions* build_options,
+                             DevicePtrBase*        temporary_buffer,
+                             DevicePtrBase*        scene_buffer)
+{
+    Logger::Get().Debug("Intersector::BuildScene()");
+    Logger::Get().Debug("Recording scene build with {} instances", instance_count);
+
+    if (instance_count == 0u)
     {
-        geometries.push_back(std::make_pair(impl_->temporary_buffer_.buffer, 0u));
+        Logger::Get().Warn("Scene without instances, nothing to build");
+        return;
     }
 
-    void* mapped_ptr = desc_buffer->Map();
-    std::memcpy(mapped_ptr, instance_descs.data(), instance_count * sizeof(InstanceDescription));
-    desc_buffer->Unmap();
+    auto command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+
+    vk::Buffer result        = device_ptr_cast(scene_buffer);
+    size_t     result_offset = device_ptr_offset(scene_buffer);
+
+    // Small scenes opting in get a binned SAH tree built on the host, the GPU only fits the bounds then.
+    // The choice only depends on the options and the instance count, so the same input gives the same tree.
+    bool host_build = IsHostSceneBuild(build_options) && instance_count <= BuildSahTopLevel::kMaxInstanceCount;
+    std::vector<BuildSahTopLevel::Bounds> instance_bounds;
+    if (host_build && !impl_->GetInstanceBounds(instances, instance_count, instance_bounds))
+    {
+        constexpr const char* message =
+            "Host scene build requires completed builds of all geometries with RR_BUILD_FLAG_BITS_HOST_SCENE_BUILD";
+        Logger::Get().Error(message);
+        throw std::runtime_error(message);
+    }
+
+    auto  desc_range = impl_->WriteInstanceDescs(command_stream, instances, instance_count, result, result_offset);
+    auto& geometries = impl_->buffers_cache_.at(std::make_pair(result, result_offset)).buffers;
+
+    if (host_build)
+    {
+        Logger::Get().Debug("Building scene on the host");
+        auto nodes_range = command_stream->AllocateUploadRange(GetBvhNodeCount(instance_count) * sizeof(BvhNode));
+        impl_->build_sah_top_level_(instance_bounds, nodes_range.data);
+
+        impl_->build_bvh_top_level_.BuildFromNodes(command_stream->Get(),
+                                                   nodes_range.buffer,
+                                                   nodes_range.offset,
+                                                   desc_range.buffer,
+                                                   desc_range.offset,
+                                                   geometries,
+                                                   instance_count,
+                                                   result,
+                                                   result_offset);
+        return;
+    }
 
     vk::Buffer scratch        = device_ptr_cast(temporary_buffer);
     size_t     scratch_offset = device_ptr_offset(temporary_buffer);
-    vk::Buffer result         = device_ptr_cast(scene_buffer);
-    size_t     result_offset  = device_ptr_offset(scene_buffer);
 
     impl_->build_bvh_top_level_(command_stream->Get(),
-                                desc_buffer->buffer,
-                                0,
+                                desc_range.buffer,
+                                desc_range.offset,
                                 geometries,
                                 instance_count,
                                 scratch,
                                 scratch_offset,
                                 result,
                                 result_offset);
-    impl_->buffers_cache_[std::make_pair(result, result_offset)] = ChildrenBvhsDesc{instance_count, geometries};
+}
+void Intersector::UpdateScene(CommandStreamBase* command_stream_base,
+                              const RRInstance*  instances,
+                              uint32_t           instance_count,
+                              const RRBuildOptions*,
+                              DevicePtrBase*,
+                              DevicePtrBase* scene_buffer)
+{
+    Logger::Get().Debug("Intersector::UpdateScene()");
+    Logger::Get().Debug("Recording scene update with {} instances", instance_count);
+
+    auto command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
+
+    vk::Buffer result        = device_ptr_cast(scene_buffer);
+    size_t     result_offset = device_ptr_offset(scene_buffer);
+
+    // A refit keeps the topology, so the buffer has to hold a scene over the same number of instances.
+    auto it = impl_->buffers_cache_.find(std::make_pair(result, result_offset));
+    if (it == impl_->buffers_cache_.end() || it->second.bvhs_count != instance_count)
+    {
+        constexpr const char* message = "Scene update requires a scene built with the same instance count";
+        Logger::Get().Error(message);
+        throw std::runtime_error(message);
+    }
+
+    auto desc_range = impl_->WriteInstanceDescs(command_stream, instances, instance_count, result, result_offset);
+
+    impl_->build_bvh_top_level_.Update(command_stream->Get(),
+                                       desc_range.buffer,
+                                       desc_range.offset,
+                                       it->second.buffers,
+                                       instance_count,
+                                       result,
+                                       result_offset);
 }
 void Intersector::Intersect(CommandStreamBase*     command_stream_base,
                             DevicePtrBase*         scene,
@@ -276,6 +1312,15 @@ void Intersector::Intersect(CommandStreamBase*     command_stream_base,
     auto              command_stream = dynamic_cast<CommandStreamBackend<BackendType::kVulkan>*>(command_stream_base);
     vk::CommandBuffer command_buffer = command_stream->Get();
 
+    bool reorder = (query & RR_INTERSECT_QUERY_FLAG_BITS_REORDER_RAYS) != 0 && ray_count > 0;
+    query        = RRIntersectQuery(query & ~RR_INTERSECT_QUERY_FLAG_BITS_REORDER_RAYS);
+
+    // Occlusion only needs to know whether anything is hit.
+    if (query_output == RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT)
+    {
+        query = RR_INTERSECT_QUERY_ANY;
+    }
+
     vk::Buffer scene_buffer     = device_ptr_cast(scene);
     size_t     scene_offset     = device_ptr_offset(scene);
     vk::Buffer rays_buffer      = device_ptr_cast(rays);
@@ -287,11 +1332,40 @@ void Intersector::Intersect(CommandStreamBase*     command_stream_base,
     vk::Buffer scratch_buffer   = device_ptr_cast(scratch);
     size_t     scratch_offset   = device_ptr_offset(scratch);
     auto       key              = std::make_pair(scene_buffer, scene_offset);
+
+    // Reordered rays are traced from the scratch buffer, hits go there too until they are scattered back.
+    vk::Buffer trace_hits_buffer    = hits_buffer;
+    size_t     trace_hits_offset    = hits_offset;
+    size_t     trace_scratch_offset = scratch_offset;
+    size_t     trace_scratch_size   = GetTraceMemoryRequirements(ray_count);
+    if (reorder)
+    {
+        impl_->reorder_rays_.Gather(command_buffer,
+                                    scene_buffer,
+                                    scene_offset,
+                                    ray_count,
+                                    ray_count_buffer,
+                                    ray_count_offset,
+                                    rays_buffer,
+                                    rays_offset,
+                                    scratch_buffer,
+                                    scratch_offset,
+                                    trace_scratch_size);
+
+        auto ranges          = impl_->reorder_rays_.GetTraceRanges(ray_count, trace_scratch_size, scratch_offset);
+        rays_buffer          = scratch_buffer;
+        rays_offset          = ranges.rays_offset;
+        trace_hits_buffer    = scratch_buffer;
+        trace_hits_offset    = ranges.hits_offset;
+        trace_scratch_offset = ranges.trace_scratch_offset;
+    }
+
     if (!impl_->buffers_cache_.count(key))
     {
         impl_->trace_geometry_(command_buffer,
                                query,
                                query_output,
+                               impl_->IsWideGeometry(scene_buffer, scene_offset),
                                scene_buffer,
                                scene_offset,
                                ray_count,
@@ -299,10 +1373,10 @@ void Intersector::Intersect(CommandStreamBase*     command_stream_base,
                                ray_count_offset,
                                rays_buffer,
                                rays_offset,
-                               hits_buffer,
-                               hits_offset,
+                               trace_hits_buffer,
+                               trace_hits_offset,
                                scratch_buffer,
-                               scratch_offset);
+                               trace_scratch_offset);
     } else
     {
         impl_->trace_scene_(command_buffer,
@@ -316,10 +1390,22 @@ void Intersector::Intersect(CommandStreamBase*     command_stream_base,
                             ray_count_offset,
                             rays_buffer,
                             rays_offset,
-                            hits_buffer,
-                            hits_offset,
+                            trace_hits_buffer,
+                            trace_hits_offset,
                             scratch_buffer,
-                            scratch_offset);
+                            trace_scratch_offset);
+    }
+
+    if (reorder)
+    {
+        impl_->reorder_rays_.Scatter(command_buffer,
+                                     query_output,
+                                     ray_count,
+                                     hits_buffer,
+                                     hits_offset,
+                                     scratch_buffer,
+                                     scratch_offset,
+                                     trace_scratch_size);
     }
 }
 size_t Intersector::GetTraceMemoryRequirements(uint32_t ray_count)
@@ -327,4 +1413,25 @@ size_t Intersector::GetTraceMemoryRequirements(uint32_t ray_count)
     return std::max<size_t>(impl_->trace_scene_.GetScratchSize(ray_count),
                             impl_->trace_geometry_.GetScratchSize(ray_count));
 }
+size_t Intersector::GetReorderedTraceMemoryRequirements(uint32_t ray_count)
+{
+    return impl_->reorder_rays_.GetScratchSize(ray_count, GetTraceMemoryRequirements(ray_count));
+}
+
+void Intersector::SetTraceStackSize(uint32_t stack_size)
+{
+    Logger::Get().Debug("Intersector::SetTraceStackSize({})", stack_size);
+
+    // Stacks spill from LDS in chunks of this size.
+    constexpr uint32_t kLdsStackSize = 16u;
+
+    stack_size = RoundUp(std::max(stack_size, kLdsStackSize), kLdsStackSize);
+    impl_->trace_geometry_.SetStackSize(stack_size);
+    impl_->trace_scene_.SetStackSize(stack_size);
+}
+
+uint32_t Intersector::GetTraceStackOverflowCount()
+{
+    return impl_->trace_geometry_.GetStackOverflowCount() + impl_->trace_scene_.GetStackOverflowCount();
+}
 }  // namespace rt::vulkan
\ No newline at end of file
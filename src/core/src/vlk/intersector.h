@@ -33,8 +33,8 @@ namespace rt::vulkan
 class Intersector : public IntersectorBase
 {
 public:
-    /// Constructor.
-    Intersector(std::shared_ptr<GpuHelper> gpu_helper);
+    /// Constructor, persistent_threads selects persistent-threads traversal of binary BVHs.
+    Intersector(std::shared_ptr<GpuHelper> gpu_helper, bool persistent_threads = false);
     /// Destructor.
     ~Intersector();
 
@@ -51,6 +51,26 @@ public:
     PreBuildInfo GetTriangleMeshPreBuildInfo(const std::vector<TriangleMeshBuildInfo>& build_info,
                                              const RRBuildOptions*                     build_options) override;
 
+    /**
+     * @brief Get an info on batched build memory requirements.
+     *
+     * @param build_infos Mesh build data, one entry per mesh.
+     *
+     * @return Memory requirements to build specified meshes.
+     **/
+    PreBuildInfo GetTriangleMeshesPreBuildInfo(const std::vector<TriangleMeshBuildInfo>& build_infos,
+                                               const RRBuildOptions*                     build_options) override;
+
+    /**
+     * @brief Get an info on AABB list build memory requirements.
+     *
+     * @param build_info Array of AABB lists of the geometry.
+     *
+     * @return Memory requirements to build specified AABB lists.
+     **/
+    PreBuildInfo GetAabbListPreBuildInfo(const std::vector<AabbListBuildInfo>& build_info,
+                                         const RRBuildOptions*                 build_options) override;
+
     /**
      * @brief Get an info on build memory requirements.
      *
@@ -76,6 +96,22 @@ public:
                            DevicePtrBase*                            temporary_buffer,
                            DevicePtrBase*                            geometry_buffer) override;
 
+    /**
+     * @brief Build triangle meshes.
+     *
+     * Record commands to build a number of triangle meshes with merged dispatches.
+     *
+     * @param command_stream Command stream to record to.
+     * @param build_infos Mesh data, one entry per mesh.
+     * @param temporary_buffer Temporary memory needed during the build.
+     * @param geometry_buffers Buffers to put results into, one per mesh.
+     **/
+    void BuildTriangleMeshes(CommandStreamBase*                        command_stream_base,
+                             const std::vector<TriangleMeshBuildInfo>& build_infos,
+                             const RRBuildOptions*                     build_options,
+                             DevicePtrBase*                            temporary_buffer,
+                             const std::vector<DevicePtrBase*>&        geometry_buffers) override;
+
     /**
      * @brief Update triangle mesh.
      *
@@ -93,6 +129,127 @@ public:
                             DevicePtrBase*                            temporary_buffer,
                             DevicePtrBase*                            geometry_buffer) override;
 
+    /**
+     * @brief Build AABB list.
+     *
+     * Record commands to build a single BVH over all boxes of the geometry.
+     *
+     * @param command_stream Command stream to record to.
+     * @param build_info Array of AABB lists of the geometry.
+     * @param temporary_buffer Temporary memory needed during the build.
+     * @param geometry_buffer A buffer to put result into.
+     **/
+    void BuildAabbList(CommandStreamBase*                    command_stream_base,
+                       const std::vector<AabbListBuildInfo>& build_info,
+                       const RRBuildOptions*                 build_options,
+                       DevicePtrBase*                        temporary_buffer,
+                       DevicePtrBase*                        geometry_buffer) override;
+
+    /**
+     * @brief Update AABB list.
+     *
+     * Record commands to refit a geometry to new box positions.
+     *
+     * @param command_stream Command stream to record to.
+     * @param build_info Array of AABB lists of the geometry.
+     * @param temporary_buffer Temporary memory needed during the build.
+     * @param geometry_buffer A buffer to put result into.
+     **/
+    void UpdateAabbList(CommandStreamBase*                    command_stream_base,
+                        const std::vector<AabbListBuildInfo>& build_info,
+                        const RRBuildOptions*                 build_options,
+                        DevicePtrBase*                        temporary_buffer,
+                        DevicePtrBase*                        geometry_buffer) override;
+
+    /**
+     * @brief Get the compacted size of a geometry.
+     *
+     * @param geometry_buffer A buffer holding a built geometry.
+     *
+     * @return Number of bytes the geometry occupies.
+     **/
+    size_t GetGeometryCompactedSize(DevicePtrBase* geometry_buffer) override;
+
+    /**
+     * @brief Copy a geometry.
+     *
+     * Record a command to copy the nodes of a geometry into another buffer.
+     *
+     * @param command_stream Command stream to record to.
+     * @param src_geometry_buffer A buffer holding a built geometry.
+     * @param dst_geometry_buffer A buffer to copy the geometry to.
+     **/
+    void CopyGeometry(CommandStreamBase* command_stream_base,
+                      DevicePtrBase*     src_geometry_buffer,
+                      DevicePtrBase*     dst_geometry_buffer) override;
+
+    /**
+     * @brief Get the size of a serialized geometry or scene.
+     *
+     * @param acceleration_structure A buffer holding a geometry or a scene.
+     *
+     * @return Size of serialized data including the header.
+     **/
+    size_t GetSerializedSize(DevicePtrBase* acceleration_structure) override;
+
+    /**
+     * @brief Serialize a geometry.
+     *
+     * Record a command to copy the header and nodes of a geometry.
+     *
+     * @param command_stream Command stream to record to.
+     * @param geometry_buffer A buffer holding a built geometry.
+     * @param serialized_buffer A buffer to write serialized data to.
+     **/
+    void SerializeGeometry(CommandStreamBase* command_stream_base,
+                           DevicePtrBase*     geometry_buffer,
+                           DevicePtrBase*     serialized_buffer) override;
+
+    /**
+     * @brief Deserialize a geometry.
+     *
+     * Record a command to upload serialized nodes in chunks through the upload ring.
+     *
+     * @param command_stream Command stream to record to.
+     * @param serialized_data Host memory holding serialized data.
+     * @param serialized_size Size of serialized data in bytes.
+     * @param geometry_buffer A buffer to put result into.
+     **/
+    void DeserializeGeometry(CommandStreamBase* command_stream_base,
+                             void const*        serialized_data,
+                             size_t             serialized_size,
+                             DevicePtrBase*     geometry_buffer) override;
+
+    /**
+     * @brief Serialize a scene.
+     *
+     * Record a command to copy the header and contents of a scene buffer.
+     *
+     * @param command_stream Command stream to record to.
+     * @param scene_buffer A buffer holding a built scene.
+     * @param serialized_buffer A buffer to write serialized data to.
+     **/
+    void SerializeScene(CommandStreamBase* command_stream_base,
+                        DevicePtrBase*     scene_buffer,
+                        DevicePtrBase*     serialized_buffer) override;
+
+    /**
+     * @brief Deserialize a scene.
+     *
+     * Record a command to upload a serialized scene, instance geometry slots are reassigned on the host.
+     *
+     * @param command_stream Command stream to record to.
+     * @param serialized_data Host memory holding serialized data.
+     * @param serialized_size Size of serialized data in bytes.
+     * @param geometry_buffers Geometry of each instance.
+     * @param scene_buffer A buffer to put result into.
+     **/
+    void DeserializeScene(CommandStreamBase*                 command_stream_base,
+                          void const*                        serialized_data,
+                          size_t                             serialized_size,
+                          const std::vector<DevicePtrBase*>& geometry_buffers,
+                          DevicePtrBase*                     scene_buffer) override;
+
     /**
      * @brief Build a scene.
      *
@@ -111,6 +268,24 @@ public:
                     DevicePtrBase*        temporary_buffer,
                     DevicePtrBase*        scene_buffer) override;
 
+    /**
+     * @brief Update a scene.
+     *
+     * Record a command to refit a scene to new instance transforms keeping its topology.
+     *
+     * @param command_stream Command stream to record to.
+     * @param instances Array of instance data.
+     * @param instance_count Number of instances in the array, has to match the build.
+     * @param temporary_buffer Unused, a refit needs no temporary memory.
+     * @param scene_buffer A scene built earlier to update in place.
+     **/
+    void UpdateScene(CommandStreamBase*    command_stream_base,
+                     const RRInstance*     instances,
+                     uint32_t              instance_count,
+                     const RRBuildOptions* build_options,
+                     DevicePtrBase*        temporary_buffer,
+                     DevicePtrBase*        scene_buffer) override;
+
     /**
      * @brief Record intersect command into command stream.
      *
@@ -147,12 +322,34 @@ public:
      */
     size_t GetTraceMemoryRequirements(uint32_t ray_count) override;
 
+    /** @brief Get memory requirements for trace scratch buffer of reordered rays.
+     *
+     * @param ray_count Number of rays in the buffer (or max number of rays if indirect_ray_count is supplied).
+     * @return Size of scratch buffer.
+     */
+    size_t GetReorderedTraceMemoryRequirements(uint32_t ray_count) override;
+
+    /** @brief Set the traversal stack size of traces.
+     *
+     * Rounded up to a multiple of the LDS stack size, trace scratch requirements follow it.
+     *
+     * @param stack_size Number of stack entries per ray.
+     */
+    void SetTraceStackSize(uint32_t stack_size) override;
+
+    /** @brief Get the number of traversal stack overflows since the last call and reset it.
+     *
+     * @return Number of overflows of both geometry and scene traces.
+     */
+    uint32_t GetTraceStackOverflowCount() override;
+
 private:
     // Pimpl.
     struct IntersectorImpl;
     std::unique_ptr<IntersectorImpl> impl_;
 };
 
-std::unique_ptr<IntersectorBase> CreateIntersector(std::shared_ptr<GpuHelper> gpu_helper);
+std::unique_ptr<IntersectorBase> CreateIntersector(std::shared_ptr<GpuHelper> gpu_helper,
+                                                   bool                       persistent_threads = false);
 
 }  // namespace rt::vulkan
\ No newline at end of file
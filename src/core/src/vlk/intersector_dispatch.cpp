@@ -13,6 +13,8 @@ std::unique_ptr<IntersectorBase> CreateIntersector(DeviceBase& device, Intersect
     {
     case IntersectorType::kCompute:
         return CreateIntersector(vk_gpu_helper);
+    case IntersectorType::kComputePersistent:
+        return CreateIntersector(vk_gpu_helper, true);
     default:
         throw std::runtime_error("Unsupported intersector type");
     }
@@ -28,6 +28,7 @@ namespace rt::vulkan
 enum class IntersectorType
 {
     kCompute,
+    kComputePersistent,
     kKhrRaytracing
 };
 
@@ -21,6 +21,10 @@ THE SOFTWARE.
 ********************************************************************/
 #define RR_BVH2_INTERNAL_NODE(node)((node).child0 != RR_INVALID_ADDR)
 #define RR_BVH2_PRIM_ID(node)(((node).child1))
+// Leaves store the index of the mesh the triangle belongs to in the otherwise unused x of aabb1_max_or_v3.
+#define RR_BVH2_GEOMETRY_ID(node)(floatBitsToUint((node).aabb1_max_or_v3.x))
+// AABB leaves store (min, max, min) as a degenerate triangle and flag themselves in y of aabb1_max_or_v3.
+#define RR_BVH2_AABB_LEAF(node)(floatBitsToUint((node).aabb1_max_or_v3.y) != 0u)
 
 struct BVHNode
 {
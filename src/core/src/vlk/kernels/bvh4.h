@@ -0,0 +1,84 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+// A wide node spans two consecutive BVHNode slots stored after the binary nodes of a geometry.
+// Each slot keeps two children: bounds in aabb0/aabb1 and addresses in child0/child1,
+// so children 0, 1 live in the first slot and children 2, 3 in the second one.
+// Child addresses are slots relative to the first node of the geometry:
+// internal children point to wide nodes, leaf children to the binary leaf node with RR_BVH4_LEAF_BIT set,
+// unused children are RR_INVALID_ADDR.
+#define RR_BVH4_LEAF_BIT 0x80000000u
+#define RR_BVH4_LEAF(addr)(((addr) & RR_BVH4_LEAF_BIT) != 0u)
+#define RR_BVH4_LEAF_ADDR(addr)((addr) & ~RR_BVH4_LEAF_BIT)
+// The binary root of a wide geometry keeps the slot of the wide root in update.
+#define RR_BVH4_ROOT(root)(RR_BVH2_INTERNAL_NODE(root) ? (root).update : RR_BVH4_LEAF_BIT)
+
+// Order children a and b by distance.
+void sort_children2(inout vec4 dist, inout uvec4 addr, int a, int b)
+{
+    if (dist[b] < dist[a])
+    {
+        float t = dist[a];
+        dist[a] = dist[b];
+        dist[b] = t;
+        uint c = addr[a];
+        addr[a] = addr[b];
+        addr[b] = c;
+    }
+}
+
+// Sort distances of 4 children so that the nearest one comes first.
+void sort_children4(inout vec4 dist, inout uvec4 addr)
+{
+    sort_children2(dist, addr, 0, 1);
+    sort_children2(dist, addr, 2, 3);
+    sort_children2(dist, addr, 0, 2);
+    sort_children2(dist, addr, 1, 3);
+    sort_children2(dist, addr, 1, 2);
+}
+
+// Intersect the ray with 4 children of a wide node.
+// Returns the number of children hit, their addresses come first sorted nearest first, the rest is RR_INVALID_ADDR.
+uint intersect_children4(BVHNode n0, BVHNode n1,
+                         vec3 invdir, vec3 oxinvdir, float t_max, float t_min,
+                         out uvec4 addr)
+{
+    vec2 s[4];
+    s[0] = fast_intersect_aabb(n0.aabb0_min_or_v0, n0.aabb0_max_or_v1, invdir, oxinvdir, t_max, t_min);
+    s[1] = fast_intersect_aabb(n0.aabb1_min_or_v2, n0.aabb1_max_or_v3, invdir, oxinvdir, t_max, t_min);
+    s[2] = fast_intersect_aabb(n1.aabb0_min_or_v0, n1.aabb0_max_or_v1, invdir, oxinvdir, t_max, t_min);
+    s[3] = fast_intersect_aabb(n1.aabb1_min_or_v2, n1.aabb1_max_or_v3, invdir, oxinvdir, t_max, t_min);
+
+    addr = uvec4(n0.child0, n0.child1, n1.child0, n1.child1);
+
+    vec4 dist;
+    uint count = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        bool hit = s[i].x <= s[i].y && addr[i] != RR_INVALID_ADDR;
+        dist[i] = hit ? s[i].x : uintBitsToFloat(0x7f800000u);
+        addr[i] = hit ? addr[i] : RR_INVALID_ADDR;
+        count += hit ? 1 : 0;
+    }
+
+    sort_children4(dist, addr);
+    return count;
+}
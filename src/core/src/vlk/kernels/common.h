@@ -24,6 +24,7 @@ const float PI_2 = 1.57079632679489661923;
 const float PI_4 = 0.785398163397448309616;
 
 const float unit_side = 1024.0f;
+const float wide_unit_side = 2097152.0f;
 
 struct Ray
 {
@@ -33,13 +34,56 @@ struct Ray
     vec3 direction;
     // Intersection distance
     float max_t;
+    // Instances not sharing a bit with the mask are skipped, 0 disables masking
+    uint mask;
+    // Combination of RR_RAY_FLAG_* bits
+    uint flags;
+    uint padding0;
+    uint padding1;
 };
 
+// Ray flags, see RRRayFlagBits.
+#define RR_RAY_FLAG_CULL_BACK_FACING_TRIANGLES 1u
+#define RR_RAY_FLAG_CULL_FRONT_FACING_TRIANGLES 2u
+#define RR_RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH 4u
+#define RR_RAY_FLAG_SKIP_TRIANGLES 8u
+#define RR_RAY_FLAG_SKIP_AABBS 16u
+
 struct Hit
 {
     vec2 uv;
     uint shape_id;
     uint prim_id;
+    uint geom_id;
+    float t;
+};
+
+// Hit with the geometric normal, scalar members keep the layout tight (40 bytes).
+struct HitWithNormal
+{
+    vec2 uv;
+    uint shape_id;
+    uint prim_id;
+    uint geom_id;
+    float t;
+    float normal_x;
+    float normal_y;
+    float normal_z;
+    uint padding;
+};
+
+// Number of candidate hits reported per ray.
+#define RR_MAX_CANDIDATE_HITS 4u
+
+// Candidate hit, AABB primitives report the entry and exit distances, triangles report t_entry == t_exit.
+struct CandidateHit
+{
+    float t_entry;
+    float t_exit;
+    uint shape_id;
+    uint prim_id;
+    uint geom_id;
+    uint padding;
 };
 
 struct Transform
@@ -49,11 +93,19 @@ struct Transform
     vec4 m2;
 };
 
+// Max number of distinct buffers holding the geometries of a scene, matches radeonrays.h.
+#define RR_MAX_GEOMETRY_BUFFERS 2048
+
 struct InstanceDescription
 {
     Transform transform;
     uint   index;
-    uint   padding[3];
+    // Slot of the buffer holding the geometry in the children BVH descriptor array.
+    uint   geometry_buffer;
+    // Index of the root node of the geometry in that buffer.
+    uint   geometry_offset;
+    // Visibility mask tested against ray masks.
+    uint   mask;
 };
 
 struct Aabb
@@ -106,13 +158,21 @@ float fast_intersect_triangle(Ray r,
                               vec3 v3,
                               float t_max)
 {
+    if ((r.flags & RR_RAY_FLAG_SKIP_TRIANGLES) != 0)
+    {
+        return t_max;
+    }
+
     vec3 e1 = v2 - v1;
     vec3 e2 = v3 - v1;
     vec3 s1 = cross(r.direction, e2);
 
     float denom = dot(s1, e1);
 
-    if (denom == 0.f)
+    // denom is positive for front facing (counter-clockwise) triangles.
+    if (denom == 0.f ||
+        (denom < 0.f && (r.flags & RR_RAY_FLAG_CULL_BACK_FACING_TRIANGLES) != 0) ||
+        (denom > 0.f && (r.flags & RR_RAY_FLAG_CULL_FRONT_FACING_TRIANGLES) != 0))
     {
         return t_max;
     }
@@ -267,6 +327,23 @@ uint calculate_morton_code(vec3 p)
     return (expand_bits(uint(x)) << 2) | (expand_bits(uint(y)) << 1) | expand_bits(uint(z));
 }
 
+// Calculate and pack 63-bit Morton code for the point, low word in x and high word in y
+uvec2 calculate_wide_morton_code(vec3 p)
+{
+    uint x = uint(clamp(p.x * wide_unit_side, 0.0f, wide_unit_side - 1.0f));
+    uint y = uint(clamp(p.y * wide_unit_side, 0.0f, wide_unit_side - 1.0f));
+    uint z = uint(clamp(p.z * wide_unit_side, 0.0f, wide_unit_side - 1.0f));
+
+    // Bits 0-29 interleave low 10 bits of each axis, bits 30-32 hold 10th bits
+    uint lo = (expand_bits(x & 0x3ffu) << 2) | (expand_bits(y & 0x3ffu) << 1) | expand_bits(z & 0x3ffu);
+    lo |= (((z >> 10) & 1u) << 30) | (((y >> 10) & 1u) << 31);
+    // Bits 33-62 interleave high 10 bits of each axis
+    uint hi = (expand_bits(x >> 11) << 2) | (expand_bits(y >> 11) << 1) | expand_bits(z >> 11);
+    hi = (hi << 1) | ((x >> 10) & 1u);
+
+    return uvec2(lo, hi);
+}
+
 vec3 transform_point(vec3 p, Transform transform)
 {
     vec3 result;
@@ -339,4 +416,19 @@ Transform inverse(Transform t)
     res.m2 = vec4(m[0].z, m[1].z, m[2].z, m[3].z);
 
     return res;
-}
\ No newline at end of file
+}
+// Insert a candidate keeping the list sorted by entry distance.
+// Full lists drop their farthest entry, callers only insert candidates closer than it.
+void insert_candidate(inout CandidateHit candidates[RR_MAX_CANDIDATE_HITS],
+                      inout uint num_candidates,
+                      CandidateHit candidate)
+{
+    uint i = min(num_candidates, RR_MAX_CANDIDATE_HITS - 1);
+    while (i > 0 && candidates[i - 1].t_entry > candidate.t_entry)
+    {
+        candidates[i] = candidates[i - 1];
+        --i;
+    }
+    candidates[i] = candidate;
+    num_candidates = min(num_candidates + 1, RR_MAX_CANDIDATE_HITS);
+}
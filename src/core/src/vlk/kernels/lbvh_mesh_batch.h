@@ -0,0 +1,209 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+// Shared declarations of the batched (multi-geometry) mesh LBVH kernels.
+//
+// Primitives of all geometries are concatenated. Geometries get full 30-bit Morton codes and
+// are sorted with a segmented sort: a stable sort by Morton code, then a stable sort by geometry
+// slot, so every geometry ends up in its original range sorted by Morton code.
+//
+// With RR_BATCH_MERGE_GEOMETRIES set the geometries are the meshes of a single multi-mesh geometry:
+// they share one bounds slot, need no slot sort and get the BVH in slot 0, leaves keep the mesh index.
+// RR_BATCH_REFIT refits such a BVH in place: init resets update flags and fit reads no sort keys.
+//
+// AABB list geometries go through the same kernels: a box is loaded as the degenerate triangle
+// (min, max, min) whose bounds are the box itself, emit flags its leaf with RR_BVH2_AABB_LEAF.
+
+#define RR_MAX_BATCH_GEOMETRIES 1024
+
+// Batch flags.
+#define RR_BATCH_MERGE_GEOMETRIES 1u
+#define RR_BATCH_REFIT 2u
+
+// Geometry primitive types.
+#define RR_BATCH_PRIMITIVE_TRIANGLES 0u
+#define RR_BATCH_PRIMITIVE_AABBS 1u
+
+struct GeometryDesc
+{
+    // First primitive of the geometry in the concatenated primitive range.
+    uint prim_offset;
+    // Number of primitives in the geometry.
+    uint prim_count;
+    // Stride in the vertex (or AABB) buffer.
+    uint vertex_stride;
+    // RR_BATCH_PRIMITIVE_TRIANGLES or RR_BATCH_PRIMITIVE_AABBS.
+    uint primitive_type;
+};
+
+// Per geometry build descriptions, the whole buffer is bound so batches share descriptor sets.
+layout(set = 0, binding = 0) buffer GeometryDescs
+{
+    GeometryDesc g_geometry_descs[];
+};
+
+// Sort keys: Morton codes for the first sort, geometry slots for the second one.
+layout(set = 0, binding = 1) buffer SortKeys
+{
+    uint g_sort_keys[];
+};
+
+// Primitive references into the concatenated range.
+layout(set = 0, binding = 2) buffer Indices
+{
+    uint g_indices[];
+};
+
+// Per geometry AABBs, 8 uints each.
+layout(set = 0, binding = 3) buffer GeometryAABBs
+{
+    uint g_geometry_aabbs[];
+};
+
+// Morton codes of primitives in the concatenated range.
+layout(set = 0, binding = 4) buffer MortonCodes
+{
+    uint g_morton_codes[];
+};
+
+layout(set = 1, binding = 0) buffer MeshIndices
+{
+    uint indices[];
+} g_mesh_indices[RR_MAX_BATCH_GEOMETRIES];
+
+layout(set = 1, binding = 1) buffer MeshVertices
+{
+    float vertices[];
+} g_mesh_vertices[RR_MAX_BATCH_GEOMETRIES];
+
+layout(set = 1, binding = 2) coherent buffer BVH
+{
+    BVHNode nodes[];
+} g_bvh[RR_MAX_BATCH_GEOMETRIES];
+
+// Push constants.
+layout (push_constant) uniform PushConstants
+{
+    // Number of geometries in the batch.
+    uint g_num_geometries;
+    // Total number of leafs across the batch.
+    uint g_num_leafs;
+    // Batch flags.
+    uint g_flags;
+    // First description of the batch in g_geometry_descs.
+    uint g_geometry_descs_offset;
+};
+
+// Build description of a geometry.
+GeometryDesc GetGeometryDesc(uint geometry)
+{
+    return g_geometry_descs[g_geometry_descs_offset + geometry];
+}
+
+// Find the geometry owning a primitive of the concatenated range.
+uint FindGeometry(uint prim_index)
+{
+    uint lo = 0;
+    uint hi = g_num_geometries - 1;
+    while (lo < hi)
+    {
+        uint mid = (lo + hi + 1) >> 1;
+        if (GetGeometryDesc(mid).prim_offset <= prim_index)
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+// Number of bounds and BVH slots.
+uint GetSlotCount()
+{
+    return (g_flags & RR_BATCH_MERGE_GEOMETRIES) != 0u ? 1u : g_num_geometries;
+}
+
+// Bounds and BVH slot of a geometry.
+uint GetGeometrySlot(uint geometry)
+{
+    return (g_flags & RR_BATCH_MERGE_GEOMETRIES) != 0u ? 0u : geometry;
+}
+
+// Slot of a sorted primitive, sort keys only hold slots once sorted by them.
+uint GetSortedSlot(uint sorted_index)
+{
+    return GetSlotCount() == 1u ? 0u : g_sort_keys[sorted_index];
+}
+
+// Morton code of a sorted primitive.
+uint GetSortedMortonCode(uint sorted_index)
+{
+    return g_morton_codes[g_indices[sorted_index]];
+}
+
+// First primitive of a slot in the concatenated range.
+uint GetSlotPrimOffset(uint slot)
+{
+    return (g_flags & RR_BATCH_MERGE_GEOMETRIES) != 0u ? 0u : GetGeometryDesc(slot).prim_offset;
+}
+
+// Number of primitives (leafs) of a slot.
+uint GetSlotPrimCount(uint slot)
+{
+    return (g_flags & RR_BATCH_MERGE_GEOMETRIES) != 0u ? g_num_leafs : GetGeometryDesc(slot).prim_count;
+}
+
+// Fetch a primitive of a geometry as a triangle, boxes come as (min, max, min).
+void LoadPrimitive(uint geometry, uint triangle, out vec3 v0, out vec3 v1, out vec3 v2)
+{
+    uint vertex_stride_in_floats = GetGeometryDesc(geometry).vertex_stride >> 2;
+
+    if (GetGeometryDesc(geometry).primitive_type == RR_BATCH_PRIMITIVE_AABBS)
+    {
+        // Boxes are (xmin, ymin, zmin, unused), (xmax, ymax, zmax, unused).
+        uint base = triangle * vertex_stride_in_floats;
+        v0 = vec3(g_mesh_vertices[nonuniformEXT(geometry)].vertices[base + 0],
+                  g_mesh_vertices[nonuniformEXT(geometry)].vertices[base + 1],
+                  g_mesh_vertices[nonuniformEXT(geometry)].vertices[base + 2]);
+        v1 = vec3(g_mesh_vertices[nonuniformEXT(geometry)].vertices[base + 4],
+                  g_mesh_vertices[nonuniformEXT(geometry)].vertices[base + 5],
+                  g_mesh_vertices[nonuniformEXT(geometry)].vertices[base + 6]);
+        v2 = v0;
+        return;
+    }
+
+    uint i0 = g_mesh_indices[nonuniformEXT(geometry)].indices[3 * triangle + 0];
+    uint i1 = g_mesh_indices[nonuniformEXT(geometry)].indices[3 * triangle + 1];
+    uint i2 = g_mesh_indices[nonuniformEXT(geometry)].indices[3 * triangle + 2];
+
+    v0 = vec3(g_mesh_vertices[nonuniformEXT(geometry)].vertices[i0 * vertex_stride_in_floats + 0],
+              g_mesh_vertices[nonuniformEXT(geometry)].vertices[i0 * vertex_stride_in_floats + 1],
+              g_mesh_vertices[nonuniformEXT(geometry)].vertices[i0 * vertex_stride_in_floats + 2]);
+    v1 = vec3(g_mesh_vertices[nonuniformEXT(geometry)].vertices[i1 * vertex_stride_in_floats + 0],
+              g_mesh_vertices[nonuniformEXT(geometry)].vertices[i1 * vertex_stride_in_floats + 1],
+              g_mesh_vertices[nonuniformEXT(geometry)].vertices[i1 * vertex_stride_in_floats + 2]);
+    v2 = vec3(g_mesh_vertices[nonuniformEXT(geometry)].vertices[i2 * vertex_stride_in_floats + 0],
+              g_mesh_vertices[nonuniformEXT(geometry)].vertices[i2 * vertex_stride_in_floats + 1],
+              g_mesh_vertices[nonuniformEXT(geometry)].vertices[i2 * vertex_stride_in_floats + 2]);
+}
@@ -0,0 +1,170 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "profiler.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "utils/logger.h"
+
+namespace rt::vulkan
+{
+Profiler::Profiler(vk::Device device, float timestamp_period, uint32_t timestamp_valid_bits)
+    : device_(device),
+      timestamp_period_(timestamp_period),
+      timestamp_mask_(timestamp_valid_bits < 64u ? (1ull << timestamp_valid_bits) - 1ull : ~0ull)
+{
+}
+
+Profiler::~Profiler()
+{
+    for (auto& recording : recordings_)
+    {
+        Recycle(recording.second);
+    }
+    for (auto& submission : submissions_)
+    {
+        Recycle(submission.second);
+    }
+    for (auto query_pool : free_query_pools_)
+    {
+        device_.destroyQueryPool(query_pool);
+    }
+}
+
+void Profiler::BeginScope(vk::CommandBuffer command_buffer, std::string const& name)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto&                       recording = recordings_[static_cast<VkCommandBuffer>(command_buffer)];
+    uint32_t                    query     = uint32_t(recording.scope_names.size() * 2u) % kQueriesPerPool;
+    if (query == 0u)
+    {
+        vk::QueryPool query_pool;
+        if (free_query_pools_.empty())
+        {
+            query_pool = device_.createQueryPool({{}, vk::QueryType::eTimestamp, kQueriesPerPool});
+        } else
+        {
+            query_pool = free_query_pools_.back();
+            free_query_pools_.pop_back();
+        }
+        // Queries have to be reset before they are written, the reset executes in order with the scopes.
+        command_buffer.resetQueryPool(query_pool, 0u, kQueriesPerPool);
+        recording.query_pools.push_back(query_pool);
+    }
+    recording.scope_names.push_back(name);
+    command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, recording.query_pools.back(), query);
+}
+
+void Profiler::EndScope(vk::CommandBuffer command_buffer)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto&                       recording = recordings_.at(static_cast<VkCommandBuffer>(command_buffer));
+    uint32_t                    query     = uint32_t(recording.scope_names.size() * 2u - 1u) % kQueriesPerPool;
+    command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, recording.query_pools.back(), query);
+}
+
+void Profiler::OnSubmit(vk::CommandBuffer command_buffer, EventBase const* event)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto                        recording  = recordings_.find(static_cast<VkCommandBuffer>(command_buffer));
+    auto&                       submission = submissions_[event];
+    // Events are pooled, scopes of a former submission not released through the device are dropped here.
+    Recycle(submission);
+    if (recording != recordings_.end())
+    {
+        submission = std::move(recording->second);
+        recordings_.erase(recording);
+    }
+}
+
+void Profiler::Discard(vk::CommandBuffer command_buffer)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto                        recording = recordings_.find(static_cast<VkCommandBuffer>(command_buffer));
+    if (recording != recordings_.end())
+    {
+        Recycle(recording->second);
+        recordings_.erase(recording);
+    }
+}
+
+std::vector<ProfilingScope> Profiler::GetResults(EventBase const* event)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto                        submission = submissions_.find(event);
+    if (submission == submissions_.end())
+    {
+        return {};
+    }
+
+    auto const&           recording   = submission->second;
+    uint32_t              num_queries = uint32_t(recording.scope_names.size() * 2u);
+    std::vector<uint64_t> timestamps(num_queries);
+    vk::QueryResultFlags  flags = vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait;
+    for (uint32_t i = 0; i < recording.query_pools.size(); ++i)
+    {
+        uint32_t first  = i * kQueriesPerPool;
+        uint32_t count  = std::min(kQueriesPerPool, num_queries - first);
+        auto     result = device_.getQueryPoolResults(
+            recording.query_pools[i], 0u, count, count * sizeof(uint64_t), &timestamps[first], sizeof(uint64_t), flags);
+        if (result != vk::Result::eSuccess)
+        {
+            Logger::Get().Error("Failed to read timestamp queries: {}", vk::to_string(result));
+            throw std::runtime_error("Failed to read timestamp queries");
+        }
+    }
+
+    // Accumulate scopes sharing a name, e.g. passes of a sort.
+    std::vector<ProfilingScope> scopes;
+    for (size_t i = 0; i < recording.scope_names.size(); ++i)
+    {
+        auto const& name    = recording.scope_names[i];
+        auto        matches = [&name](ProfilingScope const& scope) { return scope.name == name; };
+        auto        scope   = std::find_if(scopes.begin(), scopes.end(), matches);
+        if (scope == scopes.end())
+        {
+            scope       = scopes.insert(scopes.end(), ProfilingScope{});
+            scope->name = name;
+        }
+        uint64_t ticks = (timestamps[2 * i + 1] - timestamps[2 * i]) & timestamp_mask_;
+        scope->dispatch_count++;
+        scope->duration_ms += double(ticks) * timestamp_period_ * 1e-6;
+    }
+    return scopes;
+}
+
+void Profiler::Release(EventBase const* event)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto                        submission = submissions_.find(event);
+    if (submission != submissions_.end())
+    {
+        Recycle(submission->second);
+        submissions_.erase(submission);
+    }
+}
+
+void Profiler::Recycle(Recording& recording)
+{
+    free_query_pools_.insert(free_query_pools_.end(), recording.query_pools.begin(), recording.query_pools.end());
+    recording.query_pools.clear();
+    recording.scope_names.clear();
+}
+}  // namespace rt::vulkan
@@ -0,0 +1,106 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/device_base.h"
+#include "vlk/gpu_helper.h"
+
+namespace rt::vulkan
+{
+/**
+ * @brief GPU timestamp profiler.
+ *
+ * Brackets scopes recorded into a command buffer with timestamp queries. Query pools recorded into a command buffer
+ * are handed over to the event of its submission, so the durations are available until the event is released.
+ **/
+class Profiler
+{
+public:
+    Profiler(vk::Device device, float timestamp_period, uint32_t timestamp_valid_bits);
+    ~Profiler();
+
+    Profiler(Profiler const&) = delete;
+    Profiler& operator=(Profiler const&) = delete;
+
+    /**
+     * @brief Write a timestamp opening a named scope.
+     *
+     * @param command_buffer Command buffer being recorded.
+     * @param name Scope name, scopes sharing a name are accumulated.
+     **/
+    void BeginScope(vk::CommandBuffer command_buffer, std::string const& name);
+
+    /**
+     * @brief Write a timestamp closing the scope opened last.
+     *
+     * @param command_buffer Command buffer being recorded.
+     **/
+    void EndScope(vk::CommandBuffer command_buffer);
+
+    /**
+     * @brief Hand the scopes recorded into a command buffer over to the event of its submission.
+     **/
+    void OnSubmit(vk::CommandBuffer command_buffer, EventBase const* event);
+
+    /**
+     * @brief Drop the scopes of a command buffer released without a submission.
+     **/
+    void Discard(vk::CommandBuffer command_buffer);
+
+    /**
+     * @brief Get GPU durations of the scopes of a completed submission.
+     *
+     * @param event Submission event.
+     * @return Scopes in order of their first appearance.
+     **/
+    std::vector<ProfilingScope> GetResults(EventBase const* event);
+
+    /**
+     * @brief Recycle query pools of a released event.
+     **/
+    void Release(EventBase const* event);
+
+private:
+    // Timestamps and scope names of a command buffer, each scope takes two consecutive queries.
+    struct Recording
+    {
+        std::vector<vk::QueryPool> query_pools;
+        std::vector<std::string>   scope_names;
+    };
+    static constexpr uint32_t kQueriesPerPool = 256u;
+
+    void Recycle(Recording& recording);
+
+    vk::Device device_;
+    // Nanoseconds per timestamp tick.
+    double   timestamp_period_ = 1.0;
+    uint64_t timestamp_mask_   = ~0ull;
+
+    // Command buffers are recorded from different threads.
+    std::mutex                                      mutex_;
+    std::unordered_map<VkCommandBuffer, Recording>  recordings_;
+    std::unordered_map<EventBase const*, Recording> submissions_;
+    std::vector<vk::QueryPool>                      free_query_pools_;
+};
+}  // namespace rt::vulkan
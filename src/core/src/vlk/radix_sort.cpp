@@ -1,5 +1,6 @@
 #include "radix_sort.h"
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 
@@ -10,8 +11,10 @@ namespace rt::vulkan::algorithm
 {
 namespace
 {
-constexpr uint32_t       kNumBitsPerPass   = 4;
+// Must match PP_NUM_HISTOGRAM_BITS of the sort kernels.
+constexpr uint32_t       kNumBitsPerPass   = 8;
 constexpr uint32_t       kHistogramNumBins = (1 << kNumBitsPerPass);
+constexpr uint32_t       kMaxKeyBits       = 32;
 
 struct Parameters
 {
@@ -69,7 +72,7 @@ struct RadixSortKeyValue::RadixSortImpl
 
     std::shared_ptr<GpuHelper> gpu_helper_;
     ShaderManager const&       shader_manager_;
-    // Scan for histogram scans.
+    // Scan for histogram scans, their prefixes are bounded by the key count so look-back is safe.
     Scan     scan_;
     uint32_t num_keys_;
 
@@ -85,7 +88,7 @@ struct RadixSortKeyValue::RadixSortImpl
     mutable ScratchLayoutT scratch_layout_ = ScratchLayoutT(kAlignment);
 
     RadixSortImpl(std::shared_ptr<GpuHelper> helper, ShaderManager const& manager)
-        : gpu_helper_(helper), shader_manager_(manager), scan_(helper, manager), cache_(helper)
+        : gpu_helper_(helper), shader_manager_(manager), scan_(helper, manager, true), cache_(helper)
     {
         Init();
     }
@@ -169,7 +172,8 @@ void RadixSortKeyValue::operator()(vk::CommandBuffer command_buffer,
                                    vk::DeviceSize    output_values_size,
                                    vk::Buffer        scratch_data,
                                    vk::DeviceSize    scratch_offset,
-                                   uint32_t          num_keys)
+                                   uint32_t          num_keys,
+                                   uint32_t          key_bits)
 {
     AdjustLayouts(num_keys);
     // bind memory to temporary buffers and update descriptors
@@ -199,9 +203,13 @@ void RadixSortKeyValue::operator()(vk::CommandBuffer command_buffer,
     auto scan_offset             = impl_->scratch_layout_.offset_of(RadixSortImpl::ScratchLayout::kScanScratch);
 
     uint32_t num_histogram_elems = impl_->parameters_->CalculateNumGroupHistogramElements(num_keys);
-    // Here is what is happening here: We are taking 8 passes and
-    // sort according to 4 next bits (lsb to msb) every pass using stable sort.
-    // This effectively gives us fully sorted 32-bit sequence at the end.
+    // Only the passes covering significant key bits are needed, but their number is kept even
+    // for the ping-pong below to finish in the output buffer.
+    auto num_passes = CeilDivide(std::clamp(key_bits, 1u, kMaxKeyBits), kNumBitsPerPass);
+    num_passes += num_passes & 1u;
+    // Here is what is happening here: We are taking up to 4 passes and
+    // sort according to 8 next bits (lsb to msb) every pass using stable sort.
+    // This effectively gives us fully sorted key_bits-bit sequence at the end.
     // Since we are using ping-pong we are doing the following:
     // 0th iteration takes elements from input and outputs them into temporary buffer.
     // 1st iteration takes partially sorted elements from temporary buffer and outputs
@@ -211,8 +219,8 @@ void RadixSortKeyValue::operator()(vk::CommandBuffer command_buffer,
     // 3rd iteration takes partially sorted elements from temporary buffer and outputs
     //     them into output.
     // and so on.
-    // After 7th iteration we have our fully sorted sequence in the output buffer.
-    for (auto bitshift = 0u; bitshift < 32; bitshift += kNumBitsPerPass)
+    // After the last (odd) iteration we have our fully sorted sequence in the output buffer.
+    for (auto bitshift = 0u; bitshift < num_passes * kNumBitsPerPass; bitshift += kNumBitsPerPass)
     {
         // Calculate group histograms
         auto pass = bitshift == 0 ? 2 : ((bitshift & ((kNumBitsPerPass << 1) - 1)) ? 0u : 1u);
@@ -393,7 +401,8 @@ void RadixSortKeyValue::UpdateDescriptors(vk::Buffer     input_keys,
         // 3) output -> temp
         // We only apply (1) once for getting input data into
         // the temporary buffer and then we ping-pong between
-        // temp and output. Input buffer remain unchanged.
+        // temp and output. Input buffer is not touched after (1),
+        // so output may alias it.
 
         // Update descriptors.
         vk::DescriptorBufferInfo histogram_start_infos[] = {
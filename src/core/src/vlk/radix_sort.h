@@ -46,6 +46,9 @@ public:
      * @param output_values Output values pointer.
      * @param scratch_data Scratch area pointer.
      * @param size Number of elements to sort.
+     * @param key_bits Number of significant low bits in the keys, higher bits are ignored.
+     *
+     * Output may alias input for an in-place sort: input is only read by the first pass.
      **/
     void operator()(vk::CommandBuffer command_buffer,
                     vk::Buffer        input_keys,
@@ -62,7 +65,8 @@ public:
                     vk::DeviceSize    output_values_size,
                     vk::Buffer        scratch_data,
                     vk::DeviceSize    scratch_offset,
-                    uint32_t          size);
+                    uint32_t          size,
+                    uint32_t          key_bits = 32u);
 
     /**
      * @brief Get the amount of scratch memory in bytes required to sort specified amount of elements.
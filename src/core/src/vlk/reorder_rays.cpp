@@ -0,0 +1,350 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "reorder_rays.h"
+
+#include <algorithm>
+
+#include "utils/logger.h"
+#include "utils/memory_layout.h"
+#include "vlk/radix_sort.h"
+
+namespace rt::vulkan
+{
+namespace
+{
+constexpr char const* s_calc_keys_kernel_name          = "reorder_calc_keys.comp.spv";
+constexpr char const* s_calc_keys_indirect_kernel_name = "reorder_calc_keys_i.comp.spv";
+constexpr char const* s_gather_rays_kernel_name        = "reorder_gather_rays.comp.spv";
+constexpr char const* s_scatter_hits_kernel_name       = "reorder_scatter_hits.comp.spv";
+constexpr char const* s_scatter_occlusion_kernel_name  = "reorder_scatter_occlusion.comp.spv";
+
+constexpr uint32_t kGroupSize = 128u;
+
+// Sorted hits are sized for the largest output, the layout does not depend on the query.
+constexpr size_t kMaxHitSize =
+    std::max({sizeof(RRHit), sizeof(RRHitWithNormal), RR_MAX_CANDIDATE_HITS * sizeof(RRCandidateHit)});
+
+// Size of a hit in uints, occlusion bits are scattered by a kernel of their own.
+uint32_t GetHitStride(RRIntersectQueryOutput query_output)
+{
+    switch (query_output)
+    {
+    case RR_INTERSECT_QUERY_OUTPUT_FULL_HIT:
+        return uint32_t(sizeof(RRHit) / sizeof(uint32_t));
+    case RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL:
+        return uint32_t(sizeof(RRHitWithNormal) / sizeof(uint32_t));
+    case RR_INTERSECT_QUERY_OUTPUT_CANDIDATES:
+        return uint32_t(RR_MAX_CANDIDATE_HITS * sizeof(RRCandidateHit) / sizeof(uint32_t));
+    default:
+        return 1u;
+    }
+}
+}  // namespace
+
+struct ReorderRays::ReorderRaysImpl
+{
+    enum class ScratchLayout
+    {
+        kKeys,
+        kValues,
+        kSortMemory,
+        kSortedRays,
+        kSortedHits,
+        kTraceMemory
+    };
+
+    // Phases of a reordered trace, used to alias scratch blocks.
+    static constexpr uint32_t kCalcKeysPhase = 0;
+    static constexpr uint32_t kSortPhase     = 1;
+    static constexpr uint32_t kGatherPhase   = 2;
+    static constexpr uint32_t kTracePhase    = 3;
+    static constexpr uint32_t kScatterPhase  = 4;
+
+#pragma pack(push, 1)
+    struct PushConstants
+    {
+        uint32_t g_num_rays;
+        uint32_t g_hit_stride;
+    };
+#pragma pack(pop)
+
+    struct Kernel
+    {
+        ShaderPtr                  kernel = nullptr;
+        std::vector<DescriptorSet> desc_set;
+    };
+
+    std::shared_ptr<GpuHelper>   gpu_helper_;
+    ShaderManager const&         shader_manager_;
+    algorithm::RadixSortKeyValue radix_sort_;
+
+    Kernel calc_keys_;
+    Kernel calc_keys_indirect_;
+    Kernel gather_rays_;
+    Kernel scatter_hits_;
+    Kernel scatter_occlusion_;
+
+    // Keyed by buffer ranges, the scratch blocks move with the ray count.
+    DescriptorCacheTable<5, 1, vk::DescriptorBufferInfo> calc_keys_cache_;
+    DescriptorCacheTable<4, 1, vk::DescriptorBufferInfo> gather_cache_;
+    DescriptorCacheTable<4, 1, vk::DescriptorBufferInfo> scatter_cache_;
+
+    using ScratchLayoutT = MemoryLayout<ScratchLayout, vk::DeviceSize>;
+    mutable ScratchLayoutT scratch_layout_     = ScratchLayoutT(kAlignment);
+    mutable uint32_t       ray_count_          = 0;
+    mutable size_t         trace_scratch_size_ = 0;
+
+    ReorderRaysImpl(std::shared_ptr<GpuHelper> helper, ShaderManager const& manager)
+        : gpu_helper_(helper),
+          shader_manager_(manager),
+          radix_sort_(helper, manager),
+          calc_keys_cache_(helper),
+          gather_cache_(helper),
+          scatter_cache_(helper)
+    {
+        Init(calc_keys_, s_calc_keys_kernel_name);
+        Init(calc_keys_indirect_, s_calc_keys_indirect_kernel_name);
+        Init(gather_rays_, s_gather_rays_kernel_name);
+        Init(scatter_hits_, s_scatter_hits_kernel_name);
+        Init(scatter_occlusion_, s_scatter_occlusion_kernel_name);
+    }
+    void Init(Kernel& kernel, ShaderManager::KernelID id)
+    {
+        kernel.kernel   = shader_manager_.CreateKernel(id);
+        kernel.desc_set = shader_manager_.CreateDescriptorSets(kernel.kernel);
+        shader_manager_.PrepareKernel(id, kernel.desc_set);
+    }
+
+    ~ReorderRaysImpl()
+    {
+        for (auto kernel : {&calc_keys_, &calc_keys_indirect_, &gather_rays_, &scatter_hits_, &scatter_occlusion_})
+        {
+            for (auto& desc_set : kernel->desc_set)
+            {
+                gpu_helper_->device.destroyDescriptorSetLayout(desc_set.layout_);
+            }
+        }
+    }
+
+    // Unused trailing key entries stay empty, so direct and indirect key calculation can share a cache.
+    template <size_t N>
+    vk::DescriptorSet GetDescriptor(Kernel const&                                         kernel,
+                                    DescriptorCacheTable<N, 1, vk::DescriptorBufferInfo>& cache,
+                                    std::vector<vk::DescriptorBufferInfo> const&          info)
+    {
+        std::array<vk::DescriptorBufferInfo, N> key = {};
+        std::copy(info.begin(), info.end(), key.begin());
+        if (cache.Contains(key))
+        {
+            return cache.Get(key)[0];
+        }
+
+        vk::DescriptorSet descriptor_set = gpu_helper_->AllocateDescriptorSet(kernel.desc_set[0].layout_);
+        gpu_helper_->WriteDescriptorSet(descriptor_set, info.data(), (uint32_t)info.size());
+        cache.Push(key, {descriptor_set});
+        return descriptor_set;
+    }
+
+    void Dispatch(vk::CommandBuffer command_buffer,
+                  Kernel const&     kernel,
+                  vk::DescriptorSet descriptor_set,
+                  uint32_t          ray_count,
+                  uint32_t          hit_stride)
+    {
+        PushConstants push_consts = {ray_count, hit_stride};
+        gpu_helper_->EncodePushConstant(
+            kernel.kernel->pipeline_layout, 0u, sizeof(push_consts), &push_consts, command_buffer);
+        gpu_helper_->EncodeBindDescriptorSets(&descriptor_set, 1u, 0u, kernel.kernel->pipeline_layout, command_buffer);
+
+        auto num_groups = CeilDivide(ray_count, kGroupSize);
+        shader_manager_.EncodeDispatch1D(*kernel.kernel, num_groups, command_buffer);
+    }
+
+    void Barrier(vk::CommandBuffer command_buffer, vk::Buffer buffer)
+    {
+        gpu_helper_->EncodeBufferBarrier(buffer,
+                                         vk::AccessFlagBits::eShaderWrite,
+                                         vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                                         vk::PipelineStageFlagBits::eComputeShader,
+                                         vk::PipelineStageFlagBits::eComputeShader,
+                                         command_buffer);
+    }
+};
+
+ReorderRays::ReorderRays(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager)
+    : impl_(std::make_unique<ReorderRaysImpl>(gpu_helper, shader_manager))
+{
+}
+ReorderRays::~ReorderRays() = default;
+
+void ReorderRays::Gather(vk::CommandBuffer command_buffer,
+                         vk::Buffer        bvh,
+                         size_t            bvh_offset,
+                         uint32_t          ray_count,
+                         vk::Buffer        ray_count_buffer,
+                         size_t            ray_count_buffer_offset,
+                         vk::Buffer        rays,
+                         size_t            rays_offset,
+                         vk::Buffer        scratch,
+                         size_t            scratch_offset,
+                         size_t            trace_scratch_size)
+{
+    using Layout = ReorderRaysImpl::ScratchLayout;
+
+    AdjustLayout(ray_count, trace_scratch_size);
+    auto& layout = impl_->scratch_layout_;
+    layout.SetBaseOffset(vk::DeviceSize(scratch_offset));
+
+    auto keys_offset   = layout.offset_of(Layout::kKeys);
+    auto keys_size     = vk::DeviceSize(layout.size_of(Layout::kKeys));
+    auto values_offset = layout.offset_of(Layout::kValues);
+    auto values_size   = vk::DeviceSize(layout.size_of(Layout::kValues));
+    auto sort_offset   = layout.offset_of(Layout::kSortMemory);
+    auto sorted_offset = layout.offset_of(Layout::kSortedRays);
+    auto sorted_size   = vk::DeviceSize(layout.size_of(Layout::kSortedRays));
+
+    // Scratch may still be in use by a previous trace.
+    impl_->Barrier(command_buffer, scratch);
+
+    // Calculate keys.
+    {
+        auto& kernel = ray_count_buffer ? impl_->calc_keys_indirect_ : impl_->calc_keys_;
+
+        std::vector<vk::DescriptorBufferInfo> info = {{bvh, bvh_offset, VK_WHOLE_SIZE},
+                                                      {rays, rays_offset, VK_WHOLE_SIZE}};
+        if (ray_count_buffer)
+        {
+            info.emplace_back(ray_count_buffer, ray_count_buffer_offset, VK_WHOLE_SIZE);
+        }
+        info.emplace_back(scratch, keys_offset, keys_size);
+        info.emplace_back(scratch, values_offset, values_size);
+
+        auto descriptor_set = impl_->GetDescriptor(kernel, impl_->calc_keys_cache_, info);
+        impl_->Dispatch(command_buffer, kernel, descriptor_set, ray_count, 0u);
+        impl_->Barrier(command_buffer, scratch);
+    }
+
+    // Sort ray indices in place.
+    impl_->radix_sort_(command_buffer,
+                       scratch,
+                       keys_offset,
+                       keys_size,
+                       scratch,
+                       keys_offset,
+                       keys_size,
+                       scratch,
+                       values_offset,
+                       values_size,
+                       scratch,
+                       values_offset,
+                       values_size,
+                       scratch,
+                       sort_offset,
+                       ray_count);
+    impl_->Barrier(command_buffer, scratch);
+
+    // Gather rays in sorted order.
+    {
+        std::vector<vk::DescriptorBufferInfo> info = {{scratch, keys_offset, keys_size},
+                                                      {scratch, values_offset, values_size},
+                                                      {rays, rays_offset, VK_WHOLE_SIZE},
+                                                      {scratch, sorted_offset, sorted_size}};
+
+        auto descriptor_set = impl_->GetDescriptor(impl_->gather_rays_, impl_->gather_cache_, info);
+        impl_->Dispatch(command_buffer, impl_->gather_rays_, descriptor_set, ray_count, 0u);
+        impl_->Barrier(command_buffer, scratch);
+    }
+}
+
+void ReorderRays::Scatter(vk::CommandBuffer      command_buffer,
+                          RRIntersectQueryOutput query_output,
+                          uint32_t               ray_count,
+                          vk::Buffer             hits,
+                          size_t                 hits_offset,
+                          vk::Buffer             scratch,
+                          size_t                 scratch_offset,
+                          size_t                 trace_scratch_size)
+{
+    using Layout = ReorderRaysImpl::ScratchLayout;
+
+    AdjustLayout(ray_count, trace_scratch_size);
+    auto& layout = impl_->scratch_layout_;
+    layout.SetBaseOffset(vk::DeviceSize(scratch_offset));
+
+    bool  occlusion = query_output == RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT;
+    auto& kernel    = occlusion ? impl_->scatter_occlusion_ : impl_->scatter_hits_;
+
+    std::vector<vk::DescriptorBufferInfo> info = {
+        {scratch, layout.offset_of(Layout::kKeys), layout.size_of(Layout::kKeys)},
+        {scratch, layout.offset_of(Layout::kValues), layout.size_of(Layout::kValues)},
+        {scratch, layout.offset_of(Layout::kSortedHits), layout.size_of(Layout::kSortedHits)},
+        {hits, hits_offset, VK_WHOLE_SIZE}};
+
+    auto descriptor_set = impl_->GetDescriptor(kernel, impl_->scatter_cache_, info);
+    impl_->Dispatch(command_buffer, kernel, descriptor_set, ray_count, GetHitStride(query_output));
+    impl_->Barrier(command_buffer, hits);
+}
+
+ReorderRays::TraceRanges ReorderRays::GetTraceRanges(uint32_t ray_count,
+                                                     size_t   trace_scratch_size,
+                                                     size_t   scratch_offset) const
+{
+    using Layout = ReorderRaysImpl::ScratchLayout;
+
+    AdjustLayout(ray_count, trace_scratch_size);
+    auto& layout = impl_->scratch_layout_;
+    layout.SetBaseOffset(vk::DeviceSize(scratch_offset));
+
+    return {size_t(layout.offset_of(Layout::kSortedRays)),
+            size_t(layout.offset_of(Layout::kSortedHits)),
+            size_t(layout.offset_of(Layout::kTraceMemory))};
+}
+
+size_t ReorderRays::GetScratchSize(uint32_t ray_count, size_t trace_scratch_size) const
+{
+    AdjustLayout(ray_count, trace_scratch_size);
+    return impl_->scratch_layout_.total_size();
+}
+
+void ReorderRays::AdjustLayout(uint32_t ray_count, size_t trace_scratch_size) const
+{
+    using Impl   = ReorderRaysImpl;
+    using Layout = ReorderRaysImpl::ScratchLayout;
+
+    if (ray_count == impl_->ray_count_ && trace_scratch_size == impl_->trace_scratch_size_)
+    {
+        return;
+    }
+
+    impl_->ray_count_          = ray_count;
+    impl_->trace_scratch_size_ = trace_scratch_size;
+
+    // Keys and values are sorted in place and needed until the scatter, sort memory is dead before the gather
+    // and gets reused by the sorted rays, the sorted hits and the trace.
+    auto& layout = impl_->scratch_layout_;
+    layout.Reset();
+    layout.AppendBlock<uint32_t>(Layout::kKeys, ray_count, {Impl::kCalcKeysPhase, Impl::kScatterPhase});
+    layout.AppendBlock<uint32_t>(Layout::kValues, ray_count, {Impl::kCalcKeysPhase, Impl::kScatterPhase});
+    layout.AppendBlock<char>(
+        Layout::kSortMemory, impl_->radix_sort_.GetScratchDataSize(ray_count), {Impl::kSortPhase, Impl::kSortPhase});
+    layout.AppendBlock<RRRay>(Layout::kSortedRays, ray_count, {Impl::kGatherPhase, Impl::kTracePhase});
+    layout.AppendBlock<char>(Layout::kSortedHits, kMaxHitSize * ray_count, {Impl::kTracePhase, Impl::kScatterPhase});
+    layout.AppendBlock<char>(Layout::kTraceMemory, trace_scratch_size, {Impl::kTracePhase, Impl::kTracePhase});
+}
+}  // namespace rt::vulkan
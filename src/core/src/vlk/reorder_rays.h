@@ -0,0 +1,105 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vlk/common.h"
+#include "vlk/gpu_helper.h"
+#include "vlk/shader_manager.h"
+
+namespace rt::vulkan
+{
+/**
+ * @brief Ray reordering for coherent traversal.
+ *
+ * Sorts rays by direction and origin Morton codes into the trace scratch buffer before trace
+ * and moves the hits back to the original ray slots afterwards.
+ **/
+class ReorderRays
+{
+public:
+    /**
+     * @brief Ranges of the scratch buffer used by a reordered trace.
+     **/
+    struct TraceRanges
+    {
+        /** @brief Rays in sorted order. */
+        size_t rays_offset;
+        /** @brief Hits in sorted order. */
+        size_t hits_offset;
+        /** @brief Scratch memory of the trace kernels. */
+        size_t trace_scratch_offset;
+    };
+
+    ReorderRays(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager);
+    ~ReorderRays();
+
+    /**
+     * @brief Sort rays.
+     *
+     * Root bounds of the BVH normalize ray origins. Rays past the indirect ray count are sorted last
+     * and left out, so the sorted rays can be traced with the same indirect ray count.
+     **/
+    void Gather(vk::CommandBuffer command_buffer,
+                vk::Buffer        bvh,
+                size_t            bvh_offset,
+                uint32_t          ray_count,
+                vk::Buffer        ray_count_buffer,
+                size_t            ray_count_buffer_offset,
+                vk::Buffer        rays,
+                size_t            rays_offset,
+                vk::Buffer        scratch,
+                size_t            scratch_offset,
+                size_t            trace_scratch_size);
+
+    /**
+     * @brief Move hits of the sorted rays back to the original ray slots.
+     **/
+    void Scatter(vk::CommandBuffer      command_buffer,
+                 RRIntersectQueryOutput query_output,
+                 uint32_t               ray_count,
+                 vk::Buffer             hits,
+                 size_t                 hits_offset,
+                 vk::Buffer             scratch,
+                 size_t                 scratch_offset,
+                 size_t                 trace_scratch_size);
+
+    /**
+     * @brief Scratch ranges the sorted trace reads rays from and writes hits to.
+     **/
+    TraceRanges GetTraceRanges(uint32_t ray_count, size_t trace_scratch_size, size_t scratch_offset) const;
+
+    /**
+     * @brief Get the amount of scratch memory in bytes required to reorder and trace ray_count rays.
+     *
+     * @param ray_count Number of rays.
+     * @param trace_scratch_size Scratch size of the trace itself.
+     **/
+    size_t GetScratchSize(uint32_t ray_count, size_t trace_scratch_size) const;
+
+private:
+    void AdjustLayout(uint32_t ray_count, size_t trace_scratch_size) const;
+
+    struct ReorderRaysImpl;
+    std::unique_ptr<ReorderRaysImpl> impl_;
+};
+
+}  // namespace rt::vulkan
@@ -0,0 +1,135 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "root_bounds.h"
+
+namespace rt::vulkan
+{
+namespace
+{
+constexpr char const* s_root_bounds_kernel_name = "root_bounds.comp.spv";
+// Min and max corners followed by the generation.
+constexpr size_t kBoundsSize = 7u * sizeof(float);
+}  // namespace
+
+struct RootBounds::RootBoundsImpl
+{
+#pragma pack(push, 1)
+    struct PushConstants
+    {
+        uint32_t g_bounds_index;
+        uint32_t g_generation;
+    };
+#pragma pack(pop)
+
+    std::shared_ptr<GpuHelper> gpu_helper_;
+    ShaderManager const&       shader_manager_;
+    ShaderPtr                  kernel_ = nullptr;
+    std::vector<DescriptorSet> desc_set_;
+    // Keyed by BVH and bounds buffer ranges.
+    DescriptorCacheTable<2, 1, vk::DescriptorBufferInfo> cache_;
+
+    RootBoundsImpl(std::shared_ptr<GpuHelper> helper, ShaderManager const& manager)
+        : gpu_helper_(helper), shader_manager_(manager), cache_(helper)
+    {
+        ShaderManager::KernelID id = s_root_bounds_kernel_name;
+        kernel_                    = shader_manager_.CreateKernel(id);
+        desc_set_                  = shader_manager_.CreateDescriptorSets(kernel_);
+        shader_manager_.PrepareKernel(id, desc_set_);
+    }
+    ~RootBoundsImpl()
+    {
+        for (auto& desc : desc_set_)
+        {
+            gpu_helper_->device.destroyDescriptorSetLayout(desc.layout_);
+        }
+    }
+
+    vk::DescriptorSet GetDescriptor(vk::Buffer bvh, size_t bvh_offset, vk::Buffer bounds, size_t bounds_offset)
+    {
+        std::array<vk::DescriptorBufferInfo, 2> key = {vk::DescriptorBufferInfo{bvh, bvh_offset, VK_WHOLE_SIZE},
+                                                       vk::DescriptorBufferInfo{bounds, bounds_offset, VK_WHOLE_SIZE}};
+        if (cache_.Contains(key))
+        {
+            return cache_.Get(key)[0];
+        }
+
+        vk::DescriptorSet descriptor_set = gpu_helper_->AllocateDescriptorSet(desc_set_[0].layout_);
+        gpu_helper_->WriteDescriptorSet(descriptor_set, key.data(), 2u);
+        cache_.Push(key, {descriptor_set});
+        return descriptor_set;
+    }
+};
+
+RootBounds::RootBounds(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager)
+    : impl_(std::make_unique<RootBoundsImpl>(gpu_helper, shader_manager))
+{
+}
+RootBounds::~RootBounds() = default;
+
+void RootBounds::operator()(vk::CommandBuffer command_buffer,
+                            vk::Buffer        bvh,
+                            size_t            bvh_offset,
+                            vk::Buffer        bounds,
+                            size_t            bounds_offset,
+                            uint32_t          bounds_index,
+                            uint32_t          generation)
+{
+    auto   descriptor_set      = impl_->GetDescriptor(bvh, bvh_offset, bounds, bounds_offset);
+    size_t bounds_write_offset = bounds_offset + sizeof(float) * bounds_index;
+
+    // Root node is written by build kernels or by copies.
+    impl_->gpu_helper_->EncodeBufferBarrier(
+        bvh,
+        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eShaderRead,
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eComputeShader,
+        command_buffer,
+        bvh_offset,
+        sizeof(BvhNode));
+    impl_->gpu_helper_->EncodeBufferBarrier(
+        bounds,
+        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite,
+        vk::AccessFlagBits::eShaderWrite,
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eComputeShader,
+        command_buffer,
+        bounds_write_offset,
+        kBoundsSize);
+
+    RootBoundsImpl::PushConstants push_consts = {bounds_index, generation};
+    impl_->gpu_helper_->EncodePushConstant(
+        impl_->kernel_->pipeline_layout, 0u, sizeof(push_consts), &push_consts, command_buffer);
+    impl_->gpu_helper_->EncodeBindDescriptorSets(
+        &descriptor_set, 1u, 0u, impl_->kernel_->pipeline_layout, command_buffer);
+    impl_->shader_manager_.EncodeDispatch1D(*impl_->kernel_, 1u, command_buffer);
+
+    impl_->gpu_helper_->EncodeBufferBarrier(
+        bounds,
+        vk::AccessFlagBits::eShaderWrite,
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eHostRead,
+        vk::PipelineStageFlagBits::eComputeShader,
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer |
+            vk::PipelineStageFlagBits::eHost,
+        command_buffer,
+        bounds_write_offset,
+        kBoundsSize);
+}
+
+}  // namespace rt::vulkan
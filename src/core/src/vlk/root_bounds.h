@@ -0,0 +1,63 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vlk/common.h"
+#include "vlk/gpu_helper.h"
+#include "vlk/shader_manager.h"
+
+namespace rt::vulkan
+{
+/**
+ * @brief Bounds of a BVH written on GPU.
+ *
+ * Reads the root node of a geometry or scene and writes the union of its child boxes
+ * with a single thread dispatch, so bounds land in buffers without a host readback.
+ **/
+class RootBounds
+{
+public:
+    RootBounds(std::shared_ptr<GpuHelper> gpu_helper, ShaderManager const& shader_manager);
+    ~RootBounds();
+
+    /**
+     * @brief Write bounds of the BVH at bvh_offset as 6 floats, min x, y, z followed by max x, y, z.
+     *
+     * The bounds are written to the float at index bounds_index of the array bound at bounds_offset,
+     * followed by generation as a uint unless it is 0.
+     * Both ranges are expected to be written by compute or transfer commands before.
+     * The bounds are ready for compute, transfer and host reads after the call.
+     **/
+    void operator()(vk::CommandBuffer command_buffer,
+                    vk::Buffer        bvh,
+                    size_t            bvh_offset,
+                    vk::Buffer        bounds,
+                    size_t            bounds_offset,
+                    uint32_t          bounds_index,
+                    uint32_t          generation = 0u);
+
+private:
+    struct RootBoundsImpl;
+    std::unique_ptr<RootBoundsImpl> impl_;
+};
+
+}  // namespace rt::vulkan
@@ -0,0 +1,267 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+
+#include "sah_top_level_builder.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace rt::vulkan
+{
+namespace
+{
+constexpr uint32_t kInvalidAddr = 0xffffffffu;
+constexpr uint32_t kBinCount    = 16u;
+
+// Host mirror of BVHNode from kernels/bvh2.h.
+struct Node
+{
+    float    aabb0_min_or_v0[3];
+    uint32_t child0;
+    float    aabb0_max_or_v1[3];
+    uint32_t child1;
+    float    aabb1_min_or_v2[3];
+    uint32_t parent;
+    float    aabb1_max_or_v3[3];
+    uint32_t update;
+};
+static_assert(sizeof(Node) == 64, "Host node has to match BvhNode");
+
+using Bounds = BuildSahTopLevel::Bounds;
+
+Bounds EmptyBounds()
+{
+    constexpr float kMax = std::numeric_limits<float>::max();
+    return {{kMax, kMax, kMax}, {-kMax, -kMax, -kMax}};
+}
+
+void Grow(Bounds& bounds, Bounds const& other)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bounds.pmin[axis] = std::min(bounds.pmin[axis], other.pmin[axis]);
+        bounds.pmax[axis] = std::max(bounds.pmax[axis], other.pmax[axis]);
+    }
+}
+
+float HalfArea(Bounds const& bounds)
+{
+    float extent[3];
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        extent[axis] = std::max(bounds.pmax[axis] - bounds.pmin[axis], 0.f);
+    }
+    return extent[0] * extent[1] + extent[1] * extent[2] + extent[2] * extent[0];
+}
+
+struct Bin
+{
+    Bounds   bounds = EmptyBounds();
+    uint32_t count  = 0;
+};
+}  // namespace
+
+uint32_t BuildSahTopLevel::Split(uint32_t begin, uint32_t end)
+{
+    uint32_t count = end - begin;
+    uint32_t half  = count / 2;
+
+    // Bin centroids along the axis of the largest centroid extent.
+    float cmin[3] = {std::numeric_limits<float>::max(),
+                     std::numeric_limits<float>::max(),
+                     std::numeric_limits<float>::max()};
+    float cmax[3] = {-std::numeric_limits<float>::max(),
+                     -std::numeric_limits<float>::max(),
+                     -std::numeric_limits<float>::max()};
+    for (auto i = begin; i < end; ++i)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            cmin[axis] = std::min(cmin[axis], centroids_[3 * refs_[i] + axis]);
+            cmax[axis] = std::max(cmax[axis], centroids_[3 * refs_[i] + axis]);
+        }
+    }
+    int axis = 0;
+    for (int a = 1; a < 3; ++a)
+    {
+        if (cmax[a] - cmin[a] > cmax[axis] - cmin[axis])
+        {
+            axis = a;
+        }
+    }
+
+    float extent = cmax[axis] - cmin[axis];
+    if (!(extent > 0.f))
+    {
+        // Coincident centroids, any split is as good as another.
+        return half;
+    }
+
+    float scale  = kBinCount / extent;
+    auto  bin_of = [&](uint32_t ref) {
+        auto bin = uint32_t((centroids_[3 * ref + axis] - cmin[axis]) * scale);
+        return std::min(bin, kBinCount - 1);
+    };
+
+    std::array<Bin, kBinCount> bins;
+    for (auto i = begin; i < end; ++i)
+    {
+        auto& bin = bins[bin_of(refs_[i])];
+        Grow(bin.bounds, bounds_[refs_[i]]);
+        ++bin.count;
+    }
+
+    // Sweep from the right to get the cost of every right side.
+    std::array<float, kBinCount> right_cost;
+    Bounds                       right_bounds = EmptyBounds();
+    uint32_t                     right_count  = 0;
+    for (auto i = kBinCount - 1; i > 0; --i)
+    {
+        Grow(right_bounds, bins[i].bounds);
+        right_count += bins[i].count;
+        right_cost[i] = right_count ? HalfArea(right_bounds) * right_count : 0.f;
+    }
+
+    // Sweep from the left and pick the cheapest split plane.
+    Bounds   left_bounds = EmptyBounds();
+    uint32_t left_count  = 0;
+    uint32_t best_split  = 0;
+    float    best_cost   = std::numeric_limits<float>::max();
+    for (auto i = 0u; i < kBinCount - 1; ++i)
+    {
+        Grow(left_bounds, bins[i].bounds);
+        left_count += bins[i].count;
+        if (left_count == 0 || left_count == count)
+        {
+            continue;
+        }
+        float cost = HalfArea(left_bounds) * left_count + right_cost[i + 1];
+        if (cost < best_cost)
+        {
+            best_cost  = cost;
+            best_split = i + 1;
+        }
+    }
+
+    if (best_split == 0)
+    {
+        return half;
+    }
+
+    auto middle = std::partition(
+        refs_.begin() + begin, refs_.begin() + end, [&](uint32_t ref) { return bin_of(ref) < best_split; });
+    return uint32_t(middle - (refs_.begin() + begin));
+}
+
+bool BuildSahTopLevel::IsValid(Bounds const& bounds)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        // Also rejects NaNs.
+        if (!(bounds.pmin[axis] <= bounds.pmax[axis]) || !std::isfinite(bounds.pmax[axis] - bounds.pmin[axis]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+Bounds BuildSahTopLevel::TransformBounds(Bounds const& bounds, float const (&transform)[3][4])
+{
+    Bounds result = EmptyBounds();
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        float p[3] = {(corner & 1) ? bounds.pmax[0] : bounds.pmin[0],
+                      (corner & 2) ? bounds.pmax[1] : bounds.pmin[1],
+                      (corner & 4) ? bounds.pmax[2] : bounds.pmin[2]};
+        Bounds point;
+        for (int row = 0; row < 3; ++row)
+        {
+            point.pmin[row] = point.pmax[row] =
+                transform[row][0] * p[0] + transform[row][1] * p[1] + transform[row][2] * p[2] + transform[row][3];
+        }
+        Grow(result, point);
+    }
+    return result;
+}
+
+void BuildSahTopLevel::operator()(std::vector<Bounds> const& bounds, void* nodes_data)
+{
+    auto instance_count = uint32_t(bounds.size());
+    auto nodes          = static_cast<Node*>(nodes_data);
+    std::memset(nodes, 0, (2 * instance_count - 1) * sizeof(Node));
+
+    bounds_ = bounds;
+    centroids_.resize(3 * instance_count);
+    refs_.resize(instance_count);
+    for (auto i = 0u; i < instance_count; ++i)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            centroids_[3 * i + axis] = 0.5f * (bounds[i].pmin[axis] + bounds[i].pmax[axis]);
+        }
+        refs_[i] = i;
+    }
+
+    uint32_t next_internal = 0;
+    uint32_t next_leaf     = instance_count - 1;
+
+    // Leaves are numbered in the order they are created, internal nodes follow the build order with the root at 0.
+    auto allocate = [&](uint32_t count) { return count == 1 ? next_leaf++ : next_internal++; };
+
+    struct Task
+    {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t node;
+    };
+    std::vector<Task> stack;
+    stack.push_back({0u, instance_count, allocate(instance_count)});
+    nodes[0].parent = kInvalidAddr;
+
+    while (!stack.empty())
+    {
+        auto task = stack.back();
+        stack.pop_back();
+
+        auto& node = nodes[task.node];
+        if (task.end - task.begin == 1)
+        {
+            node.child0 = kInvalidAddr;
+            node.child1 = refs_[task.begin];
+            continue;
+        }
+
+        auto middle = task.begin + Split(task.begin, task.end);
+        auto left   = allocate(middle - task.begin);
+        auto right  = allocate(task.end - middle);
+
+        node.child0         = left;
+        node.child1         = right;
+        nodes[left].parent  = task.node;
+        nodes[right].parent = task.node;
+
+        stack.push_back({middle, task.end, right});
+        stack.push_back({task.begin, middle, left});
+    }
+}
+}  // namespace rt::vulkan
@@ -0,0 +1,76 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace rt::vulkan
+{
+/**
+ * @brief Host binned SAH builder for scenes.
+ *
+ * Builds the topology of a top level BVH on the host out of instance bounds.
+ * Nodes are laid out the way the GPU builder emits them: instance_count - 1 internal
+ * nodes with the root at 0 followed by instance_count leaves. Node bounds are left
+ * to the scene refit kernel, so the bounds passed in only steer the splits.
+ **/
+class BuildSahTopLevel
+{
+public:
+    /** @brief Scenes up to this instance count are built on the host. */
+    static constexpr uint32_t kMaxInstanceCount = 1024u;
+
+    struct Bounds
+    {
+        float pmin[3];
+        float pmax[3];
+    };
+
+    /**
+     * @brief Build BVH.
+     *
+     * Write 2 * bounds.size() - 1 nodes of kAlignment bytes each to nodes.
+     *
+     * @param bounds World space bounds of instances.
+     * @param nodes Memory to write the nodes to.
+     **/
+    void operator()(std::vector<Bounds> const& bounds, void* nodes);
+
+    /**
+     * @brief Check bounds of a geometry read back from GPU.
+     *
+     * @return False if the bounds are empty or not finite.
+     **/
+    static bool IsValid(Bounds const& bounds);
+
+    /**
+     * @brief Transform bounds by an instance transform.
+     **/
+    static Bounds TransformBounds(Bounds const& bounds, float const (&transform)[3][4]);
+
+private:
+    // Split a range of references, returns the number of references going to the left child.
+    uint32_t Split(uint32_t begin, uint32_t end);
+
+    std::vector<Bounds>   bounds_;
+    std::vector<float>    centroids_;
+    std::vector<uint32_t> refs_;
+};
+}  // namespace rt::vulkan
@@ -34,12 +34,17 @@ enum class ScanType
 struct Parameters
 {
     Parameters() = default;
-    Parameters(uint32_t keys_per_thread, uint32_t group_size, std::string scan_kernel, std::string reduce_kernel)
+    Parameters(uint32_t    keys_per_thread,
+               uint32_t    group_size,
+               std::string scan_kernel,
+               std::string reduce_kernel,
+               std::string lookback_kernel)
         : keys_per_thread_(keys_per_thread),
           group_size_(group_size),
           keys_per_group_(keys_per_thread * group_size),
           scan_kernel_name_(std::move(scan_kernel)),
-          reduce_kernel_name_(std::move(reduce_kernel))
+          reduce_kernel_name_(std::move(reduce_kernel)),
+          lookback_kernel_name_(std::move(lookback_kernel))
     {
     }
     auto     CalculateNumGroups(uint32_t num_keys) { return CeilDivide(num_keys, keys_per_group_); }
@@ -61,17 +66,22 @@ struct Parameters
         }
     }
 
-    uint32_t    keys_per_thread_    = 2u;
-    uint32_t    group_size_         = 256u;
-    uint32_t    keys_per_group_     = 512u;
-    std::string scan_kernel_name_   = "scan_exclusive_add.comp.spv";
-    std::string reduce_kernel_name_ = "scan_exclusive_add_group_reduce.comp.spv";
+    uint32_t    keys_per_thread_      = 2u;
+    uint32_t    group_size_           = 256u;
+    uint32_t    keys_per_group_       = 512u;
+    std::string scan_kernel_name_     = "scan_exclusive_add.comp.spv";
+    std::string reduce_kernel_name_   = "scan_exclusive_add_group_reduce.comp.spv";
+    std::string lookback_kernel_name_ = "scan_exclusive_add_lookback.comp.spv";
 };
 
 struct AmdParameters : public Parameters
 {
     AmdParameters()
-        : Parameters(4u, 256u, "scan_exclusive_add_amd.comp.spv", "scan_exclusive_add_group_reduce_amd.comp.spv")
+        : Parameters(4u,
+                     256u,
+                     "scan_exclusive_add_amd.comp.spv",
+                     "scan_exclusive_add_group_reduce_amd.comp.spv",
+                     "scan_exclusive_add_lookback_amd.comp.spv")
     {
     }
 };
@@ -80,10 +90,10 @@ struct AmdParameters : public Parameters
 
 struct Scan::ScanImpl
 {
-    ScanImpl(std::shared_ptr<GpuHelper> helper, ShaderManager const& manager)
+    ScanImpl(std::shared_ptr<GpuHelper> helper, ShaderManager const& manager, bool decoupled_look_back)
         : gpu_helper_(helper), shader_manager_(manager), cache_(helper)
     {
-        Init();
+        Init(decoupled_look_back);
     }
 
     // vulkan internals
@@ -95,10 +105,13 @@ struct Scan::ScanImpl
     std::vector<DescriptorSet>  reduce_desc_sets_;
     ShaderPtr                   scan_kernel_;
     ShaderPtr                   reduce_kernel_;
+    ShaderPtr                   lookback_kernel_;
     uint32_t                    num_keys_;
     DescriptorCacheTable<3, 5>  cache_;
     std::shared_ptr<Parameters> parameters_;
-    // Scratch space layout.
+    // Single pass scan, tiles wait for their predecessors so it needs forward progress between groups.
+    bool decoupled_look_back_ = false;
+    // Scratch space layout. Look-back scan keeps its tile counter and states in part sums 0.
     enum class ScratchLayout
     {
         kPartSums0,
@@ -108,7 +121,7 @@ struct Scan::ScanImpl
     using ScratchLayoutT                   = MemoryLayout<ScratchLayout, vk::DeviceSize>;
     mutable ScratchLayoutT scratch_layout_ = ScratchLayoutT(kAlignment);
 
-    void Init()
+    void Init(bool decoupled_look_back)
     {
         if (gpu_helper_->IsAmdDevice())
         {
@@ -127,6 +140,14 @@ struct Scan::ScanImpl
         reduce_desc_sets_ = shader_manager_.CreateDescriptorSets(reduce_kernel_);
         shader_manager_.PrepareKernel(parameters_->reduce_kernel_name_, reduce_desc_sets_);
         reduce_desc_sets_.push_back(reduce_desc_sets_[0]);
+
+        // Opt-in only, 30 bit tile sums. AMD and NVIDIA keep started groups running, which is all it needs.
+        decoupled_look_back_ = decoupled_look_back && (gpu_helper_->IsAmdDevice() || gpu_helper_->IsNvDevice());
+        if (decoupled_look_back_)
+        {
+            lookback_kernel_ = shader_manager_.CreateKernel(parameters_->lookback_kernel_name_);
+            shader_manager_.PrepareKernel(parameters_->lookback_kernel_name_, scan_desc_sets_);
+        }
     }
     void AllocateDescriptorSets()
     {
@@ -158,8 +179,8 @@ struct Scan::ScanImpl
     }
 };
 
-Scan::Scan(std::shared_ptr<GpuHelper> helper, ShaderManager const& shader_manager)
-    : impl_(std::make_unique<ScanImpl>(helper, shader_manager))
+Scan::Scan(std::shared_ptr<GpuHelper> helper, ShaderManager const& shader_manager, bool decoupled_look_back)
+    : impl_(std::make_unique<ScanImpl>(helper, shader_manager, decoupled_look_back))
 {
 }
 Scan::~Scan() = default;
@@ -185,6 +206,73 @@ void Scan::operator()(vk::CommandBuffer command_buffer,
     auto part_sums1_offset = impl_->scratch_layout_.offset_of(ScanImpl::ScratchLayout::kPartSums1);
     auto part_sums1_size   = (vk::DeviceSize)impl_->scratch_layout_.size_of(ScanImpl::ScratchLayout::kPartSums1);
 
+    if (impl_->decoupled_look_back_)
+    {
+        // Same bindings as the last level of the multi-pass scan.
+        vk::DescriptorSet lookback_desc_sets[] = {impl_->scan_desc_sets_[0].descriptor_set_};
+
+        // Bind internal and user desc sets.
+        impl_->gpu_helper_->EncodeBindDescriptorSets(lookback_desc_sets,
+                                                     sizeof(lookback_desc_sets) / sizeof(lookback_desc_sets[0]),
+                                                     0u,
+                                                     impl_->lookback_kernel_->pipeline_layout,
+                                                     command_buffer);
+
+        // Reset tile counter and states with a compute pass, scratch may lack transfer usage.
+        impl_->gpu_helper_->EncodeBufferBarrier(scratch_data,
+                                                vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                                                vk::AccessFlagBits::eShaderWrite,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                command_buffer,
+                                                part_sums0_offset,
+                                                part_sums0_size);
+
+        std::uint32_t reset_push_consts[] = {num_keys, 1u};
+
+        impl_->gpu_helper_->EncodePushConstant(impl_->lookback_kernel_->pipeline_layout,
+                                               0u,
+                                               sizeof(reset_push_consts),
+                                               reset_push_consts,
+                                               command_buffer);
+
+        uint32_t num_tiles = impl_->parameters_->CalculateNumGroups(num_keys);
+        impl_->shader_manager_.EncodeDispatch1D(
+            *impl_->lookback_kernel_, CeilDivide(num_tiles + 1u, impl_->parameters_->group_size_), command_buffer);
+
+        impl_->gpu_helper_->EncodeBufferBarrier(scratch_data,
+                                                vk::AccessFlagBits::eShaderWrite,
+                                                vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                command_buffer,
+                                                part_sums0_offset,
+                                                part_sums0_size);
+
+        // Scan input to output in a single pass
+        std::uint32_t lookback_push_consts[] = {num_keys, 0u};
+
+        impl_->gpu_helper_->EncodePushConstant(impl_->lookback_kernel_->pipeline_layout,
+                                               0u,
+                                               sizeof(lookback_push_consts),
+                                               lookback_push_consts,
+                                               command_buffer);
+
+        // Launch the kernel.
+        impl_->shader_manager_.EncodeDispatch1D(*impl_->lookback_kernel_, num_tiles, command_buffer);
+
+        // Output barrier.
+        impl_->gpu_helper_->EncodeBufferBarrier(output_keys,
+                                                vk::AccessFlagBits::eShaderWrite,
+                                                vk::AccessFlagBits::eShaderRead,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                vk::PipelineStageFlagBits::eComputeShader,
+                                                command_buffer,
+                                                output_offset,
+                                                output_size);
+        return;
+    }
+
     if (scan_type != ScanType::kBlock)
     {
         // Reduce to part sum 0
@@ -358,6 +446,13 @@ void Scan::AdjustLayouts(uint32_t num_keys) const
 
     impl_->scratch_layout_.Reset();
     auto size_level_1 = CeilDivide(num_keys, impl_->parameters_->keys_per_group_);
+    if (impl_->decoupled_look_back_)
+    {
+        // Tile counter followed by a state per tile, part sums 1 are never used.
+        impl_->scratch_layout_.AppendBlock<uint32_t>(ScanImpl::ScratchLayout::kPartSums0, size_level_1 + 1);
+        impl_->scratch_layout_.AppendBlock<uint32_t>(ScanImpl::ScratchLayout::kPartSums1, kAlignment);
+        return;
+    }
     impl_->scratch_layout_.AppendBlock<uint32_t>(ScanImpl::ScratchLayout::kPartSums0, size_level_1);
     uint32_t size_level_2 = 0u;
     if (size_level_1 > impl_->parameters_->keys_per_group_)
@@ -34,7 +34,15 @@ namespace rt::vulkan::algorithm
 class Scan
 {
 public:
-    Scan(std::shared_ptr<GpuHelper> helper, ShaderManager const& shader_manager);
+    /**
+     * @brief Constructor.
+     *
+     * @param helper GPU helper.
+     * @param shader_manager Shader manager.
+     * @param decoupled_look_back Use the single pass look-back scan where the device supports it.
+     * Its tile states keep 30 bit sums, so every prefix of the scanned data has to stay below 2^30.
+     **/
+    Scan(std::shared_ptr<GpuHelper> helper, ShaderManager const& shader_manager, bool decoupled_look_back = false);
     ~Scan();
     /**
      * @brief Record prefix sum into a command list.
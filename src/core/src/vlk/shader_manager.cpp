@@ -20,7 +20,10 @@ THE SOFTWARE.
 
 #include <algorithm>
 #include <set>
+#include <string>
 #include <vector>
+
+#include "profiler.h"
 #ifdef RR_EMBEDDED_KERNELS
 #include "compiled_map_spv.h"
 #endif
@@ -218,9 +221,10 @@ vk::DescriptorSetLayout ShaderManager::CreateDescriptorSetLayout(
     int                                     i = 0;
     for (const auto& binding : bindings)
     {
-        if (binding.descriptorCount == 0 && binding.descriptorCount > 1)
+        // Descriptor arrays are only written up to the number of resources actually used.
+        if (binding.descriptorCount > 1)
         {
-            binding_flags[i] = {vk::DescriptorBindingFlagBits::eVariableDescriptorCount};
+            binding_flags[i] = {vk::DescriptorBindingFlagBits::ePartiallyBound};
         }
         i++;
     }
@@ -230,7 +234,7 @@ vk::DescriptorSetLayout ShaderManager::CreateDescriptorSetLayout(
     return device_.createDescriptorSetLayout(create_info);
 }
 
-ShaderManager::ShaderManager(vk::Device device) : device_(device)
+ShaderManager::ShaderManager(vk::Device device, Profiler* profiler) : device_(device), profiler_(profiler)
 {
     empty_descriptor_set_layout_ = device_.createDescriptorSetLayout({{}, 0u, nullptr});
 }
@@ -265,6 +269,7 @@ ShaderPtr ShaderManager::SetupKernel(KernelID const& id) const
     PopulatePushConstants(binding_stage_flags, glsl, *kernel);
 
     kernel->module = device_.createShaderModule({{}, code.size() * sizeof(uint32_t), code.data()});
+    kernel->name   = id.substr(0, id.find('.'));
 
     return kernel;
 }
@@ -282,23 +287,39 @@ bool ShaderManager::GetKernel(KernelID const& id, ShaderPtr& kernel) const
     return false;
 }
 
-ShaderPtr ShaderManager::CreateKernel(KernelID const& id) const
+ShaderManager::KernelID ShaderManager::GetSpecializedID(KernelID const&                   id,
+                                                        std::vector<std::uint32_t> const& specialization_constants)
+{
+    KernelID specialized_id = id;
+    for (auto value : specialization_constants)
+    {
+        specialized_id += "#" + std::to_string(value);
+    }
+    return specialized_id;
+}
+
+ShaderPtr ShaderManager::CreateKernel(KernelID const&                   id,
+                                      std::vector<std::uint32_t> const& specialization_constants) const
 {
     std::unique_lock<std::mutex> lock(kernels_mutex_);
     ShaderPtr                    kernel;
-    if (!GetKernel(id, kernel))
+    KernelID                     specialized_id = GetSpecializedID(id, specialization_constants);
+    if (!GetKernel(specialized_id, kernel))
     {
-        kernel       = SetupKernel(id);
-        kernels_[id] = kernel;
+        kernel                           = SetupKernel(id);
+        kernel->specialization_constants = specialization_constants;
+        kernels_[specialized_id]         = kernel;
     }
 
     return kernel;
 }
 
-void ShaderManager::PrepareKernel(KernelID const& id, std::vector<DescriptorSet> const& descriptor_sets) const
+void ShaderManager::PrepareKernel(KernelID const&                   id,
+                                  std::vector<DescriptorSet> const& descriptor_sets,
+                                  std::vector<std::uint32_t> const& specialization_constants) const
 {
     ShaderPtr kernel;
-    if (!GetKernel(id, kernel))
+    if (!GetKernel(GetSpecializedID(id, specialization_constants), kernel))
     {
         throw std::runtime_error("Kernel is not registered");
     }
@@ -319,8 +340,24 @@ void ShaderManager::PrepareKernel(KernelID const& id, std::vector<DescriptorSet>
                                                             layouts.data(),
                                                             (uint32_t)kernel->push_constant_ranges.size(),
                                                             kernel->push_constant_ranges.data()});
+
+    // Constant i of the shader takes the i-th value.
+    std::vector<vk::SpecializationMapEntry> map_entries;
+    for (uint32_t i = 0; i < (uint32_t)kernel->specialization_constants.size(); ++i)
+    {
+        map_entries.emplace_back(i, i * (uint32_t)sizeof(std::uint32_t), sizeof(std::uint32_t));
+    }
+    vk::SpecializationInfo specialization_info = {(uint32_t)map_entries.size(),
+                                                  map_entries.data(),
+                                                  kernel->specialization_constants.size() * sizeof(std::uint32_t),
+                                                  kernel->specialization_constants.data()};
+
     vk::PipelineCache                 cache         = nullptr;
-    vk::PipelineShaderStageCreateInfo stage_info    = {{}, vk::ShaderStageFlagBits::eCompute, kernel->module, "main"};
+    vk::PipelineShaderStageCreateInfo stage_info    = {{},
+                                                    vk::ShaderStageFlagBits::eCompute,
+                                                    kernel->module,
+                                                    "main",
+                                                    map_entries.empty() ? nullptr : &specialization_info};
     vk::ComputePipelineCreateInfo     pipeline_info = {{}, stage_info, kernel->pipeline_layout};
 
     kernel->pipeline = device_.createComputePipeline(cache, pipeline_info).value;
@@ -344,7 +381,15 @@ void ShaderManager::EncodeDispatch1D(Shader const&      kernel,
                                      vk::CommandBuffer& command_buffer) const
 {
     command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernel.pipeline);
+    if (profiler_)
+    {
+        profiler_->BeginScope(command_buffer, kernel.name);
+    }
     command_buffer.dispatch(num_groups, 1u, 1u);
+    if (profiler_)
+    {
+        profiler_->EndScope(command_buffer);
+    }
 }
 
 void ShaderManager::EncodeDispatch2D(Shader const&        kernel,
@@ -352,7 +397,15 @@ void ShaderManager::EncodeDispatch2D(Shader const&        kernel,
                                      vk::CommandBuffer&   command_buffer) const
 {
     command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernel.pipeline);
+    if (profiler_)
+    {
+        profiler_->BeginScope(command_buffer, kernel.name);
+    }
     command_buffer.dispatch(num_groups[0], num_groups[1], 1u);
+    if (profiler_)
+    {
+        profiler_->EndScope(command_buffer);
+    }
 }
 
 void ShaderManager::EncodeDispatch1DIndirect(Shader const&      kernel,
@@ -361,7 +414,15 @@ void ShaderManager::EncodeDispatch1DIndirect(Shader const&      kernel,
                                              vk::CommandBuffer& command_buffer) const
 {
     command_buffer.bindPipeline(vk::PipelineBindPoint::eCompute, kernel.pipeline);
+    if (profiler_)
+    {
+        profiler_->BeginScope(command_buffer, kernel.name);
+    }
     command_buffer.dispatchIndirect(num_groups, num_groups_offset);
+    if (profiler_)
+    {
+        profiler_->EndScope(command_buffer);
+    }
 }
 
 DescriptorSet ShaderManager::CreateDescriptorSet(ShaderPtr shader, std::uint32_t descriptor_set_id) const
@@ -19,6 +19,7 @@ THE SOFTWARE.
 #pragma once
 #include <fstream>
 #include <mutex>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -32,6 +33,8 @@ THE SOFTWARE.
 
 namespace rt::vulkan
 {
+class Profiler;
+
 struct Shader
 {
     vk::ShaderModule                                         module = nullptr;
@@ -40,6 +43,10 @@ struct Shader
     vk::PipelineLayout                                       pipeline_layout = nullptr;
     vk::Pipeline                                             pipeline        = nullptr;
     bool                                                     set             = false;
+    // Values of specialization constants 0, 1, ... the pipeline is created with.
+    std::vector<std::uint32_t> specialization_constants;
+    // Kernel file name without extensions, names profiling scopes of its dispatches.
+    std::string name;
 };
 
 using ShaderPtr = std::shared_ptr<Shader>;
@@ -99,14 +106,17 @@ class ShaderManager
 public:
     using KernelID = std::string;
 
-    ShaderManager(vk::Device device);
+    /// Dispatches are bracketed by timestamps if a profiler is given.
+    ShaderManager(vk::Device device, Profiler* profiler = nullptr);
     ~ShaderManager();
 
-    /// Initialize kernel with given pipeline layout and cache it
-    ShaderPtr CreateKernel(KernelID const& id) const;
+    /// Initialize kernel with given pipeline layout and cache it, each set of specialization constants is cached apart
+    ShaderPtr CreateKernel(KernelID const& id, std::vector<std::uint32_t> const& specialization_constants = {}) const;
 
     /// Initialize compute pipelines
-    void PrepareKernel(KernelID const& id, std::vector<DescriptorSet> const& descriptor_sets) const;
+    void PrepareKernel(KernelID const&                   id,
+                       std::vector<DescriptorSet> const& descriptor_sets,
+                       std::vector<std::uint32_t> const& specialization_constants = {}) const;
 
     /// Create descriptor set based on shader
     std::vector<DescriptorSet> CreateDescriptorSets(ShaderPtr shader) const;
@@ -138,6 +148,9 @@ private:
     /// Get cached kernel
     bool GetKernel(KernelID const& id, ShaderPtr& kernel) const;
 
+    /// Cache key of a kernel specialized with given constants
+    static KernelID GetSpecializedID(KernelID const& id, std::vector<std::uint32_t> const& specialization_constants);
+
     /// Set kernel with provided layout
     ShaderPtr SetupKernel(KernelID const& id) const;
 
@@ -161,6 +174,8 @@ private:
         const std::vector<vk::DescriptorSetLayoutBinding>& bindings) const;
 
     vk::Device device_;
+    // Optional timestamp profiler.
+    Profiler* profiler_ = nullptr;
     // Cached kernels.
     mutable std::unordered_map<KernelID, ShaderPtr> kernels_;
 
@@ -0,0 +1,160 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#include "upload_ring.h"
+
+#include <algorithm>
+
+#include "utils/logger.h"
+
+namespace rt::vulkan
+{
+namespace
+{
+constexpr uint64_t kInfiniteTime = UINT64_MAX;
+
+vk::DeviceSize AlignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+}  // namespace
+
+UploadRing::UploadRing(std::shared_ptr<GpuHelper> gpu_helper, vk::DeviceSize capacity)
+    : gpu_helper_(gpu_helper),
+      alignment_(std::max<vk::DeviceSize>(gpu_helper->device_properties.limits.minStorageBufferOffsetAlignment, 16u))
+{
+    capacity_ = AlignUp(capacity, alignment_);
+    buffer_   = gpu_helper_->CreateStagingBuffer(capacity_);
+    // Staging memory is host coherent, so it stays mapped for the whole lifetime of the ring.
+    mapped_ = buffer_.Map<uint8_t>();
+}
+
+UploadRing::~UploadRing() { buffer_.Destroy(); }
+
+UploadRange UploadRing::Allocate(vk::DeviceSize size)
+{
+    size = AlignUp(std::max<vk::DeviceSize>(size, 1u), alignment_);
+    if (size > capacity_)
+    {
+        return {};
+    }
+
+    // Cheap path: retire everything the device has already finished with.
+    while (segment_count_ > 0 &&
+           gpu_helper_->device.getFenceStatus(segments_[first_segment_].fence) == vk::Result::eSuccess)
+    {
+        RetireOldest(false);
+    }
+
+    vk::DeviceSize offset = 0;
+    while (!TryAllocate(size, offset))
+    {
+        if (segment_count_ == 0)
+        {
+            // The open segment alone is holding the space, nothing to wait for.
+            return {};
+        }
+        Logger::Get().Debug("UploadRing: waiting for in-flight segment");
+        RetireOldest(true);
+    }
+    return {buffer_.buffer, offset, mapped_ + offset};
+}
+
+bool UploadRing::TryAllocate(vk::DeviceSize size, vk::DeviceSize& offset)
+{
+    if (used_ == 0)
+    {
+        head_ = 0;
+    }
+
+    vk::DeviceSize consumed = 0;
+    if (used_ <= head_)
+    {
+        // Live data is in [head - used, head): free space at the end and at the beginning.
+        if (size <= capacity_ - head_)
+        {
+            offset   = head_;
+            consumed = size;
+        } else if (size <= head_ - used_)
+        {
+            // Skip the tail and wrap around, skipped bytes are retired together with this segment.
+            offset   = 0;
+            consumed = capacity_ - head_ + size;
+        } else
+        {
+            return false;
+        }
+    } else
+    {
+        // Live data wraps around: free space is the gap right after the head.
+        if (size <= capacity_ - used_)
+        {
+            offset   = head_;
+            consumed = size;
+        } else
+        {
+            return false;
+        }
+    }
+
+    head_ = offset + size;
+    used_ += consumed;
+    open_consumed_ += consumed;
+    return true;
+}
+
+void UploadRing::Submit(vk::Fence fence)
+{
+    if (open_consumed_ == 0)
+    {
+        return;
+    }
+    if (segment_count_ == kMaxSegments)
+    {
+        RetireOldest(true);
+    }
+    segments_[(first_segment_ + segment_count_) % kMaxSegments] = {fence, open_consumed_};
+    ++segment_count_;
+    open_consumed_ = 0;
+}
+
+void UploadRing::RetireOldest(bool wait)
+{
+    auto& segment = segments_[first_segment_];
+    if (wait)
+    {
+        auto result = gpu_helper_->device.waitForFences({segment.fence}, VK_TRUE, kInfiniteTime);
+        if (result != vk::Result::eSuccess)
+        {
+            throw std::runtime_error("Waiting for upload ring segment failed.");
+        }
+    }
+    used_ -= segment.consumed;
+    first_segment_ = (first_segment_ + 1) % kMaxSegments;
+    --segment_count_;
+}
+
+void UploadRing::Reset()
+{
+    head_          = 0;
+    used_          = 0;
+    open_consumed_ = 0;
+    first_segment_ = 0;
+    segment_count_ = 0;
+}
+}  // namespace rt::vulkan
@@ -0,0 +1,114 @@
+/**********************************************************************
+Copyright (c) 2020 Advanced Micro Devices, Inc. All rights reserved.
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+********************************************************************/
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "vlk/gpu_helper.h"
+
+namespace rt::vulkan
+{
+/**
+ * @brief Sub-range of an upload ring.
+ *
+ * Host pointer is persistently mapped, buffer / offset pair is what the device binds.
+ **/
+struct UploadRange
+{
+    vk::Buffer     buffer = nullptr;
+    vk::DeviceSize offset = 0;
+    void*          data   = nullptr;
+
+    explicit operator bool() const { return data != nullptr; }
+};
+
+/**
+ * @brief Linear ring allocator for host to device uploads.
+ *
+ * Sub-allocates a single persistently mapped staging buffer. Ranges handed out between two submissions form a
+ * segment which is retired once the fence of that submission has signaled, so in a steady state the ring neither
+ * allocates nor maps / unmaps memory.
+ **/
+class UploadRing
+{
+public:
+    UploadRing(std::shared_ptr<GpuHelper> gpu_helper, vk::DeviceSize capacity);
+    ~UploadRing();
+
+    UploadRing(UploadRing const&) = delete;
+    UploadRing& operator=(UploadRing const&) = delete;
+
+    /**
+     * @brief Allocate a sub-range.
+     *
+     * Retires completed segments and, if there is still not enough space, waits for the oldest in-flight one.
+     *
+     * @param size Size in bytes.
+     * @return Allocated range or an empty range if the request does not fit into the ring at all.
+     **/
+    UploadRange Allocate(vk::DeviceSize size);
+
+    /**
+     * @brief Close the segment recorded so far and track it with a submission fence.
+     *
+     * @param fence Fence signaled on the submission completion.
+     **/
+    void Submit(vk::Fence fence);
+
+    /**
+     * @brief Drop all the segments.
+     *
+     * Caller guarantees that the device does not access the ring anymore.
+     **/
+    void Reset();
+
+    vk::DeviceSize capacity() const { return capacity_; }
+
+private:
+    bool TryAllocate(vk::DeviceSize size, vk::DeviceSize& offset);
+    void RetireOldest(bool wait);
+
+    struct Segment
+    {
+        vk::Fence      fence    = nullptr;
+        vk::DeviceSize consumed = 0;
+    };
+    static constexpr size_t kMaxSegments = 16u;
+
+    std::shared_ptr<GpuHelper> gpu_helper_;
+    AllocatedBuffer            buffer_;
+    uint8_t*                   mapped_    = nullptr;
+    vk::DeviceSize             capacity_  = 0;
+    vk::DeviceSize             alignment_ = 1;
+
+    // Next free byte.
+    vk::DeviceSize head_ = 0;
+    // Bytes owned by in-flight segments and by the open one, including the tail skipped on wrap around.
+    vk::DeviceSize used_ = 0;
+    // Bytes consumed since the last submission.
+    vk::DeviceSize open_consumed_ = 0;
+
+    std::array<Segment, kMaxSegments> segments_;
+    size_t                            first_segment_ = 0;
+    size_t                            segment_count_ = 0;
+};
+}  // namespace rt::vulkan
@@ -23,6 +23,7 @@ THE SOFTWARE.
 #include "base/event_base.h"
 #include "base/intersector_base.h"
 #include "vlk/gpu_helper.h"
+#include "vlk/upload_ring.h"
 
 namespace rt
 {
@@ -31,6 +32,8 @@ class CommandStreamBackend<BackendType::kVulkan> : public CommandStreamBase
 {
 public:
     virtual vulkan::AllocatedBuffer* GetAllocatedTemporaryBuffer(size_t size) = 0;
+    virtual vulkan::UploadRange      AllocateUploadRange(size_t size)         = 0;
+    virtual void                     OnSubmit(vk::Fence fence)                = 0;
     virtual void                     ClearTemporaryBuffers()                  = 0;
     virtual vk::CommandBuffer        Get() const                              = 0;
     virtual void                     Set(vk::CommandBuffer command_buffer)    = 0;
@@ -40,8 +43,11 @@ template <>
 class EventBackend<BackendType::kVulkan> : public EventBase
 {
 public:
-    virtual vk::Fence Get() const      = 0;
-    virtual void      Set(vk::Fence f) = 0;
+    virtual vk::Fence     Get() const                                          = 0;
+    virtual void          Set(vk::Fence f)                                     = 0;
+    virtual vk::Semaphore Semaphore() const                                    = 0;
+    virtual uint64_t      Value() const                                        = 0;
+    virtual void          SetTimeline(vk::Semaphore semaphore, uint64_t value) = 0;
 };
 
 template <>
@@ -62,6 +68,8 @@ public:
     virtual DevicePtrBackend<BackendType::kVulkan>* CreateAllocatedBuffer(size_t size)                          = 0;
     virtual vulkan::AllocatedBuffer*                AcquireTemporaryBuffer(size_t size)                         = 0;
     virtual void                                    ReleaseTemporaryBuffer(vulkan::AllocatedBuffer* tmp_buffer) = 0;
+    virtual vulkan::UploadRing*                     AcquireUploadRing()                                         = 0;
+    virtual void                                    ReleaseUploadRing(vulkan::UploadRing* ring)                 = 0;
 };
 
 }  // namespace rt
\ No newline at end of file
@@ -688,7 +688,13 @@ TEST_F(BasicTest, BuildObjTwoLevelDxCompute)
     RRCommandStream command_stream_2lvl = nullptr;
     RREvent         wait_event_2lvl     = nullptr;
     CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream_2lvl));
-    CHECK_RR_CALL(rrCmdBuildScene(context, &scene_build_input, &options, scratch_ptr, scene_ptr, command_stream_2lvl));
+    CHECK_RR_CALL(rrCmdBuildScene(context,
+                                  RR_BUILD_OPERATION_BUILD,
+                                  &scene_build_input,
+                                  &options,
+                                  scratch_ptr,
+                                  scene_ptr,
+                                  command_stream_2lvl));
 
     CHECK_RR_CALL(rrSumbitCommandStream(context, command_stream_2lvl, nullptr, &wait_event_2lvl));
     CHECK_RR_CALL(rrWaitEvent(context, wait_event_2lvl));
@@ -283,47 +283,52 @@ TEST_F(AlgosTest, ScanTest)
 
     auto          helper = std::make_shared<GpuHelper>(device, phdevice_, queue, queue_family_index_);
     ShaderManager shader_mngr(device);
-    Scan          scan_kernel(helper, shader_mngr);
-
-    auto scratch_size   = scan_kernel.GetScratchDataSize(kKeysCount);
-    auto scratch_buffer = helper->CreateScratchDeviceBuffer(scratch_size);
+    // Multi-pass scan and the single pass look-back the radix sort opts into.
+    for (bool decoupled_look_back : {false, true})
+    {
+        Scan scan_kernel(helper, shader_mngr, decoupled_look_back);
 
-    auto            to_scan           = generate_data(kKeysCount);
-    AllocatedBuffer keys_buffer       = helper->StageToDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, to_scan);
-    auto            buffer_size       = to_scan.size() * sizeof(uint32_t);
-    AllocatedBuffer output_buffer     = helper->CreateScratchDeviceBuffer(buffer_size);
-    AllocatedBuffer output_cpu_buffer = helper->CreateStagingBuffer(buffer_size);
+        auto scratch_size   = scan_kernel.GetScratchDataSize(kKeysCount);
+        auto scratch_buffer = helper->CreateScratchDeviceBuffer(scratch_size);
 
-    helper->WithPrimaryCommandBuffer([&](vk::CommandBuffer scan_cmd_buffer) {
-        scan_kernel(scan_cmd_buffer,
-                    keys_buffer.buffer,
-                    vk::DeviceSize(0u),
-                    vk::DeviceSize(buffer_size),
-                    output_buffer.buffer,
-                    vk::DeviceSize(0u),
-                    vk::DeviceSize(buffer_size),
-                    scratch_buffer.buffer,
-                    vk::DeviceSize(0u),
-                    kKeysCount);
-        scan_cmd_buffer.copyBuffer(
-            output_buffer.buffer, output_cpu_buffer.buffer, vk::BufferCopy(0, 0, vk::DeviceSize(buffer_size)));
-    });
+        auto            to_scan           = generate_data(kKeysCount);
+        AllocatedBuffer keys_buffer =
+            helper->StageToDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, to_scan);
+        auto            buffer_size       = to_scan.size() * sizeof(uint32_t);
+        AllocatedBuffer output_buffer     = helper->CreateScratchDeviceBuffer(buffer_size);
+        AllocatedBuffer output_cpu_buffer = helper->CreateStagingBuffer(buffer_size);
 
-    std::vector<uint32_t> scanned_cpu;
-    scanned_cpu.reserve(kKeysCount);
-    std::exclusive_scan(to_scan.begin(), to_scan.end(), std::back_inserter(scanned_cpu), 0);
-    {
-        uint32_t* mapped_ptr = output_cpu_buffer.Map<uint32_t>();
-        for (const auto scanned_value : scanned_cpu)
+        helper->WithPrimaryCommandBuffer([&](vk::CommandBuffer scan_cmd_buffer) {
+            scan_kernel(scan_cmd_buffer,
+                        keys_buffer.buffer,
+                        vk::DeviceSize(0u),
+                        vk::DeviceSize(buffer_size),
+                        output_buffer.buffer,
+                        vk::DeviceSize(0u),
+                        vk::DeviceSize(buffer_size),
+                        scratch_buffer.buffer,
+                        vk::DeviceSize(0u),
+                        kKeysCount);
+            scan_cmd_buffer.copyBuffer(
+                output_buffer.buffer, output_cpu_buffer.buffer, vk::BufferCopy(0, 0, vk::DeviceSize(buffer_size)));
+        });
+
+        std::vector<uint32_t> scanned_cpu;
+        scanned_cpu.reserve(kKeysCount);
+        std::exclusive_scan(to_scan.begin(), to_scan.end(), std::back_inserter(scanned_cpu), 0);
         {
-            ASSERT_EQ(*(mapped_ptr++), scanned_value);
+            uint32_t* mapped_ptr = output_cpu_buffer.Map<uint32_t>();
+            for (const auto scanned_value : scanned_cpu)
+            {
+                ASSERT_EQ(*(mapped_ptr++), scanned_value);
+            }
+            output_cpu_buffer.Unmap();
         }
-        output_cpu_buffer.Unmap();
+        keys_buffer.Destroy();
+        output_buffer.Destroy();
+        output_cpu_buffer.Destroy();
+        scratch_buffer.Destroy();
     }
-    keys_buffer.Destroy();
-    output_buffer.Destroy();
-    output_cpu_buffer.Destroy();
-    scratch_buffer.Destroy();
 }
 
 TEST_F(AlgosTest, SortTest)
@@ -389,6 +394,74 @@ TEST_F(AlgosTest, SortTest)
     scratch_buffer.Destroy();
 }
 
+TEST_F(AlgosTest, SortKeyBitsTest)
+{
+    using algorithm::RadixSortKeyValue;
+    auto    device = device_.get();
+    VkQueue queue  = nullptr;
+    vkGetDeviceQueue(device_.get(), queue_family_index_, 0, &queue);
+
+    auto              helper = std::make_shared<GpuHelper>(device, phdevice_, queue, queue_family_index_);
+    ShaderManager     shader_mngr(device);
+    RadixSortKeyValue sort_kernel(helper, shader_mngr);
+
+    auto            scratch_size   = sort_kernel.GetScratchDataSize(kKeysCount);
+    AllocatedBuffer scratch_buffer = helper->CreateScratchDeviceBuffer(scratch_size);
+
+    // Generated keys fit in 10 bits, so the sort only needs two 8-bit passes.
+    auto            to_sort     = generate_data(kKeysCount);
+    auto            usage       = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc;
+    AllocatedBuffer keys_buffer = helper->StageToDeviceBuffer(usage, to_sort);
+    AllocatedBuffer vals_buffer = helper->StageToDeviceBuffer(usage, to_sort);
+    auto            buffer_size = to_sort.size() * sizeof(uint32_t);
+    AllocatedBuffer output_keys_cpu_buffer = helper->CreateStagingBuffer(buffer_size);
+    AllocatedBuffer output_vals_cpu_buffer = helper->CreateStagingBuffer(buffer_size);
+    helper->WithPrimaryCommandBuffer([&](vk::CommandBuffer sort_cmd_buffer) {
+        // Sort in place.
+        sort_kernel(sort_cmd_buffer,
+                    keys_buffer.buffer,
+                    vk::DeviceSize(0u),
+                    vk::DeviceSize(buffer_size),
+                    keys_buffer.buffer,
+                    vk::DeviceSize(0u),
+                    vk::DeviceSize(buffer_size),
+                    vals_buffer.buffer,
+                    vk::DeviceSize(0u),
+                    vk::DeviceSize(buffer_size),
+                    vals_buffer.buffer,
+                    vk::DeviceSize(0u),
+                    vk::DeviceSize(buffer_size),
+                    scratch_buffer.buffer,
+                    vk::DeviceSize(0u),
+                    kKeysCount,
+                    10u);
+        sort_cmd_buffer.copyBuffer(
+            keys_buffer.buffer, output_keys_cpu_buffer.buffer, vk::BufferCopy(0, 0, vk::DeviceSize(buffer_size)));
+        sort_cmd_buffer.copyBuffer(
+            vals_buffer.buffer, output_vals_cpu_buffer.buffer, vk::BufferCopy(0, 0, vk::DeviceSize(buffer_size)));
+    });
+
+    std::sort(to_sort.begin(), to_sort.end());
+    {
+        uint32_t* mapped_keys = output_keys_cpu_buffer.Map<uint32_t>();
+        uint32_t* mapped_vals = output_vals_cpu_buffer.Map<uint32_t>();
+        for (size_t i = 0; i < to_sort.size(); ++i)
+        {
+            ASSERT_EQ(mapped_keys[i], to_sort[i]);
+            // Values were equal to keys before sorting.
+            ASSERT_EQ(mapped_vals[i], to_sort[i]);
+        }
+        output_vals_cpu_buffer.Unmap();
+        output_keys_cpu_buffer.Unmap();
+    }
+
+    keys_buffer.Destroy();
+    vals_buffer.Destroy();
+    output_keys_cpu_buffer.Destroy();
+    output_vals_cpu_buffer.Destroy();
+    scratch_buffer.Destroy();
+}
+
 //#define PERFORMANCE_TESTING
 
 #ifdef PERFORMANCE_TESTING
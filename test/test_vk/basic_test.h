@@ -370,6 +370,144 @@ TEST_F(BasicTest, BuildSingleTriangle)
     CHECK_RR_CALL(rrDestroyContext(context));
 }
 
+TEST_F(BasicTest, BuildTriangleBatch)
+{
+    RRContext context = nullptr;
+    VkQueue   queue   = nullptr;
+    vkGetDeviceQueue(device_.get(), queue_family_index_, 0, &queue);
+    CHECK_RR_CALL(rrCreateContextVk(RR_API_VERSION, device_.get(), phdevice_, queue, queue_family_index_, &context));
+    auto local_memory_index = FindDeviceMemoryIndex(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    struct Vertex
+    {
+        float v0, v1, v2;
+    };
+
+    // Meshes of different sizes sharing a vertex buffer.
+    std::vector<Vertex> vertices = {
+        {0.f, 0.f, 0.f}, {1.f, 0.f, 0.f}, {0.f, 1.f, 0.f}, {1.f, 1.f, 0.f}, {0.f, 0.f, 1.f}, {1.f, 0.f, 1.f}};
+    std::vector<std::vector<uint32_t>> mesh_indices = {
+        {0, 1, 2}, {0, 1, 2, 1, 3, 2, 4, 5, 0, 5, 1, 0}, {0, 1, 2, 1, 3, 2, 2, 3, 4}};
+    auto const mesh_count = (uint32_t)mesh_indices.size();
+
+    auto vertex_buffer = CreateBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                      vertices.size() * sizeof(Vertex));
+    VkMemoryRequirements vertex_buffer_mem_reqs;
+    vkGetBufferMemoryRequirements(device_.get(), vertex_buffer.get(), &vertex_buffer_mem_reqs);
+    auto vertex_buffer_memory = AllocateDeviceMemory(local_memory_index, vertex_buffer_mem_reqs.size);
+    vkBindBufferMemory(device_.get(), vertex_buffer.get(), vertex_buffer_memory.get(), 0u);
+    UploadMemory(vertices, vertex_buffer.get());
+
+    RRDevicePtr vertex_ptr = nullptr;
+    CHECK_RR_CALL(rrGetDevicePtrFromVkBuffer(context, vertex_buffer.get(), 0, &vertex_ptr));
+
+    std::vector<VkScopedObject<VkBuffer>>       index_buffers;
+    std::vector<VkScopedObject<VkDeviceMemory>> index_memories;
+    std::vector<RRTriangleMeshPrimitive>        meshes(mesh_count);
+    std::vector<RRGeometryBuildInput>           build_inputs(mesh_count);
+    for (uint32_t i = 0; i < mesh_count; ++i)
+    {
+        auto index_buffer = CreateBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                         mesh_indices[i].size() * sizeof(uint32_t));
+        VkMemoryRequirements index_buffer_mem_reqs;
+        vkGetBufferMemoryRequirements(device_.get(), index_buffer.get(), &index_buffer_mem_reqs);
+        auto index_buffer_memory = AllocateDeviceMemory(local_memory_index, index_buffer_mem_reqs.size);
+        vkBindBufferMemory(device_.get(), index_buffer.get(), index_buffer_memory.get(), 0u);
+        UploadMemory(mesh_indices[i], index_buffer.get());
+
+        RRDevicePtr index_ptr = nullptr;
+        CHECK_RR_CALL(rrGetDevicePtrFromVkBuffer(context, index_buffer.get(), 0, &index_ptr));
+
+        meshes[i].vertices                       = vertex_ptr;
+        meshes[i].vertex_count                   = (uint32_t)vertices.size();
+        meshes[i].vertex_stride                  = sizeof(Vertex);
+        meshes[i].triangle_indices               = index_ptr;
+        meshes[i].triangle_count                 = (uint32_t)mesh_indices[i].size() / 3;
+        meshes[i].index_type                     = RR_INDEX_TYPE_UINT32;
+        build_inputs[i].primitive_type           = RR_PRIMITIVE_TYPE_TRIANGLE_MESH;
+        build_inputs[i].primitive_count          = 1;
+        build_inputs[i].triangle_mesh_primitives = &meshes[i];
+
+        index_buffers.push_back(index_buffer);
+        index_memories.push_back(index_buffer_memory);
+    }
+
+    RRBuildOptions options;
+    options.build_flags = RR_BUILD_FLAG_BITS_PREFER_FAST_BUILD;
+
+    RRMemoryRequirements batch_reqs;
+    CHECK_RR_CALL(
+        rrGetGeometriesBuildMemoryRequirements(context, mesh_count, build_inputs.data(), &options, &batch_reqs));
+
+    auto scratch_memory = AllocateDeviceMemory(local_memory_index, batch_reqs.temporary_build_buffer_size);
+    auto scratch        = CreateBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, batch_reqs.temporary_build_buffer_size);
+    vkBindBufferMemory(device_.get(), scratch.get(), scratch_memory.get(), 0u);
+    RRDevicePtr scratch_ptr = nullptr;
+    CHECK_RR_CALL(rrGetDevicePtrFromVkBuffer(context, scratch.get(), 0, &scratch_ptr));
+
+    // Every geometry goes to its own buffer sized by the single geometry requirements.
+    std::vector<VkScopedObject<VkBuffer>>       geometries;
+    std::vector<VkScopedObject<VkDeviceMemory>> geometry_memories;
+    std::vector<RRDevicePtr>                    geometry_ptrs(mesh_count);
+    size_t                                      total_result_size = 0;
+    for (uint32_t i = 0; i < mesh_count; ++i)
+    {
+        RRMemoryRequirements geometry_reqs;
+        CHECK_RR_CALL(rrGetGeometryBuildMemoryRequirements(context, &build_inputs[i], &options, &geometry_reqs));
+        total_result_size += geometry_reqs.result_buffer_size;
+
+        auto geometry = CreateBuffer(VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                     geometry_reqs.result_buffer_size);
+        VkMemoryRequirements geometry_mem_reqs;
+        vkGetBufferMemoryRequirements(device_.get(), geometry.get(), &geometry_mem_reqs);
+        auto geometry_memory = AllocateDeviceMemory(local_memory_index, geometry_mem_reqs.size);
+        vkBindBufferMemory(device_.get(), geometry.get(), geometry_memory.get(), 0u);
+        CHECK_RR_CALL(rrGetDevicePtrFromVkBuffer(context, geometry.get(), 0, &geometry_ptrs[i]));
+
+        geometries.push_back(geometry);
+        geometry_memories.push_back(geometry_memory);
+    }
+    ASSERT_EQ(batch_reqs.result_buffer_size, total_result_size);
+
+    RRCommandStream command_stream = nullptr;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+
+    // build
+    CHECK_RR_CALL(rrCmdBuildGeometries(
+        context, mesh_count, build_inputs.data(), &options, scratch_ptr, geometry_ptrs.data(), command_stream));
+
+    RREvent wait_event = nullptr;
+    CHECK_RR_CALL(rrSumbitCommandStream(context, command_stream, nullptr, &wait_event));
+    CHECK_RR_CALL(rrWaitEvent(context, wait_event));
+    CHECK_RR_CALL(rrReleaseEvent(context, wait_event));
+    CHECK_RR_CALL(rrReleaseCommandStream(context, command_stream));
+
+    // Each BVH keeps its own primitive ids: leafs of a mesh reference all its triangles exactly once.
+    constexpr uint32_t kNodeSizeInUints = 16u;
+    constexpr uint32_t kChild0          = 3u;
+    constexpr uint32_t kChild1          = 7u;
+    constexpr uint32_t kParent          = 11u;
+    for (uint32_t i = 0; i < mesh_count; ++i)
+    {
+        auto                  triangle_count = meshes[i].triangle_count;
+        std::vector<uint32_t> bvh((2 * triangle_count - 1) * kNodeSizeInUints);
+        DownloadMemory(bvh, geometries[i].get());
+
+        EXPECT_EQ(bvh[kParent], ~0u);
+        std::vector<bool> referenced(triangle_count, false);
+        for (uint32_t leaf = triangle_count - 1; leaf < 2 * triangle_count - 1; ++leaf)
+        {
+            EXPECT_EQ(bvh[leaf * kNodeSizeInUints + kChild0], ~0u);
+            auto prim_id = bvh[leaf * kNodeSizeInUints + kChild1];
+            ASSERT_LT(prim_id, triangle_count);
+            EXPECT_FALSE(referenced[prim_id]);
+            referenced[prim_id] = true;
+        }
+    }
+
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
 TEST_F(BasicTest, BuildObj)
 {
 #ifdef USE_RENDERDOC
@@ -891,8 +1029,13 @@ TEST_F(BasicTest, BuildObj2Level)
     RRCommandStream command_stream_2lvl = nullptr;
     RREvent         wait_event_2lvl     = nullptr;
     CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream_2lvl));
-    CHECK_RR_CALL(
-        rrCmdBuildScene(context, &scene_build_input, &options, scratch_scene_ptr, scene_ptr, command_stream_2lvl));
+    CHECK_RR_CALL(rrCmdBuildScene(context,
+                                  RR_BUILD_OPERATION_BUILD,
+                                  &scene_build_input,
+                                  &options,
+                                  scratch_scene_ptr,
+                                  scene_ptr,
+                                  command_stream_2lvl));
 
     CHECK_RR_CALL(rrSumbitCommandStream(context, command_stream_2lvl, nullptr, &wait_event_2lvl));
     CHECK_RR_CALL(rrWaitEvent(context, wait_event_2lvl));
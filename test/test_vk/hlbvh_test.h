@@ -15,6 +15,7 @@
 #include "vlk/gpu_helper.h"
 #include "vlk/hlbvh_builder.h"
 #include "vlk/restructure_hlbvh.h"
+#include "vlk/sah_top_level_builder.h"
 #include "vlk/shader_manager.h"
 #include "vlk/update_hlbvh.h"
 #include "vulkan/vulkan.hpp"
@@ -501,3 +502,251 @@ TEST_F(HlbvhTest, UpdateTest)
     result_buffer.Destroy();
     result_staging_buffer.Destroy();
 }
+
+TEST(SahTopLevelTest, BuildTest)
+{
+    // Two clusters of instances far apart, the root split has to separate them.
+    constexpr uint32_t kClusterSize   = 37u;
+    constexpr uint32_t kInstanceCount = 2u * kClusterSize;
+
+    std::mt19937                          gen(42);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+
+    std::vector<BuildSahTopLevel::Bounds> bounds(kInstanceCount);
+    for (auto i = 0u; i < kInstanceCount; ++i)
+    {
+        float shift = i < kClusterSize ? -100.f : 100.f;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            bounds[i].pmin[axis] = dist(gen) + (axis == 0 ? shift : 0.f);
+            bounds[i].pmax[axis] = bounds[i].pmin[axis] + dist(gen);
+        }
+    }
+
+    std::vector<bvh_utils::VkBvhNode> nodes(2 * kInstanceCount - 1);
+    BuildSahTopLevel                  builder;
+    builder(bounds, nodes.data());
+
+    ASSERT_EQ(nodes[0].parent, bvh_utils::kInvalidID);
+
+    // Check topology and collect the instances referenced by every subtree of the root.
+    std::vector<uint32_t> visits(kInstanceCount, 0u);
+    for (auto child = 0u; child < 2u; ++child)
+    {
+        auto root_child = child == 0u ? nodes[0].child0 : nodes[0].child1;
+
+        std::queue<uint32_t> q;
+        q.push(root_child);
+        while (!q.empty())
+        {
+            auto  addr = q.front();
+            auto& node = nodes[addr];
+            q.pop();
+
+            if (node.child0 == bvh_utils::kInvalidID)
+            {
+                ASSERT_GE(addr, kInstanceCount - 1);
+                ASSERT_LT(node.child1, kInstanceCount);
+                ASSERT_EQ(node.child1 < kClusterSize, child == 0u);
+                ++visits[node.child1];
+                continue;
+            }
+
+            ASSERT_LT(addr, kInstanceCount - 1);
+            ASSERT_EQ(nodes[node.child0].parent, addr);
+            ASSERT_EQ(nodes[node.child1].parent, addr);
+            q.push(node.child0);
+            q.push(node.child1);
+        }
+    }
+
+    for (auto count : visits)
+    {
+        ASSERT_EQ(count, 1u);
+    }
+}
+
+TEST_F(HlbvhTest, WideMortonCodesTest)
+{
+    // A dense cluster of quads next to one far triangle: the cluster fits in a single cell of the 10-bit per axis
+    // grid, so all of its 30-bit Morton codes collide and only the 63-bit codes tell its triangles apart.
+    constexpr uint32_t kGridSize    = 64u;
+    constexpr float    kClusterSize = 0.5f;
+    constexpr float    kCellSize    = kClusterSize / kGridSize;
+
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    for (auto y = 0u; y <= kGridSize; ++y)
+    {
+        for (auto z = 0u; z <= kGridSize; ++z)
+        {
+            vertices.insert(vertices.end(), {0.f, kCellSize * y, kCellSize * z});
+        }
+    }
+    for (auto y = 0u; y < kGridSize; ++y)
+    {
+        for (auto z = 0u; z < kGridSize; ++z)
+        {
+            uint32_t v = y * (kGridSize + 1) + z;
+            indices.insert(indices.end(), {v, v + 1, v + kGridSize + 1, v + kGridSize + 1, v + 1, v + kGridSize + 2});
+        }
+    }
+    auto far_vertex = uint32_t(vertices.size() / 3);
+    vertices.insert(vertices.end(), {1000.f, 1000.f, 1000.f, 1000.f, 1001.f, 1000.f, 1000.f, 1000.f, 1001.f});
+    indices.insert(indices.end(), {far_vertex, far_vertex + 1, far_vertex + 2});
+
+    auto    device = device_.get();
+    VkQueue queue  = nullptr;
+    vkGetDeviceQueue(device_.get(), queue_family_index_, 0, &queue);
+
+    // Every mesh takes the wide path: two sorts around the gather kernel and the wide emit kernel.
+    auto          helper = std::make_shared<GpuHelper>(device, phdevice_, queue, queue_family_index_);
+    ShaderManager shader_mngr(device);
+    BuildHlBvh    mesh_builder(helper, shader_mngr, 0u);
+    auto vertex_buffer = helper->StageToDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, vertices);
+    auto index_buffer  = helper->StageToDeviceBuffer(vk::BufferUsageFlagBits::eStorageBuffer, indices);
+
+    uint32_t triangle_count = uint32_t(indices.size() / 3);
+    uint32_t vertex_count   = uint32_t(vertices.size() / 3);
+
+    auto scratch_size   = mesh_builder.GetScratchDataSize(triangle_count);
+    auto scratch_buffer = helper->CreateScratchDeviceBuffer(scratch_size);
+    auto result_size    = mesh_builder.GetResultDataSize(triangle_count);
+    auto result_buffer =
+        helper->CreateBuffer(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferSrc,
+                             vk::MemoryPropertyFlagBits::eDeviceLocal,
+                             result_size);
+    auto result_staging_buffer = helper->CreateStagingBuffer(result_size);
+
+    helper->WithPrimaryCommandBuffer([&](vk::CommandBuffer build_cmd_buffer) {
+        mesh_builder(build_cmd_buffer,
+                     vertex_buffer.buffer,
+                     0u,
+                     3 * sizeof(float),
+                     vertex_count,
+                     index_buffer.buffer,
+                     0u,
+                     triangle_count,
+                     scratch_buffer.buffer,
+                     0u,
+                     result_buffer.buffer,
+                     0u);
+        build_cmd_buffer.copyBuffer(
+            result_buffer.buffer, result_staging_buffer.buffer, vk::BufferCopy(0, 0, result_size));
+    });
+
+    std::vector<bvh_utils::VkBvhNode> nodes(2 * triangle_count - 1);
+    {
+        bvh_utils::VkBvhNode* mapped_ptr = (bvh_utils::VkBvhNode*)result_staging_buffer.Map();
+        std::copy(mapped_ptr, mapped_ptr + nodes.size(), nodes.begin());
+        result_staging_buffer.Unmap();
+    }
+    ASSERT_TRUE(CheckConstistency(nodes.data()));
+
+    // Every triangle lands in exactly one leaf.
+    std::vector<uint32_t> visits(triangle_count, 0u);
+    for (auto i = triangle_count - 1; i < nodes.size(); ++i)
+    {
+        ASSERT_EQ(nodes[i].child0, bvh_utils::kInvalidID);
+        ASSERT_LT(nodes[i].child1, triangle_count);
+        ++visits[nodes[i].child1];
+    }
+    for (auto count : visits)
+    {
+        ASSERT_EQ(count, 1u);
+    }
+
+    // Distance to the triangle along the ray, or FLT_MAX on a miss.
+    auto intersect_triangle =
+        [](float3 const& o, float3 const& d, float3 const& v0, float3 const& v1, float3 const& v2) {
+            auto e1  = v1 - v0;
+            auto e2  = v2 - v0;
+            auto p   = cross(d, e2);
+            auto det = dot(e1, p);
+            if (std::abs(det) < 1e-12f)
+            {
+                return FLT_MAX;
+            }
+            auto s = o - v0;
+            auto u = dot(s, p) / det;
+            auto q = cross(s, e1);
+            auto v = dot(d, q) / det;
+            auto t = dot(e2, q) / det;
+            return (u < 0.f || v < 0.f || u + v > 1.f || t < 0.f) ? FLT_MAX : t;
+        };
+    auto intersect_aabb = [](float3 const& o, float3 const& invd, float3 const& pmin, float3 const& pmax) {
+        auto t0 = (pmin - o) * invd;
+        auto t1 = (pmax - o) * invd;
+        auto tn = vmin(t0, t1);
+        auto tf = vmax(t0, t1);
+        return std::max(std::max(tn.x, tn.y), std::max(tn.z, 0.f)) <= std::min(std::min(tf.x, tf.y), tf.z);
+    };
+    auto vertex = [&vertices, &indices](uint32_t triangle, uint32_t i) {
+        auto v = indices[3 * triangle + i];
+        return float3{vertices[3 * v + 0], vertices[3 * v + 1], vertices[3 * v + 2]};
+    };
+
+    // Rays through every cell of the cluster hit the same triangle in the BVH as in the triangle list.
+    for (auto y = 0u; y < kGridSize; ++y)
+    {
+        for (auto z = 0u; z < kGridSize; ++z)
+        {
+            float3 o{1.f, kCellSize * (y + 0.3f), kCellSize * (z + 0.6f)};
+            float3 d{-1.f, 0.f, 0.f};
+            auto   invd = rcp(d);
+
+            auto expected_t = FLT_MAX, t = FLT_MAX;
+            auto expected_prim = bvh_utils::kInvalidID, prim = bvh_utils::kInvalidID;
+            for (auto i = 0u; i < triangle_count; ++i)
+            {
+                auto hit_t = intersect_triangle(o, d, vertex(i, 0), vertex(i, 1), vertex(i, 2));
+                if (hit_t < expected_t)
+                {
+                    expected_t    = hit_t;
+                    expected_prim = i;
+                }
+            }
+
+            std::stack<uint32_t> traversal_stack;
+            traversal_stack.push(0u);
+            while (!traversal_stack.empty())
+            {
+                auto const& node = nodes[traversal_stack.top()];
+                traversal_stack.pop();
+
+                auto v0 = float3{node.aabb0_min_or_v0[0], node.aabb0_min_or_v0[1], node.aabb0_min_or_v0[2]};
+                auto v1 = float3{node.aabb0_max_or_v1[0], node.aabb0_max_or_v1[1], node.aabb0_max_or_v1[2]};
+                auto v2 = float3{node.aabb1_min_or_v2[0], node.aabb1_min_or_v2[1], node.aabb1_min_or_v2[2]};
+                auto v3 = float3{node.aabb1_max_or_v3[0], node.aabb1_max_or_v3[1], node.aabb1_max_or_v3[2]};
+                if (node.child0 == bvh_utils::kInvalidID)
+                {
+                    auto hit_t = intersect_triangle(o, d, v0, v1, v2);
+                    if (hit_t < t)
+                    {
+                        t    = hit_t;
+                        prim = node.child1;
+                    }
+                    continue;
+                }
+                if (intersect_aabb(o, invd, v0, v1))
+                {
+                    traversal_stack.push(node.child0);
+                }
+                if (intersect_aabb(o, invd, v2, v3))
+                {
+                    traversal_stack.push(node.child1);
+                }
+            }
+
+            ASSERT_NE(expected_prim, bvh_utils::kInvalidID);
+            EXPECT_EQ(prim, expected_prim);
+            EXPECT_EQ(t, expected_t);
+        }
+    }
+
+    index_buffer.Destroy();
+    vertex_buffer.Destroy();
+    scratch_buffer.Destroy();
+    result_buffer.Destroy();
+    result_staging_buffer.Destroy();
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <iostream>
 #include <stack>
 
@@ -23,7 +25,6 @@
 using namespace std::chrono;
 template <typename T>
 using VkScopedObject = std::shared_ptr<std::remove_pointer_t<T>>;
-
 class InternalResourcesTest : public ::testing::Test
 {
 public:
@@ -31,6 +32,95 @@ public:
 
     void TearDown() override {}
 
+protected:
+    // Triangle mesh with float3 positions and 32-bit indices in device buffers.
+    struct Mesh
+    {
+        RRDevicePtr             vertices  = nullptr;
+        RRDevicePtr             indices   = nullptr;
+        RRTriangleMeshPrimitive primitive = {};
+    };
+
+    // Quad of the given half size in the x = -5 plane, facing +x.
+    static void MakeQuad(float half_size, std::vector<float>& vertices, std::vector<uint32_t>& indices);
+    // Grid of grid_size x grid_size unit quads in the x = -5 plane centered on the x axis.
+    static void MakeGrid(uint32_t grid_size, std::vector<float>& vertices, std::vector<uint32_t>& indices);
+    // Instance of the geometry translated along z.
+    static RRInstance MakeInstance(RRDevicePtr geometry, float z, RRRayMask mask = ~0u);
+
+    // Allocate a device buffer holding a copy of data.
+    void Upload(RRContext context, void const* data, size_t size, RRDevicePtr* device_ptr);
+    template <typename T>
+    void Upload(RRContext context, std::vector<T> const& data, RRDevicePtr* device_ptr)
+    {
+        Upload(context, data.data(), data.size() * sizeof(T), device_ptr);
+    }
+    // Copy the first data.size() elements of a device buffer.
+    template <typename T>
+    void Download(RRContext context, RRDevicePtr device_ptr, std::vector<T>& data)
+    {
+        void* ptr = nullptr;
+        CHECK_RR_CALL(rrMapDevicePtr(context, device_ptr, &ptr));
+        std::memcpy(data.data(), ptr, data.size() * sizeof(T));
+        CHECK_RR_CALL(rrUnmapDevicePtr(context, device_ptr, &ptr));
+    }
+    // Submit a command stream, wait for its completion and release it.
+    void Submit(RRContext context, RRCommandStream command_stream);
+
+    void UploadMesh(RRContext                    context,
+                    std::vector<float> const&    vertices,
+                    std::vector<uint32_t> const& indices,
+                    Mesh&                        mesh);
+    void ReleaseMesh(RRContext context, Mesh& mesh);
+
+    // Build or update an acceleration structure and wait for it, the result buffer is allocated on build.
+    void BuildGeometry(RRContext                   context,
+                       RRBuildOperation            operation,
+                       RRGeometryBuildInput const& build_input,
+                       RRBuildOptions const&       options,
+                       RRDevicePtr*                geometry_ptr);
+    void BuildMesh(RRContext context, Mesh& mesh, RRBuildOptions const& options, RRDevicePtr* geometry_ptr);
+    void BuildScene(RRContext                context,
+                    RRBuildOperation         operation,
+                    RRSceneBuildInput const& build_input,
+                    RRBuildOptions const&    options,
+                    RRDevicePtr*             scene_ptr);
+
+    // Trace the rays and read back hits.size() elements of the output, the output buffer starts as a copy of hits.
+    template <typename T>
+    void Intersect(RRContext                 context,
+                   RRDevicePtr               acceleration_structure,
+                   RRIntersectQuery          query,
+                   RRIntersectQueryOutput    query_output,
+                   std::vector<RRRay> const& rays,
+                   std::vector<T>&           hits,
+                   RRDevicePtr               ray_count_ptr = nullptr)
+    {
+        RRDevicePtr rays_ptr = nullptr, hits_ptr = nullptr;
+        Upload(context, rays, &rays_ptr);
+        Upload(context, hits, &hits_ptr);
+        IntersectBuffers(context,
+                         acceleration_structure,
+                         query,
+                         query_output,
+                         rays_ptr,
+                         (uint32_t)rays.size(),
+                         ray_count_ptr,
+                         hits_ptr);
+        Download(context, hits_ptr, hits);
+        CHECK_RR_CALL(rrReleaseDevicePtr(context, hits_ptr));
+        CHECK_RR_CALL(rrReleaseDevicePtr(context, rays_ptr));
+    }
+    // Trace rays already on the device with a scratch buffer sized for the query.
+    void IntersectBuffers(RRContext              context,
+                          RRDevicePtr            acceleration_structure,
+                          RRIntersectQuery       query,
+                          RRIntersectQueryOutput query_output,
+                          RRDevicePtr            rays_ptr,
+                          uint32_t               ray_count,
+                          RRDevicePtr            ray_count_ptr,
+                          RRDevicePtr            hits_ptr);
+
 #ifdef USE_RENDERDOC
     RENDERDOC_API_1_4_0* rdoc_api_ = NULL;
 #endif
@@ -48,6 +138,182 @@ void InternalResourcesTest::SetUp()
     }
 #endif
 }
+
+void InternalResourcesTest::MakeQuad(float half_size, std::vector<float>& vertices, std::vector<uint32_t>& indices)
+{
+    float s  = half_size;
+    vertices = {-5.f, -s, -s, -5.f, -s, s, -5.f, s, -s, -5.f, s, s};
+    indices  = {0, 1, 2, 2, 1, 3};
+}
+
+void InternalResourcesTest::MakeGrid(uint32_t grid_size, std::vector<float>& vertices, std::vector<uint32_t>& indices)
+{
+    float half_size = 0.5f * grid_size;
+    vertices.clear();
+    indices.clear();
+    for (uint32_t y = 0; y <= grid_size; ++y)
+    {
+        for (uint32_t z = 0; z <= grid_size; ++z)
+        {
+            vertices.insert(vertices.end(), {-5.f, float(y) - half_size, float(z) - half_size});
+        }
+    }
+    for (uint32_t y = 0; y < grid_size; ++y)
+    {
+        for (uint32_t z = 0; z < grid_size; ++z)
+        {
+            uint32_t v = y * (grid_size + 1) + z;
+            indices.insert(indices.end(), {v, v + 1, v + grid_size + 1, v + grid_size + 1, v + 1, v + grid_size + 2});
+        }
+    }
+}
+
+RRInstance InternalResourcesTest::MakeInstance(RRDevicePtr geometry, float z, RRRayMask mask)
+{
+    RRInstance instance = {};
+    instance.transform[0][0] = instance.transform[1][1] = instance.transform[2][2] = 1.f;
+    instance.transform[2][3]                                                       = z;
+    instance.geometry                                                              = geometry;
+    instance.mask                                                                  = mask;
+    return instance;
+}
+
+void InternalResourcesTest::Upload(RRContext context, void const* data, size_t size, RRDevicePtr* device_ptr)
+{
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, size, device_ptr));
+    void* ptr = nullptr;
+    CHECK_RR_CALL(rrMapDevicePtr(context, *device_ptr, &ptr));
+    std::memcpy(ptr, data, size);
+    CHECK_RR_CALL(rrUnmapDevicePtr(context, *device_ptr, &ptr));
+}
+
+void InternalResourcesTest::Submit(RRContext context, RRCommandStream command_stream)
+{
+    RREvent wait_event = nullptr;
+    CHECK_RR_CALL(rrSumbitCommandStream(context, command_stream, nullptr, &wait_event));
+    CHECK_RR_CALL(rrWaitEvent(context, wait_event));
+    CHECK_RR_CALL(rrReleaseEvent(context, wait_event));
+    CHECK_RR_CALL(rrReleaseCommandStream(context, command_stream));
+}
+
+void InternalResourcesTest::UploadMesh(RRContext                    context,
+                                       std::vector<float> const&    vertices,
+                                       std::vector<uint32_t> const& indices,
+                                       Mesh&                        mesh)
+{
+    Upload(context, vertices, &mesh.vertices);
+    Upload(context, indices, &mesh.indices);
+
+    mesh.primitive                  = {};
+    mesh.primitive.vertices         = mesh.vertices;
+    mesh.primitive.vertex_count     = (uint32_t)vertices.size() / 3;
+    mesh.primitive.vertex_stride    = 3 * sizeof(float);
+    mesh.primitive.triangle_indices = mesh.indices;
+    mesh.primitive.triangle_count   = (uint32_t)indices.size() / 3;
+    mesh.primitive.index_type       = RR_INDEX_TYPE_UINT32;
+}
+
+void InternalResourcesTest::ReleaseMesh(RRContext context, Mesh& mesh)
+{
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, mesh.indices));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, mesh.vertices));
+}
+
+void InternalResourcesTest::BuildGeometry(RRContext                   context,
+                                          RRBuildOperation            operation,
+                                          RRGeometryBuildInput const& build_input,
+                                          RRBuildOptions const&       options,
+                                          RRDevicePtr*                geometry_ptr)
+{
+    RRMemoryRequirements geometry_reqs;
+    CHECK_RR_CALL(rrGetGeometryBuildMemoryRequirements(context, &build_input, &options, &geometry_reqs));
+
+    RRDevicePtr scratch_ptr = nullptr;
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, geometry_reqs.temporary_build_buffer_size, &scratch_ptr));
+    if (operation == RR_BUILD_OPERATION_BUILD)
+    {
+        CHECK_RR_CALL(rrAllocateDeviceBuffer(context, geometry_reqs.result_buffer_size, geometry_ptr));
+    }
+
+    RRCommandStream command_stream = nullptr;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+    CHECK_RR_CALL(
+        rrCmdBuildGeometry(context, operation, &build_input, &options, scratch_ptr, *geometry_ptr, command_stream));
+    Submit(context, command_stream);
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scratch_ptr));
+}
+
+void InternalResourcesTest::BuildMesh(RRContext             context,
+                                      Mesh&                 mesh,
+                                      RRBuildOptions const& options,
+                                      RRDevicePtr*          geometry_ptr)
+{
+    RRGeometryBuildInput geometry_build_input     = {};
+    geometry_build_input.primitive_type           = RR_PRIMITIVE_TYPE_TRIANGLE_MESH;
+    geometry_build_input.primitive_count          = 1u;
+    geometry_build_input.triangle_mesh_primitives = &mesh.primitive;
+    BuildGeometry(context, RR_BUILD_OPERATION_BUILD, geometry_build_input, options, geometry_ptr);
+}
+
+void InternalResourcesTest::BuildScene(RRContext                context,
+                                       RRBuildOperation         operation,
+                                       RRSceneBuildInput const& build_input,
+                                       RRBuildOptions const&    options,
+                                       RRDevicePtr*             scene_ptr)
+{
+    RRMemoryRequirements scene_reqs;
+    CHECK_RR_CALL(rrGetSceneBuildMemoryRequirements(context, &build_input, &options, &scene_reqs));
+
+    RRDevicePtr scratch_ptr = nullptr;
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, scene_reqs.temporary_build_buffer_size, &scratch_ptr));
+    if (operation == RR_BUILD_OPERATION_BUILD)
+    {
+        CHECK_RR_CALL(rrAllocateDeviceBuffer(context, scene_reqs.result_buffer_size, scene_ptr));
+    }
+
+    RRCommandStream command_stream = nullptr;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+    CHECK_RR_CALL(rrCmdBuildScene(context, operation, &build_input, &options, scratch_ptr, *scene_ptr, command_stream));
+    Submit(context, command_stream);
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scratch_ptr));
+}
+
+void InternalResourcesTest::IntersectBuffers(RRContext              context,
+                                             RRDevicePtr            acceleration_structure,
+                                             RRIntersectQuery       query,
+                                             RRIntersectQueryOutput query_output,
+                                             RRDevicePtr            rays_ptr,
+                                             uint32_t               ray_count,
+                                             RRDevicePtr            ray_count_ptr,
+                                             RRDevicePtr            hits_ptr)
+{
+    size_t scratch_trace_size = 0;
+    if (query & RR_INTERSECT_QUERY_FLAG_BITS_REORDER_RAYS)
+    {
+        CHECK_RR_CALL(rrGetReorderedTraceMemoryRequirements(context, ray_count, &scratch_trace_size));
+    } else
+    {
+        CHECK_RR_CALL(rrGetTraceMemoryRequirements(context, ray_count, &scratch_trace_size));
+    }
+    RRDevicePtr scratch_trace_ptr = nullptr;
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, scratch_trace_size, &scratch_trace_ptr));
+
+    RRCommandStream command_stream = nullptr;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+    CHECK_RR_CALL(rrCmdIntersect(context,
+                                 acceleration_structure,
+                                 query,
+                                 rays_ptr,
+                                 ray_count,
+                                 ray_count_ptr,
+                                 query_output,
+                                 hits_ptr,
+                                 scratch_trace_ptr,
+                                 command_stream));
+    Submit(context, command_stream);
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scratch_trace_ptr));
+}
+
 TEST_F(InternalResourcesTest, CreateContext)
 {
     RRContext context = nullptr;
@@ -234,3 +500,1174 @@ TEST_F(InternalResourcesTest, BuildObj)
     CHECK_RR_CALL(rrReleaseDevicePtr(context, vertex_ptr));
     CHECK_RR_CALL(rrDestroyContext(context));
 }
+
+TEST_F(InternalResourcesTest, BuildMultiMesh)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // Two quads facing +x with different vertex layouts: mesh 0 below y = 0, mesh 1 above.
+    std::vector<float> vertices0 = {-5.f, -2.f, -1.f, -5.f, -2.f, 1.f, -5.f, -0.5f, -1.f, -5.f, -0.5f, 1.f};
+    std::vector<float> vertices1 = {
+        -5.f, 0.5f, -1.f, 0.f, -5.f, 0.5f, 1.f, 0.f, -5.f, 2.f, -1.f, 0.f, -5.f, 2.f, 1.f, 0.f};
+    std::vector<uint32_t> indices = {0, 1, 2, 2, 1, 3};
+
+    RRDevicePtr vertex_ptrs[2] = {nullptr, nullptr};
+    RRDevicePtr index_ptr      = nullptr;
+    Upload(context, vertices0, &vertex_ptrs[0]);
+    Upload(context, vertices1, &vertex_ptrs[1]);
+    Upload(context, indices, &index_ptr);
+
+    RRTriangleMeshPrimitive meshes[2] = {};
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        meshes[i].vertices         = vertex_ptrs[i];
+        meshes[i].vertex_count     = 4u;
+        meshes[i].vertex_stride    = (i == 0 ? 3 : 4) * sizeof(float);
+        meshes[i].triangle_indices = index_ptr;
+        meshes[i].triangle_count   = (uint32_t)indices.size() / 3;
+        meshes[i].index_type       = RR_INDEX_TYPE_UINT32;
+    }
+
+    RRGeometryBuildInput geometry_build_input     = {};
+    geometry_build_input.primitive_type           = RR_PRIMITIVE_TYPE_TRIANGLE_MESH;
+    geometry_build_input.primitive_count          = 2u;
+    geometry_build_input.triangle_mesh_primitives = meshes;
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    // One ray towards each quad.
+    std::vector<RRRay> rays = {{{0.f, -1.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f},
+                               {{0.f, 1.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f}};
+    std::vector<RRHit> hits(rays.size());
+
+    // Hits report the mesh and the triangle within the mesh.
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildGeometry(context, RR_BUILD_OPERATION_BUILD, geometry_build_input, options, &geometry_ptr);
+    Intersect(context, geometry_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, hits);
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        EXPECT_NE(hits[i].inst_id, ~0u);
+        EXPECT_EQ(hits[i].geom_id, i);
+        EXPECT_LT(hits[i].prim_id, meshes[i].triangle_count);
+    }
+
+    // Move mesh 1 out of the way of its ray and refit.
+    for (size_t i = 0; i < vertices1.size(); i += 4)
+    {
+        vertices1[i + 2] += 10.f;
+    }
+    void* ptr = nullptr;
+    CHECK_RR_CALL(rrMapDevicePtr(context, vertex_ptrs[1], &ptr));
+    std::memcpy(ptr, vertices1.data(), vertices1.size() * sizeof(float));
+    CHECK_RR_CALL(rrUnmapDevicePtr(context, vertex_ptrs[1], &ptr));
+
+    BuildGeometry(context, RR_BUILD_OPERATION_UPDATE, geometry_build_input, options, &geometry_ptr);
+    Intersect(context, geometry_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, hits);
+    EXPECT_EQ(hits[0].geom_id, 0u);
+    EXPECT_EQ(hits[1].inst_id, ~0u);
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, index_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, vertex_ptrs[1]));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, vertex_ptrs[0]));
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, BuildAabbList)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // Three unit boxes along -x and one off the axis, as (min, unused), (max, unused) pairs.
+    std::vector<float> aabbs = {-3.f, -.5f, -.5f, 0.f, -2.f, .5f, .5f, 0.f,
+                                -6.f, -.5f, -.5f, 0.f, -5.f, .5f, .5f, 0.f,
+                                -9.f, -.5f, -.5f, 0.f, -8.f, .5f, .5f, 0.f,
+                                -3.f, 4.5f, -.5f, 0.f, -2.f, 5.5f, .5f, 0.f};
+
+    RRDevicePtr aabbs_ptr = nullptr;
+    Upload(context, aabbs, &aabbs_ptr);
+
+    RRAABBListPrimitive aabb_list = {};
+    aabb_list.aabbs               = aabbs_ptr;
+    aabb_list.aabb_count          = 4u;
+    aabb_list.aabb_stride         = 8 * sizeof(float);
+
+    RRGeometryBuildInput geometry_build_input = {};
+    geometry_build_input.primitive_type       = RR_PRIMITIVE_TYPE_AABB_LIST;
+    geometry_build_input.primitive_count      = 1u;
+    geometry_build_input.aabb_primitives      = &aabb_list;
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildGeometry(context, RR_BUILD_OPERATION_BUILD, geometry_build_input, options, &geometry_ptr);
+
+    // One ray through the boxes on the axis, one away from all of them.
+    std::vector<RRRay> rays = {{{0.f, 0.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f},
+                               {{0.f, 0.f, 0.f}, 0.001f, {1.f, 0.f, 0.f}, 100.f}};
+
+    std::vector<RRCandidateHit> hits(rays.size() * RR_MAX_CANDIDATE_HITS);
+    Intersect(context, geometry_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_CANDIDATES, rays, hits);
+
+    // Boxes on the axis come sorted by entry distance, the rest of the entries are unused.
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        EXPECT_EQ(hits[i].inst_id, 0u);
+        EXPECT_EQ(hits[i].prim_id, i);
+        EXPECT_NEAR(hits[i].t_entry, 2.f + 3.f * i, 1e-4f);
+        EXPECT_NEAR(hits[i].t_exit, 3.f + 3.f * i, 1e-4f);
+    }
+    EXPECT_EQ(hits[3].inst_id, ~0u);
+    for (uint32_t i = 0; i < RR_MAX_CANDIDATE_HITS; ++i)
+    {
+        EXPECT_EQ(hits[RR_MAX_CANDIDATE_HITS + i].inst_id, ~0u);
+    }
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, aabbs_ptr));
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, BuildManyInstances)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // A single quad facing +x, instanced along z more times than there are geometry descriptor slots.
+    constexpr uint32_t    kInstanceCount = 4096u;
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeQuad(1.f, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildMesh(context, mesh, options, &geometry_ptr);
+
+    std::vector<RRInstance> instances;
+    for (uint32_t i = 0; i < kInstanceCount; ++i)
+    {
+        // The last instance leaves its mask zero, which keeps it visible to all rays.
+        instances.push_back(MakeInstance(geometry_ptr, 4.f * i, i + 1 < kInstanceCount ? 1u << (i % 2) : 0u));
+    }
+
+    RRSceneBuildInput scene_build_input = {};
+    scene_build_input.instances         = instances.data();
+    scene_build_input.instance_count    = kInstanceCount;
+
+    RRDevicePtr scene_ptr = nullptr;
+    BuildScene(context, RR_BUILD_OPERATION_BUILD, scene_build_input, options, &scene_ptr);
+
+    // One ray towards the first instance, one towards the last, one between two instances,
+    // one towards the first instance masking it out and one towards the second without a mask.
+    std::vector<RRRay> rays = {{{0.f, 0.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{0.f, 0.f, 4.f * (kInstanceCount - 1)}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, 1u},
+                               {{0.f, 0.f, 2.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{0.f, 0.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, 2u},
+                               {{0.f, 0.f, 4.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, 0u}};
+
+    std::vector<RRHit> hits(rays.size());
+    Intersect(context, scene_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, hits);
+
+    EXPECT_EQ(hits[0].inst_id, 0u);
+    EXPECT_EQ(hits[1].inst_id, kInstanceCount - 1);
+    EXPECT_EQ(hits[2].inst_id, ~0u);
+    EXPECT_EQ(hits[3].inst_id, ~0u);
+    EXPECT_EQ(hits[4].inst_id, 1u);
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scene_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, HostSceneBuild)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeQuad(1.f, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRBuildOptions options;
+    options.build_flags = RR_BUILD_FLAG_BITS_HOST_SCENE_BUILD;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildMesh(context, mesh, options, &geometry_ptr);
+
+    std::vector<RRInstance> instances = {
+        MakeInstance(geometry_ptr, 0.f), MakeInstance(geometry_ptr, 4.f), MakeInstance(geometry_ptr, 8.f)};
+
+    RRSceneBuildInput scene_build_input = {};
+    scene_build_input.instances         = instances.data();
+    scene_build_input.instance_count    = uint32_t(instances.size());
+
+    // The geometry build has completed, so the scene is built on the host.
+    RRDevicePtr scene_ptr = nullptr;
+    BuildScene(context, RR_BUILD_OPERATION_BUILD, scene_build_input, options, &scene_ptr);
+
+    std::vector<RRRay> rays = {{{0.f, 0.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{0.f, 0.f, 8.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{0.f, 0.f, 6.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u}};
+
+    std::vector<RRHit> hits(rays.size());
+    Intersect(context, scene_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, hits);
+
+    EXPECT_EQ(hits[0].inst_id, 0u);
+    EXPECT_EQ(hits[1].inst_id, 2u);
+    EXPECT_EQ(hits[2].inst_id, ~0u);
+
+    // Rebuilt without the flag, the geometry bounds are unknown and host scene builds are rejected.
+    RRBuildOptions gpu_options;
+    gpu_options.build_flags = 0u;
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    BuildMesh(context, mesh, gpu_options, &geometry_ptr);
+    for (auto& instance : instances)
+    {
+        instance.geometry = geometry_ptr;
+    }
+
+    RRMemoryRequirements scene_reqs;
+    CHECK_RR_CALL(rrGetSceneBuildMemoryRequirements(context, &scene_build_input, &options, &scene_reqs));
+    RRDevicePtr scratch_ptr = nullptr;
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, scene_reqs.temporary_build_buffer_size, &scratch_ptr));
+
+    RRCommandStream command_stream = nullptr;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+    EXPECT_NE(
+        rrCmdBuildScene(
+            context, RR_BUILD_OPERATION_BUILD, &scene_build_input, &options, scratch_ptr, scene_ptr, command_stream),
+        RR_SUCCESS);
+    CHECK_RR_CALL(rrReleaseCommandStream(context, command_stream));
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scratch_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scene_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, RayFlags)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // A quad facing +x, rays travelling along -x see its back faces.
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeQuad(1.f, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildMesh(context, mesh, options, &geometry_ptr);
+
+    RRRayFlags flags[] = {RR_RAY_FLAG_BITS_NONE,
+                          RR_RAY_FLAG_BITS_CULL_BACK_FACING_TRIANGLES,
+                          RR_RAY_FLAG_BITS_CULL_FRONT_FACING_TRIANGLES,
+                          RR_RAY_FLAG_BITS_SKIP_TRIANGLES,
+                          RR_RAY_FLAG_BITS_ACCEPT_FIRST_HIT_AND_END_SEARCH};
+
+    bool expect_hit[] = {true, false, true, false, true};
+
+    std::vector<RRRay> rays;
+    for (auto ray_flags : flags)
+    {
+        rays.push_back({{0.f, 0.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u, ray_flags});
+    }
+
+    std::vector<RRHit> hits(rays.size());
+    Intersect(context, geometry_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, hits);
+
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        EXPECT_EQ(hits[i].inst_id != ~0u, expect_hit[i]) << "ray flags " << flags[i];
+    }
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, OcclusionBit)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // A quad facing +x, every third ray goes through it.
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeQuad(1.f, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildMesh(context, mesh, options, &geometry_ptr);
+
+    constexpr uint32_t kRayCount  = 70u;
+    constexpr uint32_t kWordCount = (kRayCount + 31) / 32;
+    std::vector<RRRay> rays;
+    for (uint32_t i = 0; i < kRayCount; ++i)
+    {
+        rays.push_back({{0.f, i % 3 == 0 ? 0.f : 5.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u});
+    }
+
+    std::vector<uint32_t> words(kWordCount);
+    Intersect(context, geometry_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT, rays, words);
+
+    for (uint32_t i = 0; i < kRayCount; ++i)
+    {
+        bool occluded = (words[i / 32] >> (i % 32)) & 1u;
+        EXPECT_EQ(occluded, i % 3 == 0) << "ray " << i;
+    }
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, HitDistanceAndNormal)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // A quad in the x = -5 plane, its vertices are counter-clockwise seen from -x.
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeQuad(1.f, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildMesh(context, mesh, options, &geometry_ptr);
+
+    // t is measured in units of the ray direction length.
+    std::vector<RRRay> rays = {{{0.f, 0.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{2.f, 0.5f, 0.f}, 0.001f, {-2.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{0.f, 5.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u}};
+    float              expected_t[] = {5.f, 3.5f};
+
+    std::vector<RRHitWithNormal> hits(rays.size());
+    Intersect(context,
+              geometry_ptr,
+              RR_INTERSECT_QUERY_CLOSEST,
+              RR_INTERSECT_QUERY_OUTPUT_FULL_HIT_WITH_NORMAL,
+              rays,
+              hits);
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        ASSERT_NE(hits[i].inst_id, ~0u) << "ray " << i;
+        EXPECT_NEAR(hits[i].t, expected_t[i], 1e-4f) << "ray " << i;
+        EXPECT_NEAR(hits[i].normal[0], -1.f, 1e-4f) << "ray " << i;
+        EXPECT_NEAR(hits[i].normal[1], 0.f, 1e-4f) << "ray " << i;
+        EXPECT_NEAR(hits[i].normal[2], 0.f, 1e-4f) << "ray " << i;
+    }
+    EXPECT_EQ(hits[2].inst_id, ~0u);
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, CopyGeometry)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeQuad(1.f, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRGeometryBuildInput geometry_build_input     = {};
+    geometry_build_input.primitive_type           = RR_PRIMITIVE_TYPE_TRIANGLE_MESH;
+    geometry_build_input.primitive_count          = 1u;
+    geometry_build_input.triangle_mesh_primitives = &mesh.primitive;
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRMemoryRequirements geometry_reqs;
+    CHECK_RR_CALL(rrGetGeometryBuildMemoryRequirements(context, &geometry_build_input, &options, &geometry_reqs));
+
+    // Build into an oversized buffer, as a pooled allocation would.
+    RRDevicePtr scratch_ptr  = nullptr;
+    RRDevicePtr geometry_ptr = nullptr;
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, geometry_reqs.temporary_build_buffer_size, &scratch_ptr));
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, 4 * geometry_reqs.result_buffer_size, &geometry_ptr));
+
+    RRCommandStream command_stream = nullptr;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+    CHECK_RR_CALL(rrCmdBuildGeometry(context,
+                                     RR_BUILD_OPERATION_BUILD,
+                                     &geometry_build_input,
+                                     &options,
+                                     scratch_ptr,
+                                     geometry_ptr,
+                                     command_stream));
+
+    size_t compacted_size = 0;
+    CHECK_RR_CALL(rrGetGeometryCompactedSize(context, geometry_ptr, &compacted_size));
+    EXPECT_EQ(compacted_size, 3 * 64u);
+    EXPECT_LE(compacted_size, geometry_reqs.result_buffer_size);
+
+    RRDevicePtr compacted_ptr = nullptr;
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, compacted_size, &compacted_ptr));
+    CHECK_RR_CALL(rrCmdCopyGeometry(context, geometry_ptr, compacted_ptr, command_stream));
+    Submit(context, command_stream);
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+
+    size_t copy_size = 0;
+    CHECK_RR_CALL(rrGetGeometryCompactedSize(context, compacted_ptr, &copy_size));
+    EXPECT_EQ(copy_size, compacted_size);
+
+    std::vector<RRRay> rays = {{{0.f, 0.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{0.f, 5.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u}};
+
+    std::vector<RRHit> hits(rays.size());
+    Intersect(context, compacted_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, hits);
+
+    ASSERT_NE(hits[0].inst_id, ~0u);
+    EXPECT_NEAR(hits[0].t, 5.f, 1e-4f);
+    EXPECT_EQ(hits[1].inst_id, ~0u);
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scratch_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, compacted_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, SerializeScene)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    auto serialize = [&](RRDevicePtr acceleration_structure, bool scene, std::vector<char>& blob) {
+        size_t serialized_size = 0;
+        CHECK_RR_CALL(rrGetSerializedSize(context, acceleration_structure, &serialized_size));
+        RRDevicePtr serialized_ptr = nullptr;
+        CHECK_RR_CALL(rrAllocateDeviceBuffer(context, serialized_size, &serialized_ptr));
+
+        RRCommandStream command_stream = nullptr;
+        CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+        if (scene)
+        {
+            CHECK_RR_CALL(rrCmdSerializeScene(context, acceleration_structure, serialized_ptr, command_stream));
+        } else
+        {
+            CHECK_RR_CALL(rrCmdSerializeGeometry(context, acceleration_structure, serialized_ptr, command_stream));
+        }
+        Submit(context, command_stream);
+
+        blob.resize(serialized_size);
+        Download(context, serialized_ptr, blob);
+        CHECK_RR_CALL(rrReleaseDevicePtr(context, serialized_ptr));
+    };
+
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeQuad(1.f, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildMesh(context, mesh, options, &geometry_ptr);
+
+    std::vector<RRInstance> instances = {MakeInstance(geometry_ptr, 0.f), MakeInstance(geometry_ptr, 4.f)};
+
+    RRSceneBuildInput scene_build_input = {};
+    scene_build_input.instances         = instances.data();
+    scene_build_input.instance_count    = 2u;
+
+    RRDevicePtr scene_ptr = nullptr;
+    BuildScene(context, RR_BUILD_OPERATION_BUILD, scene_build_input, options, &scene_ptr);
+
+    std::vector<char> geometry_blob, scene_blob;
+    serialize(geometry_ptr, false, geometry_blob);
+    serialize(scene_ptr, true, scene_blob);
+
+    RRSerializedHeader header;
+    std::memcpy(&header, geometry_blob.data(), sizeof(header));
+    EXPECT_EQ(header.magic, RR_SERIALIZED_MAGIC);
+    EXPECT_EQ(header.version, RR_SERIALIZED_VERSION);
+    EXPECT_EQ(header.type, RR_SERIALIZED_TYPE_GEOMETRY);
+    EXPECT_EQ(header.node_count, 3u);
+    EXPECT_EQ(sizeof(header) + header.data_size, geometry_blob.size());
+    // Bounds of the quad in geometry space.
+    std::vector<float> bounds(header.bounds_min, header.bounds_min + 3);
+    bounds.insert(bounds.end(), header.bounds_max, header.bounds_max + 3);
+    std::vector<float> expected_bounds = {-5.f, -1.f, -1.f, -5.f, 1.f, 1.f};
+    for (auto i = 0u; i < 6u; ++i)
+    {
+        EXPECT_NEAR(bounds[i], expected_bounds[i], 1e-3f);
+    }
+    std::memcpy(&header, scene_blob.data(), sizeof(header));
+    EXPECT_EQ(header.type, RR_SERIALIZED_TYPE_SCENE);
+    EXPECT_EQ(header.instance_count, 2u);
+    // The scene spans both instances.
+    bounds.assign(header.bounds_min, header.bounds_min + 3);
+    bounds.insert(bounds.end(), header.bounds_max, header.bounds_max + 3);
+    expected_bounds = {-5.f, -1.f, -1.f, -5.f, 1.f, 5.f};
+    for (auto i = 0u; i < 6u; ++i)
+    {
+        EXPECT_NEAR(bounds[i], expected_bounds[i], 1e-3f);
+    }
+
+    // Restore both from the blobs into fresh buffers.
+    RRGeometryBuildInput geometry_build_input     = {};
+    geometry_build_input.primitive_type           = RR_PRIMITIVE_TYPE_TRIANGLE_MESH;
+    geometry_build_input.primitive_count          = 1u;
+    geometry_build_input.triangle_mesh_primitives = &mesh.primitive;
+
+    RRMemoryRequirements geometry_reqs, scene_reqs;
+    CHECK_RR_CALL(rrGetGeometryBuildMemoryRequirements(context, &geometry_build_input, &options, &geometry_reqs));
+    CHECK_RR_CALL(rrGetSceneBuildMemoryRequirements(context, &scene_build_input, &options, &scene_reqs));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scene_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, geometry_reqs.result_buffer_size, &geometry_ptr));
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, scene_reqs.result_buffer_size, &scene_ptr));
+
+    std::vector<RRDevicePtr> geometries(2, geometry_ptr);
+    RRCommandStream          command_stream = nullptr;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+    CHECK_RR_CALL(rrCmdDeserializeGeometry(
+        context, geometry_blob.data(), geometry_blob.size(), geometry_ptr, command_stream));
+    CHECK_RR_CALL(rrCmdDeserializeScene(
+        context, scene_blob.data(), scene_blob.size(), 2u, geometries.data(), scene_ptr, command_stream));
+    Submit(context, command_stream);
+
+    // A scene blob is rejected as a geometry, and so is a truncated blob.
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+    EXPECT_NE(rrCmdDeserializeGeometry(context, scene_blob.data(), scene_blob.size(), geometry_ptr, command_stream),
+              RR_SUCCESS);
+    EXPECT_NE(rrCmdDeserializeGeometry(
+                  context, geometry_blob.data(), geometry_blob.size() - 1, geometry_ptr, command_stream),
+              RR_SUCCESS);
+    EXPECT_NE(rrCmdDeserializeGeometry(context, geometry_blob.data(), 16u, geometry_ptr, command_stream), RR_SUCCESS);
+    CHECK_RR_CALL(rrReleaseCommandStream(context, command_stream));
+
+    std::vector<RRRay> rays = {{{0.f, 0.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{0.f, 0.f, 4.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{0.f, 0.f, 2.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u}};
+
+    std::vector<RRHit> hits(rays.size());
+    Intersect(context, scene_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, hits);
+
+    EXPECT_EQ(hits[0].inst_id, 0u);
+    EXPECT_EQ(hits[1].inst_id, 1u);
+    EXPECT_EQ(hits[2].inst_id, ~0u);
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scene_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, UpdateScene)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeQuad(1.f, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRBuildOptions options;
+    options.build_flags = RR_BUILD_FLAG_BITS_ALLOW_UPDATE;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildMesh(context, mesh, options, &geometry_ptr);
+
+    std::vector<RRInstance> instances = {MakeInstance(geometry_ptr, 0.f), MakeInstance(geometry_ptr, 4.f)};
+
+    RRSceneBuildInput scene_build_input = {};
+    scene_build_input.instances         = instances.data();
+    scene_build_input.instance_count    = 2u;
+
+    RRMemoryRequirements scene_reqs;
+    CHECK_RR_CALL(rrGetSceneBuildMemoryRequirements(context, &scene_build_input, &options, &scene_reqs));
+    EXPECT_EQ(scene_reqs.temporary_update_buffer_size, 0u);
+
+    RRDevicePtr scene_ptr = nullptr;
+    BuildScene(context, RR_BUILD_OPERATION_BUILD, scene_build_input, options, &scene_ptr);
+
+    // Move the second instance, the refit has to follow it without a scratch buffer.
+    instances[1].transform[2][3]   = 8.f;
+    RRCommandStream command_stream = nullptr;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+    CHECK_RR_CALL(rrCmdBuildScene(
+        context, RR_BUILD_OPERATION_UPDATE, &scene_build_input, &options, nullptr, scene_ptr, command_stream));
+    Submit(context, command_stream);
+
+    // Updates can't change the instance count.
+    scene_build_input.instance_count = 1u;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &command_stream));
+    EXPECT_NE(rrCmdBuildScene(
+                  context, RR_BUILD_OPERATION_UPDATE, &scene_build_input, &options, nullptr, scene_ptr, command_stream),
+              RR_SUCCESS);
+    CHECK_RR_CALL(rrReleaseCommandStream(context, command_stream));
+
+    std::vector<RRRay> rays = {{{0.f, 0.f, 0.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{0.f, 0.f, 4.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u},
+                               {{0.f, 0.f, 8.f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u}};
+
+    std::vector<RRHit> hits(rays.size());
+    Intersect(context, scene_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, hits);
+
+    EXPECT_EQ(hits[0].inst_id, 0u);
+    EXPECT_EQ(hits[1].inst_id, ~0u);
+    EXPECT_EQ(hits[2].inst_id, 1u);
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scene_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, WideBvh)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // Grid of quads facing -x, enough triangles for several levels of wide nodes.
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeGrid(8u, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRGeometryBuildInput geometry_build_input     = {};
+    geometry_build_input.primitive_type           = RR_PRIMITIVE_TYPE_TRIANGLE_MESH;
+    geometry_build_input.primitive_count          = 1u;
+    geometry_build_input.triangle_mesh_primitives = &mesh.primitive;
+
+    // The same mesh with a binary and with a wide BVH.
+    RRBuildOptions options[2];
+    options[0].build_flags = 0u;
+    options[1].build_flags = RR_BUILD_FLAG_BITS_WIDE_BVH;
+
+    RRDevicePtr geometry_ptrs[2];
+    size_t      result_sizes[2];
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        RRMemoryRequirements geometry_reqs;
+        CHECK_RR_CALL(
+            rrGetGeometryBuildMemoryRequirements(context, &geometry_build_input, &options[i], &geometry_reqs));
+        result_sizes[i] = geometry_reqs.result_buffer_size;
+        BuildGeometry(context, RR_BUILD_OPERATION_BUILD, geometry_build_input, options[i], &geometry_ptrs[i]);
+    }
+    EXPECT_GT(result_sizes[1], result_sizes[0]);
+
+    // Wide nodes follow the binary ones.
+    size_t compacted_size = 0;
+    CHECK_RR_CALL(rrGetGeometryCompactedSize(context, geometry_ptrs[1], &compacted_size));
+    EXPECT_EQ(compacted_size, (4 * mesh.primitive.triangle_count - 2) * 64u);
+
+    // Rays through the grid, some of them miss it.
+    std::vector<RRRay> rays;
+    for (uint32_t y = 0; y < 16; ++y)
+    {
+        for (uint32_t z = 0; z < 16; ++z)
+        {
+            rays.push_back({{0.f, 0.61f * y - 4.7f, 0.59f * z - 4.6f}, 0.001f, {-1.f, 0.f, 0.f}, 100.f, ~0u});
+        }
+    }
+
+    std::vector<RRHit> binary_hits(rays.size()), wide_hits(rays.size()), scene_hits(rays.size());
+    Intersect(
+        context, geometry_ptrs[0], RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, binary_hits);
+    Intersect(
+        context, geometry_ptrs[1], RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, wide_hits);
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        EXPECT_EQ(wide_hits[i].inst_id, binary_hits[i].inst_id);
+        EXPECT_EQ(wide_hits[i].prim_id, binary_hits[i].prim_id);
+        if (binary_hits[i].inst_id != ~0u)
+        {
+            EXPECT_NEAR(wide_hits[i].t, 5.f, 1e-4f);
+        }
+    }
+
+    // A scene over wide geometries traverses them with the wide kernel.
+    std::vector<RRInstance> instances = {MakeInstance(geometry_ptrs[1], 0.f), MakeInstance(geometry_ptrs[1], 20.f)};
+
+    RRSceneBuildInput scene_build_input = {};
+    scene_build_input.instances         = instances.data();
+    scene_build_input.instance_count    = 2u;
+
+    RRDevicePtr scene_ptr = nullptr;
+    BuildScene(context, RR_BUILD_OPERATION_BUILD, scene_build_input, options[0], &scene_ptr);
+
+    Intersect(context, scene_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, scene_hits);
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        EXPECT_EQ(scene_hits[i].prim_id, binary_hits[i].prim_id);
+        EXPECT_EQ(scene_hits[i].inst_id, binary_hits[i].inst_id == ~0u ? ~0u : 0u);
+    }
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scene_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptrs[0]));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptrs[1]));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, ReorderRays)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // Grid of quads facing -x.
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeGrid(8u, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildMesh(context, mesh, options, &geometry_ptr);
+
+    // Incoherent rays: scattered origins and directions, some of them miss the grid or point away from it.
+    std::vector<RRRay> rays;
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        float a = float((i * 37) % 101) / 101.f;
+        float b = float((i * 53) % 97) / 97.f;
+        float c = float((i * 71) % 89) / 89.f;
+        rays.push_back({{4.f * c, 8.f * a - 4.f, 8.f * b - 4.f}, 0.f, {-1.f, b - 0.5f, 0.5f - a}, 100.f, ~0u});
+        if (i % 7 == 0)
+        {
+            rays.back().direction[0] = 1.f;
+        }
+    }
+
+    size_t scratch_trace_size = 0, scratch_reordered_size = 0;
+    CHECK_RR_CALL(rrGetTraceMemoryRequirements(context, (uint32_t)rays.size(), &scratch_trace_size));
+    CHECK_RR_CALL(rrGetReorderedTraceMemoryRequirements(context, (uint32_t)rays.size(), &scratch_reordered_size));
+    EXPECT_GE(scratch_reordered_size, scratch_trace_size);
+
+    auto reordered = [](RRIntersectQuery query) {
+        return RRIntersectQuery(query | RR_INTERSECT_QUERY_FLAG_BITS_REORDER_RAYS);
+    };
+
+    // Reordering does not change the hits nor their order, the second pair traces a smaller batch.
+    for (size_t ray_count : {rays.size(), rays.size() / 3})
+    {
+        std::vector<RRRay> batch(rays.begin(), rays.begin() + ray_count);
+        std::vector<RRHit> hits(ray_count), reordered_hits(ray_count);
+        Intersect(context, geometry_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, batch, hits);
+        Intersect(context,
+                  geometry_ptr,
+                  reordered(RR_INTERSECT_QUERY_CLOSEST),
+                  RR_INTERSECT_QUERY_OUTPUT_FULL_HIT,
+                  batch,
+                  reordered_hits);
+        for (size_t i = 0; i < ray_count; ++i)
+        {
+            EXPECT_EQ(reordered_hits[i].inst_id, hits[i].inst_id);
+            EXPECT_EQ(reordered_hits[i].prim_id, hits[i].prim_id);
+            EXPECT_EQ(reordered_hits[i].t, hits[i].t);
+        }
+    }
+
+    // Occlusion bits land in the original ray order as well.
+    std::vector<uint32_t> bits((rays.size() + 31) / 32), reordered_bits((rays.size() + 31) / 32);
+    Intersect(context, geometry_ptr, RR_INTERSECT_QUERY_ANY, RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT, rays, bits);
+    Intersect(context,
+              geometry_ptr,
+              reordered(RR_INTERSECT_QUERY_ANY),
+              RR_INTERSECT_QUERY_OUTPUT_OCCLUSION_BIT,
+              rays,
+              reordered_bits);
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        EXPECT_EQ((reordered_bits[i / 32] >> (i % 32)) & 1u, (bits[i / 32] >> (i % 32)) & 1u);
+    }
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, PersistentThreads)
+{
+    // Grid of quads facing -x.
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeGrid(8u, vertices, indices);
+
+    // More rays than the persistent groups cover in one pass, some of them miss the grid.
+    std::vector<RRRay> rays;
+    for (uint32_t i = 0; i < 100000; ++i)
+    {
+        float a = float((i * 37) % 101) / 101.f;
+        float b = float((i * 53) % 97) / 97.f;
+        rays.push_back({{0.f, 10.f * a - 5.f, 10.f * b - 5.f}, 0.f, {-1.f, 0.f, 0.f}, 100.f, ~0u});
+    }
+    uint32_t indirect_ray_count = (uint32_t)rays.size() / 3;
+
+    // Trace the rays directly and with an indirect count on a context created with the given flags.
+    auto trace = [&](RRContextFlags flags, bool indirect) {
+        RRContext context = nullptr;
+        EXPECT_EQ(rrCreateContextWithFlags(RR_API_VERSION, RR_API_VK, flags, &context), RR_SUCCESS);
+
+        Mesh mesh;
+        UploadMesh(context, vertices, indices, mesh);
+
+        RRBuildOptions options;
+        options.build_flags = 0u;
+
+        RRDevicePtr geometry_ptr = nullptr, ray_count_ptr = nullptr;
+        BuildMesh(context, mesh, options, &geometry_ptr);
+        Upload(context, &indirect_ray_count, sizeof(uint32_t), &ray_count_ptr);
+
+        std::vector<RRHit> hits(rays.size());
+        Intersect(context,
+                  geometry_ptr,
+                  RR_INTERSECT_QUERY_CLOSEST,
+                  RR_INTERSECT_QUERY_OUTPUT_FULL_HIT,
+                  rays,
+                  hits,
+                  indirect ? ray_count_ptr : nullptr);
+        hits.resize(indirect ? indirect_ray_count : rays.size());
+
+        EXPECT_EQ(rrReleaseDevicePtr(context, ray_count_ptr), RR_SUCCESS);
+        EXPECT_EQ(rrReleaseDevicePtr(context, geometry_ptr), RR_SUCCESS);
+        ReleaseMesh(context, mesh);
+        EXPECT_EQ(rrDestroyContext(context), RR_SUCCESS);
+        return hits;
+    };
+
+    // Persistent threads find the same hits as one thread per ray.
+    for (bool indirect : {false, true})
+    {
+        auto hits            = trace(RR_CONTEXT_FLAG_BITS_NONE, indirect);
+        auto persistent_hits = trace(RR_CONTEXT_FLAG_BITS_PERSISTENT_THREADS, indirect);
+        ASSERT_EQ(persistent_hits.size(), hits.size());
+        for (size_t i = 0; i < hits.size(); ++i)
+        {
+            EXPECT_EQ(persistent_hits[i].inst_id, hits[i].inst_id);
+            EXPECT_EQ(persistent_hits[i].prim_id, hits[i].prim_id);
+            EXPECT_EQ(persistent_hits[i].t, hits[i].t);
+        }
+    }
+}
+
+TEST_F(InternalResourcesTest, IndirectRayCount)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // Single quad facing -x.
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeQuad(4.f, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildMesh(context, mesh, options, &geometry_ptr);
+
+    // All rays hit the quad.
+    std::vector<RRRay> rays(1000, {{0.f, 0.f, 0.f}, 0.f, {-1.f, 0.f, 0.f}, 100.f, ~0u});
+
+    // Only the first min(count, ray_count) hits are written, counts past the ray buffer are clamped.
+    for (uint32_t count : {0u, 1u, 129u, 1000u, 5000u})
+    {
+        RRDevicePtr ray_count_ptr = nullptr;
+        Upload(context, &count, sizeof(uint32_t), &ray_count_ptr);
+
+        std::vector<RRHit> hits(rays.size());
+        std::memset(hits.data(), 0xff, hits.size() * sizeof(RRHit));
+        Intersect(context,
+                  geometry_ptr,
+                  RR_INTERSECT_QUERY_CLOSEST,
+                  RR_INTERSECT_QUERY_OUTPUT_FULL_HIT,
+                  rays,
+                  hits,
+                  ray_count_ptr);
+        CHECK_RR_CALL(rrReleaseDevicePtr(context, ray_count_ptr));
+
+        for (size_t i = 0; i < hits.size(); ++i)
+        {
+            if (i < count)
+            {
+                EXPECT_NE(hits[i].prim_id, ~0u);
+                EXPECT_NEAR(hits[i].t, 5.f, 1e-4f);
+            } else
+            {
+                EXPECT_EQ(hits[i].prim_id, ~0u);
+            }
+        }
+    }
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, TraceStackSize)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // Grid of quads facing -x.
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeGrid(8u, vertices, indices);
+
+    Mesh mesh;
+    UploadMesh(context, vertices, indices, mesh);
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRDevicePtr geometry_ptr = nullptr;
+    BuildMesh(context, mesh, options, &geometry_ptr);
+
+    std::vector<RRRay> rays;
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        float a = float((i * 37) % 101) / 101.f;
+        float b = float((i * 53) % 97) / 97.f;
+        rays.push_back({{0.f, 10.f * a - 5.f, 10.f * b - 5.f}, 0.f, {-1.f, b - 0.5f, 0.5f - a}, 100.f, ~0u});
+    }
+
+    // Traces size their scratch buffer for the current stack size.
+    size_t default_scratch_size = 0, small_scratch_size = 0;
+    CHECK_RR_CALL(rrGetTraceMemoryRequirements(context, (uint32_t)rays.size(), &default_scratch_size));
+    std::vector<RRHit> hits(rays.size());
+    Intersect(context, geometry_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, hits);
+
+    // A shallow tree fits a smaller stack, 20 entries are rounded up to 32.
+    EXPECT_EQ(rrSetTraceStackSize(context, 0u), RR_ERROR_INVALID_PARAMETER);
+    CHECK_RR_CALL(rrSetTraceStackSize(context, 20u));
+    CHECK_RR_CALL(rrGetTraceMemoryRequirements(context, (uint32_t)rays.size(), &small_scratch_size));
+    EXPECT_EQ(small_scratch_size * 2, default_scratch_size);
+
+    std::vector<RRHit> small_stack_hits(rays.size());
+    Intersect(
+        context, geometry_ptr, RR_INTERSECT_QUERY_CLOSEST, RR_INTERSECT_QUERY_OUTPUT_FULL_HIT, rays, small_stack_hits);
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        EXPECT_EQ(small_stack_hits[i].prim_id, hits[i].prim_id);
+        EXPECT_EQ(small_stack_hits[i].t, hits[i].t);
+    }
+
+    uint32_t overflow_count = ~0u;
+    CHECK_RR_CALL(rrGetTraceStackOverflowCount(context, &overflow_count));
+    EXPECT_EQ(overflow_count, 0u);
+
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, AsyncComputeBuild)
+{
+    RRContext context = nullptr;
+    CHECK_RR_CALL(rrCreateContext(RR_API_VERSION, RR_API_VK, &context));
+
+    // Grid of quads facing -x.
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeGrid(8u, vertices, indices);
+
+    // Rays inside the grid, all of them hit it at t = 5.
+    std::vector<RRRay> rays;
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        float a = float((i * 37) % 101) / 101.f;
+        float b = float((i * 53) % 97) / 97.f;
+        rays.push_back({{0.f, 7.f * a - 3.5f, 7.f * b - 3.5f}, 0.f, {-1.f, 0.f, 0.f}, 100.f, ~0u});
+    }
+
+    Mesh        mesh;
+    RRDevicePtr rays_ptr = nullptr;
+    UploadMesh(context, vertices, indices, mesh);
+    Upload(context, rays, &rays_ptr);
+
+    RRGeometryBuildInput geometry_build_input     = {};
+    geometry_build_input.primitive_type           = RR_PRIMITIVE_TYPE_TRIANGLE_MESH;
+    geometry_build_input.primitive_count          = 1u;
+    geometry_build_input.triangle_mesh_primitives = &mesh.primitive;
+
+    RRBuildOptions options;
+    options.build_flags = 0u;
+
+    RRMemoryRequirements geometry_reqs;
+    CHECK_RR_CALL(rrGetGeometryBuildMemoryRequirements(context, &geometry_build_input, &options, &geometry_reqs));
+
+    size_t scratch_trace_size = 0;
+    CHECK_RR_CALL(rrGetTraceMemoryRequirements(context, (uint32_t)rays.size(), &scratch_trace_size));
+
+    RRDevicePtr scratch_ptr = nullptr, geometry_ptr = nullptr, hits_ptr = nullptr, scratch_trace_ptr = nullptr;
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, geometry_reqs.temporary_build_buffer_size, &scratch_ptr));
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, geometry_reqs.result_buffer_size, &geometry_ptr));
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, rays.size() * sizeof(RRHit), &hits_ptr));
+    CHECK_RR_CALL(rrAllocateDeviceBuffer(context, scratch_trace_size, &scratch_trace_ptr));
+
+    // Build on the async compute queue.
+    RRCommandStream build_stream = nullptr;
+    RREvent         build_event  = nullptr;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &build_stream));
+    CHECK_RR_CALL(rrCmdBuildGeometry(
+        context, RR_BUILD_OPERATION_BUILD, &geometry_build_input, &options, scratch_ptr, geometry_ptr, build_stream));
+    CHECK_RR_CALL(rrSubmitCommandStreamAsync(context, build_stream, nullptr, &build_event));
+
+    // Trace on the main queue, waiting for the build on the GPU.
+    RRCommandStream trace_stream = nullptr;
+    RREvent         trace_event  = nullptr;
+    CHECK_RR_CALL(rrAllocateCommandStream(context, &trace_stream));
+    CHECK_RR_CALL(rrCmdIntersect(context,
+                                 geometry_ptr,
+                                 RR_INTERSECT_QUERY_CLOSEST,
+                                 rays_ptr,
+                                 (uint32_t)rays.size(),
+                                 nullptr,
+                                 RR_INTERSECT_QUERY_OUTPUT_FULL_HIT,
+                                 hits_ptr,
+                                 scratch_trace_ptr,
+                                 trace_stream));
+    CHECK_RR_CALL(rrSumbitCommandStream(context, trace_stream, build_event, &trace_event));
+    CHECK_RR_CALL(rrWaitEvent(context, trace_event));
+
+    std::vector<RRHit> hits(rays.size());
+    Download(context, hits_ptr, hits);
+    for (auto const& hit : hits)
+    {
+        EXPECT_NE(hit.prim_id, ~0u);
+        EXPECT_NEAR(hit.t, 5.f, 1e-4f);
+    }
+
+    CHECK_RR_CALL(rrReleaseEvent(context, trace_event));
+    CHECK_RR_CALL(rrReleaseEvent(context, build_event));
+    CHECK_RR_CALL(rrReleaseCommandStream(context, trace_stream));
+    CHECK_RR_CALL(rrReleaseCommandStream(context, build_stream));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scratch_trace_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, hits_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, rays_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, scratch_ptr));
+    CHECK_RR_CALL(rrReleaseDevicePtr(context, geometry_ptr));
+    ReleaseMesh(context, mesh);
+    CHECK_RR_CALL(rrDestroyContext(context));
+}
+
+TEST_F(InternalResourcesTest, ProfilingResults)
+{
+    // Grid of quads facing -x.
+    std::vector<float>    vertices;
+    std::vector<uint32_t> indices;
+    MakeGrid(8u, vertices, indices);
+
+    // Build the grid on a context created with the given flags and report kernel durations of the build.
+    auto profile_build = [&](RRContextFlags flags) {
+        RRContext context = nullptr;
+        EXPECT_EQ(rrCreateContextWithFlags(RR_API_VERSION, RR_API_VK, flags, &context), RR_SUCCESS);
+
+        Mesh mesh;
+        UploadMesh(context, vertices, indices, mesh);
+
+        RRGeometryBuildInput geometry_build_input     = {};
+        geometry_build_input.primitive_type           = RR_PRIMITIVE_TYPE_TRIANGLE_MESH;
+        geometry_build_input.primitive_count          = 1u;
+        geometry_build_input.triangle_mesh_primitives = &mesh.primitive;
+
+        RRBuildOptions options;
+        options.build_flags = 0u;
+
+        RRMemoryRequirements geometry_reqs;
+        EXPECT_EQ(rrGetGeometryBuildMemoryRequirements(context, &geometry_build_input, &options, &geometry_reqs),
+                  RR_SUCCESS);
+
+        RRDevicePtr scratch_ptr  = nullptr;
+        RRDevicePtr geometry_ptr = nullptr;
+        EXPECT_EQ(rrAllocateDeviceBuffer(context, geometry_reqs.temporary_build_buffer_size, &scratch_ptr),
+                  RR_SUCCESS);
+        EXPECT_EQ(rrAllocateDeviceBuffer(context, geometry_reqs.result_buffer_size, &geometry_ptr), RR_SUCCESS);
+
+        // The event is kept alive to query the results of this submission.
+        RRCommandStream command_stream = nullptr;
+        RREvent         event          = nullptr;
+        EXPECT_EQ(rrAllocateCommandStream(context, &command_stream), RR_SUCCESS);
+        EXPECT_EQ(rrCmdBuildGeometry(context,
+                                     RR_BUILD_OPERATION_BUILD,
+                                     &geometry_build_input,
+                                     &options,
+                                     scratch_ptr,
+                                     geometry_ptr,
+                                     command_stream),
+                  RR_SUCCESS);
+        EXPECT_EQ(rrSumbitCommandStream(context, command_stream, nullptr, &event), RR_SUCCESS);
+
+        uint32_t result_count = 0u;
+        EXPECT_EQ(rrGetProfilingResults(context, event, &result_count, nullptr), RR_SUCCESS);
+        std::vector<RRProfilingResult> results(result_count);
+        EXPECT_EQ(rrGetProfilingResults(context, event, &result_count, results.data()), RR_SUCCESS);
+        EXPECT_EQ(result_count, (uint32_t)results.size());
+
+        EXPECT_EQ(rrReleaseEvent(context, event), RR_SUCCESS);
+        EXPECT_EQ(rrReleaseCommandStream(context, command_stream), RR_SUCCESS);
+        EXPECT_EQ(rrReleaseDevicePtr(context, scratch_ptr), RR_SUCCESS);
+        EXPECT_EQ(rrReleaseDevicePtr(context, geometry_ptr), RR_SUCCESS);
+        ReleaseMesh(context, mesh);
+        EXPECT_EQ(rrDestroyContext(context), RR_SUCCESS);
+        return results;
+    };
+
+    EXPECT_TRUE(profile_build(RR_CONTEXT_FLAG_BITS_NONE).empty());
+
+    // Every build phase is reported once per kernel, sort passes are accumulated. Kernels may have vendor suffixes.
+    auto results = profile_build(RR_CONTEXT_FLAG_BITS_PROFILING);
+    for (auto kernel : {"lbvh_calc_morton_codes_mesh", "radix_sort_scatter", "lbvh_emit_hierarchy_mesh"})
+    {
+        auto result = std::find_if(results.begin(), results.end(), [kernel](RRProfilingResult const& result) {
+            return std::strncmp(result.name, kernel, std::strlen(kernel)) == 0;
+        });
+        ASSERT_NE(result, results.end()) << kernel;
+        EXPECT_GT(result->dispatch_count, 0u);
+        EXPECT_GE(result->duration_ms, 0.f);
+    }
+}
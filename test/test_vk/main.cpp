@@ -2,6 +2,7 @@
 #include "basic_test.h"
 #include "internal_resources_test.h"
 #include "hlbvh_test.h"
+#include "pool_test.h"
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 #include "gtest/gtest.h"
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "utils/pool.h"
+
+namespace
+{
+constexpr size_t kPoolSizeClassCount = 3u;
+
+struct PooledObject
+{
+    size_t size_class;
+    //<! Set while the object is handed out.
+    std::atomic<bool> acquired{false};
+};
+
+//<! Counts created and destroyed objects, the counters outlive the pool.
+struct CountingPoolPolicy
+{
+    PooledObject* Create(size_t size_class)
+    {
+        created->fetch_add(1u, std::memory_order_relaxed);
+        auto obj        = new PooledObject;
+        obj->size_class = size_class;
+        return obj;
+    }
+    void Destroy(PooledObject* obj)
+    {
+        destroyed->fetch_add(1u, std::memory_order_relaxed);
+        delete obj;
+    }
+
+    std::atomic<uint32_t>* created   = nullptr;
+    std::atomic<uint32_t>* destroyed = nullptr;
+};
+}  // namespace
+
+TEST(PoolTest, ConcurrentAcquireRelease)
+{
+    constexpr uint32_t kThreadCount    = 8u;
+    constexpr uint32_t kIterationCount = 20000u;
+    constexpr uint32_t kMaxHeldObjects = 4u;
+
+    std::atomic<uint32_t> created{0u}, destroyed{0u};
+    std::atomic<uint32_t> errors{0u};
+    {
+        rt::Pool<PooledObject, CountingPoolPolicy, kPoolSizeClassCount> pool(
+            CountingPoolPolicy{&created, &destroyed});
+
+        // Every thread holds a few objects of one size class at a time. An object handed out twice or taken from
+        // another size class is an error.
+        auto worker = [&](uint32_t thread_index) {
+            std::vector<PooledObject*> held;
+            for (auto i = 0u; i < kIterationCount; ++i)
+            {
+                auto size_class = (thread_index + i) % kPoolSizeClassCount;
+                auto count      = 1u + (thread_index * 7u + i) % kMaxHeldObjects;
+                for (auto j = 0u; j < count; ++j)
+                {
+                    auto obj = pool.AcquireObject(size_class);
+                    if (obj->acquired.exchange(true, std::memory_order_acq_rel) || obj->size_class != size_class)
+                    {
+                        errors.fetch_add(1u, std::memory_order_relaxed);
+                    }
+                    held.push_back(obj);
+                }
+                for (auto obj : held)
+                {
+                    obj->acquired.store(false, std::memory_order_release);
+                    pool.ReleaseObject(obj, size_class);
+                }
+                held.clear();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (auto i = 0u; i < kThreadCount; ++i)
+        {
+            threads.emplace_back(worker, i);
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+        EXPECT_EQ(errors.load(), 0u);
+        // Objects are only created when a size class runs dry, so at most every thread holds its maximum at once.
+        EXPECT_LE(created.load(), kThreadCount * kMaxHeldObjects * kPoolSizeClassCount);
+
+        // All objects are back in the pool: draining it yields each of them once, in the size class it was
+        // released to, until a size class runs dry and a new object is created.
+        auto                                          pooled_count = created.load();
+        std::set<PooledObject*>                       drained;
+        std::vector<std::pair<PooledObject*, size_t>> acquired;
+        for (size_t size_class = 0; size_class < kPoolSizeClassCount; ++size_class)
+        {
+            for (auto created_count = created.load();; created_count = created.load())
+            {
+                auto obj = pool.AcquireObject(size_class);
+                acquired.emplace_back(obj, size_class);
+                if (created.load() != created_count)
+                {
+                    break;
+                }
+                EXPECT_EQ(obj->size_class, size_class);
+                EXPECT_TRUE(drained.insert(obj).second);
+            }
+        }
+        EXPECT_EQ(drained.size(), pooled_count);
+        for (auto& [obj, size_class] : acquired)
+        {
+            pool.ReleaseObject(obj, size_class);
+        }
+    }
+    EXPECT_EQ(destroyed.load(), created.load());
+}